@@ -0,0 +1,541 @@
+#include "allocator.h"
+
+#include "headers/errors.h"        /* fwarn_ret */
+#include "headers/stdc_versions.h" /* STANDARD_C11_VERSION */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#if defined( __STDC_VERSION__ ) && __STDC_VERSION__ >= STANDARD_C11_VERSION
+#define ALLOCATOR_THREAD_LOCAL _Thread_local
+#else
+#define ALLOCATOR_THREAD_LOCAL __thread
+#endif
+
+
+/** Rounds `size` up to a multiple of `ALLOCATOR_ALIGNMENT` */
+#define allocator_align( SIZE ) \
+    ( ( ( SIZE ) + ALLOCATOR_ALIGNMENT - 1 ) & ~( size_t ) ( ALLOCATOR_ALIGNMENT - 1 ) )
+
+
+/* -------- DEFAULT -------- */
+
+Private void *default_alloc( void *ctx, const size_t size )
+{
+    ( void ) ctx;
+    return malloc( size );
+}
+
+Private void *default_resize( void *ctx,
+                              void *ptr,
+                              const size_t old_size,
+                              const size_t new_size )
+{
+    ( void ) ctx;
+    ( void ) old_size;
+    return realloc( ptr, new_size );
+}
+
+Private void default_free( void *ctx, void *ptr, const size_t size )
+{
+    ( void ) ctx;
+    ( void ) size;
+    free( ptr );
+}
+
+Private const Allocator default_allocator = {
+    .alloc  = default_alloc,
+    .resize = default_resize,
+    .free   = default_free,
+    .ctx    = NULL,
+};
+
+const Allocator *allocator_default( void )
+{
+    return &default_allocator;
+}
+
+
+void *allocator_alloc( const Allocator *allocator, const size_t size )
+{
+    if ( allocator == NULL )
+        allocator = &default_allocator;
+    return allocator->alloc( allocator->ctx, size );
+}
+
+void *allocator_calloc( const Allocator *allocator,
+                        const size_t nmemb,
+                        const size_t size )
+{
+    if ( size != 0 && nmemb > SIZE_MAX / size )
+        return fwarnx_ret( NULL, "%zu * %zu bytes overflows", nmemb, size );
+
+    void *ptr = allocator_alloc( allocator, nmemb * size );
+    if ( ptr != NULL )
+        memset( ptr, 0, nmemb * size );
+    return ptr;
+}
+
+void *allocator_resize( const Allocator *allocator,
+                        void *ptr,
+                        const size_t old_size,
+                        const size_t new_size )
+{
+    if ( allocator == NULL )
+        allocator = &default_allocator;
+    if ( ptr == NULL )
+        return allocator->alloc( allocator->ctx, new_size );
+    return allocator->resize( allocator->ctx, ptr, old_size, new_size );
+}
+
+void allocator_free( const Allocator *allocator, void *ptr, const size_t size )
+{
+    if ( ptr == NULL )
+        return;
+    if ( allocator == NULL )
+        allocator = &default_allocator;
+    allocator->free( allocator->ctx, ptr, size );
+}
+
+
+/* -------- ARENA -------- */
+
+#define ARENA_DEFAULT_BLOCK_SIZE ( 64 * 1024 )
+
+struct arena_block {
+    struct arena_block *next;
+    size_t size; // usable bytes after the (aligned) header
+};
+
+#define ARENA_HEADER_SIZE allocator_align( sizeof( struct arena_block ) )
+
+#define arena_block_data( BLOCK ) ( ( byte * ) ( BLOCK ) + ARENA_HEADER_SIZE )
+
+struct arena {
+    Allocator allocator;
+
+    struct arena_block *first;
+    struct arena_block *current; // `NULL` only before the first allocation
+    size_t offset;               // first free byte of `current`
+
+    size_t block_size;
+    size_t used;
+
+    void *last; // the last allocation, which may still be freed or grown in place
+};
+
+
+Private void *arena_alloc_ctx( void *ctx, const size_t size )
+{
+    return arena_alloc( ctx, size );
+}
+
+Private void arena_free_ctx( void *ctx, void *ptr, const size_t size )
+{
+    struct arena *arena = ctx;
+    if ( ptr == NULL || ptr != arena->last )
+        return;
+
+    // only the last allocation can be handed back
+    arena->offset = ( size_t ) ( ( byte * ) ptr - arena_block_data( arena->current ) );
+    arena->used -= allocator_align( size );
+    arena->last = NULL;
+}
+
+Private void *arena_resize_ctx( void *ctx,
+                                void *ptr,
+                                const size_t old_size,
+                                const size_t new_size )
+{
+    struct arena *arena = ctx;
+
+    if ( ptr == arena->last && ptr != NULL )
+    {
+        const size_t start =
+                ( size_t ) ( ( byte * ) ptr - arena_block_data( arena->current ) );
+        if ( start + allocator_align( new_size ) <= arena->current->size )
+        {
+            arena->offset = start + allocator_align( new_size );
+            arena->used   = arena->used - allocator_align( old_size )
+                          + allocator_align( new_size );
+            return ptr;
+        }
+    }
+
+    void *new = arena_alloc( arena, new_size );
+    if ( new == NULL )
+        return f_stack_trace( NULL );
+
+    memcpy( new, ptr, old_size < new_size ? old_size : new_size );
+    return new;
+}
+
+
+Arena *arena_init( const size_t block_size )
+{
+    struct arena *arena = calloc( 1, sizeof( struct arena ) );
+    if ( arena == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    arena->block_size = block_size != 0 ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->allocator  = ( Allocator ) {
+         .alloc  = arena_alloc_ctx,
+         .resize = arena_resize_ctx,
+         .free   = arena_free_ctx,
+         .ctx    = arena,
+    };
+
+    return arena;
+}
+
+/**
+ * Moves `current` to the next kept block with at least `size` free bytes,
+ * allocating a new one if there is none.
+ */
+Private int arena_next_block( struct arena *arena, const size_t size )
+{
+    struct arena_block *block =
+            arena->current != NULL ? arena->current->next : arena->first;
+    while ( block != NULL && block->size < size )
+        block = block->next;
+
+    if ( block == NULL )
+    {
+        const size_t block_size = size > arena->block_size ? size : arena->block_size;
+        if ( ( block = malloc( ARENA_HEADER_SIZE + block_size ) ) == NULL )
+            return fwarn_ret( RV_ERROR, "malloc" );
+
+        block->size = block_size;
+        if ( arena->current != NULL )
+        {
+            block->next           = arena->current->next;
+            arena->current->next = block;
+        }
+        else
+        {
+            block->next  = arena->first;
+            arena->first = block;
+        }
+    }
+
+    arena->current = block;
+    arena->offset  = 0;
+    return RV_SUCCESS;
+}
+
+void *arena_alloc( Arena *arena, const size_t size )
+{
+    const size_t aligned = allocator_align( size );
+
+    if ( arena->current == NULL || arena->offset + aligned > arena->current->size )
+        if ( arena_next_block( arena, aligned ) != RV_SUCCESS )
+            return f_stack_trace( NULL );
+
+    void *ptr = arena_block_data( arena->current ) + arena->offset;
+    arena->offset += aligned;
+    arena->used += aligned;
+    arena->last = ptr;
+
+    return ptr;
+}
+
+void arena_reset( Arena *arena )
+{
+    arena->current = arena->first;
+    arena->offset  = 0;
+    arena->used    = 0;
+    arena->last    = NULL;
+}
+
+size_t arena_used( const Arena *arena )
+{
+    return arena->used;
+}
+
+void arena_destroy( Arena *arena )
+{
+    struct arena_block *block = arena->first;
+    while ( block != NULL )
+    {
+        struct arena_block *next = block->next;
+        free( block );
+        block = next;
+    }
+    free( arena );
+}
+
+const Allocator *arena_allocator( Arena *arena )
+{
+    return &arena->allocator;
+}
+
+
+/* -------- SLAB POOL -------- */
+
+#define SLAB_DEFAULT_OBJS 64
+
+struct slab {
+    struct slab *next;
+};
+
+#define SLAB_HEADER_SIZE allocator_align( sizeof( struct slab ) )
+
+/** A free object; the free list is threaded through the objects themselves */
+struct slab_free_obj {
+    struct slab_free_obj *next;
+};
+
+struct slab_pool {
+    Allocator allocator;
+
+    size_t requested_size; // largest block the pool serves
+    size_t obj_size;       // `requested_size` rounded up to the alignment
+    size_t objs_per_slab;
+
+    struct slab *slabs;
+    struct slab_free_obj *free_list;
+};
+
+
+Private void *slab_alloc_ctx( void *ctx, const size_t size )
+{
+    struct slab_pool *pool = ctx;
+    return size <= pool->requested_size ? slab_alloc( pool ) : malloc( size );
+}
+
+Private void slab_free_ctx( void *ctx, void *ptr, const size_t size )
+{
+    struct slab_pool *pool = ctx;
+    if ( size <= pool->requested_size )
+        slab_free( pool, ptr );
+    else
+        free( ptr );
+}
+
+Private void *slab_resize_ctx( void *ctx,
+                               void *ptr,
+                               const size_t old_size,
+                               const size_t new_size )
+{
+    struct slab_pool *pool = ctx;
+
+    const bool old_pooled = old_size <= pool->requested_size;
+    const bool new_pooled = new_size <= pool->requested_size;
+    if ( old_pooled && new_pooled )
+        return ptr;
+    if ( !old_pooled && !new_pooled )
+        return realloc( ptr, new_size );
+
+    void *new = slab_alloc_ctx( pool, new_size );
+    if ( new == NULL )
+        return NULL;
+
+    memcpy( new, ptr, old_size < new_size ? old_size : new_size );
+    slab_free_ctx( pool, ptr, old_size );
+    return new;
+}
+
+
+SlabPool *slab_init( const size_t obj_size, const size_t objs_per_slab )
+{
+    struct slab_pool *pool = calloc( 1, sizeof( struct slab_pool ) );
+    if ( pool == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    pool->requested_size = obj_size;
+    pool->obj_size       = allocator_align( obj_size > sizeof( struct slab_free_obj )
+                                                    ? obj_size
+                                                    : sizeof( struct slab_free_obj ) );
+    pool->objs_per_slab  = objs_per_slab != 0 ? objs_per_slab : SLAB_DEFAULT_OBJS;
+    pool->allocator      = ( Allocator ) {
+             .alloc  = slab_alloc_ctx,
+             .resize = slab_resize_ctx,
+             .free   = slab_free_ctx,
+             .ctx    = pool,
+    };
+
+    return pool;
+}
+
+/** Allocates a new slab and puts all of its objects on the free list */
+Private int slab_grow( struct slab_pool *pool )
+{
+    struct slab *slab = malloc( SLAB_HEADER_SIZE + pool->objs_per_slab * pool->obj_size );
+    if ( slab == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    slab->next  = pool->slabs;
+    pool->slabs = slab;
+
+    byte *objs = ( byte * ) slab + SLAB_HEADER_SIZE;
+    for ( size_t i = pool->objs_per_slab; i-- > 0; )
+    {
+        struct slab_free_obj *obj =
+                ( struct slab_free_obj * ) ( objs + i * pool->obj_size );
+        obj->next                 = pool->free_list;
+        pool->free_list           = obj;
+    }
+
+    return RV_SUCCESS;
+}
+
+void *slab_alloc( SlabPool *pool )
+{
+    if ( pool->free_list == NULL && slab_grow( pool ) != RV_SUCCESS )
+        return f_stack_trace( NULL );
+
+    struct slab_free_obj *obj = pool->free_list;
+    pool->free_list           = obj->next;
+    return obj;
+}
+
+void slab_free( SlabPool *pool, void *ptr )
+{
+    if ( ptr == NULL )
+        return;
+
+    struct slab_free_obj *obj = ptr;
+    obj->next                 = pool->free_list;
+    pool->free_list           = obj;
+}
+
+void slab_destroy( SlabPool *pool )
+{
+    struct slab *slab = pool->slabs;
+    while ( slab != NULL )
+    {
+        struct slab *next = slab->next;
+        free( slab );
+        slab = next;
+    }
+    free( pool );
+}
+
+const Allocator *slab_allocator( SlabPool *pool )
+{
+    return &pool->allocator;
+}
+
+
+/* -------- THREAD-LOCAL CACHE -------- */
+
+/** Size classes are 16, 32, ..., `TCACHE_MAX_SIZE` bytes */
+#define TCACHE_MIN_SIZE  16
+#define TCACHE_N_CLASSES 7
+/** Blocks kept per size class (and thread) */
+#define TCACHE_MAX_CACHED 64
+
+struct tcache_block {
+    struct tcache_block *next;
+};
+
+struct tcache {
+    struct tcache_block *heads[ TCACHE_N_CLASSES ];
+    unsigned counts[ TCACHE_N_CLASSES ];
+};
+
+Private ALLOCATOR_THREAD_LOCAL struct tcache tcache;
+
+
+Private inline size_t tcache_class( const size_t size )
+{
+    size_t cls        = 0;
+    size_t class_size = TCACHE_MIN_SIZE;
+    while ( class_size < size )
+    {
+        class_size *= 2;
+        ++cls;
+    }
+    return cls;
+}
+
+#define tcache_class_size( CLS ) ( ( size_t ) TCACHE_MIN_SIZE << ( CLS ) )
+
+
+Private void *tcache_alloc( void *ctx, const size_t size )
+{
+    ( void ) ctx;
+    if ( size > TCACHE_MAX_SIZE )
+        return malloc( size );
+
+    const size_t cls           = tcache_class( size );
+    struct tcache_block *block = tcache.heads[ cls ];
+    if ( block == NULL )
+        return malloc( tcache_class_size( cls ) );
+
+    tcache.heads[ cls ] = block->next;
+    --tcache.counts[ cls ];
+    return block;
+}
+
+Private void tcache_free( void *ctx, void *ptr, const size_t size )
+{
+    ( void ) ctx;
+    if ( size > TCACHE_MAX_SIZE )
+    {
+        free( ptr );
+        return;
+    }
+
+    const size_t cls = tcache_class( size );
+    if ( tcache.counts[ cls ] >= TCACHE_MAX_CACHED )
+    {
+        free( ptr );
+        return;
+    }
+
+    struct tcache_block *block = ptr;
+    block->next                = tcache.heads[ cls ];
+    tcache.heads[ cls ]        = block;
+    ++tcache.counts[ cls ];
+}
+
+Private void *tcache_resize( void *ctx,
+                             void *ptr,
+                             const size_t old_size,
+                             const size_t new_size )
+{
+    if ( old_size > TCACHE_MAX_SIZE && new_size > TCACHE_MAX_SIZE )
+        return realloc( ptr, new_size );
+    if ( old_size <= TCACHE_MAX_SIZE && new_size <= TCACHE_MAX_SIZE
+         && tcache_class( old_size ) == tcache_class( new_size ) )
+        return ptr;
+
+    void *new = tcache_alloc( ctx, new_size );
+    if ( new == NULL )
+        return NULL;
+
+    memcpy( new, ptr, old_size < new_size ? old_size : new_size );
+    tcache_free( ctx, ptr, old_size );
+    return new;
+}
+
+Private const Allocator tcache_allocator_instance = {
+    .alloc  = tcache_alloc,
+    .resize = tcache_resize,
+    .free   = tcache_free,
+    .ctx    = NULL,
+};
+
+const Allocator *tcache_allocator( void )
+{
+    return &tcache_allocator_instance;
+}
+
+void tcache_flush( void )
+{
+    for ( size_t cls = 0; cls < TCACHE_N_CLASSES; ++cls )
+    {
+        struct tcache_block *block = tcache.heads[ cls ];
+        while ( block != NULL )
+        {
+            struct tcache_block *next = block->next;
+            free( block );
+            block = next;
+        }
+        tcache.heads[ cls ]  = NULL;
+        tcache.counts[ cls ] = 0;
+    }
+}
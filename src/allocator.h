@@ -0,0 +1,155 @@
+/**
+ * @file allocator.h
+ * @brief
+ * Allocators used by the containers (see the `*_init_with_allocator()` functions).
+ *
+ * An `Allocator` is a table of functions (plus their context) through which
+ * a container does all of its internal (de)allocations. Memory handed over
+ * to the user (e.g. by `list_items_copy()`) always comes from `malloc()`.
+ *
+ * Provided allocators:
+ *  - `allocator_default()`: `malloc()`, `realloc()` and `free()`
+ *  - `Arena`: bump allocator; nothing is freed until `arena_reset()`,
+ *    which frees everything allocated from the arena at once, in O(1).
+ *    Containers allocated from an arena may be "destroyed" just by resetting it,
+ *    without calling their `*_destroy()` function.
+ *  - `SlabPool`: free lists of fixed-size objects, carved out of large slabs
+ *  - `tcache_allocator()`: thread-local caches of recently freed blocks
+ *    in front of `malloc()`
+ *
+ * Allocators aren't thread-safe (except for `allocator_default()`
+ * and `tcache_allocator()`) and must outlive all containers using them.
+ */
+
+#ifndef CLIBS_ALLOCATOR_H
+#define CLIBS_ALLOCATOR_H
+
+#include "headers/attributes.h"
+#include "headers/types.h"
+
+
+/**
+ * `free` and `resize` get the size of the block
+ * (as passed to `alloc` or the last `resize`),
+ * so that the allocators don't need to store it.
+ */
+typedef struct allocator {
+    void *( *alloc )( void *ctx, size_t size );
+    void *( *resize )( void *ctx, void *ptr, size_t old_size, size_t new_size );
+    void ( *free )( void *ctx, void *ptr, size_t size );
+
+    void *ctx;
+} Allocator;
+
+
+/** All allocations are aligned to this many bytes */
+#define ALLOCATOR_ALIGNMENT 16
+
+
+/** @return allocator using `malloc()`, `realloc()` and `free()` */
+const Allocator *allocator_default( void );
+
+/**
+ * @param allocator may be `NULL` for `allocator_default()`
+ * @return pointer to `size` bytes or `NULL` on failure
+ */
+void *allocator_alloc( const Allocator *allocator, size_t size );
+/**
+ * Like `calloc()`
+ *
+ * @return pointer to `nmemb * size` zeroed bytes or `NULL` on failure (or overflow)
+ */
+void *allocator_calloc( const Allocator *allocator, size_t nmemb, size_t size );
+/**
+ * Like `realloc()`; the contents up to the smaller of the sizes are kept.
+ *
+ * @return the new pointer or `NULL` on failure, in which case `ptr` is left intact
+ */
+void *allocator_resize( const Allocator *allocator,
+                        void *ptr,
+                        size_t old_size,
+                        size_t new_size );
+/** Frees `ptr` (of `size` bytes); `NULL` is ignored */
+void allocator_free( const Allocator *allocator, void *ptr, size_t size );
+
+
+/* -------- ARENA -------- */
+
+typedef struct arena Arena;
+
+/**
+ * @param block_size size of the blocks allocated from `malloc()`;
+ *                   0 for the default (64 KiB)
+ */
+Constructor Arena *arena_init( size_t block_size );
+/**
+ * @return pointer to `size` bytes (aligned to `ALLOCATOR_ALIGNMENT`)
+ * or `NULL` if `malloc()` failed
+ */
+void *arena_alloc( Arena *, size_t size );
+/**
+ * Frees all allocations made from the arena at once.
+ *
+ * Its blocks are kept and reused by the following allocations.
+ */
+void arena_reset( Arena * );
+/** @return number of bytes allocated from the arena since the last reset */
+size_t arena_used( const Arena * );
+/** Frees the arena and all memory allocated from it. */
+void arena_destroy( Arena * );
+/**
+ * `free` only reclaims the last allocation, `resize` grows the last allocation
+ * in place (other allocations are copied).
+ *
+ * @return allocator allocating from the arena, valid until it is destroyed
+ */
+const Allocator *arena_allocator( Arena * );
+
+
+/* -------- SLAB POOL -------- */
+
+typedef struct slab_pool SlabPool;
+
+/**
+ * @param obj_size      size of the pooled objects
+ * @param objs_per_slab number of objects allocated at once; 0 for the default (64)
+ */
+Constructor SlabPool *slab_init( size_t obj_size, size_t objs_per_slab );
+/** @return pointer to a block of the pool's `obj_size` or `NULL` on failure */
+void *slab_alloc( SlabPool * );
+/** Returns `ptr` (from `slab_alloc()`) to the pool */
+void slab_free( SlabPool *, void *ptr );
+/** Frees the pool and all of its objects. */
+void slab_destroy( SlabPool * );
+/**
+ * Blocks of at most `obj_size` bytes come from the pool,
+ * larger ones from `malloc()`.
+ *
+ * @return allocator allocating from the pool, valid until it is destroyed
+ */
+const Allocator *slab_allocator( SlabPool * );
+
+
+/* -------- THREAD-LOCAL CACHE -------- */
+
+/** Largest block (in bytes) kept in the thread-local caches */
+#define TCACHE_MAX_SIZE 1024
+
+/**
+ * Freed blocks of up to `TCACHE_MAX_SIZE` bytes are kept in per-thread
+ * free lists (by power-of-two size class) and reused by the following
+ * allocations of the same thread. Larger blocks go straight to `malloc()`.
+ *
+ * Blocks may be freed by another thread than the one which allocated them.
+ *
+ * @return the (global) thread-local cache allocator
+ */
+const Allocator *tcache_allocator( void );
+/**
+ * Returns the blocks cached by the calling thread to `free()`.
+ *
+ * Should be called before a thread using `tcache_allocator()` exits.
+ */
+void tcache_flush( void );
+
+#endif //CLIBS_ALLOCATOR_H
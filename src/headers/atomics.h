@@ -0,0 +1,39 @@
+/**
+ * @file atomics.h
+ * @brief
+ * Shorthands for atomic operations, shared by the thread pool,
+ * the parallel List algorithms and the concurrent containers.
+ *
+ * The library is C99, so these are the GCC/Clang `__atomic` builtins,
+ * which follow the C11 memory model (`memory_order_*` <=> `__ATOMIC_*`).
+ */
+
+#ifndef CLIBS_ATOMICS_H
+#define CLIBS_ATOMICS_H
+
+
+#define atomic_load_acquire( PTR )       __atomic_load_n( PTR, __ATOMIC_ACQUIRE )
+#define atomic_load_relaxed( PTR )       __atomic_load_n( PTR, __ATOMIC_RELAXED )
+#define atomic_load_seq_cst( PTR )       __atomic_load_n( PTR, __ATOMIC_SEQ_CST )
+#define atomic_store_release( PTR, VAL ) __atomic_store_n( PTR, VAL, __ATOMIC_RELEASE )
+#define atomic_store_relaxed( PTR, VAL ) __atomic_store_n( PTR, VAL, __ATOMIC_RELAXED )
+#define atomic_store_seq_cst( PTR, VAL ) __atomic_store_n( PTR, VAL, __ATOMIC_SEQ_CST )
+#define atomic_add_relaxed( PTR, VAL )   __atomic_fetch_add( PTR, VAL, __ATOMIC_RELAXED )
+#define atomic_add_seq_cst( PTR, VAL )   __atomic_fetch_add( PTR, VAL, __ATOMIC_SEQ_CST )
+#define atomic_sub_seq_cst( PTR, VAL )   __atomic_fetch_sub( PTR, VAL, __ATOMIC_SEQ_CST )
+
+/** Strong compare-and-swap; `*EXPECTED` gets the current value if it fails */
+#define atomic_cas_seq_cst( PTR, EXPECTED, DESIRED ) \
+    __atomic_compare_exchange_n( PTR, EXPECTED, DESIRED, false, __ATOMIC_SEQ_CST, \
+                                 __ATOMIC_RELAXED )
+/** Weak (may fail spuriously) relaxed compare-and-swap, for retry loops */
+#define atomic_cas_weak_relaxed( PTR, EXPECTED, DESIRED ) \
+    __atomic_compare_exchange_n( PTR, EXPECTED, DESIRED, true, __ATOMIC_RELAXED, \
+                                 __ATOMIC_RELAXED )
+
+
+/** Fields written by different threads are kept this far apart (false sharing) */
+#define CLIBS_CACHE_LINE 64
+
+
+#endif //CLIBS_ATOMICS_H
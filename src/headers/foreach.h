@@ -127,7 +127,8 @@
  */
 #define foreach_que( ENTRY_NAME, QUEUE )                                           \
     for ( const struct queue_node *ENTRY_NAME = queue__iterator_get_head( QUEUE ); \
-          ENTRY_NAME != NULL; ENTRY_NAME      = queue__iterator_get_next( ENTRY_NAME ) )
+          ENTRY_NAME != NULL;                                                      \
+          ENTRY_NAME = queue__iterator_get_next( ( QUEUE ), ENTRY_NAME ) )
 
 #endif // Queue
 
@@ -0,0 +1,479 @@
+/**
+ * @file hash.h
+ * @brief
+ * Seeded 64-bit hash functions for byte arrays.
+ *
+ * The default hash (`hash_bytes()`) reads the input a word at a time
+ * (wyhash-style multiply-mix) and has good avalanche properties,
+ * so even small integer keys spread evenly over power-of-two tables.
+ *
+ * Long inputs (at least `HASH_LONG_THRESHOLD` bytes) go through a striped
+ * accumulator (xxh3-style), which has an SSE2 and an AVX2 implementation.
+ * The best one the CPU supports is picked at runtime.
+ * All implementations compute exactly the same value,
+ * so hashes never depend on the machine they were computed on
+ * (as long as it is little-endian).
+ *
+ * Containers take a `HashFunction` and a seed (see `set_init_with_hash()`,
+ * `dict_init_with_hash()`). Use a seed from `hash_random_seed()`
+ * for tables filled with untrusted keys, to resist hash flooding.
+ */
+
+#ifndef CLIBS_HASH_H
+#define CLIBS_HASH_H
+
+#include "attributes.h" /* LibraryDefined */
+#include "types.h"      /* uint64_t, byte */
+
+#include <string.h> /* memcpy */
+#include <time.h>   /* time, clock */
+
+
+/// Interface for functions that hash data
+typedef uint64_t ( *HashFunction )( const void *data, size_t nbytes, uint64_t seed );
+
+
+/// Seed used when the user doesn't supply one
+#define HASH_DEFAULT_SEED 0
+
+/// Inputs at least this long are hashed by the (vectorized) striped accumulator
+#define HASH_LONG_THRESHOLD 256
+
+
+/** Implementations of the long-input path */
+enum HashImpl {
+    HASH_IMPL_AUTO   = 0, /* best one supported by the CPU */
+    HASH_IMPL_SCALAR = 1,
+    HASH_IMPL_SSE2   = 2,
+    HASH_IMPL_AVX2   = 3,
+};
+
+
+#if defined( __x86_64__ ) && HAS_ATTRIBUTE( target )
+/** The SSE2/AVX2 kernels are compiled in (selected at runtime) */
+#define CLIBS_HASH_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+
+/** @cond INTERNAL */
+#define HASH__P0 UINT64_C( 0xa0761d6478bd642f )
+#define HASH__P1 UINT64_C( 0xe7037ed1a0b428db )
+#define HASH__P2 UINT64_C( 0x8ebc6af09c88c6e3 )
+#define HASH__P3 UINT64_C( 0x589965cc75374cc3 )
+
+#define HASH__PRIME32 UINT64_C( 0x9E3779B1 )
+
+#define HASH__STRIPE_LEN         64
+#define HASH__STRIPES_PER_BLOCK  16
+#define HASH__BLOCK_LEN          ( HASH__STRIPE_LEN * HASH__STRIPES_PER_BLOCK )
+#define HASH__N_ACC              8
+
+
+#if defined( __SIZEOF_INT128__ )
+__extension__ typedef unsigned __int128 hash__u128;
+#endif
+
+/** 64x64 -> 128 bit multiplication */
+LibraryDefined inline void hash__mul128( const uint64_t a,
+                                         const uint64_t b,
+                                         uint64_t *lo,
+                                         uint64_t *hi )
+{
+#if defined( __SIZEOF_INT128__ )
+    const hash__u128 r = ( hash__u128 ) a * b;
+    *lo                = ( uint64_t ) r;
+    *hi                = ( uint64_t ) ( r >> 64 );
+#else
+    const uint64_t ha = a >> 32, hb = b >> 32, la = ( uint32_t ) a, lb = ( uint32_t ) b;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t  = rl + ( rm0 << 32 );
+    *lo               = t + ( rm1 << 32 );
+    *hi               = rh + ( rm0 >> 32 ) + ( rm1 >> 32 ) + ( t < rl ) + ( *lo < t );
+#endif
+}
+
+/** 64x64 -> 128 bit multiplication, folded back to 64 bits */
+LibraryDefined inline uint64_t hash__mix( const uint64_t a, const uint64_t b )
+{
+    uint64_t lo, hi;
+    hash__mul128( a, b, &lo, &hi );
+    return lo ^ hi;
+}
+
+LibraryDefined inline uint64_t hash__read64( const byte *p )
+{
+    uint64_t v;
+    memcpy( &v, p, sizeof v );
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64( v );
+#endif
+    return v;
+}
+
+LibraryDefined inline uint64_t hash__read32( const byte *p )
+{
+    uint32_t v;
+    memcpy( &v, p, sizeof v );
+#if defined( __BYTE_ORDER__ ) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32( v );
+#endif
+    return v;
+}
+
+/** 1 to 3 bytes */
+LibraryDefined inline uint64_t hash__read_small( const byte *p, const size_t k )
+{
+    return ( ( uint64_t ) ( uint8_t ) p[ 0 ] << 16 )
+           | ( ( uint64_t ) ( uint8_t ) p[ k >> 1 ] << 8 ) | ( uint8_t ) p[ k - 1 ];
+}
+
+
+/*
+ * Striped accumulator for long inputs.
+ *
+ * For every 8-byte lane `i` of a 64-byte stripe:
+ *     acc[ i ^ 1 ] += data[ i ]
+ *     acc[ i ]     += lo32( data[ i ] ^ key[ i ] ) * hi32( data[ i ] ^ key[ i ] )
+ * After every block of 16 stripes the accumulators are scrambled.
+ *
+ * The vector kernels do exactly the same, just 2/4 lanes at a time.
+ */
+struct hash__kernels {
+    void ( *accumulate )( uint64_t acc[ HASH__N_ACC ], const byte *stripes,
+                          size_t n_stripes, const uint64_t key[ HASH__N_ACC ] );
+    void ( *scramble )( uint64_t acc[ HASH__N_ACC ], const uint64_t key[ HASH__N_ACC ] );
+};
+
+LibraryDefined void hash__accumulate_scalar( uint64_t acc[ HASH__N_ACC ],
+                                             const byte *stripes,
+                                             const size_t n_stripes,
+                                             const uint64_t key[ HASH__N_ACC ] )
+{
+    for ( size_t s = 0; s < n_stripes; ++s )
+    {
+        const byte *p = stripes + s * HASH__STRIPE_LEN;
+        for ( size_t i = 0; i < HASH__N_ACC; ++i )
+        {
+            const uint64_t data    = hash__read64( p + 8 * i );
+            const uint64_t keyed   = data ^ key[ i ];
+            acc[ i ^ 1 ]          += data;
+            acc[ i ]              += ( keyed & 0xFFFFFFFF ) * ( keyed >> 32 );
+        }
+    }
+}
+
+LibraryDefined void hash__scramble_scalar( uint64_t acc[ HASH__N_ACC ],
+                                           const uint64_t key[ HASH__N_ACC ] )
+{
+    for ( size_t i = 0; i < HASH__N_ACC; ++i )
+    {
+        uint64_t a = acc[ i ];
+        a ^= a >> 47;
+        a ^= key[ i ];
+        acc[ i ] = a * HASH__PRIME32;
+    }
+}
+
+#ifdef CLIBS_HASH_X86_KERNELS
+#define HASH__TARGET( ISA ) __attribute__( ( __target__( ISA ) ) )
+
+HASH__TARGET( "sse2" )
+LibraryDefined void hash__accumulate_sse2( uint64_t acc[ HASH__N_ACC ],
+                                           const byte *stripes,
+                                           const size_t n_stripes,
+                                           const uint64_t key[ HASH__N_ACC ] )
+{
+    __m128i a[ 4 ], k[ 4 ];
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        a[ i ] = _mm_loadu_si128( ( const __m128i * ) ( acc + 2 * i ) );
+        k[ i ] = _mm_loadu_si128( ( const __m128i * ) ( key + 2 * i ) );
+    }
+
+    for ( size_t s = 0; s < n_stripes; ++s )
+    {
+        const byte *p = stripes + s * HASH__STRIPE_LEN;
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            const __m128i data  = _mm_loadu_si128( ( const __m128i * ) ( p + 16 * i ) );
+            const __m128i keyed = _mm_xor_si128( data, k[ i ] );
+            const __m128i prod  = _mm_mul_epu32( keyed, _mm_srli_epi64( keyed, 32 ) );
+            const __m128i swap  = _mm_shuffle_epi32( data, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+            a[ i ]              = _mm_add_epi64( a[ i ], _mm_add_epi64( prod, swap ) );
+        }
+    }
+
+    for ( size_t i = 0; i < 4; ++i )
+        _mm_storeu_si128( ( __m128i * ) ( acc + 2 * i ), a[ i ] );
+}
+
+HASH__TARGET( "sse2" )
+LibraryDefined void hash__scramble_sse2( uint64_t acc[ HASH__N_ACC ],
+                                         const uint64_t key[ HASH__N_ACC ] )
+{
+    const __m128i prime = _mm_set1_epi32( ( int ) HASH__PRIME32 );
+    for ( size_t i = 0; i < 4; ++i )
+    {
+        __m128i a = _mm_loadu_si128( ( const __m128i * ) ( acc + 2 * i ) );
+        a = _mm_xor_si128( a, _mm_srli_epi64( a, 47 ) );
+        a = _mm_xor_si128( a, _mm_loadu_si128( ( const __m128i * ) ( key + 2 * i ) ) );
+
+        // 64 x 32 bit multiplication
+        const __m128i lo = _mm_mul_epu32( a, prime );
+        const __m128i hi = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), prime );
+        _mm_storeu_si128( ( __m128i * ) ( acc + 2 * i ),
+                          _mm_add_epi64( lo, _mm_slli_epi64( hi, 32 ) ) );
+    }
+}
+
+HASH__TARGET( "avx2" )
+LibraryDefined void hash__accumulate_avx2( uint64_t acc[ HASH__N_ACC ],
+                                           const byte *stripes,
+                                           const size_t n_stripes,
+                                           const uint64_t key[ HASH__N_ACC ] )
+{
+    __m256i a[ 2 ], k[ 2 ];
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        a[ i ] = _mm256_loadu_si256( ( const __m256i * ) ( acc + 4 * i ) );
+        k[ i ] = _mm256_loadu_si256( ( const __m256i * ) ( key + 4 * i ) );
+    }
+
+    for ( size_t s = 0; s < n_stripes; ++s )
+    {
+        const byte *p = stripes + s * HASH__STRIPE_LEN;
+        for ( size_t i = 0; i < 2; ++i )
+        {
+            const __m256i data = _mm256_loadu_si256( ( const __m256i * ) ( p + 32 * i ) );
+            const __m256i keyed = _mm256_xor_si256( data, k[ i ] );
+            const __m256i high = _mm256_srli_epi64( keyed, 32 );
+            const __m256i prod = _mm256_mul_epu32( keyed, high );
+            const __m256i swap = _mm256_shuffle_epi32( data, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+            a[ i ] = _mm256_add_epi64( a[ i ], _mm256_add_epi64( prod, swap ) );
+        }
+    }
+
+    for ( size_t i = 0; i < 2; ++i )
+        _mm256_storeu_si256( ( __m256i * ) ( acc + 4 * i ), a[ i ] );
+}
+
+HASH__TARGET( "avx2" )
+LibraryDefined void hash__scramble_avx2( uint64_t acc[ HASH__N_ACC ],
+                                         const uint64_t key[ HASH__N_ACC ] )
+{
+    const __m256i prime = _mm256_set1_epi32( ( int ) HASH__PRIME32 );
+    for ( size_t i = 0; i < 2; ++i )
+    {
+        __m256i a = _mm256_loadu_si256( ( const __m256i * ) ( acc + 4 * i ) );
+        a         = _mm256_xor_si256( a, _mm256_srli_epi64( a, 47 ) );
+        a = _mm256_xor_si256( a,
+                              _mm256_loadu_si256( ( const __m256i * ) ( key + 4 * i ) ) );
+
+        const __m256i lo = _mm256_mul_epu32( a, prime );
+        const __m256i hi = _mm256_mul_epu32( _mm256_srli_epi64( a, 32 ), prime );
+        _mm256_storeu_si256( ( __m256i * ) ( acc + 4 * i ),
+                             _mm256_add_epi64( lo, _mm256_slli_epi64( hi, 32 ) ) );
+    }
+}
+#endif // CLIBS_HASH_X86_KERNELS
+
+
+LibraryDefined const struct hash__kernels *hash__get_kernels( enum HashImpl impl )
+{
+    static const struct hash__kernels scalar = {
+        hash__accumulate_scalar,
+        hash__scramble_scalar,
+    };
+#ifdef CLIBS_HASH_X86_KERNELS
+    static const struct hash__kernels sse2 = {
+        hash__accumulate_sse2,
+        hash__scramble_sse2,
+    };
+    static const struct hash__kernels avx2 = {
+        hash__accumulate_avx2,
+        hash__scramble_avx2,
+    };
+
+    if ( impl == HASH_IMPL_AUTO )
+        impl = __builtin_cpu_supports( "avx2" ) ? HASH_IMPL_AVX2 : HASH_IMPL_SSE2;
+
+    switch ( impl )
+    {
+        case HASH_IMPL_AVX2:
+            if ( __builtin_cpu_supports( "avx2" ) )
+                return &avx2;
+            return &sse2;
+        case HASH_IMPL_SSE2:
+            return &sse2;
+        default:
+            return &scalar;
+    }
+#else
+    ( void ) impl;
+    return &scalar;
+#endif
+}
+
+
+LibraryDefined uint64_t hash__long( const byte *p,
+                                    const size_t len,
+                                    const uint64_t seed,
+                                    const struct hash__kernels *kernels )
+{
+    static const uint64_t primes[ 4 ] = { HASH__P0, HASH__P1, HASH__P2, HASH__P3 };
+
+    uint64_t key[ HASH__N_ACC ];
+    uint64_t acc[ HASH__N_ACC ];
+    for ( size_t i = 0; i < HASH__N_ACC; ++i )
+    {
+        key[ i ] = hash__mix( seed ^ primes[ i % 4 ], primes[ ( i + 1 ) % 4 ] + i );
+        acc[ i ] = primes[ ( i + 2 ) % 4 ] ^ i;
+    }
+
+    const size_t n_blocks = ( len - 1 ) / HASH__BLOCK_LEN;
+    for ( size_t b = 0; b < n_blocks; ++b )
+    {
+        kernels->accumulate( acc, p + b * HASH__BLOCK_LEN, HASH__STRIPES_PER_BLOCK, key );
+        kernels->scramble( acc, key );
+    }
+
+    const size_t done      = n_blocks * HASH__BLOCK_LEN;
+    const size_t n_stripes = ( len - 1 - done ) / HASH__STRIPE_LEN;
+    kernels->accumulate( acc, p + done, n_stripes, key );
+
+    // last (possibly overlapping) stripe
+    kernels->accumulate( acc, p + len - HASH__STRIPE_LEN, 1, key );
+
+    uint64_t result = len * HASH__P0;
+    for ( size_t i = 0; i < HASH__N_ACC; i += 2 )
+        result += hash__mix( acc[ i ] ^ key[ i + 1 ], acc[ i + 1 ] ^ HASH__P1 );
+
+    return hash__mix( result ^ ( result >> 29 ), HASH__P2 ^ seed );
+}
+/** @endcond */
+
+
+/**
+ * Hashes `nbytes` bytes under `data`.
+ *
+ * Same as `hash_bytes()`, except the long-input path
+ * always uses the specified implementation.
+ * If the CPU doesn't support it, the next best one is used.
+ * (Used mainly for testing that all implementations agree.)
+ *
+ * @return unsigned 64-bit int hash
+ */
+LibraryDefined uint64_t hash_bytes_impl( const void *const data,
+                                         const size_t nbytes,
+                                         uint64_t seed,
+                                         const enum HashImpl impl )
+{
+    const byte *p = data;
+
+    if ( nbytes >= HASH_LONG_THRESHOLD )
+        return hash__long( p, nbytes, seed, hash__get_kernels( impl ) );
+
+    seed ^= hash__mix( seed ^ HASH__P0, HASH__P1 );
+
+    uint64_t a, b;
+    if ( nbytes <= 16 )
+    {
+        if ( nbytes >= 4 )
+        {
+            const size_t shift = ( nbytes >> 3 ) << 2;
+            a = ( hash__read32( p ) << 32 ) | hash__read32( p + shift );
+            b = ( hash__read32( p + nbytes - 4 ) << 32 )
+                | hash__read32( p + nbytes - 4 - shift );
+        }
+        else if ( nbytes > 0 )
+        {
+            a = hash__read_small( p, nbytes );
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        size_t i = nbytes;
+        if ( i > 48 )
+        {
+            uint64_t see1 = seed, see2 = seed;
+            do
+            {
+                seed = hash__mix( hash__read64( p ) ^ HASH__P1,
+                                  hash__read64( p + 8 ) ^ seed );
+                see1 = hash__mix( hash__read64( p + 16 ) ^ HASH__P2,
+                                  hash__read64( p + 24 ) ^ see1 );
+                see2 = hash__mix( hash__read64( p + 32 ) ^ HASH__P3,
+                                  hash__read64( p + 40 ) ^ see2 );
+                p += 48;
+                i -= 48;
+            }
+            while ( i > 48 );
+            seed ^= see1 ^ see2;
+        }
+        while ( i > 16 )
+        {
+            seed = hash__mix( hash__read64( p ) ^ HASH__P1,
+                              hash__read64( p + 8 ) ^ seed );
+            i -= 16;
+            p += 16;
+        }
+        a = hash__read64( p + i - 16 );
+        b = hash__read64( p + i - 8 );
+    }
+
+    hash__mul128( a ^ HASH__P1, b ^ seed, &a, &b );
+    return hash__mix( a ^ HASH__P0 ^ nbytes, b ^ HASH__P1 );
+}
+
+/**
+ * Default `HashFunction`.
+ *
+ * @param data      pointer to data
+ * @param nbytes    number of bytes under the pointer
+ * @param seed      any number; equal seeds give equal hashes
+ * @return unsigned 64-bit int hash
+ */
+LibraryDefined uint64_t hash_bytes( const void *const data,
+                                    const size_t nbytes,
+                                    const uint64_t seed )
+{
+    return hash_bytes_impl( data, nbytes, seed, HASH_IMPL_AUTO );
+}
+
+
+/**
+ * Name of the implementation `hash_bytes()` uses for long inputs on this CPU.
+ */
+LibraryDefined const char *hash_impl_name( void )
+{
+#ifdef CLIBS_HASH_X86_KERNELS
+    return __builtin_cpu_supports( "avx2" ) ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+
+/**
+ * Creates a hard to guess seed (e.g. for tables filled with untrusted keys).
+ *
+ * Not cryptographically secure.
+ */
+LibraryDefined uint64_t hash_random_seed( void )
+{
+    static uint64_t counter = 0;
+
+    const uint64_t local = ( uint64_t ) ( uintptr_t ) &counter;
+    const uint64_t stack = ( uint64_t ) ( uintptr_t ) &local;
+
+    uint64_t seed = hash__mix( ( uint64_t ) time( NULL ) ^ HASH__P0, stack ^ HASH__P1 );
+    seed = hash__mix( seed ^ ( uint64_t ) clock(), local ^ ++counter ^ HASH__P2 );
+    return seed;
+}
+
+
+#endif //CLIBS_HASH_H
@@ -8,6 +8,7 @@
 #define CLIBS_MISC_H
 
 #include "attributes.h"
+#include "hash.h" /* hash_bytes() */
 #include "types.h"
 
 
@@ -61,16 +62,12 @@ DEFINE_CMP_FUNCTION( uint64_t )
  * @param data      pointer to data
  * @param nbytes    number of bytes (chars) under the pointer
  * @return unsigned 64-bit int hash
+ *
+ * @see `hash_bytes()` in `hash.h` for a seeded version
  */
 LibraryDefined uint64_t hash_func( const void *const data, const size_t nbytes )
 {
-    uint64_t hash = 5381 * nbytes;
-
-    const byte *data_byte = ( byte * ) data;
-    for ( size_t i = 0; i < nbytes; ++i )
-        hash = ( hash << 5 ) + hash + data_byte[ i ];
-
-    return hash;
+    return hash_bytes( data, nbytes, HASH_DEFAULT_SEED );
 }
 
 
@@ -0,0 +1,591 @@
+/*
+ * The binary format of the containers (see serialize.h).
+ *
+ * Writers collect records in a buffer and write it out as one chunk
+ * once it holds `SERIAL_CHUNK_SIZE` bytes; a record larger than that
+ * gets a chunk of its own. Readers read a whole chunk at a time.
+ * The checksum is `hash_bytes()` chained over the records of the chunks.
+ */
+
+#include "serialize.h"
+
+#include "headers/errors.h"
+
+#include <stdlib.h> /* malloc */
+#include <string.h> /* memcpy, memcmp */
+
+
+#define SERIAL_MAGIC         "CLIBSBIN"
+#define SERIAL_MAGIC_LEN     8
+#define SERIAL_HEADER_SIZE   ( SERIAL_MAGIC_LEN + 2 + 2 + 4 + 3 * 8 )
+#define SERIAL_CHECKSUM_SEED UINT64_C( 0x434c49425342494e )
+
+
+Private inline void serial_put_u64( uint8_t *dest, const uint64_t value )
+{
+    for ( size_t i = 0; i < 8; ++i )
+        dest[ i ] = ( uint8_t ) ( value >> ( 8 * i ) );
+}
+
+Private inline uint64_t serial_get_u64( const uint8_t *src )
+{
+    uint64_t value = 0;
+    for ( size_t i = 0; i < 8; ++i )
+        value |= ( uint64_t ) src[ i ] << ( 8 * i );
+    return value;
+}
+
+Private inline void serial_put_u32( uint8_t *dest, const uint32_t value )
+{
+    for ( size_t i = 0; i < 4; ++i )
+        dest[ i ] = ( uint8_t ) ( value >> ( 8 * i ) );
+}
+
+Private inline uint32_t serial_get_u32( const uint8_t *src )
+{
+    uint32_t value = 0;
+    for ( size_t i = 0; i < 4; ++i )
+        value |= ( uint32_t ) src[ i ] << ( 8 * i );
+    return value;
+}
+
+Private inline bool serial_kind_is_valid( const uint32_t kind )
+{
+    return kind >= SERIAL_LIST && kind <= SERIAL_DICT;
+}
+
+/** Items of Lists and Queues are of a fixed size and carry no hash */
+Private inline bool serial_kind_is_array( const enum SerialKind kind )
+{
+    return kind == SERIAL_LIST || kind == SERIAL_QUEUE;
+}
+
+
+/* -------- WRITER -------- */
+
+struct serial_writer {
+    FILE *file;
+    enum SerialKind kind;
+    size_t el_size;
+    HashFunction hash;
+    uint64_t seed;
+
+    uint8_t *chunk; // records not written yet
+    size_t chunk_cap;
+    size_t chunk_bytes;
+    size_t chunk_records;
+
+    uint64_t count; // records written so far
+    uint64_t checksum;
+};
+
+
+Private int serial_fwrite( SerialWriter *writer, const void *data, const size_t size )
+{
+    if ( size > 0 && fwrite( data, size, 1, writer->file ) != 1 )
+        return fwarn_ret( RV_ERROR, "fwrite" );
+    return RV_SUCCESS;
+}
+
+Private int serial_write_header( SerialWriter *writer,
+                                 const uint32_t engine,
+                                 const size_t count )
+{
+    uint8_t header[ SERIAL_HEADER_SIZE ];
+    memcpy( header, SERIAL_MAGIC, SERIAL_MAGIC_LEN );
+    header[ 8 ]  = ( uint8_t ) SERIAL_VERSION;
+    header[ 9 ]  = ( uint8_t ) ( SERIAL_VERSION >> 8 );
+    header[ 10 ] = ( uint8_t ) writer->kind;
+    header[ 11 ] = 0;
+    serial_put_u32( header + 12, engine );
+    serial_put_u64( header + 16, writer->el_size );
+    serial_put_u64( header + 24, writer->seed );
+    serial_put_u64( header + 32, count );
+
+    return serial_fwrite( writer, header, sizeof header );
+}
+
+/** Writes the buffered records as one chunk */
+Private int serial_flush_chunk( SerialWriter *writer )
+{
+    if ( writer->chunk_records == 0 )
+        return RV_SUCCESS;
+
+    uint8_t chunk_header[ 16 ];
+    serial_put_u64( chunk_header, writer->chunk_records );
+    serial_put_u64( chunk_header + 8, writer->chunk_bytes );
+    if ( serial_fwrite( writer, chunk_header, sizeof chunk_header ) != RV_SUCCESS
+         || serial_fwrite( writer, writer->chunk, writer->chunk_bytes ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    writer->checksum =
+            hash_bytes( writer->chunk, writer->chunk_bytes, writer->checksum );
+    writer->count += writer->chunk_records;
+    writer->chunk_bytes   = 0;
+    writer->chunk_records = 0;
+    return RV_SUCCESS;
+}
+
+/**
+ * @return space for a record of `size` bytes at the end of the chunk, or `NULL`
+ *
+ * Chunks are flushed at `SERIAL_CHUNK_SIZE` bytes (not `chunk_cap`,
+ * which a large record raises), as readers expect.
+ */
+Private uint8_t *serial_reserve( SerialWriter *writer, const size_t size )
+{
+    if ( writer->chunk_bytes + size > SERIAL_CHUNK_SIZE )
+    {
+        if ( serial_flush_chunk( writer ) != RV_SUCCESS )
+            return f_stack_trace( NULL );
+
+        if ( size > writer->chunk_cap )
+        {
+            uint8_t *bigger = realloc( writer->chunk, size );
+            if ( bigger == NULL )
+                return fwarn_ret( NULL, "realloc" );
+            writer->chunk     = bigger;
+            writer->chunk_cap = size;
+        }
+    }
+
+    uint8_t *record = writer->chunk + writer->chunk_bytes;
+    writer->chunk_bytes += size;
+    ++writer->chunk_records;
+    return record;
+}
+
+
+SerialWriter *serial__writer_open( FILE *file,
+                                   const enum SerialKind kind,
+                                   const size_t el_size,
+                                   const HashFunction hash,
+                                   const uint64_t seed,
+                                   const uint32_t engine,
+                                   const size_t count )
+{
+    if ( !serial_kind_is_valid( kind ) )
+        return fwarnx_ret( NULL, "invalid kind: %d", ( int ) kind );
+    if ( serial_kind_is_array( kind ) && el_size == 0 )
+        return fwarnx_ret( NULL, "el_size may not be 0" );
+
+    SerialWriter *writer = calloc( 1, sizeof( SerialWriter ) );
+    if ( writer == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    if ( ( writer->chunk = malloc( SERIAL_CHUNK_SIZE ) ) == NULL )
+    {
+        free( writer );
+        return fwarn_ret( NULL, "malloc" );
+    }
+
+    writer->file      = file;
+    writer->kind      = kind;
+    writer->el_size   = serial_kind_is_array( kind ) ? el_size : 0;
+    writer->hash      = hash != NULL ? hash : hash_bytes;
+    writer->seed      = serial_kind_is_array( kind ) ? 0 : seed;
+    writer->chunk_cap = SERIAL_CHUNK_SIZE;
+    writer->checksum  = SERIAL_CHECKSUM_SEED;
+
+    if ( serial_write_header( writer, engine, count ) != RV_SUCCESS )
+    {
+        free( writer->chunk );
+        free( writer );
+        return f_stack_trace( NULL );
+    }
+
+    return writer;
+}
+
+SerialWriter *serial_writer_open( FILE *file,
+                                  const enum SerialKind kind,
+                                  const size_t el_size,
+                                  const HashFunction hash,
+                                  const uint64_t seed )
+{
+    SerialWriter *writer = serial__writer_open( file, kind, el_size, hash, seed, 0, 0 );
+    if ( writer == NULL )
+        return f_stack_trace( NULL );
+
+    return writer;
+}
+
+int serial_writer_close( SerialWriter *writer )
+{
+    int rv = serial_flush_chunk( writer );
+
+    if ( rv == RV_SUCCESS )
+    {
+        uint8_t end[ 32 ] = { 0 };
+        serial_put_u64( end + 16, writer->count );
+        serial_put_u64( end + 24, writer->checksum );
+        rv = serial_fwrite( writer, end, sizeof end );
+    }
+    if ( rv == RV_SUCCESS && fflush( writer->file ) != 0 )
+        rv = fwarn_ret( RV_ERROR, "fflush" );
+
+    free( writer->chunk );
+    free( writer );
+
+    return rv;
+}
+
+
+int serial_write_items( SerialWriter *writer, const void *items, const size_t count )
+{
+    if ( !serial_kind_is_array( writer->kind ) )
+        return fwarnx_ret( RV_EXCEPTION, "not a List or Queue" );
+
+    for ( size_t done = 0; done < count; )
+    {
+        if ( writer->chunk_bytes + writer->el_size > SERIAL_CHUNK_SIZE
+             && serial_flush_chunk( writer ) != RV_SUCCESS )
+            return f_stack_trace( RV_ERROR );
+
+        // as many as fit into the chunk (at least one)
+        size_t n = ( SERIAL_CHUNK_SIZE - writer->chunk_bytes ) / writer->el_size;
+        if ( n == 0 )
+            n = 1;
+        if ( n > count - done )
+            n = count - done;
+
+        uint8_t *dest = serial_reserve( writer, n * writer->el_size );
+        if ( dest == NULL )
+            return f_stack_trace( RV_ERROR );
+
+        memcpy( dest,
+                ( const uint8_t * ) items + done * writer->el_size,
+                n * writer->el_size );
+        writer->chunk_records += n - 1;
+        done += n;
+    }
+
+    return RV_SUCCESS;
+}
+
+int serial__write_hashed( SerialWriter *writer,
+                          const uint64_t hash,
+                          const void *key,
+                          const size_t key_size,
+                          const void *val,
+                          const size_t val_size )
+{
+    const size_t n_sizes = writer->kind == SERIAL_DICT ? 2 : 1;
+
+    uint8_t *record = serial_reserve( writer, 8 + 8 * n_sizes + key_size + val_size );
+    if ( record == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    serial_put_u64( record, hash );
+    serial_put_u64( record + 8, key_size );
+    if ( n_sizes == 2 )
+        serial_put_u64( record + 16, val_size );
+    record += 8 + 8 * n_sizes;
+
+    memcpy( record, key, key_size );
+    if ( val_size > 0 )
+        memcpy( record + key_size, val, val_size );
+
+    return RV_SUCCESS;
+}
+
+int serial_write_item( SerialWriter *writer, const void *item, const size_t size )
+{
+    if ( serial_kind_is_array( writer->kind ) )
+    {
+        if ( size != writer->el_size )
+            return fwarnx_ret( RV_EXCEPTION,
+                               "item of %zu bytes in a file of %zu-byte items",
+                               size,
+                               writer->el_size );
+        return serial_write_items( writer, item, 1 );
+    }
+    if ( writer->kind != SERIAL_SET )
+        return fwarnx_ret( RV_EXCEPTION, "not a List, Queue or Set" );
+
+    return serial__write_hashed(
+            writer, writer->hash( item, size, writer->seed ), item, size, NULL, 0 );
+}
+
+int serial_write_entry( SerialWriter *writer,
+                        const void *key,
+                        const size_t key_size,
+                        const void *val,
+                        const size_t val_size )
+{
+    if ( writer->kind != SERIAL_DICT )
+        return fwarnx_ret( RV_EXCEPTION, "not a Dictionary" );
+
+    return serial__write_hashed( writer,
+                                 writer->hash( key, key_size, writer->seed ),
+                                 key,
+                                 key_size,
+                                 val,
+                                 val_size );
+}
+
+
+/* -------- READER -------- */
+
+struct serial_reader {
+    FILE *file;
+    enum SerialKind kind;
+    uint32_t engine;
+    size_t el_size;
+    uint64_t seed;
+    uint64_t count_hint;
+
+    uint8_t *chunk; // the current chunk
+    size_t chunk_cap;
+    size_t chunk_bytes;
+    size_t chunk_pos;
+    size_t records_left; // in the current chunk
+
+    uint64_t count; // records read so far
+    uint64_t checksum;
+    bool at_end;
+};
+
+
+/** @return `RV_EXCEPTION` at the end of the file, `RV_ERROR` on failure */
+Private int serial_fread( SerialReader *reader, void *data, const size_t size )
+{
+    if ( size == 0 || fread( data, size, 1, reader->file ) == 1 )
+        return RV_SUCCESS;
+
+    if ( feof( reader->file ) )
+        return fwarnx_ret( RV_EXCEPTION, "unexpected end of file" );
+    return fwarn_ret( RV_ERROR, "fread" );
+}
+
+SerialReader *serial_reader_open( FILE *file )
+{
+    uint8_t header[ SERIAL_HEADER_SIZE ];
+    if ( fread( header, sizeof header, 1, file ) != 1 )
+        return fwarnx_ret( NULL, "couldn't read the header" );
+
+    if ( memcmp( header, SERIAL_MAGIC, SERIAL_MAGIC_LEN ) != 0 )
+        return fwarnx_ret( NULL, "not a CLibs binary file" );
+
+    const unsigned version = header[ 8 ] | ( unsigned ) header[ 9 ] << 8;
+    if ( version == 0 || version > SERIAL_VERSION )
+        return fwarnx_ret( NULL, "unsupported version %u", version );
+
+    const uint32_t kind = header[ 10 ] | ( uint32_t ) header[ 11 ] << 8;
+    if ( !serial_kind_is_valid( kind ) )
+        return fwarnx_ret( NULL, "invalid kind: %u", ( unsigned ) kind );
+
+    const uint64_t el_size = serial_get_u64( header + 16 );
+    if ( serial_kind_is_array( kind ) && ( el_size == 0 || el_size > SIZE_MAX ) )
+        return fwarnx_ret( NULL, "invalid el_size: %ju", ( uintmax_t ) el_size );
+
+    SerialReader *reader = calloc( 1, sizeof( SerialReader ) );
+    if ( reader == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    reader->file       = file;
+    reader->kind       = ( enum SerialKind ) kind;
+    reader->engine     = serial_get_u32( header + 12 );
+    reader->el_size    = ( size_t ) el_size;
+    reader->seed       = serial_get_u64( header + 24 );
+    reader->count_hint = serial_get_u64( header + 32 );
+    reader->checksum   = SERIAL_CHECKSUM_SEED;
+    return reader;
+}
+
+void serial_reader_close( SerialReader *reader )
+{
+    free( reader->chunk );
+    free( reader );
+}
+
+enum SerialKind serial_reader_kind( const SerialReader *reader )
+{
+    return reader->kind;
+}
+
+size_t serial_reader_el_size( const SerialReader *reader )
+{
+    return reader->el_size;
+}
+
+size_t serial_reader_count_hint( const SerialReader *reader )
+{
+    return reader->count_hint <= SIZE_MAX ? ( size_t ) reader->count_hint : SIZE_MAX;
+}
+
+uint32_t serial__reader_engine( const SerialReader *reader )
+{
+    return reader->engine;
+}
+
+uint64_t serial__reader_seed( const SerialReader *reader )
+{
+    return reader->seed;
+}
+
+
+/** Checks the trailer once the end has been read */
+Private int serial_read_trailer( SerialReader *reader )
+{
+    uint8_t trailer[ 16 ];
+    return_on_fail( serial_fread( reader, trailer, sizeof trailer ) );
+
+    if ( serial_get_u64( trailer ) != reader->count )
+        return fwarnx_ret( RV_EXCEPTION,
+                           "the file ends after %ju of %ju records",
+                           ( uintmax_t ) reader->count,
+                           ( uintmax_t ) serial_get_u64( trailer ) );
+    if ( serial_get_u64( trailer + 8 ) != reader->checksum )
+        return fwarnx_ret( RV_EXCEPTION, "checksum mismatch" );
+
+    reader->at_end = true;
+    return RV_SUCCESS;
+}
+
+/**
+ * Makes sure the current chunk has a record left, reading the next one if needed
+ *
+ * @return 1 if there is a record, 0 at the end, else `RV_EXCEPTION`/`RV_ERROR`
+ */
+Private int serial_next_record( SerialReader *reader )
+{
+    if ( reader->records_left > 0 )
+        return 1;
+    if ( reader->at_end )
+        return 0;
+    if ( reader->chunk_pos != reader->chunk_bytes )
+        return fwarnx_ret( RV_EXCEPTION, "corrupt chunk: trailing bytes" );
+
+    uint8_t chunk_header[ 16 ];
+    return_on_fail( serial_fread( reader, chunk_header, sizeof chunk_header ) );
+
+    const uint64_t n_records = serial_get_u64( chunk_header );
+    const uint64_t n_bytes   = serial_get_u64( chunk_header + 8 );
+    if ( n_records == 0 && n_bytes == 0 )
+    {
+        return_on_fail( serial_read_trailer( reader ) );
+        return 0;
+    }
+    // only a chunk of a single record may be over the chunk size
+    if ( n_records == 0 || n_bytes > SIZE_MAX
+         || ( n_records > 1 && n_bytes > SERIAL_CHUNK_SIZE )
+         || ( serial_kind_is_array( reader->kind )
+              && ( n_bytes % reader->el_size != 0
+                   || n_bytes / reader->el_size != n_records ) ) )
+        return fwarnx_ret( RV_EXCEPTION, "corrupt chunk header" );
+
+    if ( n_bytes > reader->chunk_cap )
+    {
+        uint8_t *bigger = realloc( reader->chunk, n_bytes );
+        if ( bigger == NULL )
+            return fwarn_ret( RV_ERROR, "realloc" );
+        reader->chunk     = bigger;
+        reader->chunk_cap = n_bytes;
+    }
+    return_on_fail( serial_fread( reader, reader->chunk, n_bytes ) );
+
+    reader->checksum     = hash_bytes( reader->chunk, n_bytes, reader->checksum );
+    reader->chunk_bytes  = n_bytes;
+    reader->chunk_pos    = 0;
+    reader->records_left = n_records;
+    reader->count += n_records;
+    return 1;
+}
+
+/** @return the next `size` bytes of the chunk, or `NULL` if there aren't as many */
+Private const uint8_t *serial_take( SerialReader *reader, const uint64_t size )
+{
+    if ( size > reader->chunk_bytes - reader->chunk_pos )
+        return NULL;
+
+    const uint8_t *data = reader->chunk + reader->chunk_pos;
+    reader->chunk_pos += size;
+    return data;
+}
+
+
+int64_t serial_read_items( SerialReader *reader, void *items, const size_t max_count )
+{
+    if ( !serial_kind_is_array( reader->kind ) )
+        return fwarnx_ret( RV_EXCEPTION, "not a List or Queue" );
+
+    const int rv = serial_next_record( reader );
+    if ( rv <= 0 )
+        return rv;
+
+    const size_t n = reader->records_left < max_count ? reader->records_left : max_count;
+    memcpy( items, serial_take( reader, n * reader->el_size ), n * reader->el_size );
+    reader->records_left -= n;
+    return ( int64_t ) n;
+}
+
+int serial__read_hashed( SerialReader *reader,
+                         uint64_t *hash,
+                         const void **key,
+                         size_t *key_size,
+                         const void **val,
+                         size_t *val_size )
+{
+    const int rv = serial_next_record( reader );
+    if ( rv <= 0 )
+        return rv;
+
+    const size_t n_sizes = reader->kind == SERIAL_DICT ? 2 : 1;
+
+    const uint8_t *fixed = serial_take( reader, 8 + 8 * n_sizes );
+    if ( fixed == NULL )
+        return fwarnx_ret( RV_EXCEPTION, "corrupt record" );
+
+    const uint64_t k_size = serial_get_u64( fixed + 8 );
+    const uint64_t v_size = n_sizes == 2 ? serial_get_u64( fixed + 16 ) : 0;
+
+    const uint8_t *k = serial_take( reader, k_size );
+    const uint8_t *v = k == NULL ? NULL : serial_take( reader, v_size );
+    if ( v == NULL )
+        return fwarnx_ret( RV_EXCEPTION, "corrupt record" );
+
+    --reader->records_left;
+
+    *hash     = serial_get_u64( fixed );
+    *key      = k;
+    *key_size = ( size_t ) k_size;
+    if ( val != NULL )
+        *val = v;
+    if ( val_size != NULL )
+        *val_size = ( size_t ) v_size;
+    return 1;
+}
+
+int serial_read_item( SerialReader *reader, const void **item, size_t *size )
+{
+    if ( serial_kind_is_array( reader->kind ) )
+    {
+        const int rv = serial_next_record( reader );
+        if ( rv <= 0 )
+            return rv;
+
+        *item = serial_take( reader, reader->el_size );
+        *size = reader->el_size;
+        --reader->records_left;
+        return 1;
+    }
+    if ( reader->kind != SERIAL_SET )
+        return fwarnx_ret( RV_EXCEPTION, "not a List, Queue or Set" );
+
+    uint64_t hash;
+    return serial__read_hashed( reader, &hash, item, size, NULL, NULL );
+}
+
+int serial_read_entry( SerialReader *reader,
+                       const void **key,
+                       size_t *key_size,
+                       const void **val,
+                       size_t *val_size )
+{
+    if ( reader->kind != SERIAL_DICT )
+        return fwarnx_ret( RV_EXCEPTION, "not a Dictionary" );
+
+    uint64_t hash;
+    return serial__read_hashed( reader, &hash, key, key_size, val, val_size );
+}
@@ -0,0 +1,183 @@
+/**
+ * @file serialize.h
+ * @brief Binary format of the containers (`list_save()`, `set_load()`, ...),
+ * and streaming readers and writers of it.
+ *
+ * A file holds one container:
+ * @code
+ * header:  magic "CLIBSBIN", u16 version, u16 kind, u32 engine,
+ *          u64 el_size, u64 seed, u64 count (of records; a hint)
+ * chunks:  u64 n_records, u64 n_bytes, records   ... as many as needed
+ * end:     u64 0, u64 0
+ * trailer: u64 count, u64 checksum (of the records)
+ * @endcode
+ * All integers are little-endian. The items, keys and values themselves
+ * are stored byte for byte, as they are in memory.
+ *
+ * Records:
+ *  - List, Queue: the item (`el_size` bytes)
+ *  - Set:         u64 hash, u64 size, the item
+ *  - Dictionary:  u64 hash, u64 key size, u64 value size, the key, the value
+ *
+ * Sets and dictionaries store the hashes of their items and their number,
+ * so they are loaded into tables of the final size, with no item hashed
+ * or moved twice. Loading them requires the hash function they were saved with.
+ *
+ * The writers and readers only need the items one at a time,
+ * so data larger than the memory can be written and read in a stream.
+ * A file is only complete once its writer has been closed;
+ * a reader checks the checksum once it reads the end.
+ */
+
+#ifndef CLIBS_SERIALIZE_H
+#define CLIBS_SERIALIZE_H
+
+#include "headers/attributes.h"
+#include "headers/hash.h" /* HashFunction */
+#include "headers/types.h"
+
+#include <stdio.h> /* FILE */
+
+
+/** Version written; files of later versions aren't read */
+#define SERIAL_VERSION 1
+
+/** Bytes of records a writer buffers before writing a chunk */
+#define SERIAL_CHUNK_SIZE ( 64 * 1024 )
+
+
+enum SerialKind {
+    SERIAL_LIST  = 1,
+    SERIAL_QUEUE = 2,
+    SERIAL_SET   = 3,
+    SERIAL_DICT  = 4,
+};
+
+
+typedef struct serial_writer SerialWriter;
+typedef struct serial_reader SerialReader;
+
+
+/**
+ * Writes the header and starts a new file.
+ *
+ * @param el_size   size of the items of a List or Queue; ignored otherwise
+ * @param hash      hash function of the Set or Dictionary (`NULL` for `hash_bytes()`);
+ *                  ignored for the other kinds
+ * @param seed      passed to `hash`; saved in the file
+ * @return pointer to a new writer, or `NULL` on allocation or write failure
+ */
+Constructor SerialWriter *serial_writer_open( FILE *,
+                                              enum SerialKind kind,
+                                              size_t el_size,
+                                              HashFunction hash,
+                                              uint64_t seed );
+/**
+ * Writes the rest of the records, the end and the trailer, and frees the writer
+ * (the file is flushed, not closed).
+ *
+ * @return `RV_ERROR` if writing fails, else `RV_SUCCESS`
+ */
+int serial_writer_close( SerialWriter * );
+
+/**
+ * Writes an item of a List, Queue (`size` must be `el_size`) or Set.
+ *
+ * @return `RV_EXCEPTION` if the item doesn't fit the kind of the file,
+ *         `RV_ERROR` if allocation or writing fails, else `RV_SUCCESS`
+ */
+int serial_write_item( SerialWriter *, const void *item, size_t size );
+/**
+ * Writes `count` items of a List or Queue at once.
+ *
+ * @param items array of `count` items of `el_size` bytes
+ * @see `serial_write_item()`
+ */
+int serial_write_items( SerialWriter *, const void *items, size_t count );
+/**
+ * Writes a key-value pair of a Dictionary.
+ *
+ * @see `serial_write_item()`
+ */
+int serial_write_entry( SerialWriter *,
+                        const void *key,
+                        size_t key_size,
+                        const void *val,
+                        size_t val_size );
+
+
+/**
+ * Reads the header of a file.
+ *
+ * @return pointer to a new reader, or `NULL` if the header can't be read
+ *         or isn't valid
+ */
+Constructor SerialReader *serial_reader_open( FILE * );
+/** Frees the reader (doesn't close the file) */
+void serial_reader_close( SerialReader * );
+
+/** @return kind of the container in the file */
+enum SerialKind serial_reader_kind( const SerialReader * );
+/** @return size of the items of a List or Queue, else 0 */
+size_t serial_reader_el_size( const SerialReader * );
+/** @return number of records the header announces (the real one may differ) */
+size_t serial_reader_count_hint( const SerialReader * );
+
+/**
+ * Reads the next item of a List, Queue or Set.
+ *
+ * @param item  the item is stored here; valid until the next read
+ * @param size  its size is stored here
+ * @return
+ * - 1 if an item has been read
+ * - 0 at the end of the file (the checksum matches)
+ * - `RV_EXCEPTION` if the file is corrupt (or of another kind)
+ * - `RV_ERROR` if reading or allocation fails
+ */
+int serial_read_item( SerialReader *, const void **item, size_t *size );
+/**
+ * Reads up to `max_count` items of a List or Queue.
+ *
+ * @param items `max_count * el_size` bytes
+ * @return number of items read (0 only at the end of the file),
+ *         or `RV_EXCEPTION`/`RV_ERROR` (see `serial_read_item()`)
+ */
+int64_t serial_read_items( SerialReader *, void *items, size_t max_count );
+/**
+ * Reads the next key-value pair of a Dictionary.
+ *
+ * @see `serial_read_item()`
+ */
+int serial_read_entry( SerialReader *,
+                       const void **key,
+                       size_t *key_size,
+                       const void **val,
+                       size_t *val_size );
+
+
+/** @cond INTERNAL */
+/* for the containers, which already know the hashes of their items */
+int serial__write_hashed( SerialWriter *,
+                          uint64_t hash,
+                          const void *key,
+                          size_t key_size,
+                          const void *val,
+                          size_t val_size );
+int serial__read_hashed( SerialReader *,
+                         uint64_t *hash,
+                         const void **key,
+                         size_t *key_size,
+                         const void **val,
+                         size_t *val_size );
+Constructor SerialWriter *serial__writer_open( FILE *,
+                                               enum SerialKind kind,
+                                               size_t el_size,
+                                               HashFunction hash,
+                                               uint64_t seed,
+                                               uint32_t engine,
+                                               size_t count );
+uint32_t serial__reader_engine( const SerialReader * );
+uint64_t serial__reader_seed( const SerialReader * );
+/** @endcond */
+
+#endif //CLIBS_SERIALIZE_H
@@ -595,11 +595,16 @@ ssize_t string_split( str_t **str_arr_cont,
         }
     }
 
-    const ssize_t count = ( ssize_t ) list_size( ls );
-    *str_arr_cont       = list_items_copy( ls );
+    size_t count;
+    if ( ( *str_arr_cont = list_release_buffer( ls, &count ) ) == NULL )
+    {
+        for ( size_t i = 0; i < list_size( ls ); ++i )
+            free( list_fetch( ls, i, str_t ) );
+        list_destroy( ls );
+        return f_stack_trace( RV_ERROR );
+    }
 
-    list_destroy( ls );
-    return count;
+    return ( ssize_t ) count;
 }
 
 ssize_t string_split_regex( str_t **str_arr_cont,
@@ -676,10 +681,14 @@ ssize_t string_split_regex( str_t **str_arr_cont,
     }
     while ( regmatch.rm_eo != -1 && regmatch.rm_so != -1 );
 
-    *str_arr_cont      = list_items_copy( ls );
-    const size_t count = list_size( ls );
-
-    list_destroy( ls );
+    size_t count;
+    if ( ( *str_arr_cont = list_release_buffer( ls, &count ) ) == NULL )
+    {
+        for ( size_t i = 0; i < list_size( ls ); ++i )
+            free( list_fetch( ls, i, str_t ) );
+        list_destroy( ls );
+        return f_stack_trace( RV_ERROR );
+    }
 
     return ( ssize_t ) count;
 }
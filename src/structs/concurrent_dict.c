@@ -0,0 +1,733 @@
+#include "concurrent_dict.h"
+
+#include "../headers/atomics.h"
+#include "../headers/errors.h"
+#include "../headers/stdc_versions.h" /* STANDARD_C11_VERSION */
+
+#include <pthread.h>
+#include <sched.h>  /* sched_yield */
+#include <stdlib.h> /* alloc */
+#include <string.h> /* memcpy, memcmp */
+
+
+#if defined( __STDC_VERSION__ ) && __STDC_VERSION__ >= STANDARD_C11_VERSION
+#define CDICT_THREAD_LOCAL _Thread_local
+#else
+#define CDICT_THREAD_LOCAL __thread
+#endif
+
+
+/** Keys and values of at most this many bytes are stored inline, in their slot */
+#define CDICT_INLINE_SIZE  16
+#define CDICT_INLINE_WORDS ( CDICT_INLINE_SIZE / sizeof( uint64_t ) )
+
+#define CDICT_MIN_CAP 16
+
+/** Retired blocks a shard collects before trying to free them */
+#define CDICT_RECLAIM_EVERY 64
+
+/** Busy-wait iterations before a waiting lookup starts yielding the CPU */
+#define CDICT_SPINS 64
+
+
+/* -------- Epochs -------- */
+
+/*
+ * Every thread that looks anything up has a `cdict_reader`, whose `epoch` is 0
+ * outside of lookups and the global epoch it started in during one.
+ *
+ * A writer first unlinks a block (so that lookups starting from then on can't
+ * reach it), then retires it along with the current global epoch. The lookups
+ * which may still be reading it started no later than that, so once every
+ * thread is either outside of a lookup or in a later epoch, the block is freed.
+ * Writers advance the global epoch whenever they try to free blocks.
+ *
+ * This relies on the order of the unlinking stores, the announcements,
+ * and the loads of the pointers lookups follow being the same for all threads,
+ * so all of those are sequentially consistent (stand-alone fences would do,
+ * but ThreadSanitizer doesn't understand them).
+ *
+ * The readers are shared by all dictionaries; a thread gets its own on its first
+ * lookup and gives it up when it exits. They are never freed.
+ */
+struct cdict_reader {
+    uint64_t epoch;
+    bool in_use; // owned by a (live) thread
+    struct cdict_reader *next;
+
+    byte pad[ CLIBS_CACHE_LINE ];
+};
+
+Private struct cdict_reader *cdict_readers = NULL; // only ever pushed to
+Private uint64_t cdict_epoch               = 1;
+
+Private pthread_once_t cdict_key_once = PTHREAD_ONCE_INIT;
+Private pthread_key_t cdict_key; // releases the reader of an exiting thread
+Private bool cdict_key_ok = false;
+
+Private CDICT_THREAD_LOCAL struct cdict_reader *cdict_self = NULL;
+
+
+/** Waits a little before a lookup retries */
+Private void cdict_backoff( unsigned *spins )
+{
+    if ( *spins < CDICT_SPINS )
+    {
+        ++*spins;
+#if defined( __x86_64__ ) || defined( __i386__ )
+        __builtin_ia32_pause();
+#endif
+        return;
+    }
+    sched_yield();
+}
+
+
+Private void cdict_reader_release( void *reader )
+{
+    atomic_store_release( &( ( struct cdict_reader * ) reader )->in_use, false );
+}
+
+Private void cdict_key_create( void )
+{
+    cdict_key_ok = pthread_key_create( &cdict_key, cdict_reader_release ) == 0;
+}
+
+/** @return the reader of the current thread, or `NULL` if it can't get one */
+Private struct cdict_reader *cdict_reader_self( void )
+{
+    if ( cdict_self != NULL )
+        return cdict_self;
+
+    pthread_once( &cdict_key_once, cdict_key_create );
+    if ( !cdict_key_ok )
+        return NULL;
+
+    // reuse one given up by an exited thread
+    struct cdict_reader *reader = atomic_load_acquire( &cdict_readers );
+    for ( ; reader != NULL; reader = reader->next )
+    {
+        bool expected = false;
+        if ( !atomic_load_relaxed( &reader->in_use )
+             && atomic_cas_seq_cst( &reader->in_use, &expected, true ) )
+            break;
+    }
+
+    if ( reader == NULL )
+    {
+        void *memory = NULL;
+        if ( posix_memalign( &memory, CLIBS_CACHE_LINE, sizeof( struct cdict_reader ) )
+             != 0 )
+            return fwarn_ret( NULL, "posix_memalign" );
+
+        reader = memset( memory, 0, sizeof( struct cdict_reader ) );
+        reader->in_use = true;
+        reader->next   = atomic_load_relaxed( &cdict_readers );
+        while ( !atomic_cas_seq_cst( &cdict_readers, &reader->next, reader ) )
+            ;
+    }
+
+    if ( pthread_setspecific( cdict_key, reader ) != 0 )
+    {
+        cdict_reader_release( reader );
+        return NULL;
+    }
+    return cdict_self = reader;
+}
+
+/**
+ * Starts a lookup.
+ *
+ * @return the reader of the thread, or `NULL` if the lookup must lock the shard
+ */
+Private struct cdict_reader *cdict_read_begin( void )
+{
+    struct cdict_reader *self = cdict_reader_self();
+    if ( self == NULL )
+        return NULL;
+
+    atomic_store_seq_cst( &self->epoch, atomic_load_seq_cst( &cdict_epoch ) );
+    return self;
+}
+
+Private void cdict_read_end( struct cdict_reader *self )
+{
+    atomic_store_release( &self->epoch, 0 );
+}
+
+/** @return the oldest epoch a lookup is running in (`UINT64_MAX` if there is none) */
+Private uint64_t cdict_oldest_epoch( void )
+{
+    uint64_t oldest = UINT64_MAX;
+    for ( const struct cdict_reader *reader = atomic_load_acquire( &cdict_readers );
+          reader != NULL; reader = reader->next )
+    {
+        const uint64_t epoch = atomic_load_seq_cst( &reader->epoch );
+        if ( epoch != 0 && epoch < oldest )
+            oldest = epoch;
+    }
+    return oldest;
+}
+
+
+/* -------- Tables -------- */
+
+enum cdict_slot_state {
+    CDICT_EMPTY   = 0, // terminates every probe sequence
+    CDICT_FULL    = 1,
+    CDICT_REMOVED = 2, // tombstone; never reused
+};
+
+/** Either a heap copy or the data itself, depending on its size */
+union cdict_data {
+    void *ptr;
+    uint64_t words[ CDICT_INLINE_WORDS ];
+};
+
+/**
+ * The key of a slot is written once, before the slot is published (`state`),
+ * and never changes. The value may be replaced (under the seqlock of the shard),
+ * so lookups load it one word at a time.
+ */
+struct cdict_slot {
+    uint64_t hash;
+    size_t key_size;
+    union cdict_data key;
+
+    size_t val_size;
+    union cdict_data val;
+
+    uint8_t state; // `enum cdict_slot_state`
+};
+
+struct cdict_table {
+    size_t capacity; // power of two
+    size_t max_used; // resize once `n_items + n_removed` would exceed this
+    struct cdict_slot slots[];
+};
+
+/** A block waiting for the lookups that may read it to end */
+struct cdict_retired {
+    void *block;
+    uint64_t epoch;
+};
+
+struct cdict_shard {
+    /* read by lookups */
+    size_t seq; // odd while a value is being replaced
+    struct cdict_table *table;
+
+    byte pad_0[ CLIBS_CACHE_LINE ];
+
+    /* writers only (under `lock`) */
+    pthread_mutex_t lock;
+    size_t n_items; // also read by `cdict_size()`
+    size_t n_removed;
+
+    struct cdict_retired *retired;
+    size_t n_retired;
+    size_t retired_cap;
+
+    byte pad_1[ CLIBS_CACHE_LINE ];
+};
+
+struct concurrent_dict {
+    HashFunction hash;
+    uint64_t seed;
+
+    struct cdict_shard *shards;
+    size_t n_shards;     // power of two
+    unsigned shard_bits; // log2( n_shards )
+};
+
+
+Private inline const void *cdict_data_get( const union cdict_data *data,
+                                           const size_t size )
+{
+    return size <= CDICT_INLINE_SIZE ? ( const void * ) data->words : data->ptr;
+}
+
+/** Copies `size` bytes of `src` into `data` (inline if they fit) */
+Private int cdict_data_init( union cdict_data *data, const void *src, const size_t size )
+{
+    memset( data, 0, sizeof( union cdict_data ) );
+    if ( size <= CDICT_INLINE_SIZE )
+    {
+        memcpy( data->words, src, size );
+        return RV_SUCCESS;
+    }
+
+    if ( ( data->ptr = malloc( size ) ) == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+    memcpy( data->ptr, src, size );
+    return RV_SUCCESS;
+}
+
+Private inline bool cdict_slot_is( const struct cdict_slot *slot,
+                                   const uint64_t hash,
+                                   const void *key,
+                                   const size_t key_size )
+{
+    return slot->hash == hash && slot->key_size == key_size
+           && memcmp( cdict_data_get( &slot->key, key_size ), key, key_size ) == 0;
+}
+
+/** Load factor 3/4; at least one slot always stays empty */
+Private struct cdict_table *cdict_table_init( const size_t capacity )
+{
+    struct cdict_table *table =
+            calloc( 1, sizeof( struct cdict_table )
+                               + capacity * sizeof( struct cdict_slot ) );
+    if ( table == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    table->capacity = capacity;
+    table->max_used = capacity - capacity / 4;
+    return table;
+}
+
+/**
+ * Walks the probe sequence of `key`; lookups may do so concurrently with a writer.
+ *
+ * @return the slot of `key`, or `NULL` if it isn't in the table
+ */
+Private struct cdict_slot *cdict_table_find( struct cdict_table *table,
+                                             const void *key,
+                                             const size_t key_size,
+                                             const uint64_t hash )
+{
+    const size_t mask = table->capacity - 1;
+    for ( size_t index = hash & mask;; index = ( index + 1 ) & mask )
+    {
+        struct cdict_slot *slot = table->slots + index;
+
+        // the key of the slot is only read once it's been published
+        const uint8_t state = atomic_load_seq_cst( &slot->state );
+        if ( state == CDICT_EMPTY )
+            return NULL;
+        if ( state == CDICT_FULL && cdict_slot_is( slot, hash, key, key_size ) )
+            return slot;
+    }
+}
+
+
+/** @return the first empty slot of the probe sequence of `hash` (writers only) */
+Private struct cdict_slot *cdict_table_empty( struct cdict_table *table,
+                                              const uint64_t hash )
+{
+    const size_t mask = table->capacity - 1;
+    size_t index      = hash & mask;
+    while ( table->slots[ index ].state != CDICT_EMPTY )
+        index = ( index + 1 ) & mask;
+    return table->slots + index;
+}
+
+
+/* -------- Shards -------- */
+
+Private inline uint64_t cdict_hash( const ConcurrentDict *dict,
+                                    const void *key,
+                                    const size_t key_size )
+{
+    return dict->hash( key, key_size, dict->seed );
+}
+
+/** The top bits pick the shard, the bottom ones the slot */
+Private inline struct cdict_shard *cdict_shard_of( const ConcurrentDict *dict,
+                                                   const uint64_t hash )
+{
+    if ( dict->shard_bits == 0 )
+        return dict->shards;
+    return dict->shards + ( hash >> ( 64 - dict->shard_bits ) );
+}
+
+Private void cdict_reclaim( struct cdict_shard *shard )
+{
+    atomic_add_seq_cst( &cdict_epoch, 1 );
+    const uint64_t oldest = cdict_oldest_epoch();
+
+    size_t n_kept = 0;
+    for ( size_t i = 0; i < shard->n_retired; ++i )
+        if ( shard->retired[ i ].epoch < oldest )
+            free( shard->retired[ i ].block );
+        else
+            shard->retired[ n_kept++ ] = shard->retired[ i ];
+    shard->n_retired = n_kept;
+}
+
+/**
+ * Frees `block` once no lookup can be reading it;
+ * it must already be unreachable for new lookups
+ */
+Private void cdict_retire( struct cdict_shard *shard, void *block, const bool now )
+{
+    const uint64_t epoch = atomic_load_seq_cst( &cdict_epoch );
+
+    if ( shard->n_retired == shard->retired_cap )
+    {
+        const size_t new_cap  = shard->retired_cap == 0 ? 16 : 2 * shard->retired_cap;
+        struct cdict_retired *retired =
+                realloc( shard->retired, new_cap * sizeof( struct cdict_retired ) );
+        if ( retired == NULL )
+        {
+            // nowhere to keep it: wait until it can be freed right away
+            fwarn( "realloc" );
+            for ( unsigned spins = 0; cdict_oldest_epoch() <= epoch; )
+            {
+                atomic_add_seq_cst( &cdict_epoch, 1 );
+                cdict_backoff( &spins );
+            }
+            free( block );
+            return;
+        }
+        shard->retired     = retired;
+        shard->retired_cap = new_cap;
+    }
+
+    shard->retired[ shard->n_retired++ ] = ( struct cdict_retired ) {
+        .block = block,
+        .epoch = epoch,
+    };
+    if ( now || shard->n_retired >= CDICT_RECLAIM_EVERY )
+        cdict_reclaim( shard );
+}
+
+/** Retires the heap copies (if any) of the key and value of `slot` */
+Private void cdict_retire_data( struct cdict_shard *shard, const struct cdict_slot *slot )
+{
+    if ( slot->key_size > CDICT_INLINE_SIZE )
+        cdict_retire( shard, slot->key.ptr, false );
+    if ( slot->val_size > CDICT_INLINE_SIZE )
+        cdict_retire( shard, slot->val.ptr, false );
+}
+
+/**
+ * Moves the items into a new table of `capacity` slots, dropping the tombstones.
+ * Heap copies are shared by both tables, the old one is retired.
+ */
+Private int cdict_rebuild( struct cdict_shard *shard, const size_t capacity )
+{
+    struct cdict_table *old   = shard->table;
+    struct cdict_table *table = cdict_table_init( capacity );
+    if ( table == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    for ( size_t i = 0; i < old->capacity; ++i )
+    {
+        const struct cdict_slot *slot = old->slots + i;
+        if ( slot->state != CDICT_FULL )
+            continue;
+
+        *cdict_table_empty( table, slot->hash ) = *slot;
+    }
+
+    // the new table is complete before lookups can see it
+    atomic_store_seq_cst( &shard->table, table );
+    shard->n_removed = 0;
+
+    cdict_retire( shard, old, true );
+    return RV_SUCCESS;
+}
+
+/** Makes room for one more item */
+Private int cdict_make_room( struct cdict_shard *shard )
+{
+    const struct cdict_table *table = shard->table;
+    if ( shard->n_items + shard->n_removed + 1 <= table->max_used )
+        return RV_SUCCESS;
+
+    // mostly tombstones => rebuilt at the same capacity
+    const size_t new_cap = ( shard->n_items + 1 ) * 2 > table->max_used
+                                   ? table->capacity * 2
+                                   : table->capacity;
+    return cdict_rebuild( shard, new_cap );
+}
+
+
+/* -------- Lookups -------- */
+
+/** A value as loaded by a lookup */
+struct cdict_val {
+    size_t size;
+    union cdict_data data;
+};
+
+/**
+ * Looks `key` up in `shard`, retrying for as long as a value is being replaced
+ * meanwhile.
+ * Unless the shard is locked, the caller must be in a lookup (`cdict_read_begin()`).
+ */
+Private bool cdict_read( struct cdict_shard *shard,
+                         const void *key,
+                         const size_t key_size,
+                         const uint64_t hash,
+                         struct cdict_val *val )
+{
+    for ( unsigned spins = 0;; )
+    {
+        const size_t seq = atomic_load_acquire( &shard->seq );
+        if ( seq % 2 == 1 )
+        {
+            cdict_backoff( &spins );
+            continue;
+        }
+
+        struct cdict_slot *slot =
+                cdict_table_find( atomic_load_seq_cst( &shard->table ), key, key_size,
+                                  hash );
+        if ( slot != NULL && val != NULL )
+        {
+            // a word of a new value would make the odd `seq` visible below
+            val->size = atomic_load_seq_cst( &slot->val_size );
+            for ( size_t i = 0; i < CDICT_INLINE_WORDS; ++i )
+                val->data.words[ i ] = atomic_load_seq_cst( &slot->val.words[ i ] );
+        }
+
+        // the value is only consistent if no replacement overlapped the loads
+        if ( atomic_load_relaxed( &shard->seq ) == seq )
+            return slot != NULL;
+    }
+}
+
+int64_t cdict_get_val( const ConcurrentDict *dict,
+                       const void *key,
+                       const size_t key_size,
+                       void *val_cont,
+                       const size_t cont_size )
+{
+    const uint64_t hash       = cdict_hash( dict, key, key_size );
+    struct cdict_shard *shard = cdict_shard_of( dict, hash );
+
+    struct cdict_reader *self = cdict_read_begin();
+    if ( self == NULL )
+        pthread_mutex_lock( &shard->lock );
+
+    struct cdict_val val = { 0 };
+    const bool found = cdict_read( shard, key, key_size, hash, &val );
+    // a heap copy stays valid until the end of the lookup
+    if ( found && val_cont != NULL && val.size <= cont_size )
+        memcpy( val_cont, cdict_data_get( &val.data, val.size ), val.size );
+
+    if ( self == NULL )
+        pthread_mutex_unlock( &shard->lock );
+    else
+        cdict_read_end( self );
+
+    return found ? ( int64_t ) val.size : -1;
+}
+
+bool cdict_has_key( const ConcurrentDict *dict, const void *key, const size_t key_size )
+{
+    return cdict_get_val( dict, key, key_size, NULL, 0 ) >= 0;
+}
+
+
+/* -------- Writers -------- */
+
+int cdict_insert( ConcurrentDict *dict,
+                  const void *key,
+                  const size_t key_size,
+                  const void *val,
+                  const size_t val_size )
+{
+    const uint64_t hash       = cdict_hash( dict, key, key_size );
+    struct cdict_shard *shard = cdict_shard_of( dict, hash );
+
+    pthread_mutex_lock( &shard->lock );
+
+    int rv = DICTINSERT_WAS_IN;
+    if ( cdict_table_find( shard->table, key, key_size, hash ) != NULL )
+        goto UNLOCK;
+
+    rv = RV_ERROR;
+    if ( cdict_make_room( shard ) != RV_SUCCESS )
+        goto UNLOCK;
+
+    struct cdict_slot *slot = cdict_table_empty( shard->table, hash );
+
+    // the slot is empty, so no lookup reads it until it's published
+    slot->hash     = hash;
+    slot->key_size = key_size;
+    slot->val_size = val_size;
+    if ( cdict_data_init( &slot->key, key, key_size ) != RV_SUCCESS )
+        goto UNLOCK;
+    if ( cdict_data_init( &slot->val, val, val_size ) != RV_SUCCESS )
+    {
+        if ( key_size > CDICT_INLINE_SIZE )
+            free( slot->key.ptr );
+        goto UNLOCK;
+    }
+
+    atomic_store_release( &slot->state, ( uint8_t ) CDICT_FULL );
+    atomic_store_relaxed( &shard->n_items, shard->n_items + 1 );
+    rv = DICTINSERT_INSERTED;
+
+UNLOCK:
+    pthread_mutex_unlock( &shard->lock );
+    return rv == RV_ERROR ? f_stack_trace( RV_ERROR ) : rv;
+}
+
+int cdict_set_val( ConcurrentDict *dict,
+                   const void *key,
+                   const size_t key_size,
+                   const void *val,
+                   const size_t val_size )
+{
+    const uint64_t hash       = cdict_hash( dict, key, key_size );
+    struct cdict_shard *shard = cdict_shard_of( dict, hash );
+
+    pthread_mutex_lock( &shard->lock );
+
+    struct cdict_slot *slot = cdict_table_find( shard->table, key, key_size, hash );
+    if ( slot == NULL )
+    {
+        pthread_mutex_unlock( &shard->lock );
+        return fwarnx_ret( RV_EXCEPTION, "couldn't find key" );
+    }
+
+    union cdict_data new_val;
+    if ( cdict_data_init( &new_val, val, val_size ) != RV_SUCCESS )
+    {
+        pthread_mutex_unlock( &shard->lock );
+        return f_stack_trace( RV_ERROR );
+    }
+    const size_t old_size      = slot->val_size;
+    const union cdict_data old = slot->val;
+
+    // lookups which overlap this see an odd or a changed `seq` and retry
+    const size_t seq = shard->seq;
+    atomic_store_relaxed( &shard->seq, seq + 1 );
+
+    // each of these releases the odd `seq`
+    atomic_store_seq_cst( &slot->val_size, val_size );
+    for ( size_t i = 0; i < CDICT_INLINE_WORDS; ++i )
+        atomic_store_seq_cst( &slot->val.words[ i ], new_val.words[ i ] );
+
+    atomic_store_release( &shard->seq, seq + 2 );
+
+    if ( old_size > CDICT_INLINE_SIZE )
+        cdict_retire( shard, old.ptr, false );
+
+    pthread_mutex_unlock( &shard->lock );
+    return RV_SUCCESS;
+}
+
+enum DictRemoveRV cdict_remove( ConcurrentDict *dict,
+                                const void *key,
+                                const size_t key_size )
+{
+    const uint64_t hash       = cdict_hash( dict, key, key_size );
+    struct cdict_shard *shard = cdict_shard_of( dict, hash );
+
+    pthread_mutex_lock( &shard->lock );
+
+    struct cdict_slot *slot = cdict_table_find( shard->table, key, key_size, hash );
+    if ( slot == NULL )
+    {
+        pthread_mutex_unlock( &shard->lock );
+        return DICTREMOVE_NOT_FOUND;
+    }
+
+    atomic_store_seq_cst( &slot->state, ( uint8_t ) CDICT_REMOVED );
+    atomic_store_relaxed( &shard->n_items, shard->n_items - 1 );
+    ++shard->n_removed;
+    cdict_retire_data( shard, slot );
+
+    // shrink once used to less than a quarter of the max load;
+    // failing to is harmless, the item has been removed either way
+    const struct cdict_table *table = shard->table;
+    if ( table->capacity > CDICT_MIN_CAP && shard->n_items < table->max_used / 4
+         && cdict_rebuild( shard, table->capacity / 2 ) != RV_SUCCESS )
+        fwarnx( "couldn't shrink the table" );
+
+    pthread_mutex_unlock( &shard->lock );
+    return DICTREMOVE_REMOVED;
+}
+
+
+/* -------- Init/destroy -------- */
+
+ConcurrentDict *cdict_init_with( const size_t n_shards,
+                                 const HashFunction hash,
+                                 const uint64_t seed )
+{
+    ConcurrentDict *dict = calloc( 1, sizeof( ConcurrentDict ) );
+    if ( dict == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    dict->hash     = hash != NULL ? hash : hash_bytes;
+    dict->seed     = seed;
+    dict->n_shards = 1;
+    while ( dict->n_shards < ( n_shards == 0 ? CDICT_DEF_SHARDS : n_shards ) )
+    {
+        dict->n_shards *= 2;
+        ++dict->shard_bits;
+    }
+
+    if ( ( dict->shards = calloc( dict->n_shards, sizeof( struct cdict_shard ) ) )
+         == NULL )
+    {
+        free( dict );
+        return fwarn_ret( NULL, "calloc" );
+    }
+
+    for ( size_t i = 0; i < dict->n_shards; ++i )
+    {
+        struct cdict_shard *shard = dict->shards + i;
+        if ( ( shard->table = cdict_table_init( CDICT_MIN_CAP ) ) == NULL
+             || pthread_mutex_init( &shard->lock, NULL ) != 0 )
+        {
+            free( shard->table );
+            shard->table = NULL;
+            dict->n_shards = i; // the ones that are complete
+            cdict_destroy( dict );
+            return fwarnx_ret( NULL, "shard init failed" );
+        }
+    }
+
+    return dict;
+}
+
+ConcurrentDict *cdict_init( void )
+{
+    return cdict_init_with( CDICT_DEF_SHARDS, hash_bytes, HASH_DEFAULT_SEED );
+}
+
+void cdict_destroy( ConcurrentDict *dict )
+{
+    for ( size_t i = 0; i < dict->n_shards; ++i )
+    {
+        struct cdict_shard *shard = dict->shards + i;
+
+        struct cdict_table *table = shard->table;
+        for ( size_t s = 0; s < table->capacity; ++s )
+        {
+            const struct cdict_slot *slot = table->slots + s;
+            if ( slot->state != CDICT_FULL )
+                continue;
+            if ( slot->key_size > CDICT_INLINE_SIZE )
+                free( slot->key.ptr );
+            if ( slot->val_size > CDICT_INLINE_SIZE )
+                free( slot->val.ptr );
+        }
+        free( table );
+
+        // nobody is looking anything up anymore
+        for ( size_t r = 0; r < shard->n_retired; ++r )
+            free( shard->retired[ r ].block );
+        free( shard->retired );
+
+        pthread_mutex_destroy( &shard->lock );
+    }
+
+    free( dict->shards );
+    free( dict );
+}
+
+size_t cdict_size( const ConcurrentDict *dict )
+{
+    size_t size = 0;
+    for ( size_t i = 0; i < dict->n_shards; ++i )
+        size += atomic_load_relaxed( &dict->shards[ i ].n_items );
+    return size;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file concurrent_dict.h
+ * @brief A hash table of key-value pairs shared by many threads.
+ *
+ * Keys and values are arrays of bytes, copied in and out, like in `Dictionary`
+ * (see dictionary.h), and the functions have the same semantics as theirs.
+ *
+ * The table is split into shards (a power of two of them), picked by the top bits
+ * of the hash of the key. Each shard is an open-addressing table of its own,
+ * with its own writer lock, and grows and shrinks on its own.
+ *
+ * Lookups take no lock and write no shared memory:
+ *  - inserts and removes become visible to them at a single store
+ *    (a slot never changes its key, removed keys leave a tombstone behind)
+ *  - values are replaced in place, under a sequence counter of the shard;
+ *    a lookup which overlapped a replacement is retried (seqlock)
+ *  - tables and heap copies replaced by a writer are freed only once
+ *    no lookup can still be reading them: every thread announces the epoch
+ *    it started a lookup in (epoch-based reclamation, like RCU)
+ * A thread is registered for the epochs on its first lookup; should that fail
+ * (allocation), its lookups lock the shard instead.
+ *
+ * Memory comes from `malloc()` (allocators aren't thread-safe).
+ * Apart from init and destroy, all functions are thread-safe.
+ */
+
+#ifndef CLIBS_CONCURRENT_DICT_H
+#define CLIBS_CONCURRENT_DICT_H
+
+#include "../headers/attributes.h"
+#include "../headers/hash.h" /* HashFunction */
+#include "../headers/types.h"
+#include "dictionary.h"      /* enum DictInsertRV, enum DictRemoveRV */
+
+
+typedef struct concurrent_dict ConcurrentDict;
+
+
+/** Default number of shards */
+#define CDICT_DEF_SHARDS 64
+
+
+/**
+ * Initializes a `ConcurrentDict` with `CDICT_DEF_SHARDS` shards.
+ *
+ * @return pointer to a new ConcurrentDict, or `NULL` if allocation fails
+ */
+Constructor ConcurrentDict *cdict_init( void );
+/**
+ * Initializes a `ConcurrentDict`.
+ *
+ * @param n_shards  rounded up to a power of two; 0 for `CDICT_DEF_SHARDS`
+ * @param hash      hash function; `NULL` means the default (`hash_bytes()`)
+ * @param seed      passed to every `hash` call
+ * @return pointer to a new ConcurrentDict, or `NULL` if allocation fails
+ */
+Constructor ConcurrentDict *cdict_init_with( size_t n_shards,
+                                             HashFunction hash,
+                                             uint64_t seed );
+/** Frees all memory owned by the dictionary; no other thread may be using it */
+void cdict_destroy( ConcurrentDict * );
+
+/**
+ * Inserts a copy of `val` under a copy of `key`, unless `key` is in already.
+ *
+ * @return `RV_ERROR` | `enum DictInsertRV`
+ */
+int cdict_insert( ConcurrentDict *,
+                  const void *key,
+                  size_t key_size,
+                  const void *val,
+                  size_t val_size );
+
+/**
+ * Replaces the value stored under `key` by a copy of `val`.
+ *
+ * @return `RV_EXCEPTION` if there is no `key`, `RV_ERROR` on alloc failure,
+ *         else `RV_SUCCESS`
+ */
+int cdict_set_val( ConcurrentDict *,
+                   const void *key,
+                   size_t key_size,
+                   const void *val,
+                   size_t val_size );
+
+enum DictRemoveRV cdict_remove( ConcurrentDict *, const void *key, size_t key_size );
+
+bool cdict_has_key( const ConcurrentDict *, const void *key, size_t key_size );
+
+/**
+ * Copies the value stored under `key` into `val_cont`.
+ *
+ * Unlike `dict_get_val()`, this can't return a pointer into the table,
+ * since another thread may replace the value at any time.
+ *
+ * @param val_cont  space for `cont_size` bytes, or `NULL`;
+ *                  the value is only copied if it fits
+ * @return size of the value, or -1 if there is no `key`
+ */
+int64_t cdict_get_val( const ConcurrentDict *,
+                       const void *key,
+                       size_t key_size,
+                       void *val_cont,
+                       size_t cont_size );
+
+/** @return number of items; only exact if no other thread is modifying the dictionary */
+size_t cdict_size( const ConcurrentDict * );
+
+#endif //CLIBS_CONCURRENT_DICT_H
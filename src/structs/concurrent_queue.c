@@ -0,0 +1,375 @@
+#include "concurrent_queue.h"
+
+#include "../headers/atomics.h"
+#include "../headers/errors.h"
+#include "../headers/simple_math.h" /* min_u64 */
+
+#include <sched.h>  /* sched_yield */
+#include <stddef.h> /* ptrdiff_t */
+#include <stdlib.h> /* alloc */
+#include <string.h> /* memcpy */
+
+
+/** Busy-wait iterations before a blocking call starts yielding the CPU */
+#define CQUEUE_SPINS 64
+
+
+/** Waits a little before a blocking operation retries */
+Private void cqueue_backoff( unsigned *spins )
+{
+    if ( *spins < CQUEUE_SPINS )
+    {
+        ++*spins;
+#if defined( __x86_64__ ) || defined( __i386__ )
+        __builtin_ia32_pause();
+#endif
+        return;
+    }
+    sched_yield();
+}
+
+/** Smallest power of two that is at least `capacity` (and at least 2) */
+Private size_t cqueue_round_cap( const size_t capacity )
+{
+    size_t cap = 2;
+    while ( cap < capacity )
+        cap *= 2;
+    return cap;
+}
+
+
+/* -------- SPSC -------- */
+
+/*
+ * `head` and `tail` only ever grow; slot `i` is `items[ i & mask ]`.
+ *
+ * Each side keeps a cached copy of the other side's index and only reloads it
+ * (which pulls in the other thread's cache line) when the cached value says
+ * the queue is full/empty.
+ */
+struct spsc_queue {
+    byte *items;
+    size_t mask;
+    size_t el_size;
+
+    byte pad_0[ CLIBS_CACHE_LINE ];
+
+    /* consumer */
+    size_t head;
+    size_t cached_tail;
+
+    byte pad_1[ CLIBS_CACHE_LINE ];
+
+    /* producer */
+    size_t tail;
+    size_t cached_head;
+
+    byte pad_2[ CLIBS_CACHE_LINE ];
+};
+
+
+SpscQueue *spsc_queue_init( const size_t el_size, const size_t capacity )
+{
+    if ( el_size == 0 )
+        return fwarnx_ret( NULL, "el_size must not be 0" );
+
+    struct spsc_queue *queue = calloc( 1, sizeof( struct spsc_queue ) );
+    if ( queue == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    const size_t cap = cqueue_round_cap( capacity );
+    if ( ( queue->items = calloc( cap, el_size ) ) == NULL )
+    {
+        free( queue );
+        return fwarn_ret( NULL, "calloc" );
+    }
+
+    queue->mask    = cap - 1;
+    queue->el_size = el_size;
+    return queue;
+}
+
+void spsc_queue_destroy( SpscQueue *queue )
+{
+    free( queue->items );
+    free( queue );
+}
+
+
+/** Copies `count` elements of `src` into the slots starting at `index` */
+Private void spsc_copy_in( struct spsc_queue *queue,
+                           const size_t index,
+                           const void *src,
+                           const size_t count )
+{
+    const size_t start = index & queue->mask;
+    const size_t first = min_u64( count, queue->mask + 1 - start );
+
+    memcpy( queue->items + start * queue->el_size, src, first * queue->el_size );
+    memcpy( queue->items,
+            ( const byte * ) src + first * queue->el_size,
+            ( count - first ) * queue->el_size );
+}
+
+/** Copies `count` elements from the slots starting at `index` to `dest` */
+Private void spsc_copy_out( const struct spsc_queue *queue,
+                            const size_t index,
+                            void *dest,
+                            const size_t count )
+{
+    const size_t start = index & queue->mask;
+    const size_t first = min_u64( count, queue->mask + 1 - start );
+
+    memcpy( dest, queue->items + start * queue->el_size, first * queue->el_size );
+    memcpy( ( byte * ) dest + first * queue->el_size,
+            queue->items,
+            ( count - first ) * queue->el_size );
+}
+
+size_t spsc_queue_try_enqueue_n( SpscQueue *queue, const void *data, const size_t count )
+{
+    const size_t tail     = atomic_load_relaxed( &queue->tail ); // only written here
+    const size_t capacity = queue->mask + 1;
+
+    if ( capacity - ( tail - queue->cached_head ) < count )
+        queue->cached_head = atomic_load_acquire( &queue->head );
+
+    const size_t n = min_u64( count, capacity - ( tail - queue->cached_head ) );
+    if ( n == 0 )
+        return 0;
+
+    spsc_copy_in( queue, tail, data, n );
+    atomic_store_release( &queue->tail, tail + n );
+    return n;
+}
+
+size_t spsc_queue_try_dequeue_n( SpscQueue *queue,
+                                 void *data_cont,
+                                 const size_t max_count )
+{
+    const size_t head = atomic_load_relaxed( &queue->head ); // only written here
+
+    if ( queue->cached_tail - head < max_count )
+        queue->cached_tail = atomic_load_acquire( &queue->tail );
+
+    const size_t n = min_u64( max_count, queue->cached_tail - head );
+    if ( n == 0 )
+        return 0;
+
+    if ( data_cont != NULL )
+        spsc_copy_out( queue, head, data_cont, n );
+    atomic_store_release( &queue->head, head + n );
+    return n;
+}
+
+bool spsc_queue_try_enqueue( SpscQueue *queue, const void *data )
+{
+    return spsc_queue_try_enqueue_n( queue, data, 1 ) == 1;
+}
+
+bool spsc_queue_try_dequeue( SpscQueue *queue, void *data_cont )
+{
+    return spsc_queue_try_dequeue_n( queue, data_cont, 1 ) == 1;
+}
+
+void spsc_queue_enqueue( SpscQueue *queue, const void *data )
+{
+    unsigned spins = 0;
+    while ( !spsc_queue_try_enqueue( queue, data ) )
+        cqueue_backoff( &spins );
+}
+
+void spsc_queue_dequeue( SpscQueue *queue, void *data_cont )
+{
+    unsigned spins = 0;
+    while ( !spsc_queue_try_dequeue( queue, data_cont ) )
+        cqueue_backoff( &spins );
+}
+
+size_t spsc_queue_size( const SpscQueue *queue )
+{
+    const size_t head = atomic_load_acquire( &queue->head );
+    const size_t tail = atomic_load_acquire( &queue->tail );
+    return tail - head;
+}
+
+size_t spsc_queue_capacity( const SpscQueue *queue )
+{
+    return queue->mask + 1;
+}
+
+
+/* -------- MPMC -------- */
+
+/*
+ * Every cell starts with a sequence number (followed by `el_size` bytes of data):
+ *  - `seq == pos`                  -- free for the producer which claims `pos`
+ *  - `seq == pos + 1`              -- full, for the consumer which claims `pos`
+ *  - `seq == pos + capacity`       -- free again, for the next lap
+ *
+ * Producers claim positions by a CAS on `enqueue_pos`, consumers on `dequeue_pos`,
+ * so the two sides never write the same index.
+ */
+struct mpmc_queue {
+    byte *cells;
+    size_t mask;
+    size_t el_size;
+    size_t cell_size; // sequence number + data, rounded up to its alignment
+
+    byte pad_0[ CLIBS_CACHE_LINE ];
+
+    size_t enqueue_pos;
+
+    byte pad_1[ CLIBS_CACHE_LINE ];
+
+    size_t dequeue_pos;
+
+    byte pad_2[ CLIBS_CACHE_LINE ];
+};
+
+#define mpmc_cell( QUEUE, POS )                                                   \
+    ( ( size_t * ) ( ( QUEUE )->cells                                             \
+                     + ( ( POS ) & ( QUEUE )->mask ) * ( QUEUE )->cell_size ) )
+
+#define mpmc_cell_data( CELL ) ( ( byte * ) ( ( CELL ) + 1 ) )
+
+
+MpmcQueue *mpmc_queue_init( const size_t el_size, const size_t capacity )
+{
+    if ( el_size == 0 )
+        return fwarnx_ret( NULL, "el_size must not be 0" );
+
+    struct mpmc_queue *queue = calloc( 1, sizeof( struct mpmc_queue ) );
+    if ( queue == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    const size_t cap = cqueue_round_cap( capacity );
+    queue->mask      = cap - 1;
+    queue->el_size   = el_size;
+    queue->cell_size = ( sizeof( size_t ) + el_size + sizeof( size_t ) - 1 )
+                     & ~( sizeof( size_t ) - 1 );
+
+    if ( ( queue->cells = malloc( cap * queue->cell_size ) ) == NULL )
+    {
+        free( queue );
+        return fwarn_ret( NULL, "malloc" );
+    }
+    for ( size_t pos = 0; pos < cap; ++pos )
+        *mpmc_cell( queue, pos ) = pos;
+
+    return queue;
+}
+
+void mpmc_queue_destroy( MpmcQueue *queue )
+{
+    free( queue->cells );
+    free( queue );
+}
+
+
+bool mpmc_queue_try_enqueue( MpmcQueue *queue, const void *data )
+{
+    size_t pos = atomic_load_relaxed( &queue->enqueue_pos );
+    size_t *cell;
+    for ( ;; )
+    {
+        cell                 = mpmc_cell( queue, pos );
+        const size_t seq     = atomic_load_acquire( cell );
+        const ptrdiff_t diff = ( ptrdiff_t ) ( seq - pos );
+
+        if ( diff == 0 )
+        {
+            // on failure, `pos` is reloaded
+            if ( atomic_cas_weak_relaxed( &queue->enqueue_pos, &pos, pos + 1 ) )
+                break;
+        }
+        else if ( diff < 0 )
+            return false; // the cell still holds the previous lap's item
+        else
+            pos = atomic_load_relaxed( &queue->enqueue_pos );
+    }
+
+    memcpy( mpmc_cell_data( cell ), data, queue->el_size );
+    atomic_store_release( cell, pos + 1 );
+    return true;
+}
+
+bool mpmc_queue_try_dequeue( MpmcQueue *queue, void *data_cont )
+{
+    size_t pos = atomic_load_relaxed( &queue->dequeue_pos );
+    size_t *cell;
+    for ( ;; )
+    {
+        cell                 = mpmc_cell( queue, pos );
+        const size_t seq     = atomic_load_acquire( cell );
+        const ptrdiff_t diff = ( ptrdiff_t ) ( seq - ( pos + 1 ) );
+
+        if ( diff == 0 )
+        {
+            if ( atomic_cas_weak_relaxed( &queue->dequeue_pos, &pos, pos + 1 ) )
+                break;
+        }
+        else if ( diff < 0 )
+            return false; // nothing has been written to the cell yet
+        else
+            pos = atomic_load_relaxed( &queue->dequeue_pos );
+    }
+
+    if ( data_cont != NULL )
+        memcpy( data_cont, mpmc_cell_data( cell ), queue->el_size );
+    atomic_store_release( cell, pos + queue->mask + 1 );
+    return true;
+}
+
+void mpmc_queue_enqueue( MpmcQueue *queue, const void *data )
+{
+    unsigned spins = 0;
+    while ( !mpmc_queue_try_enqueue( queue, data ) )
+        cqueue_backoff( &spins );
+}
+
+void mpmc_queue_dequeue( MpmcQueue *queue, void *data_cont )
+{
+    unsigned spins = 0;
+    while ( !mpmc_queue_try_dequeue( queue, data_cont ) )
+        cqueue_backoff( &spins );
+}
+
+size_t mpmc_queue_try_enqueue_n( MpmcQueue *queue, const void *data, const size_t count )
+{
+    const byte *bytes = data;
+
+    size_t n = 0;
+    while ( n < count && mpmc_queue_try_enqueue( queue, bytes + n * queue->el_size ) )
+        ++n;
+    return n;
+}
+
+size_t mpmc_queue_try_dequeue_n( MpmcQueue *queue,
+                                 void *data_cont,
+                                 const size_t max_count )
+{
+    byte *bytes = data_cont;
+
+    size_t n = 0;
+    for ( ; n < max_count; ++n )
+    {
+        void *dest = bytes != NULL ? bytes + n * queue->el_size : NULL;
+        if ( !mpmc_queue_try_dequeue( queue, dest ) )
+            break;
+    }
+    return n;
+}
+
+size_t mpmc_queue_size( const MpmcQueue *queue )
+{
+    const size_t dequeue_pos = atomic_load_acquire( &queue->dequeue_pos );
+    const size_t enqueue_pos = atomic_load_acquire( &queue->enqueue_pos );
+    // the positions are read at different times, so this may be off (even "negative")
+    return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+}
+
+size_t mpmc_queue_capacity( const MpmcQueue *queue )
+{
+    return queue->mask + 1;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file concurrent_queue.h
+ * @brief Bounded FIFO queues for passing fixed-size items between threads.
+ *
+ * - `SpscQueue`: exactly one producer and one consumer thread;
+ *   every operation is wait-free.
+ * - `MpmcQueue`: any number of producers and consumers (Dmitry Vyukov's
+ *   bounded queue); lock-free, each slot carries a sequence number, so producers
+ *   and consumers only ever contend on their own index.
+ *
+ * Both have a fixed capacity (rounded up to a power of two) and copy `el_size`
+ * bytes in and out, like `Queue`.
+ *
+ * The `try_*` functions never block and return whether they succeeded.
+ * The blocking variants spin (and then yield the CPU) until they can proceed.
+ * The batch (`*_n`) functions move as many items as they can (up to `count`)
+ * and return how many they moved.
+ *
+ * Init and destroy are not thread-safe.
+ */
+
+#ifndef CLIBS_CONCURRENT_QUEUE_H
+#define CLIBS_CONCURRENT_QUEUE_H
+
+#include "../headers/attributes.h"
+#include "../headers/types.h"
+
+
+typedef struct spsc_queue SpscQueue;
+typedef struct mpmc_queue MpmcQueue;
+
+
+/* -------- SPSC -------- */
+
+/**
+ * Initializes a single-producer single-consumer queue.
+ *
+ * @param el_size  `sizeof` a single element
+ * @param capacity max number of elements (rounded up to a power of two)
+ * @return pointer to a valid queue or `NULL`
+ */
+Constructor SpscQueue *spsc_queue_init( size_t el_size, size_t capacity );
+void spsc_queue_destroy( SpscQueue * );
+
+/** @return `false` if the queue is full */
+bool spsc_queue_try_enqueue( SpscQueue *, const void *data );
+/**
+ * @param data_cont space for `el_size` bytes or `NULL`
+ * @return `false` if the queue is empty
+ */
+bool spsc_queue_try_dequeue( SpscQueue *, void *data_cont );
+/** Waits while the queue is full */
+void spsc_queue_enqueue( SpscQueue *, const void *data );
+/** Waits while the queue is empty */
+void spsc_queue_dequeue( SpscQueue *, void *data_cont );
+
+/**
+ * Enqueues the first (up to) `count` elements of `data`, publishing them at once.
+ *
+ * @return number of enqueued elements
+ */
+size_t spsc_queue_try_enqueue_n( SpscQueue *, const void *data, size_t count );
+/**
+ * Dequeues up to `max_count` elements into `data_cont` (if not `NULL`).
+ *
+ * @return number of dequeued elements
+ */
+size_t spsc_queue_try_dequeue_n( SpscQueue *, void *data_cont, size_t max_count );
+
+/** @return number of elements; only exact if neither thread is running */
+size_t spsc_queue_size( const SpscQueue * );
+size_t spsc_queue_capacity( const SpscQueue * );
+
+
+/* -------- MPMC -------- */
+
+/**
+ * Initializes a multi-producer multi-consumer queue.
+ *
+ * @param el_size  `sizeof` a single element
+ * @param capacity max number of elements (rounded up to a power of two, at least 2)
+ * @return pointer to a valid queue or `NULL`
+ */
+Constructor MpmcQueue *mpmc_queue_init( size_t el_size, size_t capacity );
+void mpmc_queue_destroy( MpmcQueue * );
+
+/** @return `false` if the queue is full */
+bool mpmc_queue_try_enqueue( MpmcQueue *, const void *data );
+/**
+ * @param data_cont space for `el_size` bytes or `NULL`
+ * @return `false` if the queue is empty
+ */
+bool mpmc_queue_try_dequeue( MpmcQueue *, void *data_cont );
+/** Waits while the queue is full */
+void mpmc_queue_enqueue( MpmcQueue *, const void *data );
+/** Waits while the queue is empty */
+void mpmc_queue_dequeue( MpmcQueue *, void *data_cont );
+
+/**
+ * Enqueues the first (up to) `count` elements of `data`.
+ *
+ * Other producers' elements may be interleaved with them.
+ *
+ * @return number of enqueued elements
+ */
+size_t mpmc_queue_try_enqueue_n( MpmcQueue *, const void *data, size_t count );
+/**
+ * Dequeues up to `max_count` elements into `data_cont` (if not `NULL`).
+ *
+ * @return number of dequeued elements
+ */
+size_t mpmc_queue_try_dequeue_n( MpmcQueue *, void *data_cont, size_t max_count );
+
+/** @return number of elements; only exact if no thread is running */
+size_t mpmc_queue_size( const MpmcQueue * );
+size_t mpmc_queue_capacity( const MpmcQueue * );
+
+#endif //CLIBS_CONCURRENT_QUEUE_H
@@ -1,35 +1,120 @@
 #include "dictionary.h"
 
+#include "../allocator.h"
 #include "../headers/assert_that.h"
 #include "../headers/errors.h"        /* includes misc.h */
-#include "../headers/misc.h"          /* hash_func(), cmp_size_t(), cmpeq() */
-#include "../headers/pointer_utils.h" /* free_n() */
+#include "../headers/hash.h"          /* hash_bytes() */
+#include "../headers/misc.h"          /* cmp_size_t(), cmpeq() */
+#include "../headers/simple_math.h"   /* min_m */
+#include "../serialize.h"
 
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 
-struct dictionary {
+/**
+ * One open-addressing table (power-of-two capacity).
+ *
+ * A slot is either empty (`!occupied`), a tombstone (`!occupied && removed`)
+ * or occupied.
+ *
+ * Swiss tables (`ctrl != NULL`) also keep one control byte per slot:
+ * `DICT_CTRL_EMPTY`, `DICT_CTRL_DELETED` or the top 7 bits of the item's hash.
+ * Probing scans these a group at a time and only touches the slots whose
+ * control byte matches.
+ */
+struct dict_table {
     struct key_value_pair *items;
-    size_t size;
+    int8_t *ctrl; // `capacity + DICT_GROUP_WIDTH` bytes; `NULL` for linear probing
     size_t capacity;
+    size_t n_items;
+    size_t n_removed;
+};
+
+struct dictionary {
+    HashFunction hash;
+    uint64_t seed;
+    enum DictEngine engine;
+
+    /** All new items go here */
+    struct dict_table table;
+    /**
+     * While rehashing, the previous table; its items are moved into `table`
+     * a few at a time by every insert and remove.
+     * `old.items == NULL` when no rehash is in progress.
+     */
+    struct dict_table old;
+    /** Next slot of `old` to be moved */
+    size_t rehash_idx;
+
+    /** Of the tables and of the keys and values that don't fit inline */
+    const Allocator *allocator;
 };
 
 
+#ifndef DICT_INLINE_SIZE
+/** Keys and values of at most this many bytes are stored inline, in their slot */
+#define DICT_INLINE_SIZE 16
+#endif
+
+/** Either a heap copy or the data itself, depending on its size */
+union kvp_data {
+    void *ptr;
+    byte bytes[ DICT_INLINE_SIZE ];
+};
+
 struct key_value_pair {
-    void *key;
+    union kvp_data key;
     size_t key_size;
+    uint64_t key_hash; // cached `dictionary::hash( key, key_size, dictionary::seed )`
     PrintFunction key_print;
 
-    void *val;
+    union kvp_data val;
     size_t val_size;
     PrintFunction val_print;
 
+    bool occupied;
     bool removed;
 };
 
 
+Private inline const void *kvp_data_get( const union kvp_data *data, const size_t size )
+{
+    return size <= DICT_INLINE_SIZE ? data->bytes : data->ptr;
+}
+
+#define kvp_key( ITEM ) kvp_data_get( &( ITEM )->key, ( ITEM )->key_size )
+#define kvp_val( ITEM ) kvp_data_get( &( ITEM )->val, ( ITEM )->val_size )
+
+/** Copies `size` bytes of `src` into `data` (inline if they fit) */
+Private int kvp_data_init( const Allocator *allocator,
+                           union kvp_data *data,
+                           const void *src,
+                           const size_t size )
+{
+    if ( size <= DICT_INLINE_SIZE )
+    {
+        memcpy( data->bytes, src, size );
+        return RV_SUCCESS;
+    }
+
+    if ( ( data->ptr = allocator_alloc( allocator, size ) ) == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+    memcpy( data->ptr, src, size );
+    return RV_SUCCESS;
+}
+
+Private inline void kvp_data_free( const Allocator *allocator,
+                                   union kvp_data *data,
+                                   const size_t size )
+{
+    if ( size > DICT_INLINE_SIZE )
+        allocator_free( allocator, data->ptr, size );
+}
+
+
 int dict_item_key_cmp( const void *i1, const void *i2 )
 {
     const struct key_value_pair *item1 = i1;
@@ -37,7 +122,7 @@ int dict_item_key_cmp( const void *i1, const void *i2 )
 
     if ( item1->key_size != item2->key_size )
         return cmp_size_t( &item1->key_size, &item2->key_size );
-    return memcmp( item1->key, item2->key, item1->key_size );
+    return memcmp( kvp_key( item1 ), kvp_key( item2 ), item1->key_size );
 }
 
 int dict_item_val_cmp( const void *i1, const void *i2 )
@@ -47,7 +132,7 @@ int dict_item_val_cmp( const void *i1, const void *i2 )
 
     if ( item1->val_size != item2->val_size )
         return cmp_size_t( &item1->val_size, &item2->val_size );
-    return memcmp( item1->val, item2->val, item1->val_size );
+    return memcmp( kvp_val( item1 ), kvp_val( item2 ), item1->val_size );
 }
 
 int dict_item_cmp( const void *i1, const void *i2 )
@@ -60,85 +145,561 @@ int dict_item_cmp( const void *i1, const void *i2 )
 
 
 #define DICT_DEF_CAP 64
+#define DICT_MIN_CAP 16
+
+/** Items moved from the old table by one insert/remove */
+#define DICT_REHASH_MOVES 4
+/** Empty slots of the old table one move may skip over */
+#define DICT_REHASH_EMPTY_VISITS 10
+
+
+/**
+ * Checks the cached hash before comparing the keys themselves,
+ * so that probing past colliding items doesn't need a `memcmp`.
+ */
+Private inline bool kvp_key_eq( const struct key_value_pair *item,
+                                const uint64_t hash,
+                                const void *key,
+                                const size_t key_size )
+{
+    return item->key_hash == hash && item->key_size == key_size
+           && memcmp( kvp_key( item ), key, key_size ) == 0;
+}
 
 
-struct dictionary *dict_init( void )
+Private inline uint64_t dict_hash( const struct dictionary *dict,
+                                   const void *key,
+                                   const size_t key_size )
 {
-    struct dictionary *dict = calloc( 1, sizeof( struct dictionary ) );
-    if ( dict == NULL )
-        return fwarn_ret( NULL, "calloc" );
+    return dict->hash( key, key_size, dict->seed );
+}
+
+
+/* -------- Swiss table control bytes -------- */
 
-    dict->items = calloc( DICT_DEF_CAP, sizeof( struct key_value_pair ) );
-    if ( dict->items == NULL )
+/** Control bytes scanned at once */
+#define DICT_GROUP_WIDTH 16
+
+#define DICT_CTRL_EMPTY   ( ( int8_t ) -128 )
+#define DICT_CTRL_DELETED ( ( int8_t ) -2 )
+
+/** Top 7 bits of the hash; the low bits pick the first probed slot */
+#define dict_h2( HASH ) ( ( int8_t ) ( ( HASH ) >> 57 ) )
+
+
+#if defined( __SSE2__ )
+#include <emmintrin.h>
+
+typedef __m128i dict_group;
+
+Private inline dict_group dict_group_load( const int8_t *ctrl )
+{
+    return _mm_loadu_si128( ( const __m128i * ) ctrl );
+}
+
+/** @return mask with bit `i` set iff the `i`-th control byte is `ctrl` */
+Private inline uint32_t dict_group_match( const dict_group group, const int8_t ctrl )
+{
+    const __m128i match = _mm_cmpeq_epi8( group, _mm_set1_epi8( ctrl ) );
+    return ( uint32_t ) _mm_movemask_epi8( match );
+}
+
+/** @return mask with bit `i` set iff the `i`-th slot is empty or deleted */
+Private inline uint32_t dict_group_match_free( const dict_group group )
+{
+    return ( uint32_t ) _mm_movemask_epi8( group );
+}
+
+#else // scalar fallback
+
+typedef struct {
+    int8_t ctrl[ DICT_GROUP_WIDTH ];
+} dict_group;
+
+Private inline dict_group dict_group_load( const int8_t *ctrl )
+{
+    dict_group group;
+    memcpy( group.ctrl, ctrl, DICT_GROUP_WIDTH );
+    return group;
+}
+
+Private inline uint32_t dict_group_match( const dict_group group, const int8_t ctrl )
+{
+    uint32_t mask = 0;
+    for ( size_t i = 0; i < DICT_GROUP_WIDTH; ++i )
+        mask |= ( uint32_t ) ( group.ctrl[ i ] == ctrl ) << i;
+    return mask;
+}
+
+Private inline uint32_t dict_group_match_free( const dict_group group )
+{
+    uint32_t mask = 0;
+    for ( size_t i = 0; i < DICT_GROUP_WIDTH; ++i )
+        mask |= ( uint32_t ) ( group.ctrl[ i ] < 0 ) << i;
+    return mask;
+}
+
+#endif
+
+
+Private inline void dict_ctrl_set( struct dict_table *table,
+                                   const size_t index,
+                                   const int8_t ctrl )
+{
+    table->ctrl[ index ] = ctrl;
+    // the first group is mirrored after the last slot, so that groups can wrap around
+    if ( index < DICT_GROUP_WIDTH )
+        table->ctrl[ table->capacity + index ] = ctrl;
+}
+
+
+/* -------- Tables -------- */
+
+/** Load factor 3/4 (7/8 for swiss tables); at least one slot always stays empty */
+Private inline size_t dict_max_used( const struct dict_table *table )
+{
+    return table->capacity - table->capacity / ( table->ctrl != NULL ? 8 : 4 );
+}
+
+Private int dict_table_init( struct dict_table *table,
+                             const size_t capacity,
+                             const enum DictEngine engine,
+                             const Allocator *allocator )
+{
+    assert( capacity >= DICT_MIN_CAP && ( capacity & ( capacity - 1 ) ) == 0 );
+
+    if ( ( table->items = allocator_calloc( allocator, capacity,
+                                            sizeof( struct key_value_pair ) ) )
+         == NULL )
+        return fwarn_ret( RV_ERROR, "calloc" );
+
+    table->ctrl = NULL;
+    if ( engine == DICT_ENGINE_SWISS )
     {
-        free( dict );
-        return fwarn_ret( NULL, "calloc" );
+        table->ctrl = allocator_alloc( allocator, capacity + DICT_GROUP_WIDTH );
+        if ( table->ctrl == NULL )
+        {
+            allocator_free( allocator, table->items,
+                            capacity * sizeof( struct key_value_pair ) );
+            table->items = NULL;
+            return fwarn_ret( RV_ERROR, "malloc" );
+        }
+        memset( table->ctrl, DICT_CTRL_EMPTY, capacity + DICT_GROUP_WIDTH );
     }
 
-    dict->capacity = DICT_DEF_CAP;
+    table->capacity  = capacity;
+    table->n_items   = 0;
+    table->n_removed = 0;
 
-    return dict;
+    return RV_SUCCESS;
 }
 
-int dict_insert_f( struct dictionary *dict,
-                   const void *key,
-                   size_t key_size,
-                   const void *val,
-                   size_t val_size,
-                   const PrintFunction key_print,
-                   const PrintFunction val_print )
+Private void dict_table_destroy( struct dict_table *table, const Allocator *allocator )
 {
-    // todo: resize
-    const uint64_t hash = hash_func( key, key_size );
+    for ( size_t i = 0; i < table->capacity; ++i )
+    {
+        struct key_value_pair *item = table->items + i;
+        if ( !item->occupied )
+            continue;
+        kvp_data_free( allocator, &item->key, item->key_size );
+        kvp_data_free( allocator, &item->val, item->val_size );
+    }
+    allocator_free( allocator, table->items,
+                    table->capacity * sizeof( struct key_value_pair ) );
+    if ( table->ctrl != NULL )
+        allocator_free( allocator, table->ctrl, table->capacity + DICT_GROUP_WIDTH );
+    table->items = NULL;
+    table->ctrl  = NULL;
+    table->capacity = table->n_items = table->n_removed = 0;
+}
 
-    const struct key_value_pair new_item = {
-        .key_size = key_size,
-        .val_size = val_size,
-        .key      = ( void * ) key,
-        .val      = ( void * ) val,
-    };
+/** Moves `item` into the free (empty or tombstone) `slot` */
+Private inline void dict_table_occupy( struct dict_table *table,
+                                       struct key_value_pair *slot,
+                                       const struct key_value_pair *item )
+{
+    if ( slot->removed )
+        --table->n_removed;
+    ++table->n_items;
+    *slot = *item;
+
+    if ( table->ctrl != NULL )
+        dict_ctrl_set( table, ( size_t ) ( slot - table->items ),
+                       dict_h2( item->key_hash ) );
+}
+
+/** Turns `slot` into a tombstone; its key and value must already be freed or moved */
+Private inline void dict_table_vacate( struct dict_table *table,
+                                       struct key_value_pair *slot )
+{
+    memset( slot, 0, sizeof *slot );
+    slot->removed = true;
+    --table->n_items;
+    ++table->n_removed;
 
-    for ( size_t i = 0; i < dict->capacity; ++i )
+    if ( table->ctrl != NULL )
+        dict_ctrl_set( table, ( size_t ) ( slot - table->items ), DICT_CTRL_DELETED );
+}
+
+
+/**
+ * `dict_table_find()` for swiss tables.
+ *
+ * Groups are probed quadratically (by 1, 2, 3, ... groups),
+ * which visits every group of a power-of-two table.
+ */
+Private struct key_value_pair *dict_swiss_find( const struct dict_table *table,
+                                                const void *key,
+                                                const size_t key_size,
+                                                const uint64_t hash,
+                                                struct key_value_pair **insert_at )
+{
+    const size_t mask               = table->capacity - 1;
+    const int8_t h2                 = dict_h2( hash );
+    struct key_value_pair *reusable = NULL;
+
+    size_t pos = hash & mask;
+    for ( size_t step = DICT_GROUP_WIDTH;; pos = ( pos + step ) & mask,
+                 step += DICT_GROUP_WIDTH )
     {
-        const size_t index          = ( hash + i ) % dict->capacity;
-        struct key_value_pair *item = dict->items + index;
+        const dict_group group = dict_group_load( table->ctrl + pos );
 
-        if ( item->key != NULL )
+        for ( uint32_t match = dict_group_match( group, h2 ); match != 0;
+              match &= match - 1 )
         {
-            if ( dict_item_key_cmp( &new_item, item ) == 0 )
-                return DICTINSERT_WAS_IN;
+            struct key_value_pair *item =
+                    table->items + ( ( pos + ( size_t ) __builtin_ctz( match ) ) & mask );
+            if ( kvp_key_eq( item, hash, key, key_size ) )
+                return item;
+        }
+
+        const uint32_t free_slots = dict_group_match_free( group );
+        if ( reusable == NULL && free_slots != 0 )
+            reusable = table->items
+                       + ( ( pos + ( size_t ) __builtin_ctz( free_slots ) ) & mask );
+
+        if ( dict_group_match( group, DICT_CTRL_EMPTY ) != 0 )
+            break; // never-used slot => `key` can't be any further
+    }
+
+    if ( insert_at != NULL )
+        *insert_at = reusable;
+    return NULL;
+}
+
+/**
+ * Walks the probe sequence of `key` in one table.
+ *
+ * @param insert_at if not `NULL`, the first reusable slot (tombstone or empty)
+ *                  of the probe sequence is stored here
+ * @return the slot holding `key`, or `NULL` if it isn't in the table
+ */
+Private struct key_value_pair *dict_table_find( const struct dict_table *table,
+                                                const void *key,
+                                                const size_t key_size,
+                                                const uint64_t hash,
+                                                struct key_value_pair **insert_at )
+{
+    if ( table->ctrl != NULL )
+        return dict_swiss_find( table, key, key_size, hash, insert_at );
+
+    const size_t mask               = table->capacity - 1;
+    struct key_value_pair *reusable = NULL;
+
+    size_t index = hash & mask;
+    for ( size_t i = 0; i < table->capacity; ++i, index = ( index + 1 ) & mask )
+    {
+        struct key_value_pair *item = table->items + index;
+
+        if ( !item->occupied )
+        {
+            if ( reusable == NULL )
+                reusable = item;
+            if ( !item->removed )
+                break; // never-used slot => `key` can't be any further
             continue;
         }
 
-        if ( item->key == NULL )
-            dict->size++;
+        if ( kvp_key_eq( item, hash, key, key_size ) )
+            return item;
+    }
+
+    if ( insert_at != NULL )
+        *insert_at = reusable;
+    return NULL;
+}
+
+/**
+ * Looks `key` up in both tables.
+ *
+ * @param table_out if not `NULL`, the table holding the item is stored here
+ */
+Private struct key_value_pair *dict_find( const struct dictionary *dict,
+                                          const void *key,
+                                          const size_t key_size,
+                                          const uint64_t hash,
+                                          const struct dict_table **table_out )
+{
+    struct key_value_pair *item =
+            dict_table_find( &dict->table, key, key_size, hash, NULL );
+    const struct dict_table *in = &dict->table;
 
-        free( item->key );
-        free( item->val );
+    if ( item == NULL && dict->old.items != NULL )
+    {
+        item = dict_table_find( &dict->old, key, key_size, hash, NULL );
+        in   = &dict->old;
+    }
 
-        item->key = malloc( key_size );
-        if ( item->key == NULL )
-            return fwarn_ret( RV_ERROR, "malloc" );
+    if ( table_out != NULL )
+        *table_out = in;
+    return item;
+}
 
-        item->val = malloc( val_size );
-        if ( item->val == NULL )
+
+/**
+ * Moves up to `n_moves` items from the old table into the new one.
+ *
+ * Moved-out slots become tombstones, so that probing in the old table
+ * keeps working for the items that are still there.
+ * The old table is freed once it is empty.
+ */
+Private void dict_rehash_step( struct dictionary *dict, size_t n_moves )
+{
+    if ( dict->old.items == NULL )
+        return;
+
+    struct dict_table *old = &dict->old;
+    size_t n_visits        = n_moves * DICT_REHASH_EMPTY_VISITS;
+
+    while ( n_moves > 0 && n_visits > 0 && dict->rehash_idx < old->capacity )
+    {
+        struct key_value_pair *item = old->items + dict->rehash_idx++;
+        if ( !item->occupied )
         {
-            free( item->key );
-            return fwarn_ret( RV_ERROR, "malloc" );
+            --n_visits;
+            continue;
         }
 
-        memcpy( item->key, key, key_size );
-        memcpy( item->val, val, val_size );
-        item->key_size  = key_size;
-        item->val_size  = val_size;
-        item->key_print = key_print;
-        item->val_print = val_print;
-        item->removed   = false;
+        // the key is unique, so any reusable slot will do
+        struct key_value_pair *slot = NULL;
+        dict_table_find( &dict->table, kvp_key( item ), item->key_size, item->key_hash,
+                         &slot );
+        assert( slot != NULL );
 
-        return DICTINSERT_INSERTED;
+        dict_table_occupy( &dict->table, slot, item );
+        dict_table_vacate( old, item );
+        --n_moves;
+    }
+
+    if ( old->n_items == 0 )
+    {
+        dict_table_destroy( old, dict->allocator );
+        dict->rehash_idx = 0;
     }
+}
+
+Private void dict_rehash_finish( struct dictionary *dict )
+{
+    while ( dict->old.items != NULL )
+        dict_rehash_step( dict, dict->old.capacity );
+}
+
+/**
+ * Starts moving all items into a new table of `new_cap` slots.
+ *
+ * Only allocates the new table; the items are moved by `dict_rehash_step()`.
+ * A rehash that is already in progress is finished first.
+ *
+ * Swiss tables are rebuilt in one go.
+ */
+Private int dict_rehash_start( struct dictionary *dict, const size_t new_cap )
+{
+    dict_rehash_finish( dict );
+
+    struct dict_table new_table;
+    if ( dict_table_init( &new_table, new_cap, dict->engine, dict->allocator )
+         != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    dict->old        = dict->table;
+    dict->table      = new_table;
+    dict->rehash_idx = 0;
+
+    if ( dict->engine == DICT_ENGINE_SWISS )
+        dict_rehash_finish( dict );
+    else if ( dict->old.n_items == 0 )
+        dict_rehash_step( dict, 0 ); // nothing to move, just free it
 
-    return RV_ERROR;
+    return RV_SUCCESS;
+}
+
+/**
+ * Makes room for one more item in `dict->table`.
+ *
+ * If the table is full mostly because of tombstones,
+ * it is rebuilt at the same capacity instead of growing.
+ */
+Private int dict_make_room( struct dictionary *dict )
+{
+    const struct dict_table *table = &dict->table;
+    if ( table->n_items + table->n_removed + 1 <= dict_max_used( table ) )
+        return RV_SUCCESS;
+
+    const size_t size    = dict_size( dict );
+    const size_t new_cap = ( size + 1 ) * 2 > dict_max_used( table )
+                                   ? table->capacity * 2
+                                   : table->capacity;
+
+    return dict_rehash_start( dict, new_cap );
+}
+
+/** Shrinks the table once it is used to less than a quarter of its max load */
+Private int dict_shrink( struct dictionary *dict )
+{
+    const size_t capacity = dict->table.capacity;
+    if ( dict->old.items != NULL || capacity <= DICT_MIN_CAP
+         || dict->table.n_items > dict_max_used( &dict->table ) / 4 )
+        return RV_SUCCESS;
+
+    return dict_rehash_start( dict, capacity / 2 );
+}
+
+
+Private struct dictionary *dict_init_with( const enum DictEngine engine,
+                                           const HashFunction hash,
+                                           const uint64_t seed,
+                                           const Allocator *allocator )
+{
+    if ( engine != DICT_ENGINE_LINEAR && engine != DICT_ENGINE_SWISS )
+        return fwarnx_ret( NULL, "invalid engine: %d", ( int ) engine );
+
+    struct dictionary *dict =
+            allocator_calloc( allocator, 1, sizeof( struct dictionary ) );
+    if ( dict == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    if ( dict_table_init( &dict->table, DICT_DEF_CAP, engine, allocator ) != RV_SUCCESS )
+    {
+        allocator_free( allocator, dict, sizeof( struct dictionary ) );
+        return f_stack_trace( NULL );
+    }
+
+    dict->hash      = hash != NULL ? hash : hash_bytes;
+    dict->seed      = seed;
+    dict->engine    = engine;
+    dict->allocator = allocator;
+
+    return dict;
+}
+
+struct dictionary *dict_init_with_engine( const enum DictEngine engine,
+                                          const HashFunction hash,
+                                          const uint64_t seed )
+{
+    return dict_init_with( engine, hash, seed, allocator_default() );
+}
+
+struct dictionary *dict_init_with_allocator( const Allocator *allocator )
+{
+    return dict_init_with( DICT_ENGINE_LINEAR, hash_bytes, HASH_DEFAULT_SEED,
+                           allocator != NULL ? allocator : allocator_default() );
+}
+
+struct dictionary *dict_init_with_hash( const HashFunction hash, const uint64_t seed )
+{
+    return dict_init_with_engine( DICT_ENGINE_LINEAR, hash, seed );
+}
+
+struct dictionary *dict_init_swiss( void )
+{
+    return dict_init_with_engine( DICT_ENGINE_SWISS, hash_bytes, HASH_DEFAULT_SEED );
+}
+
+struct dictionary *dict_init( void )
+{
+    return dict_init_with_hash( hash_bytes, HASH_DEFAULT_SEED );
+}
+
+/** Fills the free `slot` of `dict->table` with copies of `key` and `val` */
+Private int dict_item_init( struct dictionary *dict,
+                            struct key_value_pair *slot,
+                            const void *key,
+                            const size_t key_size,
+                            const uint64_t hash,
+                            const void *val,
+                            const size_t val_size,
+                            const PrintFunction key_print,
+                            const PrintFunction val_print )
+{
+    struct key_value_pair item = {
+        .key_size  = key_size,
+        .key_hash  = hash,
+        .key_print = key_print,
+        .val_size  = val_size,
+        .val_print = val_print,
+        .occupied  = true,
+        .removed   = false,
+    };
+    if ( kvp_data_init( dict->allocator, &item.key, key, key_size ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+    if ( kvp_data_init( dict->allocator, &item.val, val, val_size ) != RV_SUCCESS )
+    {
+        kvp_data_free( dict->allocator, &item.key, key_size );
+        return f_stack_trace( RV_ERROR );
+    }
+
+    dict_table_occupy( &dict->table, slot, &item );
+    return RV_SUCCESS;
+}
+
+/**
+ * @param hash `dict_hash( dict, key, key_size )`
+ * @return `RV_ERROR` | `enum DictInsertRV`
+ */
+Private int dict_insert_hashed( struct dictionary *dict,
+                                const void *key,
+                                const size_t key_size,
+                                const uint64_t hash,
+                                const void *val,
+                                const size_t val_size,
+                                const PrintFunction key_print,
+                                const PrintFunction val_print )
+{
+    dict_rehash_step( dict, DICT_REHASH_MOVES );
+
+    struct key_value_pair *slot = NULL;
+
+    if ( dict_table_find( &dict->table, key, key_size, hash, &slot ) != NULL
+         || ( dict->old.items != NULL
+              && dict_table_find( &dict->old, key, key_size, hash, NULL ) != NULL ) )
+        return DICTINSERT_WAS_IN;
+
+    const struct key_value_pair *items = dict->table.items;
+    return_on_fail( dict_make_room( dict ) );
+    if ( dict->table.items != items ) // a rehash has started, `slot` is in the old table
+        dict_table_find( &dict->table, key, key_size, hash, &slot );
+
+    return_on_fail( dict_item_init( dict, slot, key, key_size, hash, val, val_size,
+                                    key_print, val_print ) );
+    return DICTINSERT_INSERTED;
+}
+
+int dict_insert_f( struct dictionary *dict,
+                   const void *key,
+                   size_t key_size,
+                   const void *val,
+                   size_t val_size,
+                   const PrintFunction key_print,
+                   const PrintFunction val_print )
+{
+    return dict_insert_hashed( dict,
+                               key,
+                               key_size,
+                               dict_hash( dict, key, key_size ),
+                               val,
+                               val_size,
+                               key_print,
+                               val_print );
 }
 
 int dict_insert( struct dictionary *dict,
@@ -156,29 +717,101 @@ int dict_insert( struct dictionary *dict,
                           ITEM_PRINT_FUNCTION_NAME( byte ) );
 }
 
-Private struct key_value_pair *dict_get_non_const( const struct dictionary *const dict,
-                                                   const void *data,
-                                                   const size_t nbytes )
+
+/** Items hashed (and their slots prefetched) ahead of being inserted */
+#define DICT_BATCH 16
+
+/**
+ * Makes room for `count` items in total, so that inserting them never grows the table;
+ * a rehash in progress is finished
+ */
+Private int dict_reserve( struct dictionary *dict, const size_t count )
 {
-    const uint64_t hash = hash_func( data, nbytes );
+    const size_t load_div = dict->engine == DICT_ENGINE_SWISS ? 8 : 4;
+    size_t capacity       = dict->table.capacity;
+    while ( capacity - capacity / load_div < count + 1 )
+        capacity *= 2;
 
-    const struct key_value_pair search_for = {
-        .key      = ( void * ) data,
-        .key_size = nbytes,
-    };
+    if ( capacity > dict->table.capacity )
+        return_on_fail( dict_rehash_start( dict, capacity ) );
+
+    dict_rehash_finish( dict );
+    return RV_SUCCESS;
+}
+
+Private inline void dict_prefetch( const struct dictionary *dict, const uint64_t hash )
+{
+    const size_t slot = hash & ( dict->table.capacity - 1 );
+    if ( dict->table.ctrl != NULL )
+        __builtin_prefetch( dict->table.ctrl + slot );
+    else
+        __builtin_prefetch( dict->table.items + slot );
+}
 
-    for ( size_t i = 0; i < dict->capacity; ++i )
+int dict_insert_many( struct dictionary *dict,
+                      const void *keys,
+                      const size_t key_size,
+                      const void *vals,
+                      const size_t val_size,
+                      const size_t n )
+{
+    return_on_fail( dict_reserve( dict, dict_size( dict ) + n ) );
+
+    const byte *key_bytes = keys;
+    const byte *val_bytes = vals;
+    for ( size_t first = 0; first < n; first += DICT_BATCH )
     {
-        const size_t index          = ( hash + i ) % dict->capacity;
-        struct key_value_pair *item = dict->items + index;
+        const size_t batch     = min_m( n - first, ( size_t ) DICT_BATCH );
+        const byte *batch_keys = key_bytes + first * key_size;
+        const byte *batch_vals = val_bytes + first * val_size;
 
-        if ( item->key == NULL )
-            continue;
-        if ( dict_item_key_cmp( item, &search_for ) == 0 )
-            return item;
+        // the whole batch is hashed first, so that its misses in the table overlap
+        uint64_t hashes[ DICT_BATCH ];
+        for ( size_t j = 0; j < batch; ++j )
+        {
+            hashes[ j ] = dict_hash( dict, batch_keys + j * key_size, key_size );
+            dict_prefetch( dict, hashes[ j ] );
+        }
+
+        for ( size_t j = 0; j < batch; ++j )
+            if ( dict_insert_hashed( dict,
+                                     batch_keys + j * key_size,
+                                     key_size,
+                                     hashes[ j ],
+                                     batch_vals + j * val_size,
+                                     val_size,
+                                     ITEM_PRINT_FUNCTION_NAME( byte ),
+                                     ITEM_PRINT_FUNCTION_NAME( byte ) )
+                 == RV_ERROR )
+                return f_stack_trace( RV_ERROR );
     }
 
-    return NULL;
+    return RV_SUCCESS;
+}
+
+struct dictionary *dict_from_arrays( const void *keys,
+                                     const size_t key_size,
+                                     const void *vals,
+                                     const size_t val_size,
+                                     const size_t n )
+{
+    struct dictionary *dict = dict_init();
+    if ( dict == NULL )
+        return f_stack_trace( NULL );
+
+    if ( dict_insert_many( dict, keys, key_size, vals, val_size, n ) != RV_SUCCESS )
+    {
+        dict_destroy( dict );
+        return f_stack_trace( NULL );
+    }
+    return dict;
+}
+
+Private struct key_value_pair *dict_get_non_const( const struct dictionary *const dict,
+                                                   const void *data,
+                                                   const size_t nbytes )
+{
+    return dict_find( dict, data, nbytes, dict_hash( dict, data, nbytes ), NULL );
 }
 
 bool dict_has_key( const struct dictionary *dict, const void *key, size_t key_size )
@@ -191,7 +824,30 @@ const void *dict_get_val( const struct dictionary *dict,
                           const size_t key_size )
 {
     const struct key_value_pair *item = dict_get_non_const( dict, key, key_size );
-    return item == NULL ? NULL : item->val;
+    return item == NULL ? NULL : kvp_val( item );
+}
+
+/** Replaces the value of `item` by a copy of `val` */
+Private int kvp_val_replace( const Allocator *allocator,
+                             struct key_value_pair *item,
+                             const void *val,
+                             const size_t val_size )
+{
+    // same size => same storage; `val` may point to the current value
+    if ( val_size == item->val_size )
+    {
+        memmove( ( void * ) kvp_val( item ), val, val_size );
+        return RV_SUCCESS;
+    }
+
+    union kvp_data new_val;
+    if ( kvp_data_init( allocator, &new_val, val, val_size ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    kvp_data_free( allocator, &item->val, item->val_size );
+    item->val      = new_val;
+    item->val_size = val_size;
+    return RV_SUCCESS;
 }
 
 int dict_set_val( struct dictionary *dict,
@@ -204,13 +860,105 @@ int dict_set_val( struct dictionary *dict,
     if ( item == NULL )
         return fwarnx_ret( RV_EXCEPTION, "couldn't find key" );
 
-    free( item->val );
-    item->val = malloc( val_size );
-    if ( item->val == NULL )
-        return fwarn_ret( RV_ERROR, "malloc" );
+    return kvp_val_replace( dict->allocator, item, val, val_size );
+}
 
-    item->val_size = val_size;
-    memcpy( item->val, val, val_size );
+
+/**
+ * Finds the item of `key`, or inserts one with a copy of `val` if there is none,
+ * hashing the key once and walking its probe sequence once (in each table).
+ *
+ * Room for the new item is made before looking, so that its slot stays valid;
+ * at worst, this grows the table one insert early.
+ *
+ * @param inserted  whether the item is new is stored here
+ * @return the item, or `NULL` on alloc failure
+ */
+Private struct key_value_pair *dict_find_or_insert( struct dictionary *dict,
+                                                    const void *key,
+                                                    const size_t key_size,
+                                                    const void *val,
+                                                    const size_t val_size,
+                                                    bool *inserted )
+{
+    const uint64_t hash = dict_hash( dict, key, key_size );
+
+    dict_rehash_step( dict, DICT_REHASH_MOVES );
+    if ( dict_make_room( dict ) != RV_SUCCESS )
+        return f_stack_trace( NULL );
+
+    struct key_value_pair *slot = NULL;
+    struct key_value_pair *item =
+            dict_table_find( &dict->table, key, key_size, hash, &slot );
+    if ( item == NULL && dict->old.items != NULL )
+        item = dict_table_find( &dict->old, key, key_size, hash, NULL );
+
+    *inserted = item == NULL;
+    if ( item != NULL )
+        return item;
+
+    if ( dict_item_init( dict,
+                         slot,
+                         key,
+                         key_size,
+                         hash,
+                         val,
+                         val_size,
+                         ITEM_PRINT_FUNCTION_NAME( byte ),
+                         ITEM_PRINT_FUNCTION_NAME( byte ) )
+         != RV_SUCCESS )
+        return f_stack_trace( NULL );
+    return slot;
+}
+
+int dict_upsert( struct dictionary *dict,
+                 const void *key,
+                 const size_t key_size,
+                 const void *val,
+                 const size_t val_size )
+{
+    bool inserted               = false;
+    struct key_value_pair *item =
+            dict_find_or_insert( dict, key, key_size, val, val_size, &inserted );
+    if ( item == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    if ( inserted )
+        return DICTINSERT_INSERTED;
+
+    return_on_fail( kvp_val_replace( dict->allocator, item, val, val_size ) );
+    return DICTINSERT_WAS_IN;
+}
+
+void *dict_get_or_insert( struct dictionary *dict,
+                          const void *key,
+                          const size_t key_size,
+                          const void *init_val,
+                          const size_t val_size,
+                          bool *inserted )
+{
+    bool is_new                 = false;
+    struct key_value_pair *item =
+            dict_find_or_insert( dict, key, key_size, init_val, val_size, &is_new );
+    if ( item == NULL )
+        return f_stack_trace( NULL );
+
+    if ( inserted != NULL )
+        *inserted = is_new;
+    return ( void * ) kvp_val( item );
+}
+
+int dict_update( struct dictionary *dict,
+                 const void *key,
+                 const size_t key_size,
+                 const DictUpdateFunction update,
+                 void *ctx )
+{
+    struct key_value_pair *item = dict_get_non_const( dict, key, key_size );
+    if ( item == NULL )
+        return fwarnx_ret( RV_EXCEPTION, "couldn't find key" );
+
+    update( ( void * ) kvp_val( item ), item->val_size, ctx );
     return RV_SUCCESS;
 }
 
@@ -219,41 +967,34 @@ enum DictRemoveRV dict_remove( struct dictionary *dict,
                                const void *key_data,
                                const size_t key_size )
 {
-    const uint64_t hash = hash_func( key_data, key_size );
+    dict_rehash_step( dict, DICT_REHASH_MOVES );
 
-    const struct key_value_pair search = {
-        .key      = ( void * ) key_data,
-        .key_size = key_size,
-    };
+    const struct dict_table *in = NULL;
+    const uint64_t hash         = dict_hash( dict, key_data, key_size );
+    struct key_value_pair *item = dict_find( dict, key_data, key_size, hash, &in );
+    if ( item == NULL )
+        return DICTREMOVE_NOT_FOUND;
 
-    for ( size_t i = 0; i < dict->capacity; ++i )
-    {
-        const size_t index          = ( hash + i ) % dict->capacity;
-        struct key_value_pair *item = dict->items + index;
+    struct dict_table *table = in == &dict->table ? &dict->table : &dict->old;
 
-        if ( item->key == NULL && !item->removed )
-            return DICTREMOVE_NOT_FOUND;
+    kvp_data_free( dict->allocator, &item->key, item->key_size );
+    kvp_data_free( dict->allocator, &item->val, item->val_size );
+    dict_table_vacate( table, item );
 
-        if ( !cmpeq( dict_item_key_cmp( &search, item ) ) )
-            continue;
+    if ( dict->old.items != NULL && dict->old.n_items == 0 )
+        dict_rehash_step( dict, 0 ); // removed the last old item
 
-        free_n( item->key );
-        free_n( item->val );
-        item->key_size  = 0;
-        item->val_size  = 0;
-        item->removed   = true;
-        item->key_print = item->val_print = ITEM_PRINT_FUNCTION_NAME( byte );
-        dict->size--;
-        return DICTREMOVE_REMOVED;
-    }
+    // failing to shrink is harmless; the item has been removed either way
+    if ( dict_shrink( dict ) != RV_SUCCESS )
+        ( void ) f_stack_trace( 0 );
 
-    return DICTREMOVE_NOT_FOUND;
+    return DICTREMOVE_REMOVED;
 }
 
 
 size_t dict_size( const struct dictionary *dict )
 {
-    return dict->size;
+    return dict->table.n_items + dict->old.n_items;
 }
 
 Private inline void kvp_print_as( const struct key_value_pair *item,
@@ -266,9 +1007,11 @@ Private inline void kvp_print_as( const struct key_value_pair *item,
                  "no way to print values, this shouldn't happen" );
 
     printf( "\"" );
-    ( key_print != NULL ? key_print : item->key_print )( item->key, item->key_size );
+    ( key_print != NULL ? key_print : item->key_print )( kvp_key( item ),
+                                                         item->key_size );
     printf( "%s", kv_sep );
-    ( val_print != NULL ? val_print : item->val_print )( item->val, item->val_size );
+    ( val_print != NULL ? val_print : item->val_print )( kvp_val( item ),
+                                                         item->val_size );
     printf( "\"" );
 }
 
@@ -280,27 +1023,31 @@ void dict_print_as( const struct dictionary *dict,
     /** Maximum items printed on one line */
     static const size_t line_max_items = 4;
 
+    const struct dict_table *tables[] = { &dict->old, &dict->table };
+    const size_t size                 = dict_size( dict );
+
     printf( "{" );
 
     const char *delim = "";
     size_t n          = 0;
-    for ( size_t i = 0; i < dict->capacity; ++i )
-    {
-        const struct key_value_pair *item = dict->items + i;
-        if ( item->key == NULL )
-            continue;
+    for ( size_t t = 0; t < countof( tables ); ++t )
+        for ( size_t i = 0; i < tables[ t ]->capacity; ++i )
+        {
+            const struct key_value_pair *item = tables[ t ]->items + i;
+            if ( !item->occupied )
+                continue;
 
-        delim = item->key_size > 16 || n % line_max_items == 0 ? ",\n\t" : ", ";
-        if ( n == 0 )
-            delim = dict->size > line_max_items ? "\n\t" : " ";
-        printf( "%s", delim );
+            delim = item->key_size > 16 || n % line_max_items == 0 ? ",\n\t" : ", ";
+            if ( n == 0 )
+                delim = size > line_max_items ? "\n\t" : " ";
+            printf( "%s", delim );
 
-        kvp_print_as( item, key_print, val_print, ": " );
+            kvp_print_as( item, key_print, val_print, ": " );
 
-        ++n;
-    }
+            ++n;
+        }
 
-    if ( dict->size > line_max_items )
+    if ( size > line_max_items )
         printf( "\n" );
     else if ( !strchr( delim, '\n' ) )
         printf( " " );
@@ -315,11 +1062,113 @@ void dict_print( const struct dictionary *dict )
 
 void dict_destroy( struct dictionary *dict )
 {
-    for ( size_t i = 0; i < dict->capacity; ++i )
+    dict_table_destroy( &dict->old, dict->allocator );
+    dict_table_destroy( &dict->table, dict->allocator );
+    allocator_free( dict->allocator, dict, sizeof( struct dictionary ) );
+}
+
+
+int dict_save( const struct dictionary *dict, FILE *file )
+{
+    SerialWriter *writer = serial__writer_open( file,
+                                                SERIAL_DICT,
+                                                0,
+                                                dict->hash,
+                                                dict->seed,
+                                                ( uint32_t ) dict->engine,
+                                                dict_size( dict ) );
+    if ( writer == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    const struct dict_table *tables[] = { &dict->old, &dict->table };
+
+    int rv = RV_SUCCESS;
+    for ( size_t t = 0; t < countof( tables ); ++t )
+        for ( size_t i = 0; i < tables[ t ]->capacity && rv == RV_SUCCESS; ++i )
+        {
+            const struct key_value_pair *item = tables[ t ]->items + i;
+            if ( item->occupied )
+                rv = serial__write_hashed( writer,
+                                           item->key_hash,
+                                           kvp_key( item ),
+                                           item->key_size,
+                                           kvp_val( item ),
+                                           item->val_size );
+        }
+
+    if ( serial_writer_close( writer ) != RV_SUCCESS || rv != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return RV_SUCCESS;
+}
+
+struct dictionary *dict_load( FILE *file, const HashFunction hash )
+{
+    SerialReader *reader = serial_reader_open( file );
+    if ( reader == NULL )
+        return f_stack_trace( NULL );
+
+    struct dictionary *dict = NULL;
+    if ( serial_reader_kind( reader ) != SERIAL_DICT )
+    {
+        fwarnx( "not a Dictionary" );
+        goto ERROR;
+    }
+
+    const size_t count = serial_reader_count_hint( reader );
+    if ( count > SIZE_MAX / 4 / sizeof( struct key_value_pair ) )
+    {
+        fwarnx( "invalid number of items: %zu", count );
+        goto ERROR;
+    }
+
+    dict = dict_init_with( ( enum DictEngine ) serial__reader_engine( reader ),
+                           hash,
+                           serial__reader_seed( reader ),
+                           allocator_default() );
+    if ( dict == NULL )
+        goto ERROR;
+
+    // large enough for all the items, so the table never grows
+    if ( dict_reserve( dict, count ) != RV_SUCCESS )
+        goto ERROR;
+
+    uint64_t key_hash;
+    const void *key;
+    const void *val;
+    size_t key_size;
+    size_t val_size;
+    int rv;
+    while ( ( rv = serial__read_hashed(
+                      reader, &key_hash, &key, &key_size, &val, &val_size ) )
+            == 1 )
     {
-        free( dict->items[ i ].val );
-        free( dict->items[ i ].key );
+        if ( dict_size( dict ) == 0 && dict_hash( dict, key, key_size ) != key_hash )
+        {
+            fwarnx( "the dictionary was saved with a different hash function" );
+            goto ERROR;
+        }
+
+        if ( dict_insert_hashed( dict,
+                                 key,
+                                 key_size,
+                                 key_hash,
+                                 val,
+                                 val_size,
+                                 ITEM_PRINT_FUNCTION_NAME( byte ),
+                                 ITEM_PRINT_FUNCTION_NAME( byte ) )
+             == RV_ERROR )
+            goto ERROR;
     }
-    free( dict->items );
-    free( dict );
+    if ( rv != 0 )
+        goto ERROR;
+
+    serial_reader_close( reader );
+    return dict;
+
+ERROR:
+    if ( dict != NULL )
+        dict_destroy( dict );
+    serial_reader_close( reader );
+    return f_stack_trace( NULL );
 }
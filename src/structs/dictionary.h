@@ -1,13 +1,22 @@
 /*
  * For more information, see `docs/set.md`.
  * Lots of relevant information is shared between the two structures.
+ *
+ * The dictionary grows (and shrinks) on its own to keep the load factor
+ * between 3/16 and 3/4. Rehashing is incremental: the new table is allocated
+ * right away, but the items are moved into it a few at a time by the following
+ * inserts and removes, so no single operation pays for moving the whole table.
  */
 
 #ifndef CLIBS_DICTIONARY_H
 #define CLIBS_DICTIONARY_H
 
+#include "../allocator.h"    /* Allocator */
+#include "../headers/hash.h" /* HashFunction */
 #include "../item_print_functions.h"
 
+#include <stdio.h> /* FILE */
+
 
 typedef struct dictionary Dictionary;
 
@@ -22,8 +31,62 @@ enum DictInsertRV {
     DICTINSERT_WAS_IN   = 1,
 };
 
+/**
+ * Modifies the value of `val_size` bytes at `val` in place (see `dict_update()`)
+ *
+ * @param ctx   the `ctx` passed to `dict_update()`
+ */
+typedef void ( *DictUpdateFunction )( void *val, size_t val_size, void *ctx );
+
+
+/** How a `Dictionary` stores and looks up its items */
+enum DictEngine {
+    /**
+     * Open addressing with linear probing;
+     * rehashes incrementally (see above). The default.
+     */
+    DICT_ENGINE_LINEAR = 0,
+    /**
+     * Swiss table: one control byte (7 bits of the hash) per slot,
+     * probed 16 at a time (with SSE2 where available),
+     * so a lookup rarely touches a slot that doesn't hold its key.
+     * Faster lookups, but rehashes all at once.
+     */
+    DICT_ENGINE_SWISS = 1,
+};
+
 
 struct dictionary *dict_init( void );
+/**
+ * Initializes a `Dictionary` using the `DICT_ENGINE_SWISS` engine.
+ */
+struct dictionary *dict_init_swiss( void );
+/**
+ * Initializes a `Dictionary` with a custom hash function.
+ *
+ * @param hash  hash function; `NULL` means the default (`hash_bytes()`)
+ * @param seed  passed to every `hash` call;
+ *              use `hash_random_seed()` if the keys come from untrusted input
+ */
+struct dictionary *dict_init_with_hash( HashFunction hash, uint64_t seed );
+/**
+ * Initializes a `Dictionary` with the selected engine and a custom hash function.
+ *
+ * All engines support the whole `Dictionary` API.
+ *
+ * @see `dict_init_with_hash()`
+ */
+struct dictionary *dict_init_with_engine( enum DictEngine engine,
+                                          HashFunction hash,
+                                          uint64_t seed );
+/**
+ * Initializes a `Dictionary` which allocates its tables
+ * and the keys and values that aren't stored inline from `allocator`
+ * (see `allocator.h`).
+ *
+ * @param allocator must outlive the dictionary; `NULL` for `allocator_default()`
+ */
+struct dictionary *dict_init_with_allocator( const Allocator *allocator );
 
 
 /**
@@ -69,16 +132,111 @@ int dict_insert( struct dictionary *,
                  const void *val,
                  size_t val_size );
 
+/**
+ * Inserts `n` key-value pairs into the dictionary, like `dict_insert()` one by one:
+ * the `i`-th key of `keys` with the `i`-th value of `vals`.
+ *
+ * Room is made for all of them up front (as if none of the keys were in it yet)
+ * and the keys are hashed a batch at a time, ahead of being looked up,
+ * so that their lookups overlap.
+ *
+ * @param keys  array of `n` keys of `key_size` bytes
+ * @param vals  array of `n` values of `val_size` bytes
+ * @return `RV_ERROR` on alloc failure (some of the pairs may be inserted),
+ *         else `RV_SUCCESS`
+ */
+int dict_insert_many( struct dictionary *,
+                      const void *keys,
+                      size_t key_size,
+                      const void *vals,
+                      size_t val_size,
+                      size_t n );
+/**
+ * Creates a dictionary of the `n` key-value pairs (see `dict_insert_many()`).
+ *
+ * @return pointer to a new Dictionary, or `NULL` on alloc failure
+ */
+Constructor struct dictionary *dict_from_arrays( const void *keys,
+                                                 size_t key_size,
+                                                 const void *vals,
+                                                 size_t val_size,
+                                                 size_t n );
+
 bool dict_has_key( const struct dictionary *, const void *key, size_t key_size );
 
+/**
+ * @return pointer to the value stored under `key`, or `NULL` if there is none.
+ * Small values are stored inside the table itself, so the pointer is only valid
+ * until the dictionary is modified.
+ */
 const void *dict_get_val( const struct dictionary *, const void *key, size_t key_size );
 
+/**
+ * Replaces the value stored under `key` by a copy of `val`
+ * (in its current storage, if the size is the same).
+ *
+ * @return `RV_EXCEPTION` if there is no `key`, `RV_ERROR` on alloc failure,
+ *         else `RV_SUCCESS`
+ */
 int dict_set_val( struct dictionary *,
                   const void *key,
                   size_t key_size,
                   const void *val,
                   size_t val_size );
 
+/**
+ * Inserts a copy of `val` under `key`, or replaces the value stored under it
+ * if there is one.
+ *
+ * Like `dict_get_or_insert()` and `dict_update()`, this hashes the key once
+ * and walks its probe sequence once, unlike `dict_has_key()` followed by
+ * `dict_insert()` or `dict_set_val()`.
+ *
+ * @return `RV_ERROR` on alloc failure,
+ *         else `DICTINSERT_INSERTED` or `DICTINSERT_WAS_IN` (the value was replaced)
+ */
+int dict_upsert( struct dictionary *,
+                 const void *key,
+                 size_t key_size,
+                 const void *val,
+                 size_t val_size );
+/**
+ * Returns the value stored under `key`; if there is none,
+ * a copy of `init_val` is inserted under it first.
+ *
+ * The value may be modified through the pointer, but not resized:
+ * it has the size it was inserted (or last set) with, not necessarily `val_size`.
+ * The pointer is only valid until the dictionary is modified.
+ *
+ * Example (counting):
+ * @code
+ * size_t *count = dict_get_or_insert( dict, &word, sizeof word,
+ *                                     &( size_t ) { 0 }, sizeof( size_t ), NULL );
+ * if ( count == NULL )
+ *     return RV_ERROR;
+ * ++*count;
+ * @endcode
+ *
+ * @param inserted  if not `NULL`, whether `key` has been inserted is stored here
+ * @return pointer to the value, or `NULL` on alloc failure
+ */
+void *dict_get_or_insert( struct dictionary *,
+                          const void *key,
+                          size_t key_size,
+                          const void *init_val,
+                          size_t val_size,
+                          bool *inserted );
+/**
+ * Calls `update` on the value stored under `key`, which modifies it in place.
+ *
+ * @return `RV_EXCEPTION` if there is no `key`, else `RV_SUCCESS`
+ */
+int dict_update( struct dictionary *,
+                 const void *key,
+                 size_t key_size,
+                 DictUpdateFunction update,
+                 void *ctx );
+
 enum DictRemoveRV dict_remove( struct dictionary *,
                                const void *key_data,
                                size_t key_size );
@@ -93,6 +251,32 @@ size_t dict_size( const struct dictionary * );
 void dict_destroy( struct dictionary * );
 
 
+/* -------- SAVE/LOAD -------- */
+
+/**
+ * Writes the dictionary to `file` in the binary format of `serialize.h`,
+ * along with its engine, its seed and the hashes of its keys.
+ *
+ * The print functions of the items aren't saved.
+ *
+ * @return `RV_ERROR` if writing fails, else `RV_SUCCESS`
+ */
+int dict_save( const struct dictionary *, FILE *file );
+/**
+ * Reads a dictionary written by `dict_save()` (or a `SerialWriter` of a Dictionary).
+ *
+ * The saved hashes are used as they are, so no key is hashed
+ * and the table is allocated at its final size right away.
+ *
+ * @param hash  the hash function the dictionary was saved with
+ *              (`NULL` for `hash_bytes()`);
+ *              the hash of the first key is checked against it
+ * @return pointer to a new Dictionary, or `NULL` if the file is invalid or corrupt
+ *         (or of a different hash function), or if reading or allocation fails
+ */
+Constructor struct dictionary *dict_load( FILE *file, HashFunction hash );
+
+
 /* -------- PRINT -------- */
 
 #define dict_printn( DICTIONARY )         \
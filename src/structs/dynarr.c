@@ -1,19 +1,46 @@
 #include "dynarr.h"
 
+#include "../allocator.h"
 #include "../headers/assert_that.h"
 #include "../headers/misc.h"          /* cmp */
 #include "../headers/pointer_utils.h" /* deref_as */
+#include "../headers/static_assert.h"
+#include "../serialize.h"
+#include "dynarr_mmap.h"   /* list_is_mmap */
+#include "dynarr_search.h"
+#include "dynarr_typed.h" /* List_int */
 #include "queue.h"
 #include "set.h"
 
 #include <inttypes.h> /* PRIi64 */
-#include <stdlib.h>   /* alloc, bsearch, qsort */
+#include <stddef.h>   /* offsetof */
+#include <stdlib.h>   /* alloc */
 #include <string.h>   /* mem* */
 
 
 #define LIST_DEF_CAP 64
 
-#define LIST_CAP_SIZE_RATIO 2
+/*
+ * A full List grows to `capacity * LIST_GROWTH_NUM / LIST_GROWTH_DEN` items;
+ * may be overridden when building the library (e.g. to 3 / 2).
+ */
+#ifndef LIST_GROWTH_NUM
+#define LIST_GROWTH_NUM 2
+#endif
+#ifndef LIST_GROWTH_DEN
+#define LIST_GROWTH_DEN 1
+#endif
+
+STATIC_ASSERT( LIST_GROWTH_NUM > LIST_GROWTH_DEN && LIST_GROWTH_DEN > 0,
+               "the List growth factor must be greater than 1" );
+
+/*
+ * Removing items halves the capacity once at most a `1 / LIST_SHRINK_RATIO`
+ * of it is used, so that the List doesn't reallocate back and forth
+ * when items are appended and removed around a boundary.
+ * Lists of at most `LIST_DEF_CAP` items are never shrunk.
+ */
+#define LIST_SHRINK_RATIO 4
 
 
 #define ListIndexOOBExceptionString( LIST, INDEX ) \
@@ -24,13 +51,26 @@
 #define ListNullPointerExceptionString( ARG ) #ARG " may not be null"
 
 
+/*
+ * The typed lists (`List_NAME` from `dynarr_typed.h`) are this struct seen
+ * through its first four members; don't reorder them.
+ */
 struct dynamic_array {
     size_t capacity; // Amount of allocated memory slots for items
     size_t size;     // Number of items stored in List
     void *items;     // Array of any type
     size_t el_size;  // sizeof a single item
+
+    const Allocator *allocator; // of `items`
 };
 
+#define LIST_SAME_OFFSET( MEMBER ) \
+    ( offsetof( struct dynamic_array, MEMBER ) == offsetof( List_int, MEMBER ) )
+
+STATIC_ASSERT( LIST_SAME_OFFSET( capacity ) && LIST_SAME_OFFSET( size )
+                       && LIST_SAME_OFFSET( items ) && LIST_SAME_OFFSET( el_size ),
+               "typed lists must share the layout of `struct dynamic_array`" );
+
 
 Private inline void *list_at_non_safe( const struct dynamic_array *ls, const size_t idx )
 {
@@ -40,23 +80,49 @@ Private inline void *list_at_non_safe( const struct dynamic_array *ls, const siz
 
 /* –––––––––––––––––––––––––––––– FUNCTIONAL –––––––––––––––––––––––––––––– */
 
-List *list_init_cap_size( const size_t el_size, const size_t init_cap )
+Private List *list_init_with( const size_t el_size,
+                             const size_t init_cap,
+                             const Allocator *allocator )
 {
-    struct dynamic_array *ls = calloc( 1, sizeof( struct dynamic_array ) );
+    struct dynamic_array *ls =
+            allocator_calloc( allocator, 1, sizeof( struct dynamic_array ) );
     if ( ls == NULL )
         return fwarn_ret( NULL, "calloc" );
 
-    ls->items = calloc( init_cap, el_size );
+    const size_t capacity = init_cap > 0 ? init_cap : 1;
+
+    ls->items = allocator_calloc( allocator, capacity, el_size );
     if ( ls->items == NULL )
     {
-        free( ls );
+        allocator_free( allocator, ls, sizeof( struct dynamic_array ) );
         return fwarn_ret( NULL, "calloc" );
     }
-    ls->capacity = LIST_DEF_CAP;
-    ls->el_size  = el_size;
+    ls->capacity  = capacity;
+    ls->el_size   = el_size;
+    ls->allocator = allocator;
     return ls;
 }
 
+List *list_init_cap_size( const size_t el_size, const size_t init_cap )
+{
+    List *new = list_init_with( el_size, init_cap, allocator_default() );
+    if ( new == NULL )
+        return f_stack_trace( NULL );
+
+    return new;
+}
+
+List *list_init_with_allocator( const size_t el_size, const Allocator *allocator )
+{
+    List *new = list_init_with( el_size,
+                                LIST_DEF_CAP,
+                                allocator != NULL ? allocator : allocator_default() );
+    if ( new == NULL )
+        return f_stack_trace( NULL );
+
+    return new;
+}
+
 List *list_init_size( const size_t el_size )
 {
     List *new = list_init_cap_size( el_size, LIST_DEF_CAP );
@@ -71,7 +137,7 @@ List *list_init_size( const size_t el_size )
 
 Constructor List *list_from_set( const Set *set )
 {
-    size_t elsize;
+    size_t elsize = 0;
     foreach_set ( e, set )
     {
         // assign first value
@@ -167,45 +233,58 @@ void *list_at_last( List *const ls )
 
 
 /**
- * Changes (realloc) the lists capacity to be the smallest possible power of two
- * capable of holding its items + `min_cap_add`
- * \n
- * Therefore, the List always has enough space
- * to hold all of its items + min_cap_add
- * @return -1 if realloc fails, else 0
+ * Changes (realloc) the lists capacity to exactly `new_cap` (at least its size)
+ * @return RV_ERROR if realloc fails, else RV_SUCCESS
  */
-Private int list_upsize( struct dynamic_array *ls, const size_t min_cap_add )
+Private int list_set_capacity( struct dynamic_array *ls, const size_t new_cap )
 {
-    const size_t min_new_cap = ls->capacity + min_cap_add;
-
-    size_t new_capacity = ls->capacity;
-    while ( new_capacity < min_new_cap )
-        new_capacity *= LIST_CAP_SIZE_RATIO;
+    if ( new_cap > SIZE_MAX / ls->el_size )
+        return fwarnx_ret( RV_ERROR, "capacity of %zu items overflows", new_cap );
 
-    void *tmp = realloc( ls->items, new_capacity * ls->el_size );
+    void *tmp = allocator_resize( ls->allocator,
+                                  ls->items,
+                                  ls->capacity * ls->el_size,
+                                  new_cap * ls->el_size );
     if ( tmp == NULL )
         return fwarn_ret( RV_ERROR, "realloc" );
 
     ls->items    = tmp;
-    ls->capacity = new_capacity;
+    ls->capacity = new_cap;
     return RV_SUCCESS;
 }
 
 /**
- * Changes (realloc) the lists capacity to be half as large\n
- * @return -1 if realloc fails, else 0
+ * Makes space for (at least) `min_cap` items.
+ * The capacity grows by the growth factor, or to `min_cap` if that's not enough,
+ * so that appending `n` items one by one takes O(log n) reallocs.
+ * @return RV_ERROR if realloc fails, else RV_SUCCESS
  */
-Private int list_downsize( struct dynamic_array *ls )
+Private int list_grow( struct dynamic_array *ls, const size_t min_cap )
 {
-    const size_t new_cap = ls->capacity / LIST_CAP_SIZE_RATIO;
+    if ( min_cap <= ls->capacity )
+        return RV_SUCCESS;
 
-    void *tmp = realloc( ls->items, new_cap * ls->el_size );
-    if ( tmp == NULL )
-        return fwarn_ret( RV_ERROR, "realloc" );
+    size_t new_cap = ls->capacity <= SIZE_MAX / LIST_GROWTH_NUM
+                             ? ls->capacity * LIST_GROWTH_NUM / LIST_GROWTH_DEN
+                             : SIZE_MAX;
+    if ( new_cap < min_cap )
+        new_cap = min_cap;
 
-    ls->items    = tmp;
-    ls->capacity = new_cap;
-    return RV_SUCCESS;
+    return list_set_capacity( ls, new_cap );
+}
+
+/**
+ * Halves the capacity if at most `1 / LIST_SHRINK_RATIO` of it
+ * would be used after removing an item.
+ * @return RV_ERROR if realloc fails, else RV_SUCCESS
+ */
+Private int list_shrink_for_remove( struct dynamic_array *ls )
+{
+    if ( ls->capacity <= LIST_DEF_CAP
+         || ls->size - 1 > ls->capacity / LIST_SHRINK_RATIO )
+        return RV_SUCCESS;
+
+    return list_set_capacity( ls, ls->capacity / 2 );
 }
 
 
@@ -225,9 +304,8 @@ int list_set_at( struct dynamic_array *ls, const size_t index, const void *data
 
 int list_append( struct dynamic_array *ls, const void *datap )
 {
-    if ( ls->size + 1 >= ls->capacity )
-        if ( list_upsize( ls, 1 ) != RV_SUCCESS )
-            return f_stack_trace( RV_ERROR );
+    if ( list_grow( ls, ls->size + 1 ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     ++ls->size;
     memcpy( list_at_last( ls ), datap, ls->el_size );
@@ -237,9 +315,8 @@ int list_append( struct dynamic_array *ls, const void *datap )
 
 int list_extend( struct dynamic_array *ls, const void *array, const size_t array_len )
 {
-    if ( ls->capacity < ls->size + array_len )
-        if ( list_upsize( ls, array_len ) != RV_SUCCESS )
-            return f_stack_trace( RV_ERROR );
+    if ( list_grow( ls, ls->size + array_len ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     memcpy( list_at_non_safe( ls, ls->size ), array, array_len * ls->el_size );
 
@@ -250,9 +327,8 @@ int list_extend( struct dynamic_array *ls, const void *array, const size_t array
 
 int list_extend_list( struct dynamic_array *ls, const struct dynamic_array *app )
 {
-    if ( ls->size + app->size >= ls->capacity )
-        if ( list_upsize( ls, app->size ) != RV_SUCCESS )
-            return f_stack_trace( RV_ERROR );
+    if ( list_grow( ls, ls->size + app->size ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     memcpy( list_at_non_safe( ls, ls->size ), app->items, app->size * app->el_size );
 
@@ -266,9 +342,8 @@ int list_insert( struct dynamic_array *ls, const size_t index, const void *data
     if ( index > ls->size )
         return fwarnx_ret( RV_EXCEPTION, ListIndexOOBExceptionString( ls, index ) );
 
-    if ( ls->size + 1 >= ls->capacity )
-        if ( list_upsize( ls, 1 ) != RV_SUCCESS )
-            return f_stack_trace( RV_ERROR );
+    if ( list_grow( ls, ls->size + 1 ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     memmove( list_at_non_safe( ls, index + 1 ),
              list_at_non_safe( ls, index ),
@@ -293,9 +368,8 @@ int list_pop( struct dynamic_array *ls, void *container )
     if ( ls->size == 0 )
         return fwarnx_ret( RV_EXCEPTION, ListEmptyExceptionString );
 
-    if ( ls->capacity / LIST_CAP_SIZE_RATIO > ls->size )
-        if ( list_downsize( ls ) != RV_SUCCESS )
-            return f_stack_trace( RV_ERROR );
+    if ( list_shrink_for_remove( ls ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     if ( container != NULL )
         // copy popped element to container
@@ -314,16 +388,15 @@ int list_remove( struct dynamic_array *ls, const size_t index, void *container )
     if ( index == ls->size - 1 )
         return list_pop( ls, container );
 
-    if ( ls->capacity / LIST_CAP_SIZE_RATIO > ls->size )
-        if ( list_downsize( ls ) != RV_SUCCESS )
-            return f_stack_trace( RV_ERROR );
+    if ( list_shrink_for_remove( ls ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     if ( container != NULL )
         memcpy( container, list_at( ls, index ), ls->el_size );
 
     memmove( list_at( ls, index ),
              list_at( ls, index + 1 ),
-             ( ls->size - index ) * ls->el_size );
+             ( ls->size - index - 1 ) * ls->el_size );
 
     --ls->size;
 
@@ -335,9 +408,8 @@ int list_remove_fast( struct dynamic_array *ls, const size_t index, void *contai
     if ( index >= ls->size )
         return fwarnx_ret( RV_EXCEPTION, ListIndexOOBExceptionString( ls, index ) );
 
-    if ( ls->capacity / LIST_CAP_SIZE_RATIO > ls->size )
-        if ( list_downsize( ls ) )
-            return RV_ERROR;
+    if ( list_shrink_for_remove( ls ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
     if ( container != NULL )
         // put element at index into the container
@@ -353,11 +425,72 @@ int list_remove_fast( struct dynamic_array *ls, const size_t index, void *contai
 }
 
 
+int list_reserve( struct dynamic_array *ls, const size_t capacity )
+{
+    if ( capacity <= ls->capacity )
+        return RV_SUCCESS;
+
+    if ( list_set_capacity( ls, capacity ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return RV_SUCCESS;
+}
+
+int list_shrink_to_fit( struct dynamic_array *ls )
+{
+    const size_t new_cap = ls->size > 0 ? ls->size : 1;
+    if ( new_cap == ls->capacity )
+        return RV_SUCCESS;
+
+    if ( list_set_capacity( ls, new_cap ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return RV_SUCCESS;
+}
+
+int list_resize( struct dynamic_array *ls, const size_t new_size )
+{
+    if ( list_grow( ls, new_size ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    // new items are zeroed; so are removed ones, as in `list_pop()`
+    if ( new_size > ls->size )
+        memset( list_at_non_safe( ls, ls->size ),
+                0,
+                ( new_size - ls->size ) * ls->el_size );
+    else
+        memset( list_at_non_safe( ls, new_size ),
+                0,
+                ( ls->size - new_size ) * ls->el_size );
+
+    ls->size = new_size;
+
+    return RV_SUCCESS;
+}
+
+
 const void *list_bsearch_p( const struct dynamic_array *ls,
                             const void *needle,
                             int ( *cmp )( const void *, const void * ) )
 {
-    return bsearch( needle, ls->items, ls->size, ls->el_size, cmp );
+    // the first of equal items (`bsearch()` may return any of them)
+    size_t first = 0;
+    size_t count = ls->size;
+    while ( count > 0 )
+    {
+        const size_t half = count / 2;
+        if ( cmp( needle, list_at_non_safe( ls, first + half ) ) > 0 )
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+            count = half;
+    }
+
+    if ( first == ls->size || cmp( needle, list_at_non_safe( ls, first ) ) != 0 )
+        return NULL;
+    return list_at_non_safe( ls, first );
 }
 
 int64_t list_bsearch_i( const struct dynamic_array *ls,
@@ -367,29 +500,61 @@ int64_t list_bsearch_i( const struct dynamic_array *ls,
     const byte *res = list_bsearch_p( ls, needle, cmp );
     if ( res == NULL )
         return -1;
-    return res - ( byte * ) ls->items;
+    return ( res - ( byte * ) ls->items ) / ( int64_t ) ls->el_size;
 }
 
 const void *list_lsearch_p( const struct dynamic_array *ls, const void *needle )
 {
-    for ( size_t i = 0; i < ls->size; ++i )
-        if ( cmpeq( memcmp( list_see( ls, i ), needle, ls->el_size ) ) )
-            return list_see( ls, i );
-
-    return NULL;
+    const int64_t index = list_lsearch_i( ls, needle );
+    if ( index < 0 )
+        return NULL;
+    return list_at_non_safe( ls, ( size_t ) index );
 }
 
 int64_t list_lsearch_i( const struct dynamic_array *ls, const void *needle )
 {
-    const byte *res = list_lsearch_p( ls, needle );
-    if ( res == NULL )
-        return -1;
-    return res - ( byte * ) ls->items;
+    return list_lsearch_i_impl( ls, needle, LIST_SEARCH_AUTO );
+}
+
+int64_t list_lsearch_i_impl( const struct dynamic_array *ls,
+                             const void *needle,
+                             const enum ListSearchImpl impl )
+{
+    const size_t index = lsearch_items( ls->items, ls->size, ls->el_size, needle, impl );
+    return index < ls->size ? ( int64_t ) index : -1;
+}
+
+struct dynamic_array *list_lsearch_all( const struct dynamic_array *ls,
+                                        const void *needle )
+{
+    struct dynamic_array *indices = list_init_type( size_t );
+    if ( indices == NULL )
+        return f_stack_trace( NULL );
+
+    // each search starts right after the previous match
+    for ( size_t i = 0; i < ls->size; ++i )
+    {
+        i += lsearch_items( list_at_non_safe( ls, i ),
+                            ls->size - i,
+                            ls->el_size,
+                            needle,
+                            LIST_SEARCH_AUTO );
+        if ( i == ls->size )
+            break;
+
+        if ( list_append( indices, &i ) != RV_SUCCESS )
+        {
+            list_destroy( indices );
+            return f_stack_trace( NULL );
+        }
+    }
+
+    return indices;
 }
 
-void list_sort( struct dynamic_array *ls, int ( *cmp )( const void *, const void * ) )
+const char *list_lsearch_impl_name( void )
 {
-    qsort( ls->items, ls->size, ls->el_size, cmp );
+    return lsearch_impl_name();
 }
 
 
@@ -425,9 +590,19 @@ int list_reverse( struct dynamic_array *ls )
     return RV_SUCCESS;
 }
 
+/**
+ * The allocator of a new List made from `ls`;
+ * that of a memory-mapped List serves only that List
+ */
+Private const Allocator *list_derived_allocator( const struct dynamic_array *ls )
+{
+    return list_is_mmap( ls ) ? allocator_default() : ls->allocator;
+}
+
 struct dynamic_array *list_reversed( const struct dynamic_array *ls )
 {
-    struct dynamic_array *rev = list_init_size( ls->el_size );
+    struct dynamic_array *rev =
+            list_init_with_allocator( ls->el_size, list_derived_allocator( ls ) );
     if ( rev == NULL )
         return f_stack_trace( NULL );
 
@@ -453,7 +628,8 @@ struct dynamic_array *list_reversed( const struct dynamic_array *ls )
 
 int list_copy( const struct dynamic_array *old, struct dynamic_array **new_ls_container )
 {
-    struct dynamic_array *new_ls = list_init_size( old->el_size );
+    struct dynamic_array *new_ls =
+            list_init_with_allocator( old->el_size, list_derived_allocator( old ) );
     if ( new_ls == NULL )
         return RV_ERROR;
 
@@ -476,6 +652,49 @@ struct dynamic_array *list_copy_of( const struct dynamic_array *ls )
     return new;
 }
 
+struct dynamic_array *list_adopt_buffer( void *buffer,
+                                         const size_t size,
+                                         const size_t capacity,
+                                         const size_t el_size )
+{
+    struct dynamic_array *ls = list_adopt_buffer_with_allocator(
+            buffer, size, capacity, el_size, allocator_default() );
+    if ( ls == NULL )
+        return f_stack_trace( NULL );
+
+    return ls;
+}
+
+struct dynamic_array *list_adopt_buffer_with_allocator( void *buffer,
+                                                        const size_t size,
+                                                        const size_t capacity,
+                                                        const size_t el_size,
+                                                        const Allocator *allocator )
+{
+    if ( buffer == NULL )
+        return fwarnx_ret( NULL, ListNullPointerExceptionString( buffer ) );
+    if ( capacity == 0 || capacity < size )
+        return fwarnx_ret( NULL,
+                           "invalid capacity %zu for buffer of %zu items",
+                           capacity,
+                           size );
+
+    if ( allocator == NULL )
+        allocator = allocator_default();
+
+    struct dynamic_array *ls =
+            allocator_calloc( allocator, 1, sizeof( struct dynamic_array ) );
+    if ( ls == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    ls->items     = buffer;
+    ls->size      = size;
+    ls->capacity  = capacity;
+    ls->el_size   = el_size;
+    ls->allocator = allocator;
+    return ls;
+}
+
 
 int list_cmp_size( const void *l1, const void *l2 )
 {
@@ -496,22 +715,89 @@ int list_cmp_elsize( const void *l1, const void *l2 )
 
 void list_destroy( struct dynamic_array *ls )
 {
-    free_n( ls->items );
-    free( ls );
+    allocator_free( ls->allocator, ls->items, ls->capacity * ls->el_size );
+    allocator_free( ls->allocator, ls, sizeof( struct dynamic_array ) );
 }
 
 int list_clear( struct dynamic_array *ls )
 {
-    free_n( ls->items );
+    allocator_free( ls->allocator, ls->items, ls->capacity * ls->el_size );
+    ls->items    = NULL;
     ls->size     = 0;
     ls->capacity = LIST_DEF_CAP;
-    if ( ( ls->items = calloc( ls->capacity, ls->el_size ) ) == NULL )
+    if ( ( ls->items = allocator_calloc( ls->allocator, ls->capacity, ls->el_size ) )
+         == NULL )
         return fwarn_ret( RV_ERROR, "calloc" );
 
     return RV_SUCCESS;
 }
 
 
+/* ––––– SAVING/LOADING ––––– */
+
+int list_save( const struct dynamic_array *ls, FILE *file )
+{
+    SerialWriter *writer =
+            serial__writer_open( file, SERIAL_LIST, ls->el_size, NULL, 0, 0, ls->size );
+    if ( writer == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    const int rv = serial_write_items( writer, ls->items, ls->size );
+    if ( serial_writer_close( writer ) != RV_SUCCESS || rv != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return RV_SUCCESS;
+}
+
+struct dynamic_array *list_load( FILE *file )
+{
+    SerialReader *reader = serial_reader_open( file );
+    if ( reader == NULL )
+        return f_stack_trace( NULL );
+
+    struct dynamic_array *ls = NULL;
+    if ( serial_reader_kind( reader ) != SERIAL_LIST )
+    {
+        fwarnx( "not a List" );
+        goto ERROR;
+    }
+
+    // the header isn't to be trusted: don't allocate more than one chunk holds
+    // before any items are read, the array grows as they come
+    const size_t el_size   = serial_reader_el_size( reader );
+    const size_t max_count = SERIAL_CHUNK_SIZE / el_size;
+    const size_t count     = serial_reader_count_hint( reader );
+    if ( ( ls = list_init_cap_size( el_size, count < max_count ? count : max_count ) )
+         == NULL )
+        goto ERROR;
+
+    // the items are read straight into the array
+    while ( true )
+    {
+        if ( list_grow( ls, ls->size + 1 ) != RV_SUCCESS )
+            goto ERROR;
+
+        const int64_t n = serial_read_items(
+                reader, list_at_non_safe( ls, ls->size ), ls->capacity - ls->size );
+        if ( n == 0 )
+            break;
+        if ( n < 0 )
+            goto ERROR;
+
+        ls->size += ( size_t ) n;
+    }
+
+    serial_reader_close( reader );
+    return ls;
+
+ERROR:
+    if ( ls != NULL )
+        list_destroy( ls );
+    serial_reader_close( reader );
+    return f_stack_trace( NULL );
+}
+
+
 /* ––––– GETTERS/SETTERS ––––– */
 
 bool list_is_empty( const struct dynamic_array *ls )
@@ -529,6 +815,16 @@ size_t list_el_size( const struct dynamic_array *ls )
     return ls->el_size;
 }
 
+size_t list_capacity( const struct dynamic_array *ls )
+{
+    return ls->capacity;
+}
+
+const Allocator *list_allocator( const struct dynamic_array *ls )
+{
+    return ls->allocator;
+}
+
 const void *list_items( const struct dynamic_array *ls )
 {
     return ls->items;
@@ -543,3 +839,20 @@ void *list_items_copy( const struct dynamic_array *ls )
     memcpy( copy, ls->items, ls->size * ls->el_size );
     return copy;
 }
+
+void *list_release_buffer( struct dynamic_array *ls, size_t *size_cont )
+{
+    void *items;
+    if ( ls->allocator == allocator_default() )
+        items = ls->items;
+    else if ( ( items = list_items_copy( ls ) ) == NULL )
+        return f_stack_trace( NULL );
+    else
+        allocator_free( ls->allocator, ls->items, ls->capacity * ls->el_size );
+
+    if ( size_cont != NULL )
+        *size_cont = ls->size;
+
+    allocator_free( ls->allocator, ls, sizeof( struct dynamic_array ) );
+    return items;
+}
@@ -22,6 +22,10 @@
  * List::el_size  = width of a single element
  * @endcode
  *
+ * A full List grows geometrically (2x by default), so appending `n` items
+ * one by one takes O(log n) reallocations; `list_reserve()` avoids them altogether.
+ * Removing items halves the capacity once no more than a quarter of it is used.
+ *
  * Finalization (destruction) of a List is done with `list_destroy()`.
  *
  * @attention All elements must be the same number of bytes long
@@ -30,10 +34,12 @@
 #ifndef CLIBS_DYNAMIC_ARRAY_H
 #define CLIBS_DYNAMIC_ARRAY_H
 
+#include "../allocator.h"          /* Allocator */
 #include "../headers/attributes.h" /* Private */
 #include "../headers/types.h"      /* size_t, int*_t */
 
 #include <stdbool.h>
+#include <stdio.h> /* FILE */
 
 
 struct dynamic_array; // defined in dynarr.c
@@ -55,10 +61,21 @@ Constructor struct dynamic_array *list_init_size( size_t el_size );
  * Creates a new list
  *
  * @param el_size   sizeof a single element
- * @param init_cap  initial capacity in terms of elements (rather than bytes)
+ * @param init_cap  initial capacity in terms of elements (rather than bytes);
+ *                  0 is taken as 1
  * @return pointer to a new empty List, or `NULL` if allocation fails
  */
 Constructor struct dynamic_array *list_init_cap_size( size_t el_size, size_t init_cap );
+/**
+ * Creates a new list, which allocates its memory from `allocator`
+ * (see `allocator.h`)
+ *
+ * @param el_size   sizeof a single element
+ * @param allocator must outlive the List; `NULL` for `allocator_default()`
+ * @return pointer to a new empty List, or `NULL` if allocation fails
+ */
+Constructor struct dynamic_array *list_init_with_allocator( size_t el_size,
+                                                            const Allocator *allocator );
 
 /**
  * Creates a copy of the List and stores it in `new_ls_container`
@@ -75,6 +92,33 @@ int list_copy( const struct dynamic_array *old, struct dynamic_array **new_ls_co
  */
 Constructor struct dynamic_array *list_copy_of( const struct dynamic_array * );
 
+/**
+ * Creates a List around an existing array, without copying it.
+ * The List takes ownership of `buffer` and will `free()` it (or `realloc()` it).
+ *
+ * @param buffer    array from `malloc()` (or `calloc()`/`realloc()`)
+ *                  of `capacity` elements, the first `size` of which are the items
+ * @param capacity  at least `size`, at least 1
+ * @return pointer to a new List, or `NULL` if the List can't be allocated
+ *         (or the arguments are invalid), in which case `buffer` stays with the caller
+ */
+Constructor struct dynamic_array *list_adopt_buffer( void *buffer,
+                                                     size_t size,
+                                                     size_t capacity,
+                                                     size_t el_size );
+/**
+ * Like `list_adopt_buffer()`, for a buffer of `capacity * el_size` bytes
+ * allocated from `allocator`, which the List then uses (see `allocator.h`)
+ *
+ * @param allocator must outlive the List; `NULL` for `allocator_default()`
+ */
+Constructor struct dynamic_array *list_adopt_buffer_with_allocator(
+        void *buffer,
+        size_t size,
+        size_t capacity,
+        size_t el_size,
+        const Allocator *allocator );
+
 
 #if defined( CLIBS_STRUCT_CONVERSIONS )
 #include "queue.h"
@@ -234,37 +278,132 @@ int list_remove_fast( struct dynamic_array *, size_t index, void *container );
 int list_remove( struct dynamic_array *, size_t index, void *container );
 
 /**
- * Binary search, returns pointer (NULL if not found)
+ * Makes space for at least `capacity` items, so that the List
+ * doesn't reallocate until it grows past them.
+ *
+ * Example:
+ * @code
+ * list_reserve( ls, list_size( ls ) + n ); // the next `n` appends won't realloc
+ * @endcode
+ *
+ * @return `RV_ERROR` if realloc fails, else `RV_SUCCESS`
+ */
+int list_reserve( struct dynamic_array *, size_t capacity );
+/**
+ * Frees the unused capacity (the List keeps space for one item when empty)
+ *
+ * @return `RV_ERROR` if realloc fails, else `RV_SUCCESS`
+ */
+int list_shrink_to_fit( struct dynamic_array * );
+/**
+ * Changes the number of items to `new_size`:
+ * items are removed from the end or zeroed items are appended.
+ * The capacity is never reduced (see `list_shrink_to_fit()`).
+ *
+ * @return `RV_ERROR` if realloc fails, else `RV_SUCCESS`
+ */
+int list_resize( struct dynamic_array *, size_t new_size );
+
+/**
+ * Binary search, returns pointer (NULL if not found);
+ * the first of the equal items if there are several
+ * (see also dynarr_index.h for many searches)
  */
 const void *list_bsearch_p( const struct dynamic_array *,
                             const void *needle,
                             int ( *cmp )( const void *, const void * ) );
 /**
- * Binary search, returns index (-1 if not found)
+ * Binary search, returns index (-1 if not found);
+ * the first of the equal items if there are several
  */
 int64_t list_bsearch_i( const struct dynamic_array *,
                         const void *needle,
                         int ( *cmp )( const void *, const void * ) );
 
+/** Implementations of the linear search of 1-, 2-, 4- and 8-byte items */
+enum ListSearchImpl {
+    LIST_SEARCH_AUTO   = 0, /* best one supported by the CPU */
+    LIST_SEARCH_SCALAR = 1,
+    LIST_SEARCH_SSE2   = 2,
+    LIST_SEARCH_AVX2   = 3,
+};
+
 /**
  * Linear search, returns pointer (NULL if not found)
+ *
+ * Items are compared byte for byte. Items of 1, 2, 4 or 8 bytes are compared
+ * a vector at a time (SSE2/AVX2, the best one the CPU supports is picked at runtime).
  */
 const void *list_lsearch_p( const struct dynamic_array *, const void *needle );
 /**
  * Linear search, returns index (-1 if not found)
+ *
+ * @see `list_lsearch_p()`
  */
 int64_t list_lsearch_i( const struct dynamic_array *, const void *needle );
+/**
+ * `list_lsearch_i()` with the given implementation
+ * (if the CPU doesn't support it, the best one it does is used)
+ */
+int64_t list_lsearch_i_impl( const struct dynamic_array *,
+                             const void *needle,
+                             enum ListSearchImpl impl );
+/**
+ * Finds all items equal to `needle`.
+ *
+ * @return pointer to a new List of the indices (`size_t`) of the matches,
+ *         in ascending order; `NULL` if allocation fails
+ */
+Constructor struct dynamic_array *list_lsearch_all( const struct dynamic_array *,
+                                                    const void *needle );
+/** Name of the implementation `list_lsearch_i()` uses on this CPU */
+const char *list_lsearch_impl_name( void );
 
 /**
- * Uses stdlib's qsort.
+ * Sorts the List with pattern-defeating quicksort (not stable).
  *
- * @param ls    List to be sorted
- * @param cmp   compare function for the elements of the List
+ * O(n log n) in the worst case; already sorted, reversed and otherwise
+ * patterned inputs (and many equal items) take (close to) linear time.
+ * Small lists are insertion-sorted.
  *
- * @see `qsort` from `<stdlib.h>`
+ * @param ls    List to be sorted
+ * @param cmp   compare function for the elements of the List (as for `qsort`)
  */
 void list_sort( struct dynamic_array *ls, int ( *cmp )( const void *, const void * ) );
 
+/**
+ * Sorts the List, keeping equal items in their original order (merge sort).
+ *
+ * @return `RV_ERROR` if the buffer (of the size of the List) can't be allocated,
+ *         else `RV_SUCCESS`
+ */
+int list_sort_stable( struct dynamic_array *ls,
+                      int ( *cmp )( const void *, const void * ) );
+
+/**
+ * Stable radix sort by an unsigned 32-bit key, stored (in native byte order)
+ * `key_offset` bytes from the start of each element.
+ *
+ * Linear in the size of the List; needs a buffer of the size of the List.
+ * Small lists are insertion-sorted.
+ *
+ * @param key_offset e.g. `offsetof( struct record, key )`; 0 for a List of `uint32_t`
+ * @return `RV_EXCEPTION` if the key doesn't fit into the element,
+ *         `RV_ERROR` on allocation failure, else `RV_SUCCESS`
+ */
+int list_sort_radix_u32( struct dynamic_array *ls, size_t key_offset );
+/// @see `list_sort_radix_u32()`
+int list_sort_radix_u64( struct dynamic_array *ls, size_t key_offset );
+/// @see `list_sort_radix_u32()`
+int list_sort_radix_i64( struct dynamic_array *ls, size_t key_offset );
+/**
+ * @see `list_sort_radix_u32()`
+ *
+ * -0.0 goes before 0.0; NaNs go to the start (with the sign bit set)
+ * or to the end (without it).
+ */
+int list_sort_radix_f64( struct dynamic_array *ls, size_t key_offset );
+
 /**
  * Reverses the List – in place
  * @return RV_ERROR if an error occurs, else RV_SUCCESS
@@ -301,6 +440,23 @@ void list_destroy( struct dynamic_array * );
 int list_clear( struct dynamic_array *ls );
 
 
+/* ––––– SAVING/LOADING ––––– */
+
+/**
+ * Writes the List to `file` in the binary format of `serialize.h`
+ *
+ * @return `RV_ERROR` if writing fails, else `RV_SUCCESS`
+ */
+int list_save( const struct dynamic_array *, FILE *file );
+/**
+ * Reads a List written by `list_save()` (or a `SerialWriter` of a List)
+ *
+ * @return pointer to a new List, or `NULL` if the file is invalid or corrupt,
+ *         or if reading or allocation fails
+ */
+Constructor struct dynamic_array *list_load( FILE *file );
+
+
 /* ––––––––––––––––––––––––––––––– PRINTERS ––––––––––––––––––––––––––––––– */
 
 ///@see `array_fprintf_sde`
@@ -339,6 +495,10 @@ bool list_is_empty( const struct dynamic_array * );
 size_t list_size( const struct dynamic_array * );
 /// Returns sizeof elements (e.g. if list element type is `char`, returns 1)
 size_t list_el_size( const struct dynamic_array * );
+/// Returns the number of items the List can hold before it reallocates
+size_t list_capacity( const struct dynamic_array * );
+/// Returns the allocator the List gets its memory from
+const Allocator *list_allocator( const struct dynamic_array * );
 
 /**
  * Gets a `const` view of the items.
@@ -352,6 +512,16 @@ const void *list_items( const struct dynamic_array * );
  * @return A pointer to a copy of the lists items array.
  */
 UseResult void *list_items_copy( const struct dynamic_array * );
+/**
+ * Destroys the List, but hands its items over to the caller instead of freeing them.
+ * The items aren't copied, unless the List uses an allocator
+ * other than `allocator_default()`.
+ *
+ * @param size_cont if not `NULL`, the number of items is stored here
+ * @return pointer to the items, which should be `free`d;
+ *         `NULL` if the copy fails, in which case the List is left intact
+ */
+UseResult void *list_release_buffer( struct dynamic_array *, size_t *size_cont );
 
 
 #endif //CLIBS_DYNAMIC_ARRAY_H
@@ -0,0 +1,205 @@
+/*
+ * Sorted (Eytzinger) index (declared in dynarr_index.h).
+ *
+ * `items[ 1 ]` is the root of the tree, the children of `items[ k ]`
+ * are `items[ 2k ]` (less) and `items[ 2k + 1 ]` (greater); `items[ 0 ]` is unused.
+ *
+ * A search descends from the root, going right while the item is less
+ * than the needle, until it falls off the tree. The path it took, written
+ * in the bits of `k`, ends with the last left turn followed by right turns only:
+ * stripping those (the trailing ones) and the left turn leaves the node
+ * where it last turned left, which is the first item not less than the needle.
+ */
+
+#include "dynarr_index.h"
+
+#include "../headers/errors.h"
+
+#include <stdlib.h> /* posix_memalign */
+#include <string.h> /* memcpy */
+
+
+/** Items a search looks ahead to prefetch (16 = four levels down) */
+#define SORTED_INDEX_PREFETCH 16
+
+/** Searches interleaved by `sorted_index_find_n()` */
+#define SORTED_INDEX_BATCH 16
+
+#define SORTED_INDEX_ALIGN 64
+
+
+struct sorted_index {
+    byte *items;   // `size + 1` items in Eytzinger order, from 1
+    size_t *ranks; // `ranks[ k ]` = index of `items[ k ]` in the sorted List
+    size_t size;
+    size_t el_size;
+
+    int ( *cmp )( const void *, const void * );
+};
+
+
+Private inline const byte *sorted_index_at( const SortedIndex *index, const size_t k )
+{
+    return index->items + k * index->el_size;
+}
+
+/**
+ * Copies the items of the subtree rooted at `k` from `sorted`,
+ * starting at `*next`, in order
+ */
+Private void sorted_index_fill( SortedIndex *index,
+                                const byte *sorted,
+                                size_t *next,
+                                const size_t k )
+{
+    if ( k > index->size )
+        return;
+
+    sorted_index_fill( index, sorted, next, 2 * k );
+
+    memcpy( index->items + k * index->el_size, sorted + *next * index->el_size,
+            index->el_size );
+    index->ranks[ k ] = ( *next )++;
+
+    sorted_index_fill( index, sorted, next, 2 * k + 1 );
+}
+
+
+SortedIndex *sorted_index_init( const struct dynamic_array *sorted,
+                                int ( *cmp )( const void *, const void * ) )
+{
+    SortedIndex *index = calloc( 1, sizeof( SortedIndex ) );
+    if ( index == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    index->size    = list_size( sorted );
+    index->el_size = list_el_size( sorted );
+    index->cmp     = cmp;
+
+    void *items       = NULL;
+    const size_t bytes = ( index->size + 1 ) * index->el_size;
+    if ( posix_memalign( &items, SORTED_INDEX_ALIGN, bytes ) != 0 )
+    {
+        free( index );
+        return fwarn_ret( NULL, "posix_memalign" );
+    }
+    index->items = items;
+
+    if ( ( index->ranks = malloc( ( index->size + 1 ) * sizeof( size_t ) ) ) == NULL )
+    {
+        free( index->items );
+        free( index );
+        return fwarn_ret( NULL, "malloc" );
+    }
+
+    size_t next = 0;
+    sorted_index_fill( index, list_items( sorted ), &next, 1 );
+
+    return index;
+}
+
+void sorted_index_destroy( SortedIndex *index )
+{
+    free( index->items );
+    free( index->ranks );
+    free( index );
+}
+
+size_t sorted_index_size( const SortedIndex *index )
+{
+    return index->size;
+}
+
+
+/** One step down: right if the item at `k` is less than `needle` */
+Private inline size_t sorted_index_step( const SortedIndex *index,
+                                         const size_t k,
+                                         const void *needle )
+{
+    // the descendants may span more than one cache line
+    if ( SORTED_INDEX_PREFETCH * k <= index->size )
+    {
+        const byte *descendants = sorted_index_at( index, SORTED_INDEX_PREFETCH * k );
+        for ( size_t offset = 0; offset < SORTED_INDEX_PREFETCH * index->el_size
+                                 && offset < 4 * SORTED_INDEX_ALIGN;
+              offset += SORTED_INDEX_ALIGN )
+            __builtin_prefetch( descendants + offset );
+    }
+
+    return 2 * k + ( index->cmp( needle, sorted_index_at( index, k ) ) > 0 );
+}
+
+/** @return position of the lower bound of the search that fell off at `k`, or 0 */
+Private inline size_t sorted_index_lower_bound( const size_t k )
+{
+    // strip the trailing ones (right turns) and the zero before them (the left turn)
+    return k >> ( __builtin_ctzll( ~( unsigned long long ) k ) + 1 );
+}
+
+Private inline int64_t sorted_index_match( const SortedIndex *index,
+                                           const size_t k,
+                                           const void *needle )
+{
+    if ( k == 0 || index->cmp( needle, sorted_index_at( index, k ) ) != 0 )
+        return -1;
+    return ( int64_t ) index->ranks[ k ];
+}
+
+
+size_t sorted_index_rank( const SortedIndex *index, const void *needle )
+{
+    size_t k = 1;
+    while ( k <= index->size )
+        k = sorted_index_step( index, k, needle );
+
+    k = sorted_index_lower_bound( k );
+    return k == 0 ? index->size : index->ranks[ k ];
+}
+
+int64_t sorted_index_find( const SortedIndex *index, const void *needle )
+{
+    size_t k = 1;
+    while ( k <= index->size )
+        k = sorted_index_step( index, k, needle );
+
+    return sorted_index_match( index, sorted_index_lower_bound( k ), needle );
+}
+
+void sorted_index_find_n( const SortedIndex *index,
+                          const void *needles,
+                          const size_t count,
+                          int64_t *indices )
+{
+    const byte *needle_bytes = needles;
+
+    for ( size_t first = 0; first < count; first += SORTED_INDEX_BATCH )
+    {
+        const size_t batch = count - first < SORTED_INDEX_BATCH ? count - first
+                                                                 : SORTED_INDEX_BATCH;
+        const byte *batch_needles = needle_bytes + first * index->el_size;
+
+        // all searches go down a level before any goes further,
+        // so the misses of one level overlap
+        size_t k[ SORTED_INDEX_BATCH ];
+        for ( size_t j = 0; j < batch; ++j )
+            k[ j ] = 1;
+
+        for ( bool descending = index->size > 0; descending; )
+        {
+            descending = false;
+            for ( size_t j = 0; j < batch; ++j )
+                if ( k[ j ] <= index->size )
+                {
+                    k[ j ] = sorted_index_step(
+                            index, k[ j ], batch_needles + j * index->el_size );
+                    descending = true;
+                }
+        }
+
+        for ( size_t j = 0; j < batch; ++j )
+            indices[ first + j ] =
+                    sorted_index_match( index,
+                                        sorted_index_lower_bound( k[ j ] ),
+                                        batch_needles + j * index->el_size );
+    }
+}
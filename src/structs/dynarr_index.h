@@ -0,0 +1,80 @@
+/**
+ * @file dynarr_index.h
+ * @brief A read-only search index over the items of a sorted `List` (see dynarr.h).
+ *
+ * The items are copied in Eytzinger order (the breadth-first order
+ * of the implicit binary search tree: the root, both its children, their four
+ * children, ...), so the first levels of every search share a few cache lines
+ * and the items a search will need next can be prefetched
+ * (the 16 possible descendants four levels down are next to each other).
+ * Each step of a search is a comparison and an index computation, with no branch
+ * depending on its result.
+ *
+ * On large arrays this is several times faster than `list_bsearch_i()`,
+ * which misses the cache on (almost) every level.
+ * `sorted_index_find_n()` interleaves many searches to overlap their misses.
+ *
+ * The index doesn't refer to the List; it may be changed or destroyed.
+ *
+ * Example:
+ * @code
+ * SortedIndex *index = sorted_index_init( ls, cmp_int );
+ * int64_t i = sorted_index_find( index, &( int ) { 42 } ); // == list_bsearch_i()
+ * sorted_index_destroy( index );
+ * @endcode
+ */
+
+#ifndef CLIBS_DYNARR_INDEX_H
+#define CLIBS_DYNARR_INDEX_H
+
+#include "../headers/attributes.h"
+#include "../headers/types.h"
+#include "dynarr.h"
+
+
+typedef struct sorted_index SortedIndex;
+
+
+/**
+ * Builds an index of the items of `sorted`.
+ *
+ * @param sorted    List sorted in ascending order by `cmp`
+ * @param cmp       compares a needle (first) to an item (second),
+ *                  like for `list_bsearch_p()`
+ * @return pointer to a new index, or `NULL` if allocation fails
+ */
+Constructor SortedIndex *sorted_index_init( const struct dynamic_array *sorted,
+                                            int ( *cmp )( const void *, const void * ) );
+/** Frees all memory owned by the index */
+void sorted_index_destroy( SortedIndex * );
+
+/// Number of items in the index
+size_t sorted_index_size( const SortedIndex * );
+
+/**
+ * Finds an item equal to `needle` (the first one, if there are several).
+ *
+ * @return the index of the item in the sorted List, or -1 if there is none
+ *         (the same as `list_bsearch_i()` of the List)
+ */
+int64_t sorted_index_find( const SortedIndex *, const void *needle );
+/**
+ * Number of items less than `needle`,
+ * i.e. the index of the first item not less than it (the lower bound)
+ *
+ * @return value in the range [0, size]
+ */
+size_t sorted_index_rank( const SortedIndex *, const void *needle );
+
+/**
+ * `sorted_index_find()` of `count` needles at once.
+ *
+ * @param needles   array of `count` items
+ * @param indices   the results are stored here (`count` of them)
+ */
+void sorted_index_find_n( const SortedIndex *,
+                          const void *needles,
+                          size_t count,
+                          int64_t *indices );
+
+#endif //CLIBS_DYNARR_INDEX_H
@@ -0,0 +1,291 @@
+/*
+ * Memory-mapped Lists (declared in dynarr_mmap.h).
+ *
+ * The mapping is an `Allocator` (see allocator.h) of its List:
+ *  - `alloc` maps the items if nothing is mapped (e.g. after `list_clear()`),
+ *    anything else (the List itself) comes from `malloc()`
+ *  - `resize` grows the file and the mapping, or, without `LIST_MMAP_WRITE`,
+ *    moves the items to anonymous memory
+ *  - `free` unmaps the items (truncating the file to the size of the List);
+ *    freeing the List itself, which is always freed last, closes the file
+ *
+ * The allocator serves only its own List; Lists derived from it
+ * (`list_copy()`, `list_reversed()`) use `allocator_default()`.
+ */
+
+#define _GNU_SOURCE      /* mremap, MAP_ANONYMOUS */
+#define _DARWIN_C_SOURCE /* MAP_ANON */
+
+#include "dynarr_mmap.h"
+
+#include "../headers/errors.h"
+
+#include <assert.h>
+#include <fcntl.h>    /* open */
+#include <stdint.h>   /* intmax_t */
+#include <stdlib.h>   /* malloc */
+#include <string.h>   /* memcpy */
+#include <sys/mman.h> /* mmap */
+#include <sys/stat.h> /* fstat */
+#include <unistd.h>   /* ftruncate, close */
+
+
+#if !defined( MAP_ANONYMOUS ) && defined( MAP_ANON )
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define LIST_MMAP_ALL_FLAGS                                                        \
+    ( LIST_MMAP_WRITE | LIST_MMAP_CREATE | LIST_MMAP_SEQUENTIAL | LIST_MMAP_RANDOM \
+      | LIST_MMAP_WILLNEED )
+
+
+struct list_mapping {
+    Allocator allocator; // `ctx` is the mapping itself
+    const List *list;    // for its size when unmapping
+
+    int fd;
+    list_mmap_flags_t flags;
+    size_t el_size;
+
+    void *base;     // `NULL` while nothing is mapped
+    size_t mapped;  // bytes
+    bool anonymous; // the items aren't (or no longer) the file
+};
+
+
+Private void mapping_advise( const struct list_mapping *mapping )
+{
+    int advice = POSIX_MADV_NORMAL;
+    if ( mapping->flags & LIST_MMAP_SEQUENTIAL )
+        advice = POSIX_MADV_SEQUENTIAL;
+    else if ( mapping->flags & LIST_MMAP_RANDOM )
+        advice = POSIX_MADV_RANDOM;
+
+    // only hints; failing is harmless
+    if ( advice != POSIX_MADV_NORMAL )
+        ( void ) posix_madvise( mapping->base, mapping->mapped, advice );
+    if ( mapping->flags & LIST_MMAP_WILLNEED )
+        ( void ) posix_madvise( mapping->base, mapping->mapped, POSIX_MADV_WILLNEED );
+}
+
+/** Maps `size` bytes of the file (or of anonymous memory) */
+Private void *mapping_map( struct list_mapping *mapping,
+                           const size_t size,
+                           const bool anonymous )
+{
+    void *base;
+    if ( anonymous )
+        base = mmap( NULL,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1,
+                     0 );
+    else
+    {
+        if ( mapping->flags & LIST_MMAP_WRITE
+             && ftruncate( mapping->fd, ( off_t ) size ) != 0 )
+            return fwarn_ret( NULL, "ftruncate" );
+
+        base = mmap( NULL,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     mapping->flags & LIST_MMAP_WRITE ? MAP_SHARED : MAP_PRIVATE,
+                     mapping->fd,
+                     0 );
+    }
+    if ( base == MAP_FAILED )
+        return fwarn_ret( NULL, "mmap" );
+
+    mapping->base      = base;
+    mapping->mapped    = size;
+    mapping->anonymous = anonymous;
+    mapping_advise( mapping );
+    return base;
+}
+
+
+Private void *mapping_alloc( void *ctx, const size_t size )
+{
+    struct list_mapping *mapping = ctx;
+    if ( mapping->base != NULL )
+        return malloc( size );
+
+    void *base = mapping_map( mapping, size, !( mapping->flags & LIST_MMAP_WRITE ) );
+    if ( base == NULL )
+        return f_stack_trace( NULL );
+
+    return base;
+}
+
+Private void *mapping_resize( void *ctx,
+                              void *ptr,
+                              const size_t old_size,
+                              const size_t new_size )
+{
+    struct list_mapping *mapping = ctx;
+    ( void ) old_size;
+
+    // shrinking keeps the mapping; the file is truncated when unmapped
+    if ( new_size <= mapping->mapped )
+        return ptr;
+
+    void *const old_base    = mapping->base;
+    const size_t old_mapped = mapping->mapped;
+
+    if ( !( mapping->flags & LIST_MMAP_WRITE ) )
+    {
+        // copy-on-write: the file (possibly shorter than the mapping) isn't grown
+        if ( mapping_map( mapping, new_size, true ) == NULL )
+            return f_stack_trace( NULL );
+
+        memcpy( mapping->base, old_base, list_size( mapping->list ) * mapping->el_size );
+        munmap( old_base, old_mapped );
+        return mapping->base;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    if ( ftruncate( mapping->fd, ( off_t ) new_size ) != 0 )
+        return fwarn_ret( NULL, "ftruncate" );
+
+    void *base = mremap( old_base, old_mapped, new_size, MREMAP_MAYMOVE );
+    if ( base == MAP_FAILED )
+        return fwarn_ret( NULL, "mremap" );
+
+    mapping->base   = base;
+    mapping->mapped = new_size;
+    mapping_advise( mapping );
+#else
+    // the old and the new mapping share the (already written) pages of the file
+    if ( mapping_map( mapping, new_size, false ) == NULL )
+        return f_stack_trace( NULL );
+
+    munmap( old_base, old_mapped );
+#endif
+
+    return mapping->base;
+}
+
+Private void mapping_free( void *ctx, void *ptr, const size_t size )
+{
+    struct list_mapping *mapping = ctx;
+    ( void ) size;
+
+    if ( ptr == mapping->list )
+    {
+        // freed last
+        free( ptr );
+        close( mapping->fd );
+        free( mapping );
+        return;
+    }
+    assert( ptr == mapping->base );
+
+    munmap( mapping->base, mapping->mapped );
+    if ( mapping->flags & LIST_MMAP_WRITE
+         && ftruncate( mapping->fd,
+                       ( off_t ) ( list_size( mapping->list ) * mapping->el_size ) )
+                    != 0 )
+        fwarn( "ftruncate" );
+
+    mapping->base   = NULL;
+    mapping->mapped = 0;
+}
+
+
+struct dynamic_array *list_open_mmap( const char *path,
+                                      const size_t el_size,
+                                      const list_mmap_flags_t flags )
+{
+    if ( path == NULL )
+        return fwarnx_ret( NULL, "path may not be null" );
+    if ( el_size == 0 )
+        return fwarnx_ret( NULL, "el_size may not be 0" );
+    if ( flags & ~LIST_MMAP_ALL_FLAGS
+         || ( flags & LIST_MMAP_CREATE && !( flags & LIST_MMAP_WRITE ) ) )
+        return fwarnx_ret( NULL, "invalid flags: 0x%X", flags );
+
+    struct list_mapping *mapping = calloc( 1, sizeof( struct list_mapping ) );
+    if ( mapping == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    mapping->allocator = ( Allocator ) {
+        .alloc  = mapping_alloc,
+        .resize = mapping_resize,
+        .free   = mapping_free,
+        .ctx    = mapping,
+    };
+    mapping->flags   = flags;
+    mapping->el_size = el_size;
+
+    const int open_flags = ( flags & LIST_MMAP_WRITE ? O_RDWR : O_RDONLY )
+                         | ( flags & LIST_MMAP_CREATE ? O_CREAT : 0 );
+    if ( ( mapping->fd = open( path, open_flags, 0666 ) ) < 0 )
+    {
+        fwarn( "open '%s'", path );
+        free( mapping );
+        return NULL;
+    }
+
+    struct stat st;
+    if ( fstat( mapping->fd, &st ) != 0 )
+    {
+        fwarn( "fstat '%s'", path );
+        goto ERROR;
+    }
+    if ( ( size_t ) st.st_size % el_size != 0 )
+    {
+        fwarnx( "size of '%s' (%jd) isn't a multiple of %zu",
+                path,
+                ( intmax_t ) st.st_size,
+                el_size );
+        goto ERROR;
+    }
+
+    // an empty List still has room for one item
+    const size_t size     = ( size_t ) st.st_size / el_size;
+    const size_t capacity = size > 0 ? size : 1;
+
+    if ( mapping_map( mapping,
+                      capacity * el_size,
+                      size == 0 && !( flags & LIST_MMAP_WRITE ) )
+         == NULL )
+        goto ERROR;
+
+    List *ls = list_adopt_buffer_with_allocator(
+            mapping->base, size, capacity, el_size, &mapping->allocator );
+    if ( ls == NULL )
+    {
+        munmap( mapping->base, mapping->mapped );
+        goto ERROR;
+    }
+    mapping->list = ls;
+
+    return ls;
+
+ERROR:
+    close( mapping->fd );
+    free( mapping );
+    return f_stack_trace( NULL );
+}
+
+
+bool list_is_mmap( const struct dynamic_array *ls )
+{
+    return list_allocator( ls )->alloc == mapping_alloc;
+}
+
+int list_mmap_sync( const struct dynamic_array *ls )
+{
+    if ( !list_is_mmap( ls ) )
+        return fwarnx_ret( RV_EXCEPTION, "List isn't memory-mapped" );
+
+    const struct list_mapping *mapping = list_allocator( ls )->ctx;
+    if ( mapping->anonymous || mapping->base == NULL )
+        return RV_SUCCESS;
+
+    if ( msync( mapping->base, mapping->mapped, MS_SYNC ) != 0 )
+        return fwarn_ret( RV_ERROR, "msync" );
+
+    return RV_SUCCESS;
+}
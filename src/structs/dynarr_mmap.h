@@ -0,0 +1,80 @@
+/**
+ * @file dynarr_mmap.h
+ * @brief A `List` (see dynarr.h) whose items are a memory-mapped file.
+ *
+ * The file is an array of fixed-size records; it isn't read when opened,
+ * its pages are loaded (and evicted) by the OS as the items are accessed,
+ * so the file may be larger than the available memory.
+ *
+ * The List is an ordinary `List`: `list_see()`, `list_bsearch_i()`, `foreach_ls`,
+ * `list_sort()`, ... all work unchanged. It is closed by `list_destroy()`.
+ *
+ * - with `LIST_MMAP_WRITE`, the changes are written to the file; the file grows
+ *   along with the List and is truncated to the items of the List when it's destroyed
+ * - without it, the file is never modified; the List may still be changed
+ *   (and grown), but the changes are private to the List (copy-on-write)
+ */
+
+#ifndef CLIBS_DYNARR_MMAP_H
+#define CLIBS_DYNARR_MMAP_H
+
+#include "../headers/attributes.h"
+#include "../headers/types.h"
+#include "dynarr.h"
+
+
+/**
+ * Flags for `list_open_mmap()`
+ * <p>
+ *
+ * - `LIST_MMAP_WRITE`      // = 0x01
+ *      - opens the file for writing; the changes to the List are saved in it
+ *
+ * - `LIST_MMAP_CREATE`     // = 0x02
+ *      - creates the file if it doesn't exist (along with `LIST_MMAP_WRITE`)
+ *
+ * - `LIST_MMAP_SEQUENTIAL` // = 0x04
+ *      - the items will be accessed in order (the OS may read ahead aggressively)
+ *
+ * - `LIST_MMAP_RANDOM`     // = 0x08
+ *      - the items will be accessed in random order (the OS may not read ahead)
+ *
+ * - `LIST_MMAP_WILLNEED`   // = 0x10
+ *      - the whole file will be needed soon (the OS may start loading it)
+ * </p>
+ */
+typedef unsigned int list_mmap_flags_t;
+
+#define LIST_MMAP_WRITE      ( 1 << 0 )
+#define LIST_MMAP_CREATE     ( 1 << 1 )
+#define LIST_MMAP_SEQUENTIAL ( 1 << 2 )
+#define LIST_MMAP_RANDOM     ( 1 << 3 )
+#define LIST_MMAP_WILLNEED   ( 1 << 4 )
+
+
+/**
+ * Opens the file at `path` as a List of items of `el_size` bytes.
+ *
+ * @param el_size   sizeof a single item; the size of the file must be a multiple of it
+ * @param flags     see `list_mmap_flags_t`
+ * @return pointer to a new List, or `NULL` if the file can't be opened or mapped,
+ *         its size isn't a multiple of `el_size`, or the flags are invalid
+ */
+Constructor struct dynamic_array *list_open_mmap( const char *path,
+                                                  size_t el_size,
+                                                  list_mmap_flags_t flags );
+
+/// Whether the List is from `list_open_mmap()`
+bool list_is_mmap( const struct dynamic_array * );
+
+/**
+ * Writes the changes made so far to the file (a List opened without
+ * `LIST_MMAP_WRITE` has nothing to write). The file may hold more
+ * (zeroed) items than the List until the List is destroyed.
+ *
+ * @return `RV_EXCEPTION` if the List isn't from `list_open_mmap()`,
+ *         `RV_ERROR` if writing fails, else `RV_SUCCESS`
+ */
+int list_mmap_sync( const struct dynamic_array * );
+
+#endif //CLIBS_DYNARR_MMAP_H
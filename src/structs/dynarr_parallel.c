@@ -0,0 +1,446 @@
+/*
+ * Parallel algorithms for `List` (declared in dynarr_parallel.h).
+ *
+ * Every call is a fork-join: `parallel_run()` hands out task indices
+ * to the workers of `ListParallelOptions.pool` with `thread_pool_parallel_for()`,
+ * or, without a pool, starts the threads itself; these (along with the calling
+ * thread) claim task indices from a shared counter until there are none left,
+ * and are joined.
+ */
+
+#include "dynarr_parallel.h"
+
+#include "../headers/atomics.h"
+#include "../headers/errors.h"
+#include "../headers/simple_math.h" /* min_m */
+#include "dynarr_search.h"
+#include "dynarr_sort.h"
+
+#include <pthread.h>
+#include <stdlib.h> /* malloc */
+#include <string.h> /* mem* */
+#include <unistd.h> /* sysconf */
+
+
+typedef void ( *ParallelTask )( void *ctx, size_t task );
+
+struct parallel_job {
+    ParallelTask task;
+    void *ctx;
+    size_t n_tasks;
+    size_t next_task; // shared; only accessed atomically
+};
+
+
+Private void *parallel_worker( void *arg )
+{
+    struct parallel_job *job = arg;
+
+    size_t task;
+    while ( ( task = atomic_add_relaxed( &job->next_task, 1 ) ) < job->n_tasks )
+        job->task( job->ctx, task );
+
+    return NULL;
+}
+
+Private void parallel_pool_body( const size_t from, const size_t to, void *arg )
+{
+    const struct parallel_job *job = arg;
+    for ( size_t task = from; task < to; ++task )
+        job->task( job->ctx, task );
+}
+
+Private size_t parallel_n_threads( const ListParallelOptions *opts )
+{
+    if ( opts != NULL && opts->n_threads != 0 )
+        return min_m( opts->n_threads, ( size_t ) LIST_PARALLEL_MAX_THREADS );
+
+    const long n_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+    if ( n_cpus < 1 )
+        return 1;
+    return min_m( ( size_t ) n_cpus, ( size_t ) LIST_PARALLEL_MAX_THREADS );
+}
+
+/**
+ * Runs `task( ctx, 0 )` … `task( ctx, n_tasks - 1 )` on the pool of `opts`
+ * or on (up to) `opts->n_threads` threads, the calling one included.
+ * If a thread can't be started, the ones already running do its share.
+ */
+Private void parallel_run( const size_t n_tasks,
+                           const ListParallelOptions *opts,
+                           const ParallelTask task,
+                           void *ctx )
+{
+    struct parallel_job job = {
+        .task      = task,
+        .ctx       = ctx,
+        .n_tasks   = n_tasks,
+        .next_task = 0,
+    };
+
+    if ( opts != NULL && opts->pool != NULL )
+    {
+        // one task per range; the tasks are about `grain_size` already
+        if ( thread_pool_parallel_for(
+                     opts->pool, 0, n_tasks, 1, parallel_pool_body, &job )
+             != RV_SUCCESS )
+            parallel_worker( &job );
+        return;
+    }
+
+    pthread_t threads[ LIST_PARALLEL_MAX_THREADS ];
+    const size_t n_threads = min_m( parallel_n_threads( opts ), n_tasks );
+
+    size_t n_started = 0;
+    while ( n_started + 1 < n_threads
+            && pthread_create( threads + n_started, NULL, parallel_worker, &job ) == 0 )
+        ++n_started;
+
+    parallel_worker( &job );
+
+    for ( size_t i = 0; i < n_started; ++i )
+        pthread_join( threads[ i ], NULL );
+}
+
+Private size_t parallel_grain( const ListParallelOptions *opts )
+{
+    if ( opts != NULL && opts->grain_size != 0 )
+        return opts->grain_size;
+    return LIST_PARALLEL_DEF_GRAIN;
+}
+
+/** Number of `grain`-sized blocks covering `n` items */
+Private inline size_t parallel_n_blocks( const size_t n, const size_t grain )
+{
+    return n / grain + ( n % grain != 0 );
+}
+
+
+/* -------- sort -------- */
+
+struct parallel_sort {
+    byte *src;
+    byte *dst;
+    byte *buffer; // the one of `src` and `dst` that isn't the List
+    size_t n;
+    size_t el_size;
+    CmpFunction cmp;
+
+    size_t grain;
+    size_t width;           // of the sorted runs being merged
+    size_t pieces_per_pair; // of runs
+};
+
+Private void parallel_sort_block( void *ctx, const size_t block )
+{
+    const struct parallel_sort *sort = ctx;
+
+    const size_t offset = block * sort->grain * sort->el_size;
+    sort_stable_items( sort->src + offset,
+                       min_m( sort->grain, sort->n - block * sort->grain ),
+                       sort->el_size,
+                       sort->cmp,
+                       sort->buffer + offset );
+}
+
+/** Number of items in `[right, right + n_right)` less than `item` */
+Private size_t parallel_lower_bound( const struct parallel_sort *sort,
+                                     const byte *right,
+                                     size_t n_right,
+                                     const byte *item )
+{
+    size_t lo = 0;
+    while ( n_right > 0 )
+    {
+        const size_t half = n_right / 2;
+        if ( sort->cmp( right + ( lo + half ) * sort->el_size, item ) < 0 )
+        {
+            lo += half + 1;
+            n_right -= half + 1;
+        }
+        else
+            n_right = half;
+    }
+    return lo;
+}
+
+/**
+ * Where the `piece`-th piece of merging `left` and `right` starts:
+ * the left items before `left[ *i_left ]` and the right ones less than it
+ */
+Private void parallel_split( const struct parallel_sort *sort,
+                             const byte *left,
+                             const size_t n_left,
+                             const byte *right,
+                             const size_t n_right,
+                             const size_t piece,
+                             size_t *i_left,
+                             size_t *i_right )
+{
+    if ( piece == 0 || piece == sort->pieces_per_pair )
+    {
+        *i_left  = piece == 0 ? 0 : n_left;
+        *i_right = piece == 0 ? 0 : n_right;
+        return;
+    }
+
+    *i_left  = piece * n_left / sort->pieces_per_pair;
+    *i_right = *i_left == n_left ? n_right
+                                 : parallel_lower_bound( sort,
+                                                         right,
+                                                         n_right,
+                                                         left + *i_left * sort->el_size );
+}
+
+Private void parallel_merge_piece( void *ctx, const size_t task )
+{
+    const struct parallel_sort *sort = ctx;
+    const size_t el_size             = sort->el_size;
+
+    const size_t start = task / sort->pieces_per_pair * 2 * sort->width;
+    const size_t piece = task % sort->pieces_per_pair;
+    if ( start >= sort->n )
+        return;
+
+    const size_t n_left  = min_m( sort->width, sort->n - start );
+    const size_t n_right = min_m( sort->width, sort->n - start - n_left );
+    const byte *left     = sort->src + start * el_size;
+    const byte *right    = left + n_left * el_size;
+
+    size_t l_begin, r_begin, l_end, r_end;
+    parallel_split( sort, left, n_left, right, n_right, piece, &l_begin, &r_begin );
+    parallel_split( sort, left, n_left, right, n_right, piece + 1, &l_end, &r_end );
+
+    sort_merge( sort->dst + ( start + l_begin + r_begin ) * el_size,
+                left + l_begin * el_size,
+                l_end - l_begin,
+                right + r_begin * el_size,
+                r_end - r_begin,
+                el_size,
+                sort->cmp );
+}
+
+int list_parallel_sort( List *ls,
+                        const CmpFunction cmp,
+                        const ListParallelOptions *opts )
+{
+    const size_t n = list_size( ls );
+    if ( n < 2 )
+        return RV_SUCCESS;
+
+    const size_t el_size = list_el_size( ls );
+    byte *buffer         = malloc( n * el_size );
+    if ( buffer == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    const size_t grain = parallel_grain( opts );
+
+    struct parallel_sort sort = {
+        .src     = list_at( ls, 0 ),
+        .dst     = buffer,
+        .buffer  = buffer,
+        .n       = n,
+        .el_size = el_size,
+        .cmp     = cmp,
+        .grain   = grain,
+    };
+
+    parallel_run( parallel_n_blocks( n, grain ), opts, parallel_sort_block, &sort );
+
+    for ( sort.width = grain; sort.width < n; sort.width *= 2 )
+    {
+        const size_t n_pairs = parallel_n_blocks( n, 2 * sort.width );
+        sort.pieces_per_pair = parallel_n_blocks( 2 * sort.width, grain );
+
+        parallel_run( n_pairs * sort.pieces_per_pair,
+                      opts,
+                      parallel_merge_piece,
+                      &sort );
+
+        byte *swap = sort.src;
+        sort.src   = sort.dst;
+        sort.dst   = swap;
+    }
+
+    if ( sort.src == buffer )
+        memcpy( list_at( ls, 0 ), buffer, n * el_size );
+
+    free( buffer );
+    return RV_SUCCESS;
+}
+
+
+/* -------- for each -------- */
+
+struct parallel_for_each {
+    byte *items;
+    size_t n;
+    size_t el_size;
+    size_t grain;
+
+    void ( *func )( void *item, size_t index, void *arg );
+    void *arg;
+};
+
+Private void parallel_for_each_block( void *ctx, const size_t block )
+{
+    const struct parallel_for_each *each = ctx;
+
+    const size_t end = min_m( ( block + 1 ) * each->grain, each->n );
+    for ( size_t i = block * each->grain; i < end; ++i )
+        each->func( each->items + i * each->el_size, i, each->arg );
+}
+
+void list_parallel_for_each( List *ls,
+                             void ( *func )( void *item, size_t index, void *arg ),
+                             void *arg,
+                             const ListParallelOptions *opts )
+{
+    const size_t n = list_size( ls );
+    if ( n == 0 )
+        return;
+
+    struct parallel_for_each each = {
+        .items   = list_at( ls, 0 ),
+        .n       = n,
+        .el_size = list_el_size( ls ),
+        .grain   = parallel_grain( opts ),
+        .func    = func,
+        .arg     = arg,
+    };
+
+    parallel_run( parallel_n_blocks( n, each.grain ),
+                  opts,
+                  parallel_for_each_block,
+                  &each );
+}
+
+
+/* -------- reduce -------- */
+
+struct parallel_reduce {
+    const byte *items;
+    size_t n;
+    size_t el_size;
+    size_t grain;
+
+    byte *partials; // `acc_size` bytes per block
+    size_t acc_size;
+    void ( *fold )( void *acc, const void *item, void *arg );
+    void *arg;
+};
+
+Private void parallel_reduce_block( void *ctx, const size_t block )
+{
+    const struct parallel_reduce *reduce = ctx;
+
+    byte *acc        = reduce->partials + block * reduce->acc_size;
+    const size_t end = min_m( ( block + 1 ) * reduce->grain, reduce->n );
+    for ( size_t i = block * reduce->grain; i < end; ++i )
+        reduce->fold( acc, reduce->items + i * reduce->el_size, reduce->arg );
+}
+
+int list_parallel_reduce( const List *ls,
+                          void *acc,
+                          const size_t acc_size,
+                          void ( *fold )( void *acc, const void *item, void *arg ),
+                          void ( *combine )( void *acc, const void *other, void *arg ),
+                          void *arg,
+                          const ListParallelOptions *opts )
+{
+    const size_t n = list_size( ls );
+    if ( n == 0 )
+        return RV_SUCCESS;
+
+    const size_t grain    = parallel_grain( opts );
+    const size_t n_blocks = parallel_n_blocks( n, grain );
+
+    byte *partials = malloc( n_blocks * acc_size );
+    if ( partials == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+    for ( size_t i = 0; i < n_blocks; ++i )
+        memcpy( partials + i * acc_size, acc, acc_size );
+
+    struct parallel_reduce reduce = {
+        .items    = list_items( ls ),
+        .n        = n,
+        .el_size  = list_el_size( ls ),
+        .grain    = grain,
+        .partials = partials,
+        .acc_size = acc_size,
+        .fold     = fold,
+        .arg      = arg,
+    };
+
+    parallel_run( n_blocks, opts, parallel_reduce_block, &reduce );
+
+    // the first block started from the initial `acc` itself
+    memcpy( acc, partials, acc_size );
+    for ( size_t i = 1; i < n_blocks; ++i )
+        combine( acc, partials + i * acc_size, arg );
+
+    free( partials );
+    return RV_SUCCESS;
+}
+
+
+/* -------- linear search -------- */
+
+struct parallel_lsearch {
+    const byte *items;
+    size_t n;
+    size_t el_size;
+    size_t grain;
+
+    const void *needle;
+    size_t found; // shared; index of the first match found so far, or `SIZE_MAX`
+};
+
+Private void parallel_lsearch_block( void *ctx, const size_t block )
+{
+    struct parallel_lsearch *search = ctx;
+
+    const size_t start = block * search->grain;
+    // a match in an earlier block has been found already
+    if ( start > atomic_load_relaxed( &search->found ) )
+        return;
+
+    const size_t n = min_m( start + search->grain, search->n ) - start;
+    const size_t i = start
+                   + lsearch_items( search->items + start * search->el_size,
+                                    n,
+                                    search->el_size,
+                                    search->needle,
+                                    LIST_SEARCH_AUTO );
+    if ( i == start + n )
+        return;
+
+    size_t found = atomic_load_relaxed( &search->found );
+    while ( i < found && !atomic_cas_weak_relaxed( &search->found, &found, i ) )
+        continue;
+}
+
+int64_t list_parallel_lsearch_i( const List *ls,
+                                 const void *needle,
+                                 const ListParallelOptions *opts )
+{
+    const size_t n = list_size( ls );
+    if ( n == 0 )
+        return -1;
+
+    struct parallel_lsearch search = {
+        .items   = list_items( ls ),
+        .n       = n,
+        .el_size = list_el_size( ls ),
+        .grain   = parallel_grain( opts ),
+        .needle  = needle,
+        .found   = SIZE_MAX,
+    };
+
+    parallel_run( parallel_n_blocks( n, search.grain ),
+                  opts,
+                  parallel_lsearch_block,
+                  &search );
+
+    return search.found == SIZE_MAX ? -1 : ( int64_t ) search.found;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file dynarr_parallel.h
+ * @brief Multi-threaded algorithms over a `List` (see dynarr.h).
+ *
+ * The List is split into blocks of `grain_size` items, which are handed out
+ * to the workers of a `ThreadPool` (see thread_pool.h) or to `n_threads` threads
+ * started by the call; the calling thread takes part either way.
+ * See `ListParallelOptions`.
+ *
+ * The results do not depend on the number of threads and are the same as
+ * those of the serial versions:
+ *  - `list_parallel_sort()`      <=> `list_sort_stable()`
+ *  - `list_parallel_lsearch_i()` <=> `list_lsearch_i()`
+ *  - `list_parallel_reduce()`    <=> folding the List front to back,
+ *    as long as `combine` is associative (see the function)
+ *
+ * The List must not be modified by another thread during the call.
+ */
+
+#ifndef CLIBS_DYNARR_PARALLEL_H
+#define CLIBS_DYNARR_PARALLEL_H
+
+#include "../thread_pool.h"
+#include "dynarr.h"
+
+
+/** Default `ListParallelOptions.grain_size` */
+#define LIST_PARALLEL_DEF_GRAIN 16384
+/** Max number of threads started by one call (without a pool) */
+#define LIST_PARALLEL_MAX_THREADS 64
+
+
+typedef struct list_parallel_options {
+    size_t n_threads;  // 0 for one per online CPU; ignored with a `pool`
+    size_t grain_size; // items per task; 0 for `LIST_PARALLEL_DEF_GRAIN`
+    ThreadPool *pool;  // runs the tasks if not `NULL`; else threads are started
+} ListParallelOptions;
+
+
+/**
+ * Stable parallel merge sort.
+ * The blocks are sorted in parallel, then merged pairwise in rounds,
+ * each merge being split into `grain_size`d pieces.
+ *
+ * @param opts `NULL` for the defaults
+ * @return `RV_ERROR` if the buffer (of the size of the List) can't be allocated,
+ *         else `RV_SUCCESS`
+ */
+int list_parallel_sort( List *ls,
+                        int ( *cmp )( const void *, const void * ),
+                        const ListParallelOptions *opts );
+
+/**
+ * Calls `func` on every item of the List, in no particular order.
+ *
+ * @param func  gets the item, its index and `arg`
+ * @param opts  `NULL` for the defaults
+ */
+void list_parallel_for_each( List *ls,
+                             void ( *func )( void *item, size_t index, void *arg ),
+                             void *arg,
+                             const ListParallelOptions *opts );
+
+/**
+ * Every block is folded into its own copy of the initial `acc`,
+ * then the partial results are combined into `acc` in the order of the blocks.
+ * The result thus depends only on `grain_size`, never on the number of threads;
+ * it equals the serial fold if `combine` is associative and the initial `acc`
+ * is the identity (e.g. 0 for a sum).
+ *
+ * @param acc       `acc_size` bytes; the initial value, overwritten by the result
+ * @param fold      folds `item` into `acc`
+ * @param combine   combines the (later) partial result `other` into `acc`
+ * @param opts      `NULL` for the defaults
+ * @return `RV_ERROR` if the partial results can't be allocated, else `RV_SUCCESS`
+ */
+int list_parallel_reduce( const List *ls,
+                          void *acc,
+                          size_t acc_size,
+                          void ( *fold )( void *acc, const void *item, void *arg ),
+                          void ( *combine )( void *acc, const void *other, void *arg ),
+                          void *arg,
+                          const ListParallelOptions *opts );
+
+/**
+ * Linear search (by `memcmp`), returns the index of the first match
+ * (-1 if not found). Blocks after a found match are skipped.
+ *
+ * @param opts `NULL` for the defaults
+ */
+int64_t list_parallel_lsearch_i( const List *ls,
+                                 const void *needle,
+                                 const ListParallelOptions *opts );
+
+#endif //CLIBS_DYNARR_PARALLEL_H
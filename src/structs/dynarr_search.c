@@ -0,0 +1,231 @@
+/*
+ * Linear search of List items (declared in dynarr_search.h).
+ *
+ * Items of 1, 2, 4 or 8 bytes are compared `VEC` bytes at a time:
+ * the needle is broadcast to every lane, the lanes are compared for equality
+ * (all ones if equal) and the byte mask of the comparison tells
+ * which item matched first (its lowest set bit divided by the item width).
+ * Four vectors are compared per iteration, and only checked one by one
+ * once any of them matched.
+ *
+ * SSE2 has no 64-bit equality: the 32-bit halves are compared
+ * and each result is ANDed with its neighbour.
+ *
+ * Anything else (and the items that don't fill a vector) is compared one by one.
+ */
+
+#include "dynarr_search.h"
+
+#include <string.h> /* memcmp, memcpy */
+
+
+#if defined( __x86_64__ ) && HAS_ATTRIBUTE( target )
+/** The SSE2/AVX2 kernels are compiled in (selected at runtime) */
+#define CLIBS_LSEARCH_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+
+/** One by one; integer compares for the fixed widths, `memcmp()` otherwise */
+Private size_t lsearch_scalar( const byte *items,
+                               const size_t n,
+                               const size_t el_size,
+                               const void *needle )
+{
+    switch ( el_size )
+    {
+#define LSEARCH_SCALAR_CASE( TYPE )                                 \
+    case sizeof( TYPE ):                                            \
+    {                                                               \
+        TYPE value;                                                 \
+        memcpy( &value, needle, sizeof value );                     \
+        for ( size_t i = 0; i < n; ++i )                            \
+        {                                                           \
+            TYPE item;                                              \
+            memcpy( &item, items + i * sizeof item, sizeof item );  \
+            if ( item == value )                                    \
+                return i;                                           \
+        }                                                           \
+        return n;                                                   \
+    }
+        LSEARCH_SCALAR_CASE( uint8_t )
+        LSEARCH_SCALAR_CASE( uint16_t )
+        LSEARCH_SCALAR_CASE( uint32_t )
+        LSEARCH_SCALAR_CASE( uint64_t )
+#undef LSEARCH_SCALAR_CASE
+
+        default:
+            for ( size_t i = 0; i < n; ++i )
+                if ( memcmp( items + i * el_size, needle, el_size ) == 0 )
+                    return i;
+            return n;
+    }
+}
+
+
+#ifdef CLIBS_LSEARCH_X86_KERNELS
+#define LSEARCH_TARGET( ISA ) __attribute__( ( __target__( ISA ) ) )
+
+/**
+ * Defines `NAME( items, n, needle )`, a kernel for items of `WIDTH` bytes
+ * (`needle` is broadcast already)
+ */
+#define LSEARCH_KERNEL( NAME, ISA, VEC, LOADU, OR, MOVEMASK, CMPEQ, WIDTH )             \
+    LSEARCH_TARGET( ISA )                                                               \
+    Private size_t NAME( const byte *items, const size_t n, const VEC needle )          \
+    {                                                                                   \
+        const size_t per_vec = sizeof( VEC ) / ( WIDTH );                               \
+        size_t i             = 0;                                                       \
+                                                                                        \
+        for ( ; i + 4 * per_vec <= n; i += 4 * per_vec )                                \
+        {                                                                               \
+            const byte *p = items + i * ( WIDTH );                                      \
+            VEC eq[ 4 ];                                                                \
+            for ( size_t v = 0; v < 4; ++v )                                            \
+                eq[ v ] = CMPEQ( LOADU( ( const VEC * ) p + v ), needle );              \
+            if ( MOVEMASK( OR( OR( eq[ 0 ], eq[ 1 ] ), OR( eq[ 2 ], eq[ 3 ] ) ) )       \
+                 == 0 )                                                                 \
+                continue;                                                               \
+                                                                                        \
+            for ( size_t v = 0;; ++v )                                                  \
+            {                                                                           \
+                const unsigned mask = ( unsigned ) MOVEMASK( eq[ v ] );                 \
+                if ( mask != 0 )                                                        \
+                    return i + v * per_vec                                              \
+                         + ( size_t ) __builtin_ctz( mask ) / ( WIDTH );                \
+            }                                                                           \
+        }                                                                               \
+                                                                                        \
+        for ( ; i + per_vec <= n; i += per_vec )                                        \
+        {                                                                               \
+            const VEC *p        = ( const VEC * ) ( items + i * ( WIDTH ) );            \
+            const unsigned mask = ( unsigned ) MOVEMASK( CMPEQ( LOADU( p ), needle ) ); \
+            if ( mask != 0 )                                                            \
+                return i + ( size_t ) __builtin_ctz( mask ) / ( WIDTH );                \
+        }                                                                               \
+                                                                                        \
+        /* the first lane of `needle` is the needle itself */                           \
+        return i + lsearch_scalar( items + i * ( WIDTH ), n - i, WIDTH, &needle );      \
+    }
+
+LSEARCH_TARGET( "sse2" )
+Private inline __m128i lsearch_cmpeq64_sse2( const __m128i a, const __m128i b )
+{
+    const __m128i eq32 = _mm_cmpeq_epi32( a, b );
+    return _mm_and_si128( eq32, _mm_shuffle_epi32( eq32, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+}
+
+LSEARCH_KERNEL( lsearch_sse2_8, "sse2", __m128i, _mm_loadu_si128, _mm_or_si128,
+                _mm_movemask_epi8, _mm_cmpeq_epi8, 1 )
+LSEARCH_KERNEL( lsearch_sse2_16, "sse2", __m128i, _mm_loadu_si128, _mm_or_si128,
+                _mm_movemask_epi8, _mm_cmpeq_epi16, 2 )
+LSEARCH_KERNEL( lsearch_sse2_32, "sse2", __m128i, _mm_loadu_si128, _mm_or_si128,
+                _mm_movemask_epi8, _mm_cmpeq_epi32, 4 )
+LSEARCH_KERNEL( lsearch_sse2_64, "sse2", __m128i, _mm_loadu_si128, _mm_or_si128,
+                _mm_movemask_epi8, lsearch_cmpeq64_sse2, 8 )
+
+LSEARCH_KERNEL( lsearch_avx2_8, "avx2", __m256i, _mm256_loadu_si256, _mm256_or_si256,
+                _mm256_movemask_epi8, _mm256_cmpeq_epi8, 1 )
+LSEARCH_KERNEL( lsearch_avx2_16, "avx2", __m256i, _mm256_loadu_si256, _mm256_or_si256,
+                _mm256_movemask_epi8, _mm256_cmpeq_epi16, 2 )
+LSEARCH_KERNEL( lsearch_avx2_32, "avx2", __m256i, _mm256_loadu_si256, _mm256_or_si256,
+                _mm256_movemask_epi8, _mm256_cmpeq_epi32, 4 )
+LSEARCH_KERNEL( lsearch_avx2_64, "avx2", __m256i, _mm256_loadu_si256, _mm256_or_si256,
+                _mm256_movemask_epi8, _mm256_cmpeq_epi64, 8 )
+
+#undef LSEARCH_KERNEL
+
+
+LSEARCH_TARGET( "sse2" )
+Private size_t lsearch_sse2( const byte *items,
+                             const size_t n,
+                             const size_t el_size,
+                             const void *needle )
+{
+    uint8_t v8;
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+    switch ( el_size )
+    {
+        case 1:
+            memcpy( &v8, needle, 1 );
+            return lsearch_sse2_8( items, n, _mm_set1_epi8( ( char ) v8 ) );
+        case 2:
+            memcpy( &v16, needle, 2 );
+            return lsearch_sse2_16( items, n, _mm_set1_epi16( ( short ) v16 ) );
+        case 4:
+            memcpy( &v32, needle, 4 );
+            return lsearch_sse2_32( items, n, _mm_set1_epi32( ( int ) v32 ) );
+        case 8:
+            memcpy( &v64, needle, 8 );
+            return lsearch_sse2_64( items, n, _mm_set1_epi64x( ( long long ) v64 ) );
+        default:
+            return lsearch_scalar( items, n, el_size, needle );
+    }
+}
+
+LSEARCH_TARGET( "avx2" )
+Private size_t lsearch_avx2( const byte *items,
+                             const size_t n,
+                             const size_t el_size,
+                             const void *needle )
+{
+    uint8_t v8;
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+    switch ( el_size )
+    {
+        case 1:
+            memcpy( &v8, needle, 1 );
+            return lsearch_avx2_8( items, n, _mm256_set1_epi8( ( char ) v8 ) );
+        case 2:
+            memcpy( &v16, needle, 2 );
+            return lsearch_avx2_16( items, n, _mm256_set1_epi16( ( short ) v16 ) );
+        case 4:
+            memcpy( &v32, needle, 4 );
+            return lsearch_avx2_32( items, n, _mm256_set1_epi32( ( int ) v32 ) );
+        case 8:
+            memcpy( &v64, needle, 8 );
+            return lsearch_avx2_64( items, n, _mm256_set1_epi64x( ( long long ) v64 ) );
+        default:
+            return lsearch_scalar( items, n, el_size, needle );
+    }
+}
+#endif // CLIBS_LSEARCH_X86_KERNELS
+
+
+size_t lsearch_items( const byte *items,
+                      const size_t n,
+                      const size_t el_size,
+                      const void *needle,
+                      enum ListSearchImpl impl )
+{
+#ifdef CLIBS_LSEARCH_X86_KERNELS
+    if ( impl == LIST_SEARCH_AUTO || impl == LIST_SEARCH_AVX2 )
+        impl = __builtin_cpu_supports( "avx2" ) ? LIST_SEARCH_AVX2 : LIST_SEARCH_SSE2;
+
+    switch ( impl )
+    {
+        case LIST_SEARCH_AVX2:
+            return lsearch_avx2( items, n, el_size, needle );
+        case LIST_SEARCH_SSE2:
+            return lsearch_sse2( items, n, el_size, needle );
+        default:
+            return lsearch_scalar( items, n, el_size, needle );
+    }
+#else
+    ( void ) impl;
+    return lsearch_scalar( items, n, el_size, needle );
+#endif
+}
+
+const char *lsearch_impl_name( void )
+{
+#ifdef CLIBS_LSEARCH_X86_KERNELS
+    return __builtin_cpu_supports( "avx2" ) ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
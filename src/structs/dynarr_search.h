@@ -0,0 +1,27 @@
+/*
+ * Internal to the `List` implementation:
+ * the (vectorized) linear search of dynarr_search.c,
+ * shared with the parallel algorithms in dynarr_parallel.c.
+ */
+
+#ifndef CLIBS_DYNARR_SEARCH_H
+#define CLIBS_DYNARR_SEARCH_H
+
+#include "dynarr.h"
+
+
+/**
+ * Finds the first of the `n` items equal (byte for byte) to `needle`.
+ *
+ * @return its index, or `n` if there is none
+ */
+size_t lsearch_items( const byte *items,
+                      size_t n,
+                      size_t el_size,
+                      const void *needle,
+                      enum ListSearchImpl impl );
+
+/** Name of the implementation `LIST_SEARCH_AUTO` stands for on this CPU */
+const char *lsearch_impl_name( void );
+
+#endif //CLIBS_DYNARR_SEARCH_H
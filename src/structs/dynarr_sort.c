@@ -0,0 +1,656 @@
+/*
+ * Sorting algorithms for `List` (declared in dynarr.h):
+ *  - `list_sort()`:         pattern-defeating quicksort (Orson Peters' pdqsort)
+ *  - `list_sort_stable()`:  bottom-up merge sort
+ *  - `list_sort_radix_*()`: LSD radix sort by an integer/float key inside the element
+ *
+ * Every one of them falls back to insertion sort for small lists.
+ */
+
+#include "dynarr_sort.h"
+
+#include "../headers/errors.h"
+#include "../headers/simple_math.h" /* min_m */
+
+#include <stdlib.h> /* malloc, qsort */
+#include <string.h> /* mem* */
+
+
+/** Lists (or partitions) of at most this many items are insertion-sorted */
+#define PDQ_INSERTION_SORT_MAX 24
+/** Partitions larger than this use the ninther as the pivot */
+#define PDQ_NINTHER_MIN 128
+/** A partial `pdq_insertion_sort()` gives up after this many moves */
+#define PDQ_PARTIAL_INSERTION_MAX 8
+
+#define STABLE_INSERTION_SORT_MAX 16
+#define RADIX_INSERTION_SORT_MAX  64
+
+/** Temporaries of at most this many bytes live on the stack */
+#define SORT_STACK_EL_SIZE 64
+
+
+Private inline void el_copy( byte *dest, const byte *src, const size_t el_size )
+{
+    // constant sizes get inlined
+    switch ( el_size )
+    {
+        case 4:
+            memcpy( dest, src, 4 );
+            break;
+        case 8:
+            memcpy( dest, src, 8 );
+            break;
+        case 16:
+            memcpy( dest, src, 16 );
+            break;
+        default:
+            memcpy( dest, src, el_size );
+    }
+}
+
+
+/* -------- pdqsort -------- */
+
+struct pdq_sort {
+    size_t el_size;
+    CmpFunction cmp;
+    byte *tmp;   // `el_size` bytes
+    byte *pivot; // `el_size` bytes
+};
+
+#define PDQ_AT( PDQ, BASE, I ) ( ( BASE ) + ( I ) * ( PDQ )->el_size )
+
+Private inline bool pdq_less( const struct pdq_sort *pdq, const byte *a, const byte *b )
+{
+    return pdq->cmp( a, b ) < 0;
+}
+
+Private inline void pdq_swap( const struct pdq_sort *pdq, byte *a, byte *b )
+{
+    el_copy( pdq->tmp, a, pdq->el_size );
+    el_copy( a, b, pdq->el_size );
+    el_copy( b, pdq->tmp, pdq->el_size );
+}
+
+/** Sorts `a`, `b` and `c` (3 items) in place */
+Private void pdq_sort3( const struct pdq_sort *pdq, byte *a, byte *b, byte *c )
+{
+    if ( pdq_less( pdq, b, a ) )
+        pdq_swap( pdq, a, b );
+    if ( pdq_less( pdq, c, b ) )
+        pdq_swap( pdq, b, c );
+    if ( pdq_less( pdq, b, a ) )
+        pdq_swap( pdq, a, b );
+}
+
+/**
+ * @param guarded   if `false`, the item before `begin` must not be greater
+ *                  than any of the items (and the bounds aren't checked)
+ * @param max_moves give up (and return `false`) once this many items have been moved
+ */
+Private bool pdq_insertion_sort( const struct pdq_sort *pdq,
+                                 byte *begin,
+                                 const size_t n,
+                                 const bool guarded,
+                                 const size_t max_moves )
+{
+    const size_t el_size = pdq->el_size;
+    size_t moves         = 0;
+
+    for ( size_t i = 1; i < n; ++i )
+    {
+        byte *cur = PDQ_AT( pdq, begin, i );
+        if ( !pdq_less( pdq, cur, cur - el_size ) )
+            continue;
+
+        el_copy( pdq->tmp, cur, el_size );
+        byte *sift = cur;
+        do
+        {
+            el_copy( sift, sift - el_size, el_size );
+            sift -= el_size;
+        }
+        while ( ( !guarded || sift != begin )
+                && pdq_less( pdq, pdq->tmp, sift - el_size ) );
+        el_copy( sift, pdq->tmp, el_size );
+
+        moves += ( size_t ) ( cur - sift ) / el_size;
+        if ( moves > max_moves )
+            return false;
+    }
+    return true;
+}
+
+Private void pdq_sift_down( const struct pdq_sort *pdq,
+                            byte *items,
+                            size_t root,
+                            const size_t n )
+{
+    for ( size_t child; ( child = 2 * root + 1 ) < n; root = child )
+    {
+        if ( child + 1 < n
+             && pdq_less( pdq,
+                          PDQ_AT( pdq, items, child ),
+                          PDQ_AT( pdq, items, child + 1 ) ) )
+            ++child;
+        if ( !pdq_less( pdq, PDQ_AT( pdq, items, root ), PDQ_AT( pdq, items, child ) ) )
+            return;
+        pdq_swap( pdq, PDQ_AT( pdq, items, root ), PDQ_AT( pdq, items, child ) );
+    }
+}
+
+Private void pdq_heapsort( const struct pdq_sort *pdq, byte *items, const size_t n )
+{
+    for ( size_t i = n / 2; i-- > 0; )
+        pdq_sift_down( pdq, items, i, n );
+    for ( size_t end = n; end-- > 1; )
+    {
+        pdq_swap( pdq, items, PDQ_AT( pdq, items, end ) );
+        pdq_sift_down( pdq, items, 0, end );
+    }
+}
+
+/**
+ * Partitions `[begin, end)` around the pivot `*begin`:
+ * items less than it go to the left, items greater or equal to the right.
+ *
+ * @param already_partitioned set to whether no items had to be swapped
+ * @return the position of the pivot
+ */
+Private byte *pdq_partition_right( const struct pdq_sort *pdq,
+                                   byte *begin,
+                                   byte *end,
+                                   bool *already_partitioned )
+{
+    const size_t el_size = pdq->el_size;
+    el_copy( pdq->pivot, begin, el_size );
+
+    byte *first = begin;
+    byte *last  = end;
+
+    // the median of 3 guarantees there is an item >= pivot
+    do
+        first += el_size;
+    while ( pdq_less( pdq, first, pdq->pivot ) );
+
+    // and if `first` didn't move, there may not be an item < pivot
+    if ( first - el_size == begin )
+        while ( first < last )
+        {
+            last -= el_size;
+            if ( pdq_less( pdq, last, pdq->pivot ) )
+                break;
+        }
+    else
+        do
+            last -= el_size;
+        while ( !pdq_less( pdq, last, pdq->pivot ) );
+
+    *already_partitioned = first >= last;
+
+    while ( first < last )
+    {
+        pdq_swap( pdq, first, last );
+        do
+            first += el_size;
+        while ( pdq_less( pdq, first, pdq->pivot ) );
+        do
+            last -= el_size;
+        while ( !pdq_less( pdq, last, pdq->pivot ) );
+    }
+
+    byte *pivot_pos = first - el_size;
+    el_copy( begin, pivot_pos, el_size );
+    el_copy( pivot_pos, pdq->pivot, el_size );
+    return pivot_pos;
+}
+
+/**
+ * Like `pdq_partition_right()`, but items equal to the pivot go to the left.
+ * Used when the pivot equals the item before the partition,
+ * in which case the whole left side is equal to it (and already sorted).
+ */
+Private byte *pdq_partition_left( const struct pdq_sort *pdq, byte *begin, byte *end )
+{
+    const size_t el_size = pdq->el_size;
+    el_copy( pdq->pivot, begin, el_size );
+
+    byte *first = begin;
+    byte *last  = end;
+
+    do
+        last -= el_size;
+    while ( pdq_less( pdq, pdq->pivot, last ) );
+
+    if ( last + el_size == end )
+        while ( first < last )
+        {
+            first += el_size;
+            if ( pdq_less( pdq, pdq->pivot, first ) )
+                break;
+        }
+    else
+        do
+            first += el_size;
+        while ( !pdq_less( pdq, pdq->pivot, first ) );
+
+    while ( first < last )
+    {
+        pdq_swap( pdq, first, last );
+        do
+            last -= el_size;
+        while ( pdq_less( pdq, pdq->pivot, last ) );
+        do
+            first += el_size;
+        while ( !pdq_less( pdq, pdq->pivot, first ) );
+    }
+
+    el_copy( begin, last, el_size );
+    el_copy( last, pdq->pivot, el_size );
+    return last;
+}
+
+/** Swaps a few items of a partition to break patterns that caused a bad split */
+Private void pdq_shuffle( const struct pdq_sort *pdq, byte *begin, const size_t n )
+{
+    if ( n < PDQ_INSERTION_SORT_MAX )
+        return;
+
+    const size_t q = n / 4;
+    pdq_swap( pdq, begin, PDQ_AT( pdq, begin, q ) );
+    pdq_swap( pdq, PDQ_AT( pdq, begin, n - 1 ), PDQ_AT( pdq, begin, n - q ) );
+    if ( n > PDQ_NINTHER_MIN )
+    {
+        pdq_swap( pdq, PDQ_AT( pdq, begin, 1 ), PDQ_AT( pdq, begin, q + 1 ) );
+        pdq_swap( pdq, PDQ_AT( pdq, begin, 2 ), PDQ_AT( pdq, begin, q + 2 ) );
+        pdq_swap( pdq, PDQ_AT( pdq, begin, n - 2 ), PDQ_AT( pdq, begin, n - q - 1 ) );
+        pdq_swap( pdq, PDQ_AT( pdq, begin, n - 3 ), PDQ_AT( pdq, begin, n - q - 2 ) );
+    }
+}
+
+/**
+ * @param bad_allowed number of unbalanced partitions before switching to heapsort
+ * @param leftmost    whether there are no items before `begin`
+ */
+Private void pdq_loop( const struct pdq_sort *pdq,
+                       byte *begin,
+                       size_t n,
+                       size_t bad_allowed,
+                       bool leftmost )
+{
+    const size_t el_size = pdq->el_size;
+
+    while ( n >= PDQ_INSERTION_SORT_MAX )
+    {
+        byte *end       = PDQ_AT( pdq, begin, n );
+        const size_t s2 = n / 2;
+
+        // the pivot ends up in `*begin`
+        if ( n > PDQ_NINTHER_MIN )
+        {
+            pdq_sort3( pdq, begin, PDQ_AT( pdq, begin, s2 ), end - el_size );
+            pdq_sort3( pdq,
+                       PDQ_AT( pdq, begin, 1 ),
+                       PDQ_AT( pdq, begin, s2 - 1 ),
+                       end - 2 * el_size );
+            pdq_sort3( pdq,
+                       PDQ_AT( pdq, begin, 2 ),
+                       PDQ_AT( pdq, begin, s2 + 1 ),
+                       end - 3 * el_size );
+            pdq_sort3( pdq,
+                       PDQ_AT( pdq, begin, s2 - 1 ),
+                       PDQ_AT( pdq, begin, s2 ),
+                       PDQ_AT( pdq, begin, s2 + 1 ) );
+            pdq_swap( pdq, begin, PDQ_AT( pdq, begin, s2 ) );
+        }
+        else
+            pdq_sort3( pdq, PDQ_AT( pdq, begin, s2 ), begin, end - el_size );
+
+        // equal to the item before the partition: skip all items equal to the pivot
+        if ( !leftmost && !pdq_less( pdq, begin - el_size, begin ) )
+        {
+            byte *pivot_pos = pdq_partition_left( pdq, begin, end );
+            n               = ( size_t ) ( end - pivot_pos ) / el_size - 1;
+            begin           = pivot_pos + el_size;
+            continue;
+        }
+
+        bool already_partitioned;
+        byte *pivot_pos = pdq_partition_right( pdq, begin, end, &already_partitioned );
+
+        const size_t l_size = ( size_t ) ( pivot_pos - begin ) / el_size;
+        const size_t r_size = n - l_size - 1;
+
+        if ( l_size < n / 8 || r_size < n / 8 )
+        {
+            if ( --bad_allowed == 0 )
+            {
+                pdq_heapsort( pdq, begin, n );
+                return;
+            }
+            pdq_shuffle( pdq, begin, l_size );
+            pdq_shuffle( pdq, pivot_pos + el_size, r_size );
+        }
+        else if ( already_partitioned
+                  && pdq_insertion_sort(
+                          pdq, begin, l_size, leftmost, PDQ_PARTIAL_INSERTION_MAX )
+                  && pdq_insertion_sort( pdq,
+                                         pivot_pos + el_size,
+                                         r_size,
+                                         false,
+                                         PDQ_PARTIAL_INSERTION_MAX ) )
+            return;
+
+        pdq_loop( pdq, begin, l_size, bad_allowed, leftmost );
+        begin    = pivot_pos + el_size;
+        n        = r_size;
+        leftmost = false;
+    }
+
+    pdq_insertion_sort( pdq, begin, n, leftmost, SIZE_MAX );
+}
+
+
+void list_sort( List *ls, const CmpFunction cmp )
+{
+    const size_t n       = list_size( ls );
+    const size_t el_size = list_el_size( ls );
+    if ( n < 2 )
+        return;
+
+    byte stack_tmp[ 2 * SORT_STACK_EL_SIZE ];
+    byte *tmp = el_size <= SORT_STACK_EL_SIZE ? stack_tmp : malloc( 2 * el_size );
+    if ( tmp == NULL )
+    {
+        qsort( list_at( ls, 0 ), n, el_size, cmp );
+        return;
+    }
+
+    const struct pdq_sort pdq = {
+        .el_size = el_size,
+        .cmp     = cmp,
+        .tmp     = tmp,
+        .pivot   = tmp + el_size,
+    };
+
+    size_t log2_n = 0;
+    for ( size_t i = n; i > 1; i /= 2 )
+        ++log2_n;
+
+    pdq_loop( &pdq, list_at( ls, 0 ), n, log2_n, true );
+
+    if ( tmp != stack_tmp )
+        free( tmp );
+}
+
+
+/* -------- merge sort -------- */
+
+void sort_merge( byte *dest,
+                 const byte *left,
+                 size_t n_left,
+                 const byte *right,
+                 size_t n_right,
+                 const size_t el_size,
+                 const CmpFunction cmp )
+{
+    // already in order
+    if ( n_left == 0 || n_right == 0
+         || cmp( left + ( n_left - 1 ) * el_size, right ) <= 0 )
+    {
+        memcpy( dest, left, n_left * el_size );
+        memcpy( dest + n_left * el_size, right, n_right * el_size );
+        return;
+    }
+
+    while ( n_left > 0 && n_right > 0 )
+    {
+        // equal items are taken from the left, which keeps the sort stable
+        if ( cmp( right, left ) < 0 )
+        {
+            el_copy( dest, right, el_size );
+            right += el_size;
+            --n_right;
+        }
+        else
+        {
+            el_copy( dest, left, el_size );
+            left += el_size;
+            --n_left;
+        }
+        dest += el_size;
+    }
+
+    memcpy( dest, left, n_left * el_size );
+    memcpy( dest + n_left * el_size, right, n_right * el_size );
+}
+
+void sort_stable_items( byte *const items,
+                        const size_t n,
+                        const size_t el_size,
+                        const CmpFunction cmp,
+                        byte *const buffer )
+{
+    byte stack_tmp[ SORT_STACK_EL_SIZE ];
+
+    // insertion sort only moves an item past strictly greater ones
+    const struct pdq_sort runs = {
+        .el_size = el_size,
+        .cmp     = cmp,
+        .tmp     = el_size <= SORT_STACK_EL_SIZE ? stack_tmp : buffer,
+    };
+    for ( size_t i = 0; i < n; i += STABLE_INSERTION_SORT_MAX )
+        pdq_insertion_sort( &runs,
+                            items + i * el_size,
+                            min_m( STABLE_INSERTION_SORT_MAX, n - i ),
+                            true,
+                            SIZE_MAX );
+
+    byte *src = items;
+    byte *dst = buffer;
+    for ( size_t width = STABLE_INSERTION_SORT_MAX; width < n; width *= 2 )
+    {
+        for ( size_t i = 0; i < n; i += 2 * width )
+        {
+            const size_t n_left  = min_m( width, n - i );
+            const size_t n_right = min_m( width, n - i - n_left );
+            const byte *left     = src + i * el_size;
+
+            sort_merge( dst + i * el_size,
+                        left,
+                        n_left,
+                        left + n_left * el_size,
+                        n_right,
+                        el_size,
+                        cmp );
+        }
+
+        byte *swap = src;
+        src        = dst;
+        dst        = swap;
+    }
+
+    if ( src != items )
+        memcpy( items, src, n * el_size );
+}
+
+int list_sort_stable( List *ls, const CmpFunction cmp )
+{
+    const size_t n = list_size( ls );
+    if ( n < 2 )
+        return RV_SUCCESS;
+
+    byte *buffer = malloc( n * list_el_size( ls ) );
+    if ( buffer == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    sort_stable_items( list_at( ls, 0 ), n, list_el_size( ls ), cmp, buffer );
+
+    free( buffer );
+    return RV_SUCCESS;
+}
+
+
+/* -------- radix sort -------- */
+
+enum radix_key {
+    RADIX_KEY_U32,
+    RADIX_KEY_U64,
+    RADIX_KEY_I64,
+    RADIX_KEY_F64,
+};
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS ( 1 << RADIX_BITS )
+
+/** @return the key at `item + offset` mapped to an unsigned integer in the same order */
+Private inline uint64_t radix_key( const byte *item,
+                                   const size_t offset,
+                                   const enum radix_key kind )
+{
+    if ( kind == RADIX_KEY_U32 )
+    {
+        uint32_t key;
+        memcpy( &key, item + offset, sizeof key );
+        return key;
+    }
+
+    uint64_t key;
+    memcpy( &key, item + offset, sizeof key );
+
+    switch ( kind )
+    {
+        case RADIX_KEY_I64:
+            return key ^ ( UINT64_C( 1 ) << 63 );
+        case RADIX_KEY_F64:
+            // negative numbers are ordered backwards
+            return key >> 63 ? ~key : key | ( UINT64_C( 1 ) << 63 );
+        default:
+            return key;
+    }
+}
+
+Private void radix_insertion_sort( byte *items,
+                                   const size_t n,
+                                   const size_t el_size,
+                                   const size_t offset,
+                                   const enum radix_key kind,
+                                   byte *tmp )
+{
+    for ( size_t i = 1; i < n; ++i )
+    {
+        const uint64_t key = radix_key( items + i * el_size, offset, kind );
+
+        size_t j = i;
+        while ( j > 0 && radix_key( items + ( j - 1 ) * el_size, offset, kind ) > key )
+            --j;
+        if ( j == i )
+            continue;
+
+        el_copy( tmp, items + i * el_size, el_size );
+        memmove( items + ( j + 1 ) * el_size, items + j * el_size, ( i - j ) * el_size );
+        el_copy( items + j * el_size, tmp, el_size );
+    }
+}
+
+/**
+ * Stable LSD radix sort, one byte of the key per pass.
+ * Passes in which all the keys share the byte are skipped.
+ */
+Private int list_sort_radix( List *ls, const size_t offset, const enum radix_key kind )
+{
+    const size_t key_size =
+            kind == RADIX_KEY_U32 ? sizeof( uint32_t ) : sizeof( uint64_t );
+    const size_t n       = list_size( ls );
+    const size_t el_size = list_el_size( ls );
+
+    if ( offset > el_size || el_size - offset < key_size )
+        return fwarnx_ret( RV_EXCEPTION,
+                           "key at offset %zu doesn't fit into an element of %zu bytes",
+                           offset,
+                           el_size );
+    if ( n < 2 )
+        return RV_SUCCESS;
+
+    byte *const items = list_at( ls, 0 );
+    byte *buffer      = malloc( n > RADIX_INSERTION_SORT_MAX ? n * el_size : el_size );
+    if ( buffer == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    if ( n <= RADIX_INSERTION_SORT_MAX )
+    {
+        radix_insertion_sort( items, n, el_size, offset, kind, buffer );
+        free( buffer );
+        return RV_SUCCESS;
+    }
+
+    // one histogram per byte of the key, all counted in a single pass
+    size_t counts[ sizeof( uint64_t ) ][ RADIX_BUCKETS ];
+    memset( counts, 0, sizeof counts );
+    for ( size_t i = 0; i < n; ++i )
+    {
+        const uint64_t key = radix_key( items + i * el_size, offset, kind );
+        for ( size_t b = 0; b < key_size; ++b )
+            ++counts[ b ][ ( key >> ( b * RADIX_BITS ) ) & ( RADIX_BUCKETS - 1 ) ];
+    }
+
+    byte *src = items;
+    byte *dst = buffer;
+    for ( size_t b = 0; b < key_size; ++b )
+    {
+        const size_t *count = counts[ b ];
+        const size_t shift  = b * RADIX_BITS;
+
+        // skip the pass if every key has the same byte here
+        if ( count[ ( radix_key( src, offset, kind ) >> shift ) & ( RADIX_BUCKETS - 1 ) ]
+             == n )
+            continue;
+
+        size_t offsets[ RADIX_BUCKETS ];
+        size_t sum = 0;
+        for ( size_t d = 0; d < RADIX_BUCKETS; ++d )
+        {
+            offsets[ d ] = sum;
+            sum += count[ d ];
+        }
+
+        for ( size_t i = 0; i < n; ++i )
+        {
+            const byte *item = src + i * el_size;
+            const size_t d   = ( radix_key( item, offset, kind ) >> shift )
+                             & ( RADIX_BUCKETS - 1 );
+            el_copy( dst + offsets[ d ]++ * el_size, item, el_size );
+        }
+
+        byte *swap = src;
+        src        = dst;
+        dst        = swap;
+    }
+
+    if ( src != items )
+        memcpy( items, src, n * el_size );
+
+    free( buffer );
+    return RV_SUCCESS;
+}
+
+int list_sort_radix_u32( List *ls, const size_t key_offset )
+{
+    return list_sort_radix( ls, key_offset, RADIX_KEY_U32 );
+}
+
+int list_sort_radix_u64( List *ls, const size_t key_offset )
+{
+    return list_sort_radix( ls, key_offset, RADIX_KEY_U64 );
+}
+
+int list_sort_radix_i64( List *ls, const size_t key_offset )
+{
+    return list_sort_radix( ls, key_offset, RADIX_KEY_I64 );
+}
+
+int list_sort_radix_f64( List *ls, const size_t key_offset )
+{
+    return list_sort_radix( ls, key_offset, RADIX_KEY_F64 );
+}
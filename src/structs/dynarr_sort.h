@@ -0,0 +1,39 @@
+/*
+ * Internal to the `List` implementation:
+ * the sorting routines of dynarr_sort.c that work on plain arrays,
+ * shared with the parallel algorithms in dynarr_parallel.c.
+ */
+
+#ifndef CLIBS_DYNARR_SORT_H
+#define CLIBS_DYNARR_SORT_H
+
+#include "dynarr.h"
+
+
+typedef int ( *CmpFunction )( const void *, const void * );
+
+
+/**
+ * Stably merges the sorted `[left, left + n_left)` and `[right, right + n_right)`
+ * (`left` first) into `dest`, which must not overlap with either of them.
+ */
+void sort_merge( byte *dest,
+                 const byte *left,
+                 size_t n_left,
+                 const byte *right,
+                 size_t n_right,
+                 size_t el_size,
+                 CmpFunction cmp );
+
+/**
+ * Stable merge sort of `n` items.
+ *
+ * @param buffer space for `n` items (at least one)
+ */
+void sort_stable_items( byte *items,
+                        size_t n,
+                        size_t el_size,
+                        CmpFunction cmp,
+                        byte *buffer );
+
+#endif //CLIBS_DYNARR_SORT_H
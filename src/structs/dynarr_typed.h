@@ -0,0 +1,260 @@
+/**
+ * @file dynarr_typed.h
+ * @brief
+ * Type-specialized `List`s, generated by `LIST_DEFINE()`.
+ *
+ * A `List_NAME` stores its items as a plain `TYPE[]`, so that appending,
+ * getting and setting an item compiles to a few inlined instructions instead of
+ * a call copying `el_size` bytes with `memcpy()`.
+ * Sorting is an introsort with the comparison inlined (instead of `qsort()`
+ * calling the comparator through a pointer).
+ *
+ * A `List_NAME` shares its layout with the generic `List`, so the two convert
+ * both ways in O(1) (`list_NAME_as_list()`, `list_NAME_from_list()`).
+ * They are the same object; every generic `list_*` function works on the result
+ * and anything not specialized here goes through those functions.
+ *
+ * @code
+ * LIST_DEFINE_NAMED( int64_t, int64 )
+ *
+ * List_int64 *ls = list_int64_init();
+ * list_int64_append( ls, 5 );
+ * list_int64_sort( ls );
+ * printf( "%" PRIi64 "\n", list_int64_get( ls, 0 ) );
+ * list_int64_destroy( ls );
+ * @endcode
+ *
+ * @attention
+ * `list_NAME_get()` and `list_NAME_set()` only check the index with `assert()`.
+ */
+
+#ifndef CLIBS_DYNARR_TYPED_H
+#define CLIBS_DYNARR_TYPED_H
+
+#include "../headers/errors.h" /* fwarnx_ret */
+#include "dynarr.h"
+
+#include <assert.h>
+
+
+/** Partitions of at most this many items are sorted by insertion sort */
+#define LIST_TYPED_INSERTION_SORT_MAX 16
+
+/** Default ordering of `LIST_DEFINE()` */
+#define LIST_TYPED_LESS( A, B ) ( ( A ) < ( B ) )
+
+#define LIST_TYPED_SWAP( ITEMS, I, J, TMP )                   \
+    ( ( TMP ) = ( ITEMS )[ I ], ( ITEMS )[ I ] = ( ITEMS )[ J ], \
+      ( ITEMS )[ J ] = ( TMP ) )
+
+
+/**
+ * Defines `List_NAME`, a `List` of `TYPE`, and its functions:
+ *  - `list_NAME_init()`, `list_NAME_init_with_allocator()`, `list_NAME_destroy()`
+ *  - `list_NAME_as_list()`, `list_NAME_from_list()`: conversions to and from `List *`
+ *  - `list_NAME_append()`: `RV_SUCCESS` or `RV_ERROR`
+ *  - `list_NAME_get()`, `list_NAME_set()`
+ *  - `list_NAME_sort()`: ascending by `LESS`
+ *  - `list_NAME_bsearch()`: index of the first item equal to the needle
+ *    (in a sorted list) or -1
+ *
+ * The fields of `List_NAME` (`size`, `capacity`, `items`) may be read directly.
+ *
+ * @param TYPE  type of the items; must be assignable
+ * @param NAME  identifier used in the names of the type and the functions
+ * @param LESS  function-like macro (or function) taking two `TYPE`s,
+ *              `true` if the first one is ordered before the second one
+ */
+#define LIST_DEFINE_LESS( TYPE, NAME, LESS )                                            \
+    typedef struct list_##NAME {                                                        \
+        size_t capacity;                                                                \
+        size_t size;                                                                    \
+        TYPE *items;                                                                    \
+        size_t el_size;                                                                 \
+    } List_##NAME;                                                                      \
+                                                                                        \
+    LibraryDefined UseResult List_##NAME *list_##NAME##_init( void )                    \
+    {                                                                                   \
+        return ( List_##NAME * ) list_init_size( sizeof( TYPE ) );                      \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined UseResult List_##NAME *list_##NAME##_init_with_allocator(            \
+            const Allocator *allocator )                                                \
+    {                                                                                   \
+        return ( List_##NAME * ) list_init_with_allocator( sizeof( TYPE ), allocator ); \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined void list_##NAME##_destroy( List_##NAME *ls )                        \
+    {                                                                                   \
+        list_destroy( ( List * ) ls );                                                  \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined inline List *list_##NAME##_as_list( List_##NAME *ls )                \
+    {                                                                                   \
+        return ( List * ) ls;                                                           \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined List_##NAME *list_##NAME##_from_list( List *ls )                     \
+    {                                                                                   \
+        if ( list_el_size( ls ) != sizeof( TYPE ) )                                     \
+            return fwarnx_ret( NULL, "List of %zu-byte elements isn't a List_" #NAME,   \
+                               list_el_size( ls ) );                                    \
+        return ( List_##NAME * ) ls;                                                    \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined inline int list_##NAME##_append( List_##NAME *ls, const TYPE value ) \
+    {                                                                                   \
+        if ( ls->size < ls->capacity )                                                  \
+        {                                                                               \
+            ls->items[ ls->size++ ] = value;                                            \
+            return RV_SUCCESS;                                                          \
+        }                                                                               \
+        return list_append( ( List * ) ls, &value );                                    \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined inline TYPE list_##NAME##_get( const List_##NAME *ls,                \
+                                                  const size_t idx )                    \
+    {                                                                                   \
+        assert( idx < ls->size );                                                       \
+        return ls->items[ idx ];                                                        \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined inline void list_##NAME##_set( List_##NAME *ls,                      \
+                                                  const size_t idx,                     \
+                                                  const TYPE value )                    \
+    {                                                                                   \
+        assert( idx < ls->size );                                                       \
+        ls->items[ idx ] = value;                                                       \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined void list_##NAME##__insertion_sort( TYPE *items, const size_t n )    \
+    {                                                                                   \
+        for ( size_t i = 1; i < n; ++i )                                                \
+        {                                                                               \
+            const TYPE item = items[ i ];                                               \
+            size_t j        = i;                                                        \
+            for ( ; j > 0 && LESS( item, items[ j - 1 ] ); --j )                        \
+                items[ j ] = items[ j - 1 ];                                            \
+            items[ j ] = item;                                                          \
+        }                                                                               \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined void list_##NAME##__sift_down( TYPE *items,                          \
+                                                  size_t root,                          \
+                                                  const size_t n )                      \
+    {                                                                                   \
+        const TYPE item = items[ root ];                                                \
+        for ( size_t child; ( child = 2 * root + 1 ) < n; root = child )                \
+        {                                                                               \
+            if ( child + 1 < n && LESS( items[ child ], items[ child + 1 ] ) )          \
+                ++child;                                                                \
+            if ( !LESS( item, items[ child ] ) )                                        \
+                break;                                                                  \
+            items[ root ] = items[ child ];                                             \
+        }                                                                               \
+        items[ root ] = item;                                                           \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined void list_##NAME##__heapsort( TYPE *items, const size_t n )          \
+    {                                                                                   \
+        for ( size_t i = n / 2; i-- > 0; )                                              \
+            list_##NAME##__sift_down( items, i, n );                                    \
+        for ( size_t end = n; end-- > 1; )                                              \
+        {                                                                               \
+            const TYPE max = items[ 0 ];                                                \
+            items[ 0 ]     = items[ end ];                                              \
+            items[ end ]   = max;                                                       \
+            list_##NAME##__sift_down( items, 0, end );                                  \
+        }                                                                               \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined void list_##NAME##__introsort( TYPE *items, size_t n, size_t depth ) \
+    {                                                                                   \
+        while ( n > LIST_TYPED_INSERTION_SORT_MAX )                                     \
+        {                                                                               \
+            if ( depth-- == 0 )                                                         \
+            {                                                                           \
+                list_##NAME##__heapsort( items, n );                                    \
+                return;                                                                 \
+            }                                                                           \
+                                                                                        \
+            const size_t mid = ( n - 1 ) / 2;                                           \
+            TYPE tmp;                                                                   \
+            if ( LESS( items[ mid ], items[ 0 ] ) )                                     \
+                LIST_TYPED_SWAP( items, mid, 0, tmp );                                  \
+            if ( LESS( items[ n - 1 ], items[ mid ] ) )                                 \
+            {                                                                           \
+                LIST_TYPED_SWAP( items, n - 1, mid, tmp );                              \
+                if ( LESS( items[ mid ], items[ 0 ] ) )                                 \
+                    LIST_TYPED_SWAP( items, mid, 0, tmp );                              \
+            }                                                                           \
+                                                                                        \
+            const TYPE pivot = items[ mid ];                                            \
+            size_t i         = 0;                                                       \
+            size_t j         = n - 1;                                                   \
+            for ( ;; )                                                                  \
+            {                                                                           \
+                while ( LESS( items[ i ], pivot ) )                                     \
+                    ++i;                                                                \
+                while ( LESS( pivot, items[ j ] ) )                                     \
+                    --j;                                                                \
+                if ( i >= j )                                                           \
+                    break;                                                              \
+                LIST_TYPED_SWAP( items, i, j, tmp );                                    \
+                ++i;                                                                    \
+                --j;                                                                    \
+            }                                                                           \
+                                                                                        \
+            const size_t n_left = j + 1;                                                \
+            if ( n_left < n - n_left )                                                  \
+            {                                                                           \
+                list_##NAME##__introsort( items, n_left, depth );                       \
+                items += n_left;                                                        \
+                n -= n_left;                                                            \
+            }                                                                           \
+            else                                                                        \
+            {                                                                           \
+                list_##NAME##__introsort( items + n_left, n - n_left, depth );          \
+                n = n_left;                                                             \
+            }                                                                           \
+        }                                                                               \
+        list_##NAME##__insertion_sort( items, n );                                      \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined void list_##NAME##_sort( List_##NAME *ls )                           \
+    {                                                                                   \
+        size_t depth = 0;                                                               \
+        for ( size_t n = ls->size; n > 1; n /= 2 )                                      \
+            depth += 2;                                                                 \
+        list_##NAME##__introsort( ls->items, ls->size, depth );                         \
+    }                                                                                   \
+                                                                                        \
+    LibraryDefined int64_t list_##NAME##_bsearch( const List_##NAME *ls,                \
+                                                  const TYPE needle )                   \
+    {                                                                                   \
+        size_t lo = 0;                                                                  \
+        size_t hi = ls->size;                                                           \
+        while ( lo < hi )                                                               \
+        {                                                                               \
+            const size_t mid = lo + ( hi - lo ) / 2;                                    \
+            if ( LESS( ls->items[ mid ], needle ) )                                     \
+                lo = mid + 1;                                                           \
+            else                                                                        \
+                hi = mid;                                                               \
+        }                                                                               \
+        return lo < ls->size && !LESS( needle, ls->items[ lo ] ) ? ( int64_t ) lo : -1; \
+    }
+
+/// @see `LIST_DEFINE_LESS()`
+#define LIST_DEFINE_NAMED( TYPE, NAME ) LIST_DEFINE_LESS( TYPE, NAME, LIST_TYPED_LESS )
+
+/// @see `LIST_DEFINE_LESS()`; `TYPE` must be a single identifier
+#define LIST_DEFINE( TYPE ) LIST_DEFINE_NAMED( TYPE, TYPE )
+
+
+LIST_DEFINE( int )
+LIST_DEFINE_NAMED( int64_t, int64 )
+LIST_DEFINE_NAMED( uint64_t, uint64 )
+LIST_DEFINE( double )
+
+#endif //CLIBS_DYNARR_TYPED_H
@@ -0,0 +1,109 @@
+/*
+ * Views of List items (declared in dynarr_view.h).
+ */
+
+#include "dynarr_view.h"
+
+#include "../headers/errors.h"
+
+
+ListView list_view( const struct dynamic_array *ls )
+{
+    return list_view_of_array( list_items( ls ), list_size( ls ), list_el_size( ls ) );
+}
+
+ListView list_view_of_array( const void *array, const size_t size, const size_t el_size )
+{
+    return ( ListView ) {
+        .items   = array,
+        .size    = size,
+        .el_size = el_size,
+        .stride  = ( ptrdiff_t ) el_size,
+    };
+}
+
+
+/** Doesn't check the bounds; `idx` may be equal to the size if it's not 0 */
+Private inline const void *list_view_at_non_safe( const ListView view, const size_t idx )
+{
+    return ( const byte * ) view.items + ( ptrdiff_t ) idx * view.stride;
+}
+
+const void *list_view_at( const ListView view, const size_t idx )
+{
+    if ( idx >= view.size )
+        return fwarnx_ret( NULL,
+                           "index %zu out of bounds for view of size %zu",
+                           idx,
+                           view.size );
+
+    return list_view_at_non_safe( view, idx );
+}
+
+
+int list_view_slice( const ListView view,
+                     const size_t start,
+                     const size_t end,
+                     const size_t step,
+                     ListView *slice )
+{
+    if ( start > end || end > view.size )
+        return fwarnx_ret( RV_EXCEPTION,
+                           "invalid indices (start=%zu, end=%zu) for view of size %zu",
+                           start,
+                           end,
+                           view.size );
+    if ( step == 0 )
+        return fwarnx_ret( RV_EXCEPTION, "step may not be 0" );
+
+    *slice = ( ListView ) {
+        // an empty slice keeps the (valid) start of the view
+        .items   = start < end ? list_view_at_non_safe( view, start ) : view.items,
+        .size    = ( end - start + step - 1 ) / step,
+        .el_size = view.el_size,
+        .stride  = view.stride * ( ptrdiff_t ) step,
+    };
+    return RV_SUCCESS;
+}
+
+ListView list_view_reversed( const ListView view )
+{
+    if ( view.size == 0 )
+        return view;
+
+    return ( ListView ) {
+        .items   = list_view_at_non_safe( view, view.size - 1 ),
+        .size    = view.size,
+        .el_size = view.el_size,
+        .stride  = -view.stride,
+    };
+}
+
+bool list_view_is_contiguous( const ListView view )
+{
+    return view.size <= 1 || view.stride == ( ptrdiff_t ) view.el_size;
+}
+
+
+struct dynamic_array *list_from_view( const ListView view )
+{
+    struct dynamic_array *ls = list_init_cap_size( view.el_size, view.size );
+    if ( ls == NULL )
+        return f_stack_trace( NULL );
+
+    if ( list_view_is_contiguous( view ) )
+    {
+        if ( list_extend( ls, view.items, view.size ) != RV_SUCCESS )
+        {
+            list_destroy( ls );
+            return f_stack_trace( NULL );
+        }
+        return ls;
+    }
+
+    // the capacity suffices, so appending can't fail
+    for ( size_t i = 0; i < view.size; ++i )
+        list_append( ls, list_view_at_non_safe( view, i ) );
+
+    return ls;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file dynarr_view.h
+ * @brief Non-owning views of the items of a `List` (see dynarr.h) or of an array.
+ *
+ * A `ListView` is a pointer to the first item, the number of items
+ * and the distance between two consecutive items (the stride, in bytes).
+ * Slicing, striding and reversing a view only compute a new view;
+ * nothing is copied until `list_from_view()`.
+ *
+ * A view of a List is valid until the List is modified (or destroyed);
+ * appending items may move them.
+ *
+ * Example:
+ * @code
+ * ListView evens;
+ * list_view_slice( list_view( ls ), 0, list_size( ls ), 2, &evens );
+ * for ( size_t i = 0; i < evens.size; ++i )
+ *     printf( "%d\n", list_view_fetch( evens, i, int ) );
+ * @endcode
+ */
+
+#ifndef CLIBS_DYNARR_VIEW_H
+#define CLIBS_DYNARR_VIEW_H
+
+#include "../headers/attributes.h"
+#include "../headers/types.h"
+#include "dynarr.h"
+
+#include <stdbool.h>
+#include <stddef.h> /* ptrdiff_t */
+
+
+typedef struct list_view {
+    const void *items; // the first item (of the view)
+    size_t size;       // number of items
+    size_t el_size;    // sizeof a single item
+    ptrdiff_t stride;  // bytes from one item to the next; negative when reversed
+} ListView;
+
+
+/** @return view of all the items of the List */
+ListView list_view( const struct dynamic_array * );
+/** @return view of the `size` items of the array */
+ListView list_view_of_array( const void *array, size_t size, size_t el_size );
+
+/**
+ * Gets a pointer to the item at `idx`
+ *
+ * @return pointer to the item, or `NULL` if `idx` is OOB
+ */
+const void *list_view_at( ListView, size_t idx );
+/**
+ * Gets the item at `idx` of the view, which must be in bounds
+ * (as `list_fetch()` for a List).
+ */
+#define list_view_fetch( VIEW, IDX, TYPE ) \
+    ( *( const TYPE * ) list_view_at( ( VIEW ), ( IDX ) ) )
+
+/**
+ * Creates a view of every `step`-th item in `[ start, end )`,
+ * like Python's `view[ start:end:step ]`.
+ *
+ * @param step      1 for a contiguous slice
+ * @param slice     the result is stored here
+ * @return `RV_EXCEPTION` if the indices are invalid or `step` is 0,
+ *         else `RV_SUCCESS`
+ */
+int list_view_slice( ListView,
+                     size_t start,
+                     size_t end,
+                     size_t step,
+                     ListView *slice );
+/** @return view of the same items in the reverse order */
+ListView list_view_reversed( ListView );
+
+/** @return whether the items are adjacent and in order (as in an array) */
+bool list_view_is_contiguous( ListView );
+
+/**
+ * Copies the items of the view into a new List
+ *
+ * @return pointer to a new List, or `NULL` if allocation fails
+ */
+Constructor struct dynamic_array *list_from_view( ListView );
+
+#endif //CLIBS_DYNARR_VIEW_H
@@ -3,6 +3,7 @@
 //
 #include "dynstring.h"
 
+#include "../allocator.h"
 #include "../headers/assert_that.h"
 #include "../headers/errors.h"      /* RV, warn */
 #include "../headers/simple_math.h" /* min */
@@ -22,27 +23,43 @@ struct dynamic_string {
     size_t len;
 
     size_t cap;
+
+    const Allocator *allocator; // of `data`
 };
 
 
-struct dynamic_string *dynstr_init_cap( const size_t cap )
+Private struct dynamic_string *dynstr_init_with( const size_t cap,
+                                                 const Allocator *allocator )
 {
-    struct dynamic_string *new = calloc( 1, sizeof( struct dynamic_string ) );
+    struct dynamic_string *new =
+            allocator_calloc( allocator, 1, sizeof( struct dynamic_string ) );
     if ( new == NULL )
         return fwarn_ret( NULL, "calloc" );
 
-    new->cap  = cap;
-    new->len  = 0;
-    new->data = calloc( new->cap, 1 );
+    new->cap       = cap;
+    new->len       = 0;
+    new->allocator = allocator;
+    new->data      = allocator_calloc( allocator, new->cap, 1 );
     if ( new->data == NULL )
     {
-        free( new );
+        allocator_free( allocator, new, sizeof( struct dynamic_string ) );
         return fwarn_ret( NULL, "calloc" );
     }
 
     return new;
 }
 
+struct dynamic_string *dynstr_init_cap( const size_t cap )
+{
+    return dynstr_init_with( cap, allocator_default() );
+}
+
+struct dynamic_string *dynstr_init_with_allocator( const Allocator *allocator )
+{
+    return dynstr_init_with( DEFAULT_DYNSTRING_CAP,
+                             allocator != NULL ? allocator : allocator_default() );
+}
+
 struct dynamic_string *dynstr_init( void )
 {
     return dynstr_init_cap( DEFAULT_DYNSTRING_CAP );
@@ -58,7 +75,7 @@ struct dynamic_string *dynstr_init_as( const string_t s )
     if ( new == NULL )
         return f_stack_trace( NULL );
 
-    strncpy( new->data, s, len + 1 );
+    memcpy( new->data, s, len + 1 );
     new->len = len;
 
     return new;
@@ -66,8 +83,8 @@ struct dynamic_string *dynstr_init_as( const string_t s )
 
 void dynstr_destroy( struct dynamic_string *dynstr )
 {
-    free( dynstr->data );
-    free( dynstr );
+    allocator_free( dynstr->allocator, dynstr->data, dynstr->cap );
+    allocator_free( dynstr->allocator, dynstr, sizeof( struct dynamic_string ) );
 }
 
 
@@ -75,7 +92,8 @@ Private int dynstr_resize( struct dynamic_string *dynstr, const size_t new_size
 {
     assert( new_size > dynstr->len );
 
-    char *temp = realloc( dynstr->data, new_size );
+    char *temp =
+            allocator_resize( dynstr->allocator, dynstr->data, dynstr->cap, new_size );
     if ( temp == NULL )
         return fwarn_ret( RV_ERROR, "realloc" );
 
@@ -123,7 +141,10 @@ ssize_t dynstr_appendn( struct dynamic_string *dynstr, const char *app, size_t l
         return_on_fail( dynstr_resize( dynstr, new_cap ) );
     }
 
-    strncpy( dynstr->data + dynstr->len, app, len );
+    // same as strncpy, which GCC rejects here when `len` comes from `strlen( app )`
+    const size_t app_len = strnlen( app, len );
+    memcpy( dynstr->data + dynstr->len, app, app_len );
+    memset( dynstr->data + dynstr->len + app_len, 0, len - app_len );
     dynstr->data[ new_size ] = '\0';
     dynstr->len              = new_size;
 
@@ -204,7 +225,8 @@ int dynstr_slice( struct dynamic_string *dynstr,
 
     if ( len < dynstr->cap / 2 )
     {
-        char *re = realloc( dynstr->data, len + 1 );
+        char *re =
+                allocator_resize( dynstr->allocator, dynstr->data, dynstr->cap, len + 1 );
         if ( re == NULL )
             return fwarn_ret(
                     RV_ERROR,
@@ -244,8 +266,10 @@ int dynstr_slice_s( struct dynamic_string *const dynstr, const size_t start_idx
 
 int dynstr_reset( struct dynamic_string *dynstr )
 {
-    free( dynstr->data );
-    if ( ( dynstr->data = malloc( DEFAULT_DYNSTRING_CAP ) ) == NULL )
+    allocator_free( dynstr->allocator, dynstr->data, dynstr->cap );
+    dynstr->cap = 0;
+    if ( ( dynstr->data = allocator_alloc( dynstr->allocator, DEFAULT_DYNSTRING_CAP ) )
+         == NULL )
         return fwarn_ret( RV_ERROR, "malloc" );
     dynstr->data[ 0 ] = '\0';
     dynstr->len       = 0;
@@ -256,10 +280,15 @@ int dynstr_reset( struct dynamic_string *dynstr )
 int dynstr_set( struct dynamic_string *dynstr, const string_t string )
 {
     const size_t len = strlen( string );
-    if ( ( dynstr->data = strdup( string ) ) == NULL )
-        return fwarn_ret( RV_ERROR, "strdup" );
-    dynstr->len = len;
-    dynstr->cap = len + 1;
+    char *data       = allocator_alloc( dynstr->allocator, len + 1 );
+    if ( data == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+    memcpy( data, string, len + 1 );
+
+    allocator_free( dynstr->allocator, dynstr->data, dynstr->cap );
+    dynstr->data = data;
+    dynstr->len  = len;
+    dynstr->cap  = len + 1;
     return RV_SUCCESS;
 }
 
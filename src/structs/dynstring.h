@@ -5,6 +5,7 @@
 #ifndef CLIBS_DYNSTRING_H
 #define CLIBS_DYNSTRING_H
 
+#include "../allocator.h"          /* Allocator */
 #include "../headers/attributes.h" /* Constructor */
 
 #include <stdarg.h>
@@ -33,6 +34,13 @@ Constructor DynString *dynstr_init_cap( size_t cap );
  * @return a new `DynString` or `NULL` if allocation fails
  */
 Constructor DynString *dynstr_init_as( const char * );
+/**
+ * Allocates a new `DynString` (with a capacity of `DEFAULT_DYNSTRING_CAP`)
+ * and all of its data from `allocator` (see `allocator.h`)
+ * @param allocator must outlive the `DynString`; `NULL` for `allocator_default()`
+ * @return a new `DynString` or `NULL` if allocation fails
+ */
+Constructor DynString *dynstr_init_with_allocator( const Allocator *allocator );
 
 /** Frees all memory owned by the `DynString` */
 void dynstr_destroy( DynString * );
@@ -4,95 +4,206 @@
 
 #include "queue.h"
 
+#include "../allocator.h"
 #include "../headers/errors.h"
+#include "../headers/simple_math.h" /* min_u64 */
+#include "../serialize.h"
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 
-struct queue_node {
-    struct queue_node *next;
-
-    void *data;
-};
+#define QUEUE_DEF_CAP 16
 
 
+/*
+ * Ring buffer of `capacity` (a power of two) slots of `el_size` bytes.
+ *
+ * The items are the `size` slots starting at `head`, wrapping around
+ * the end of the buffer:
+ * [ 3, 4, _, _, _, 0, 1, 2 ] (head = 5, size = 5)
+ *
+ * `struct queue_node` is never defined; iterators point to the slots themselves.
+ */
 struct fifo_queue {
-    struct queue_node *head; // first in line; first out
-    struct queue_node *tail; // last
+    byte *items;
+    size_t capacity; // power of two
+    size_t head;     // slot of the first item (first out)
+    size_t size;     // number of items
 
     size_t el_size; // each element must be the same size
+
+    const Allocator *allocator; // of the queue and its buffer
 };
 
 
-struct fifo_queue *queue_init( const size_t el_size )
+Private inline byte *queue_slot( const struct fifo_queue *queue, const size_t index )
+{
+    const size_t slot = ( queue->head + index ) & ( queue->capacity - 1 );
+    return queue->items + slot * queue->el_size;
+}
+
+/**
+ * Copies `count` items, starting at `index`, out of the queue
+ * (in at most two blocks, split where the buffer wraps around).
+ */
+Private void queue_copy_out( const struct fifo_queue *queue,
+                             const size_t index,
+                             void *dest,
+                             const size_t count )
+{
+    const size_t start = ( queue->head + index ) & ( queue->capacity - 1 );
+    const size_t first = min_u64( count, queue->capacity - start );
+
+    memcpy( dest, queue->items + start * queue->el_size, first * queue->el_size );
+    memcpy( ( byte * ) dest + first * queue->el_size,
+            queue->items,
+            ( count - first ) * queue->el_size );
+}
+
+/** Copies `count` items from `src` to the free slots right after the last item */
+Private void queue_copy_in( struct fifo_queue *queue,
+                            const void *src,
+                            const size_t count )
 {
-    struct fifo_queue *queue = calloc( 1, sizeof( struct fifo_queue ) );
-    queue->el_size           = el_size;
+    const size_t start = ( queue->head + queue->size ) & ( queue->capacity - 1 );
+    const size_t first = min_u64( count, queue->capacity - start );
+
+    memcpy( queue->items + start * queue->el_size, src, first * queue->el_size );
+    memcpy( queue->items,
+            ( const byte * ) src + first * queue->el_size,
+            ( count - first ) * queue->el_size );
+}
+
+
+/**
+ * Grows the buffer so that it can hold at least `min_cap` items.
+ *
+ * The buffer is resized in place (if the allocator can),
+ * then the items that wrapped around are moved behind the old end:
+ * [ 3, 4, _, 0, 1, 2 ] -> [ _, _, _, 0, 1, 2, 3, 4, _, ... ]
+ */
+Private int queue_reserve( struct fifo_queue *queue, const size_t min_cap )
+{
+    if ( min_cap <= queue->capacity )
+        return RV_SUCCESS;
+
+    size_t new_cap = queue->capacity;
+    while ( new_cap < min_cap )
+        new_cap *= 2;
+
+    byte *items = allocator_resize( queue->allocator,
+                                    queue->items,
+                                    queue->capacity * queue->el_size,
+                                    new_cap * queue->el_size );
+    if ( items == NULL )
+        return fwarn_ret( RV_ERROR, "realloc" );
+
+    const size_t old_cap = queue->capacity;
+    queue->items         = items;
+    queue->capacity      = new_cap;
+
+    if ( queue->head + queue->size > old_cap )
+    {
+        // `new_cap >= 2 * old_cap`, so the wrapped part always fits behind the old end
+        const size_t wrapped = queue->head + queue->size - old_cap;
+        memcpy( items + old_cap * queue->el_size, items, wrapped * queue->el_size );
+    }
+
+    return RV_SUCCESS;
+}
+
+
+struct fifo_queue *queue_init_with_allocator( const size_t el_size,
+                                              const Allocator *allocator )
+{
+    if ( el_size == 0 )
+        return fwarnx_ret( NULL, "el_size must not be 0" );
+    if ( allocator == NULL )
+        allocator = allocator_default();
+
+    struct fifo_queue *queue =
+            allocator_calloc( allocator, 1, sizeof( struct fifo_queue ) );
+    if ( queue == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    queue->items = allocator_alloc( allocator, QUEUE_DEF_CAP * el_size );
+    if ( queue->items == NULL )
+    {
+        allocator_free( allocator, queue, sizeof( struct fifo_queue ) );
+        return fwarn_ret( NULL, "malloc" );
+    }
+
+    queue->capacity  = QUEUE_DEF_CAP;
+    queue->el_size   = el_size;
+    queue->allocator = allocator;
     return queue;
 }
 
+struct fifo_queue *queue_init( const size_t el_size )
+{
+    return queue_init_with_allocator( el_size, allocator_default() );
+}
+
 void queue_destroy( struct fifo_queue *queue )
 {
-    queue_clear( queue );
-    free( queue );
+    allocator_free( queue->allocator, queue->items, queue->capacity * queue->el_size );
+    allocator_free( queue->allocator, queue, sizeof( struct fifo_queue ) );
 }
 
 void queue_clear( struct fifo_queue *queue )
 {
-    struct queue_node *node = queue->head;
-    while ( node != NULL )
-    {
-        struct queue_node *next = node->next;
-        free( node->data );
-        free( node );
-        node = next;
-    }
-    queue->head = NULL;
-    queue->tail = NULL;
+    queue->head = 0;
+    queue->size = 0;
 }
 
 
 int queue_enqueue( struct fifo_queue *queue, const void *data )
 {
-    struct queue_node **next_node_cont =
-            queue->head == NULL ? &queue->head : &queue->tail->next;
+    return queue_enqueue_n( queue, data, 1 );
+}
 
-    if ( ( *next_node_cont = calloc( 1, sizeof( struct queue_node ) ) ) == NULL )
-        return fwarn_ret( RV_ERROR, "node alloc failed" );
+int queue_enqueue_n( struct fifo_queue *queue, const void *data, const size_t count )
+{
+    if ( count == 0 )
+        return RV_SUCCESS;
 
-    struct queue_node *node = *next_node_cont;
-    assert( node != NULL );
-    queue->tail = node;
+    if ( data == NULL )
+        return fwarnx_ret( RV_EXCEPTION, "data must not be NULL" );
 
-    node->data = malloc( queue->el_size );
-    if ( node->data == NULL )
-    {
-        if ( next_node_cont == &queue->head )
-            free( queue->head );
-        return fwarn_ret( RV_ERROR, "node data alloc failed" );
-    }
+    if ( queue_reserve( queue, queue->size + count ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    queue_copy_in( queue, data, count );
+    queue->size += count;
 
-    memcpy( node->data, data, queue->el_size );
     return RV_SUCCESS;
 }
 
 int queue_dequeue( struct fifo_queue *queue, void *data_cont )
 {
-    if ( queue->head == NULL )
+    if ( queue->size == 0 )
         return fwarnx_ret( RV_EXCEPTION, "queue is empty" );
 
-    struct queue_node *first = queue->head;
+    ( void ) queue_dequeue_n( queue, data_cont, 1 );
+    return RV_SUCCESS;
+}
+
+size_t queue_dequeue_n( struct fifo_queue *queue, void *data_cont, size_t max_count )
+{
+    if ( max_count > queue->size )
+        max_count = queue->size;
+
     if ( data_cont != NULL )
-        memcpy( data_cont, first->data, queue->el_size );
-    queue->head = first->next;
-    if ( queue->head == NULL )
-        queue->tail = NULL;
+        queue_copy_out( queue, 0, data_cont, max_count );
 
-    free( first->data );
-    free( first );
+    queue->head = ( queue->head + max_count ) & ( queue->capacity - 1 );
+    queue->size -= max_count;
+    if ( queue->size == 0 )
+        queue->head = 0;
 
-    return RV_SUCCESS;
+    return max_count;
 }
 
 
@@ -101,34 +212,17 @@ int queue_get( const struct fifo_queue *queue, const size_t index, void *const d
     if ( data_cont == NULL )
         return fwarnx_ret( RV_EXCEPTION, "data_cont must not be NULL" );
 
-    if ( queue->head == NULL )
+    if ( queue->size == 0 )
         return fwarnx_ret( RV_EXCEPTION, "queue is empty" );
 
-    if ( index == 0 )
-    {
-        memcpy( data_cont, queue->head->data, queue->el_size );
-        return RV_SUCCESS;
-    }
-
-    size_t actual_size_idx      = 1;
-    size_t distance_from_target = index;
-
-    const struct queue_node *node = queue->head;
-    while ( ( node = node->next ) != NULL )
-    {
-        ++actual_size_idx;
-        if ( --distance_from_target == 0 )
-        {
-            memcpy( data_cont, node->data, queue->el_size );
-            return RV_SUCCESS;
-        }
-        assert( distance_from_target > 0 );
-    }
+    if ( index >= queue->size )
+        return fwarnx_ret( RV_EXCEPTION,
+                           "queue index %zu out of bounds for queue of length %zu",
+                           index,
+                           queue->size );
 
-    return fwarnx_ret( RV_EXCEPTION,
-                       "queue index %zu out of bounds for queue of length %zu",
-                       index,
-                       actual_size_idx );
+    memcpy( data_cont, queue_slot( queue, index ), queue->el_size );
+    return RV_SUCCESS;
 }
 
 int queue_get_head( const struct fifo_queue *queue, void *data_cont )
@@ -136,13 +230,10 @@ int queue_get_head( const struct fifo_queue *queue, void *data_cont )
     if ( data_cont == NULL )
         return fwarnx_ret( RV_EXCEPTION, "data_cont must not be NULL" );
 
-    if ( queue->head == NULL )
-    {
-        assert( queue->tail == NULL );
+    if ( queue->size == 0 )
         return fwarnx_ret( RV_EXCEPTION, "queue is empty" );
-    }
 
-    memcpy( data_cont, queue->head->data, queue->el_size );
+    memcpy( data_cont, queue_slot( queue, 0 ), queue->el_size );
     return RV_SUCCESS;
 }
 
@@ -151,27 +242,16 @@ int queue_get_tail( const struct fifo_queue *queue, void *data_cont )
     if ( data_cont == NULL )
         return fwarnx_ret( RV_EXCEPTION, "data_cont must not be NULL" );
 
-    if ( queue->tail == NULL )
-    {
-        assert( queue->head == NULL );
+    if ( queue->size == 0 )
         return fwarnx_ret( RV_EXCEPTION, "queue is empty" );
-    }
 
-    memcpy( data_cont, queue->tail->data, queue->el_size );
+    memcpy( data_cont, queue_slot( queue, queue->size - 1 ), queue->el_size );
     return RV_SUCCESS;
 }
 
 size_t queue_get_size( const struct fifo_queue *queue )
 {
-    if ( queue->head == NULL )
-        return 0;
-
-    size_t i                      = 1;
-    const struct queue_node *node = queue->head;
-    while ( ( node = node->next ) != NULL )
-        i++;
-
-    return i;
+    return queue->size;
 }
 
 size_t queue_get_el_size( const Queue *q )
@@ -181,35 +261,102 @@ size_t queue_get_el_size( const Queue *q )
 
 bool queue_is_empty( const struct fifo_queue *queue )
 {
-    const bool no_head = queue->head == NULL;
-    if ( no_head )
-        assert( queue->tail == NULL );
+    return queue->size == 0;
+}
+
+
+int queue_save( const struct fifo_queue *queue, FILE *file )
+{
+    SerialWriter *writer = serial__writer_open(
+            file, SERIAL_QUEUE, queue->el_size, NULL, 0, 0, queue->size );
+    if ( writer == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    // the items in (at most) two blocks, split where the buffer wraps around
+    const size_t first = min_u64( queue->size, queue->capacity - queue->head );
+
+    int rv = serial_write_items( writer, queue_slot( queue, 0 ), first );
+    if ( rv == RV_SUCCESS )
+        rv = serial_write_items( writer, queue->items, queue->size - first );
+
+    if ( serial_writer_close( writer ) != RV_SUCCESS || rv != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return RV_SUCCESS;
+}
+
+struct fifo_queue *queue_load( FILE *file )
+{
+    SerialReader *reader = serial_reader_open( file );
+    if ( reader == NULL )
+        return f_stack_trace( NULL );
+
+    struct fifo_queue *queue = NULL;
+    if ( serial_reader_kind( reader ) != SERIAL_QUEUE )
+    {
+        fwarnx( "not a Queue" );
+        goto ERROR;
+    }
+
+    // the header isn't to be trusted: don't allocate more than one chunk holds
+    // before any items are read, the Queue grows as they come
+    const size_t el_size   = serial_reader_el_size( reader );
+    const size_t max_count = SERIAL_CHUNK_SIZE / el_size;
+    const size_t count     = serial_reader_count_hint( reader );
+
+    if ( ( queue = queue_init( el_size ) ) == NULL
+         || queue_reserve( queue, count < max_count ? count : max_count ) != RV_SUCCESS )
+        goto ERROR;
+
+    // `head` stays 0, so the free slots are all behind the items
+    while ( true )
+    {
+        if ( queue_reserve( queue, queue->size + 1 ) != RV_SUCCESS )
+            goto ERROR;
+
+        const int64_t n = serial_read_items( reader,
+                                             queue->items + queue->size * queue->el_size,
+                                             queue->capacity - queue->size );
+        if ( n == 0 )
+            break;
+        if ( n < 0 )
+            goto ERROR;
+
+        queue->size += ( size_t ) n;
+    }
 
-    return no_head;
+    serial_reader_close( reader );
+    return queue;
+
+ERROR:
+    if ( queue != NULL )
+        queue_destroy( queue );
+    serial_reader_close( reader );
+    return f_stack_trace( NULL );
 }
 
 
 const struct queue_node *queue__iterator_get_head( const Queue *q )
 {
-    if ( q->head == NULL )
-        fwarnx( "queue is empty" );
-    return q->head;
+    if ( q->size == 0 )
+        return NULL;
+    return ( const struct queue_node * ) queue_slot( q, 0 );
 }
 
 
-const struct queue_node *queue__iterator_get_next( const struct queue_node *n )
+const struct queue_node *queue__iterator_get_next( const Queue *q,
+                                                   const struct queue_node *n )
 {
-    if ( n->next == NULL )
-    {
-        fwarnx( "node is NULL" );
+    const size_t slot  = ( size_t ) ( ( const byte * ) n - q->items ) / q->el_size;
+    const size_t index = ( slot - q->head ) & ( q->capacity - 1 );
+    if ( index + 1 >= q->size )
         return NULL;
-    }
 
-    return n->next;
+    return ( const struct queue_node * ) queue_slot( q, index + 1 );
 }
 
 
 const void *queue_node_get_data( const struct queue_node *n )
 {
-    return n->data;
+    return n;
 }
@@ -2,18 +2,22 @@
  * @file queue.h
  * @brief First in, first out.
  *
- * | Method     | Time complexity |
- * |------------|-----------------|
- * | `init`     | O(1)            |
- * | `destroy`  | O(n)            |
- * | `clear`    | O(n)            |
- * | `enqueue`  | O(1)            |
- * | `dequeue`  | O(1)            |
- * | `get`      | O(n)            |
- * | `get_head` | O(1)            |
- * | `get_tail` | O(1)            |
- * | `get_size` | O(n)            |
- * | `is_empty` | O(1)            |
+ * The items are stored in a growable ring buffer.
+ *
+ * | Method      | Time complexity |
+ * |-------------|-----------------|
+ * | `init`      | O(1)            |
+ * | `destroy`   | O(1)            |
+ * | `clear`     | O(1)            |
+ * | `enqueue`   | O(1) amortized  |
+ * | `enqueue_n` | O(n) amortized  |
+ * | `dequeue`   | O(1)            |
+ * | `dequeue_n` | O(n)            |
+ * | `get`       | O(1)            |
+ * | `get_head`  | O(1)            |
+ * | `get_tail`  | O(1)            |
+ * | `get_size`  | O(1)            |
+ * | `is_empty`  | O(1)            |
  */
 
 //
@@ -23,9 +27,12 @@
 #ifndef CLIBS_QUEUE_H
 #define CLIBS_QUEUE_H
 
+#include "../allocator.h"
 #include "../headers/attributes.h"
 #include "../headers/types.h"
 
+#include <stdio.h> /* FILE */
+
 
 typedef struct fifo_queue Queue;
 
@@ -33,16 +40,28 @@ typedef struct fifo_queue Queue;
 /**
  * Initializes a FIFO queue.
  *
- * @param el_size `sizeof` a single element
+ * @param el_size `sizeof` a single element (must not be 0)
  * @return pointer to a valid Queue or `NULL`
  */
 Constructor Queue *queue_init( size_t el_size );
+/**
+ * Initializes a FIFO queue which allocates itself and its buffer from `allocator`
+ * (see `allocator.h`).
+ *
+ * @param el_size   `sizeof` a single element
+ * @param allocator must outlive the queue; `NULL` for `allocator_default()`
+ * @return pointer to a valid Queue or `NULL`
+ */
+Constructor Queue *queue_init_with_allocator( size_t el_size,
+                                              const Allocator *allocator );
 /**
  * Frees all memory owned by the queue.
  */
 void queue_destroy( Queue * );
 /**
  * Truncates the queue to length = 0.
+ *
+ * The buffer is kept.
  */
 void queue_clear( Queue * );
 
@@ -53,6 +72,18 @@ void queue_clear( Queue * );
  * @return `RV_ERROR` if alloc fails, else `RV_SUCCESS`
  */
 int queue_enqueue( Queue *, const void *data );
+/**
+ * Appends `count` elements to the end of the Queue, in order.
+ *
+ * The buffer grows (at most) once.
+ *
+ * @param data array of `count` elements
+ * @return
+ * - `RV_EXCEPTION` if `data` is `NULL` (and `count != 0`)
+ * - `RV_ERROR` if alloc fails (nothing is appended)
+ * - `RV_SUCCESS` otherwise
+ */
+int queue_enqueue_n( Queue *, const void *data, size_t count );
 /**
  * Removes an element from the front of the Queue.
  *
@@ -63,6 +94,17 @@ int queue_enqueue( Queue *, const void *data );
  * @return `RV_EXCEPTION` if queue is empty, else `RV_SUCCESS`
  */
 int queue_dequeue( Queue *, void *data_cont );
+/**
+ * Removes up to `max_count` elements from the front of the Queue.
+ *
+ * The removed elements are copied to `data_cont`, in order.
+ *
+ * @param data_cont pointer to space in memory able to hold at least
+ *                  `max_count * Queue::el_size` bytes or `NULL`
+ * @return number of removed elements (less than `max_count`
+ *         if the queue didn't have enough)
+ */
+size_t queue_dequeue_n( Queue *, void *data_cont, size_t max_count );
 
 /**
  * Fetches an item at `index`.
@@ -100,18 +142,38 @@ size_t queue_get_el_size( const Queue * );
 bool queue_is_empty( const Queue * );
 
 
+/**
+ * Writes the items of the queue, head first, to `file`
+ * in the binary format of `serialize.h`
+ *
+ * @return `RV_ERROR` if writing fails, else `RV_SUCCESS`
+ */
+int queue_save( const Queue *, FILE *file );
+/**
+ * Reads a queue written by `queue_save()`
+ *
+ * @return pointer to a new Queue, or `NULL` if the file is invalid or corrupt,
+ *         or if reading or allocation fails
+ */
+Constructor Queue *queue_load( FILE *file );
+
+
 /**
  * @cond INTERNAL
  * Iterator over queue.
  */
 const struct queue_node *queue__iterator_get_head( const Queue * );
-const struct queue_node *queue__iterator_get_next( const struct queue_node * );
+const struct queue_node *queue__iterator_get_next( const Queue *,
+                                                   const struct queue_node * );
 /** @endcond */
 
 
 // struct queue_node
 
-/** @return queue node data pointer */
+/**
+ * @return queue node data pointer;
+ *         only valid until the queue is modified
+ */
 const void *queue_node_get_data( const struct queue_node * );
 
 #endif //CLIBS_QUEUE_H
@@ -1,6 +1,9 @@
 #include "set.h"
 
-#include "../headers/misc.h" /* cmp_size_t */
+#include "../allocator.h"
+#include "../headers/misc.h"        /* cmp_size_t */
+#include "../headers/simple_math.h" /* min_m */
+#include "../serialize.h"
 #include "dynarr.h"
 
 #include <assert.h>   /* assert */
@@ -12,11 +15,56 @@
 
 #define SET_DEFAULT_CAP 64
 
+/** Smallest capacity a `Set` is ever allowed to shrink to */
+#define SET_MIN_CAP 8
 
+/** Fraction of used (live + removed) slots after which the table grows */
+#define SET_DEFAULT_MAX_LOAD 0.75
+
+/** Largest table whose slots are stored in 32 bits (larger ones use 64) */
+#define SET_NARROW_MAX_CAP ( ( size_t ) 1 << 31 )
+
+/** Slot values other than item indices */
+#define SET_SLOT_EMPTY   SIZE_MAX
+#define SET_SLOT_REMOVED ( SIZE_MAX - 1 )
+
+
+/*
+ * A compact table: the items are stored densely, in insertion order,
+ * and a sparse index of slots maps hashes to them
+ * (open addressing with linear probing).
+ *
+ * `capacity` is always a power of two, so the probe sequence is
+ * `( hash + i ) & ( capacity - 1 )`.
+ *
+ * A slot is 4 bytes (8 in tables over `SET_NARROW_MAX_CAP` slots) and holds either
+ *  - `SET_SLOT_EMPTY`   -- terminates every probe sequence
+ *  - `SET_SLOT_REMOVED` -- tombstone; skipped by lookups
+ *  - the index of an item in `items`
+ *
+ * A removed item leaves a hole (`data == NULL && removed`) in `items`
+ * and a tombstone in the index; new items are always appended.
+ * Both are dropped whenever the table is rebuilt,
+ * which is also the only time items move.
+ * Iterating over the items is linear in their number, whatever the capacity.
+ *
+ * Small items live in the item itself (`set_item::inline_data`),
+ * so moving an item has to re-point its `data`.
+ */
 struct hash_set {
-    size_t n_items;
-    size_t capacity;
-    struct set_item *items;
+    HashFunction hash;
+    uint64_t seed;
+
+    size_t n_items;   // live items
+    size_t n_removed; // tombstones (and holes)
+    size_t capacity;  // slots of `index`; power of two
+    size_t max_used;  // resize once `n_items + n_removed` would exceed this
+    double max_load;
+
+    void *index;            // `capacity` slots, `uint32_t` or `uint64_t`
+    struct set_item *items; // `max_used` items, `n_items + n_removed` of them used
+
+    const Allocator *allocator; // of everything above, including heap copies of items
 };
 
 size_t set_size( const Set *set )
@@ -24,6 +72,12 @@ size_t set_size( const Set *set )
     return set->n_items;
 }
 
+/** Items used (live and holes) */
+Private inline size_t set_n_used( const Set *set )
+{
+    return set->n_items + set->n_removed;
+}
+
 
 SetEnumeratedEntry set_get_next( const Set *set, const int64_t index_last )
 {
@@ -32,15 +86,15 @@ SetEnumeratedEntry set_get_next( const Set *set, const int64_t index_last )
         fwarnx( "index must not be negative except -1 for initialization" );
         return ( SetEnumeratedEntry ) { .item = NULL, .index = -2 };
     }
-    if ( index_last >= 0 && ( size_t ) index_last >= set->capacity )
+    if ( index_last >= 0 && ( size_t ) index_last >= set_n_used( set ) )
     {
         fwarnx( "index %" PRIi64 " out of bounds for set of length %zu", index_last,
-                set->capacity );
+                set_n_used( set ) );
 
         return ( SetEnumeratedEntry ) { .item = NULL, .index = -2 };
     }
 
-    for ( size_t i = index_last + 1; i < set->capacity; ++i )
+    for ( size_t i = index_last + 1; i < set_n_used( set ); ++i )
         if ( set->items[ i ].data != NULL )
             return ( SetEnumeratedEntry ) {
                 .item  = ( set->items + i ),
@@ -51,78 +105,362 @@ SetEnumeratedEntry set_get_next( const Set *set, const int64_t index_last )
 }
 
 
-static int set_item_cmp( const void *s1, const void *s2 )
+Private inline uint64_t set_hash( const Set *set, const void *data, const size_t len )
+{
+    return set->hash( data, len, set->seed );
+}
+
+/**
+ * Hash of `item` (which is stored in `owner`) as computed by `set`.
+ *
+ * The cached hash is reused whenever both sets hash the same way.
+ */
+Private inline uint64_t set_item_hash_in( const Set *set,
+                                          const Set *owner,
+                                          const struct set_item *item )
+{
+    if ( set->hash == owner->hash && set->seed == owner->seed )
+        return item->hash;
+    return set_hash( set, item->data, item->size );
+}
+
+
+/** Copies `len` bytes of `data` into the (free) `item` of `set` */
+Private int set_item_store( const Set *set,
+                            struct set_item *item,
+                            const void *data,
+                            const size_t len )
+{
+    if ( len <= SET_INLINE_SIZE )
+        item->data = item->inline_data;
+    else if ( ( item->data = allocator_alloc( set->allocator, len ) ) == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    memcpy( item->data, data, len );
+    return RV_SUCCESS;
+}
+
+Private inline void set_item_free( const Set *set, struct set_item *item )
+{
+    if ( item->data != item->inline_data )
+        allocator_free( set->allocator, item->data, item->size );
+    item->data = NULL;
+}
+
+/** Copies `item` to `dest` (taking over its heap copy, if it has one) */
+Private inline void set_item_move( struct set_item *dest, const struct set_item *item )
+{
+    *dest = *item;
+    if ( item->data == item->inline_data )
+        dest->data = dest->inline_data;
+}
+
+
+Private inline bool set_item_eq( const struct set_item *item,
+                                 const uint64_t hash,
+                                 const void *data,
+                                 const size_t len )
+{
+    return item->hash == hash && item->size == len
+           && memcmp( item->data, data, len ) == 0;
+}
+
+
+/* -------- Index -------- */
+
+Private inline bool set_index_wide( const size_t capacity )
 {
-    const struct set_item *item1 = s1;
-    const struct set_item *item2 = s2;
+    return capacity > SET_NARROW_MAX_CAP;
+}
 
-    if ( item1->size != item2->size )
-        return cmp_size_t( &item1->size, &item2->size );
-    return memcmp( item1->data, item2->data, item1->size );
+Private inline size_t set_index_bytes( const size_t capacity )
+{
+    return capacity * ( set_index_wide( capacity ) ? sizeof( uint64_t )
+                                                   : sizeof( uint32_t ) );
 }
 
-Private int /* NOLINT(*-no-recursion) */ set_insert_item( Set *set,
-                                                          const struct set_item *item )
+/** @return `SET_SLOT_EMPTY`, `SET_SLOT_REMOVED` or the index of an item */
+Private inline size_t set_slot_get( const Set *set, const size_t slot )
 {
-    return set_insert_f( set, item->data, item->size, item->func );
+    if ( set_index_wide( set->capacity ) )
+        return ( size_t ) ( ( const uint64_t * ) set->index )[ slot ];
+
+    const uint32_t value = ( ( const uint32_t * ) set->index )[ slot ];
+    // the special values are the largest ones in either width
+    return value >= UINT32_MAX - 1 ? SIZE_MAX - ( UINT32_MAX - value ) : value;
 }
 
+Private inline void set_slot_set( Set *set, const size_t slot, const size_t value )
+{
+    if ( set_index_wide( set->capacity ) )
+        ( ( uint64_t * ) set->index )[ slot ] = value;
+    else
+        ( ( uint32_t * ) set->index )[ slot ] = ( uint32_t ) value;
+}
+
+
+/** Smallest power of two that is at least `capacity` (and at least `SET_MIN_CAP`) */
+Private size_t set_round_cap( const size_t capacity )
+{
+    size_t cap = SET_MIN_CAP;
+    while ( cap < capacity )
+        cap *= 2;
+    return cap;
+}
 
-/* resize -> insert_item -> insert_f -> resize -\
- *  <-------------------------------------------/
+Private inline size_t set_max_used( const size_t capacity, const double max_load )
+{
+    const size_t max_used = ( size_t ) ( ( double ) capacity * max_load );
+    // at least one slot must always stay empty, or probing would never terminate
+    return max_used >= capacity ? capacity - 1 : max_used;
+}
+
+/** Capacity of a table that holds `n_items` without growing */
+Private size_t set_cap_for( const size_t n_items, const double max_load )
+{
+    size_t capacity = SET_MIN_CAP;
+    while ( set_max_used( capacity, max_load ) < n_items )
+        capacity *= 2;
+    return capacity;
+}
+
+
+/**
+ * Walks the probe sequence of `data`.
  *
- * assert() prevents potential infinite recursion
+ * @param hash      `set_hash( set, data, len )`
+ * @param slot_out  if not `NULL`, the slot of `data` is stored here,
+ *                  or, if it isn't in the set, the empty slot that ended the search
+ * @return the item equal to `data`, or `NULL` if it isn't in the set
  */
-Private int set_resize( Set *set, const size_t new_size ) // NOLINT(*-no-recursion)
+Private struct set_item *set_find( const Set *set,
+                                   const void *data,
+                                   const size_t len,
+                                   const uint64_t hash,
+                                   size_t *slot_out )
 {
-    Set *new_set = set_init_cap( new_size );
-    if ( new_set == NULL )
-        return RV_ERROR;
+    const size_t mask = set->capacity - 1;
 
-    for ( size_t i = 0; i < set->capacity; ++i )
+    size_t slot = hash & mask;
+    for ( ;; slot = ( slot + 1 ) & mask )
     {
-        const struct set_item *item = set->items + i;
-        if ( item->data == NULL )
+        const size_t value = set_slot_get( set, slot );
+        if ( value == SET_SLOT_EMPTY )
+            break; // never-used slot => `data` can't be any further
+        if ( value == SET_SLOT_REMOVED )
             continue;
 
-        const int ins_rv = set_insert_item( new_set, item );
-        if ( ins_rv < 0 )
+        struct set_item *item = set->items + value;
+        if ( set_item_eq( item, hash, data, len ) )
         {
-            set_destroy( new_set );
-            return ins_rv;
+            if ( slot_out != NULL )
+                *slot_out = slot;
+            return item;
         }
-        assert( ins_rv == SETINSERT_INSERTED );
-        free( item->data );
     }
 
-    free( set->items );
+    if ( slot_out != NULL )
+        *slot_out = slot;
+    return NULL;
+}
+
+/** Slot of the live item `set->items[ index ]` */
+Private size_t set_slot_of( const Set *set, const size_t index )
+{
+    const size_t mask = set->capacity - 1;
+
+    size_t slot = set->items[ index ].hash & mask;
+    while ( set_slot_get( set, slot ) != index )
+        slot = ( slot + 1 ) & mask;
+    return slot;
+}
+
+/** Points the first empty slot of the probe sequence of `hash` to item `index` */
+Private inline void set_index_add( Set *set, const uint64_t hash, const size_t index )
+{
+    const size_t mask = set->capacity - 1;
+
+    size_t slot = hash & mask;
+    while ( set_slot_get( set, slot ) != SET_SLOT_EMPTY )
+        slot = ( slot + 1 ) & mask;
+    set_slot_set( set, slot, index );
+}
 
-    memcpy( set, new_set, sizeof( struct hash_set ) );
 
-    free( new_set );
+/* -------- Table -------- */
 
+/** Allocates an empty index of `capacity` slots and room for the items it may hold */
+Private int set_table_alloc( const Set *set,
+                             const size_t capacity,
+                             const double max_load,
+                             void **index,
+                             struct set_item **items )
+{
+    if ( ( *index = allocator_alloc( set->allocator, set_index_bytes( capacity ) ) )
+         == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    *items = allocator_alloc( set->allocator,
+                              set_max_used( capacity, max_load )
+                                      * sizeof( struct set_item ) );
+    if ( *items == NULL )
+    {
+        allocator_free( set->allocator, *index, set_index_bytes( capacity ) );
+        return fwarn_ret( RV_ERROR, "malloc" );
+    }
+
+    // all ones are `SET_SLOT_EMPTY` in either width
+    memset( *index, 0xFF, set_index_bytes( capacity ) );
     return RV_SUCCESS;
 }
 
+/**
+ * Replaces the table of `set` by `index` and `items` (from `set_table_alloc()`),
+ * which holds the first `n_items` of `items`, without holes; indexes them
+ */
+Private void set_install( Set *set,
+                          const size_t capacity,
+                          void *index,
+                          struct set_item *items,
+                          const size_t n_items )
+{
+    allocator_free( set->allocator, set->index, set_index_bytes( set->capacity ) );
+    allocator_free( set->allocator, set->items,
+                    set->max_used * sizeof( struct set_item ) );
+
+    set->capacity  = capacity;
+    set->max_used  = set_max_used( capacity, set->max_load );
+    set->index     = index;
+    set->items     = items;
+    set->n_items   = n_items;
+    set->n_removed = 0;
+
+    for ( size_t i = 0; i < n_items; ++i )
+        set_index_add( set, items[ i ].hash, i );
+}
 
-Set *set_init_cap( const size_t capacity )
+/**
+ * Moves all items into a new table of `new_cap` slots (a power of two).
+ *
+ * Items keep their order, heap copies and cached hashes
+ * (only inline data is copied, nothing is rehashed)
+ * and all holes and tombstones are dropped.
+ */
+Private int set_rehash( Set *set, const size_t new_cap )
+{
+    assert( set_max_used( new_cap, set->max_load ) >= set->n_items );
+
+    void *new_index;
+    struct set_item *new_items;
+    return_on_fail(
+            set_table_alloc( set, new_cap, set->max_load, &new_index, &new_items ) );
+
+    size_t n = 0;
+    for ( size_t i = 0; i < set_n_used( set ); ++i )
+        if ( set->items[ i ].data != NULL )
+            set_item_move( new_items + n++, set->items + i );
+
+    set_install( set, new_cap, new_index, new_items, n );
+    return RV_SUCCESS;
+}
+
+/**
+ * Halves the table while it would stay at most half-full
+ * (and still have room for an item, which it may not with a small `max_load`)
+ */
+Private int set_shrink( Set *set )
+{
+    size_t new_cap = set->capacity;
+    while ( new_cap > SET_MIN_CAP && set_max_used( new_cap / 2, set->max_load ) > 0
+            && set->n_items * 2 <= set_max_used( new_cap / 2, set->max_load ) )
+        new_cap /= 2;
+
+    if ( new_cap == set->capacity )
+        return RV_SUCCESS;
+    // [ a, b, _, _, _, _, _, _ ] => [ a, b, _, _ ]
+    return set_rehash( set, new_cap );
+}
+
+/**
+ * Makes room for one more item.
+ *
+ * If the table is full mostly because of removed items,
+ * it is rebuilt at the same capacity instead of growing.
+ */
+Private int set_make_room( Set *set )
+{
+    if ( set_n_used( set ) + 1 <= set->max_used )
+        return RV_SUCCESS;
+
+    size_t new_cap = ( set->n_items + 1 ) * 2 > set->max_used ? set->capacity * 2
+                                                              : set->capacity;
+    // doubling once isn't always enough: with a small `max_load`,
+    // a small table may have no room at all
+    const size_t min_cap = set_cap_for( set->n_items + 1, set->max_load );
+    if ( new_cap < min_cap )
+        new_cap = min_cap;
+
+    return set_rehash( set, new_cap );
+}
+
+/** Appends `item` (moved) and indexes it; there must be room for it */
+Private struct set_item *set_append( Set *set, const struct set_item *item )
+{
+    assert( set_n_used( set ) < set->max_used );
+
+    const size_t index    = set_n_used( set );
+    struct set_item *dest = set->items + index;
+    set_item_move( dest, item );
+    set_index_add( set, dest->hash, index );
+
+    ++set->n_items;
+    return dest;
+}
+
+
+Private Set *set_init_with( const size_t capacity,
+                            const HashFunction hash,
+                            const uint64_t seed,
+                            const Allocator *allocator )
 {
-    Set *new_set = calloc( 1, sizeof( Set ) );
+    Set *new_set = allocator_calloc( allocator, 1, sizeof( Set ) );
     if ( new_set == NULL )
         return fflwarn_ret( NULL, "calloc" );
 
-    if ( ( new_set->items = calloc( capacity, sizeof( struct set_item ) ) ) == NULL )
+    new_set->hash      = hash != NULL ? hash : hash_bytes;
+    new_set->seed      = seed;
+    new_set->max_load  = SET_DEFAULT_MAX_LOAD;
+    new_set->allocator = allocator;
+
+    new_set->capacity = set_round_cap( capacity );
+    new_set->max_used = set_max_used( new_set->capacity, new_set->max_load );
+    if ( set_table_alloc( new_set, new_set->capacity, new_set->max_load,
+                          &new_set->index, &new_set->items )
+         != RV_SUCCESS )
     {
-        free( new_set );
-        return fflwarn_ret( NULL, "calloc" );
+        allocator_free( allocator, new_set, sizeof( Set ) );
+        return f_stack_trace( NULL );
     }
 
-    new_set->capacity = capacity;
+    return new_set;
+}
+
+Set *set_init_with_hash( const size_t capacity,
+                         const HashFunction hash,
+                         const uint64_t seed )
+{
+    return set_init_with( capacity, hash, seed, allocator_default() );
+}
 
-    for ( size_t i = 0; i < new_set->capacity; ++i )
-        new_set->items[ i ].func = ITEM_PRINT_FUNCTION_NAME( byte );
+Set *set_init_with_allocator( const Allocator *allocator )
+{
+    return set_init_with( SET_DEFAULT_CAP, hash_bytes, HASH_DEFAULT_SEED,
+                          allocator != NULL ? allocator : allocator_default() );
+}
 
-    return new_set;
+Set *set_init_cap( const size_t capacity )
+{
+    return set_init_with_hash( capacity, hash_bytes, HASH_DEFAULT_SEED );
 }
 
 Set *set_init( void )
@@ -130,56 +468,70 @@ Set *set_init( void )
     return set_init_cap( SET_DEFAULT_CAP );
 }
 
-
-/**
- * If the element is not already in, the function creates a shallow copy of the data
- * @param set
- * @param data
- * @param len
- * @param func
- * @return
- */
-/* NOLINT(*-no-recursion) */ int set_insert_f( Set *set, const void *data, size_t len,
-                                               const PrintFunction func )
+int set_set_max_load( Set *set, const double max_load )
 {
-    if ( set->n_items + 1 >= set->capacity )
-        if ( set_resize( set, set->capacity * 2 ) )
-            return RV_ERROR;
-
-    const size_t index = hash_func( data, len );
+    if ( !( max_load > 0 && max_load < 1 ) )
+        return fwarnx_ret( RV_EXCEPTION, "max load must be in (0, 1), not %g", max_load );
 
-    const struct set_item new = {
-        .size = len, .data = ( void * ) data,
-        /* data is still const */
-    };
+    size_t new_cap = set->capacity;
+    while ( set->n_items >= set_max_used( new_cap, max_load ) )
+        new_cap *= 2;
 
-    for ( size_t i = 0; i < set->capacity; ++i )
+    // the items are allocated for the old load factor => always rebuilt
+    const double old_max_load = set->max_load;
+    set->max_load             = max_load;
+    if ( set_rehash( set, new_cap ) != RV_SUCCESS )
     {
-        const size_t current_index = ( index + i ) % set->capacity;
-        struct set_item *curr      = set->items + current_index;
+        set->max_load = old_max_load;
+        return f_stack_trace( RV_ERROR );
+    }
+    return RV_SUCCESS;
+}
 
-        if ( set_item_cmp( &new, curr ) == 0 )
-            return SETINSERT_WAS_IN;
+int set_reserve( Set *set, const size_t n_items )
+{
+    const size_t new_cap = set_cap_for( n_items, set->max_load );
+    if ( new_cap <= set->capacity )
+        return RV_SUCCESS;
+    return set_rehash( set, new_cap );
+}
 
-        if ( curr->data != NULL )
-            continue;
 
-        // elements rightful place is empty => insert
-        curr->data = malloc( len );
-        if ( curr->data == NULL )
-            return fwarn_ret( RV_ERROR, "malloc" );
+/**
+ * If the element is not already in, the function creates a shallow copy of the data
+ *
+ * @param hash `set_hash( set, data, len )`
+ * @return `RV_ERROR` | `enum SetInsertRV`
+ */
+Private int set_insert_hashed( Set *set,
+                               const void *data,
+                               const size_t len,
+                               const uint64_t hash,
+                               const PrintFunction func )
+{
+    if ( set_find( set, data, len, hash, NULL ) != NULL )
+        return SETINSERT_WAS_IN;
+
+    if ( set_make_room( set ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
-        memcpy( curr->data, data, len );
-        curr->size    = len;
-        curr->removed = false;
-        curr->func    = func;
+    struct set_item item = {
+        .size    = len,
+        .hash    = hash,
+        .removed = false,
+        .func    = func,
+    };
+    if ( set_item_store( set, &item, data, len ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
 
-        ++set->n_items;
+    ( void ) set_append( set, &item );
 
-        return SETINSERT_INSERTED;
-    }
+    return SETINSERT_INSERTED;
+}
 
-    return fflwarnx_ret( RV_ERROR, "unrecognized exception; something went wrong" );
+int set_insert_f( Set *set, const void *data, size_t len, const PrintFunction func )
+{
+    return set_insert_hashed( set, data, len, set_hash( set, data, len ), func );
 }
 
 int set_insert( Set *set, const void *data, const size_t len )
@@ -187,141 +539,654 @@ int set_insert( Set *set, const void *data, const size_t len )
     return set_insert_f( set, data, len, ITEM_PRINT_FUNCTION_NAME( byte ) );
 }
 
-Private int set_insert_array( Set *set, const size_t len,
-                              const struct set_item set_item_array[ len ] )
+/** Inserts an item stored in `owner` */
+Private int set_insert_item( Set *set, const Set *owner, const struct set_item *item )
+{
+    return set_insert_hashed( set, item->data, item->size,
+                              set_item_hash_in( set, owner, item ), item->func );
+}
+
+/** Inserts all items of `owner` */
+Private int set_insert_all( Set *set, const Set *owner )
 {
-    for ( size_t i = 0; i < len; ++i )
+    for ( size_t i = 0; i < set_n_used( owner ); ++i )
     {
-        const struct set_item *item = set_item_array + i;
+        const struct set_item *item = owner->items + i;
         if ( item->data != NULL )
-            if ( set_insert_item( set, item ) == RV_ERROR )
+            if ( set_insert_item( set, owner, item ) == RV_ERROR )
                 return RV_ERROR;
     }
     return RV_SUCCESS;
 }
 
 
-int set_remove( Set *set, const void *data, const size_t len )
+/* -------- Bulk insertion -------- */
+
+/** Items hashed (and their slots prefetched) ahead of being inserted */
+#define SET_BATCH 16
+
+/** Smallest array `set_insert_many_parallel()` builds in parallel */
+#define SET_PARALLEL_MIN_ITEMS 65536
+/** Input items per task */
+#define SET_PARALLEL_GRAIN 16384
+/** Regions of the index filled by separate tasks */
+#define SET_PARALLEL_REGIONS 256
+
+
+Private inline void set_index_prefetch( const Set *set, const uint64_t hash )
 {
-    const size_t index = hash_func( data, len ) % set->capacity;
+    const size_t slot  = hash & ( set->capacity - 1 );
+    const size_t width = set_index_bytes( set->capacity ) / set->capacity;
+    __builtin_prefetch( ( const byte * ) set->index + slot * width );
+}
 
-    const struct set_item to_remove = {
-        .size = len, .data = ( void * ) data,
-        /* data should still be const */
-    };
+int set_insert_many( Set *set, const void *items, const size_t n, const size_t el_size )
+{
+    return_on_fail( set_reserve( set, set->n_items + n ) );
 
-    for ( size_t i = 0; i < set->capacity; ++i )
+    const byte *item_bytes = items;
+    for ( size_t first = 0; first < n; first += SET_BATCH )
     {
-        const size_t current_index = ( index + i ) % set->capacity;
-        struct set_item *curr      = set->items + current_index;
+        const size_t batch      = min_m( n - first, ( size_t ) SET_BATCH );
+        const byte *batch_items = item_bytes + first * el_size;
 
-        if ( set_item_cmp( &to_remove, curr ) == 0 )
+        // the whole batch is hashed first, so that its misses in the index overlap
+        uint64_t hashes[ SET_BATCH ];
+        for ( size_t j = 0; j < batch; ++j )
         {
-            free( curr->data );
+            hashes[ j ] = set_hash( set, batch_items + j * el_size, el_size );
+            set_index_prefetch( set, hashes[ j ] );
+        }
+
+        for ( size_t j = 0; j < batch; ++j )
+            if ( set_insert_hashed( set, batch_items + j * el_size, el_size, hashes[ j ],
+                                    ITEM_PRINT_FUNCTION_NAME( byte ) )
+                 == RV_ERROR )
+                return f_stack_trace( RV_ERROR );
+    }
+
+    return RV_SUCCESS;
+}
+
+
+/*
+ * A parallel build fills the (empty) index with the positions of the items
+ * in the input array first, and copies the items into the set last:
+ *  1. the items are hashed, and counted per block of input and region of the index
+ *     they hash into (`counts`)
+ *  2. their positions are grouped by region (`order`), in input order
+ *  3. each region is filled by its own task, which probes only the region,
+ *     so it can see only its own items. Those that would probe past its end
+ *     are left for the calling thread, which inserts them once all regions are full
+ *  4. the positions left in the index are the first occurrences (`kept`);
+ *     each block copies them into the set, after those of the blocks before it,
+ *     and replaces their hash by their position in the set
+ *  5. the index is translated to those positions
+ *
+ * Equal items hash into the same region, and a region only ever fills up,
+ * so an item probes past its end iff the first occurrence of the item did.
+ */
+struct set_build {
+    Set *set;
+    const byte *items;
+    size_t n;
+    size_t el_size;
+
+    size_t region_shift; // slot >> region_shift == its region
+    size_t n_blocks;
+
+    uint64_t *hashes;   // of the input; of the kept items replaced by their position
+    size_t *order;      // input positions grouped by region
+    size_t *counts;     // `[ block * SET_PARALLEL_REGIONS + region ]`, then offsets
+    size_t *starts;     // of the regions in `order` (one more for the end)
+    size_t *n_overflow; // per region; at the start of its part of `order`
+    size_t *n_kept;     // per block, then the position of its first item in the set
+    bool *kept;         // the input item is a first occurrence
+
+    bool failed; // a heap copy couldn't be allocated
+};
 
-            curr->data    = NULL;
-            curr->size    = 0;
-            curr->removed = true;
+typedef void ( *SetBuildTask )( struct set_build *, size_t task );
 
-            --set->n_items;
+struct set_build_job {
+    struct set_build *build;
+    SetBuildTask task;
+};
 
-            if ( set->n_items <= set->capacity / 4 )
-                if ( set_resize( set, set->capacity / 2 ) )
-                    // [ a, b, _, _, _, _, _, _ ] => [ a, b, _, _ ]
-                    return RV_ERROR;
+Private void set_build_body( const size_t from, const size_t to, void *arg )
+{
+    const struct set_build_job *job = arg;
+    for ( size_t task = from; task < to; ++task )
+        job->task( job->build, task );
+}
 
-            return SETREMOVE_REMOVED;
+/** Runs `task( build, 0 )` … `task( build, n_tasks - 1 )` on `pool` */
+Private void set_build_run( struct set_build *build,
+                            ThreadPool *pool,
+                            const size_t n_tasks,
+                            const SetBuildTask task )
+{
+    struct set_build_job job = { .build = build, .task = task };
+    if ( pool == NULL
+         || thread_pool_parallel_for( pool, 0, n_tasks, 1, set_build_body, &job )
+                    != RV_SUCCESS )
+        set_build_body( 0, n_tasks, &job );
+}
+
+Private inline size_t set_build_region( const struct set_build *build,
+                                        const uint64_t hash )
+{
+    return ( hash & ( build->set->capacity - 1 ) ) >> build->region_shift;
+}
+
+Private inline size_t set_build_block_end( const struct set_build *build,
+                                           const size_t block )
+{
+    return min_m( ( block + 1 ) * SET_PARALLEL_GRAIN, build->n );
+}
+
+/** The input items at `i` and `j` are equal */
+Private inline bool set_build_eq( const struct set_build *build,
+                                  const size_t i,
+                                  const size_t j )
+{
+    return build->hashes[ i ] == build->hashes[ j ]
+           && memcmp( build->items + i * build->el_size,
+                      build->items + j * build->el_size, build->el_size )
+                      == 0;
+}
+
+/**
+ * Probes for input item `i` from its home slot up to (not including) `end`.
+ *
+ * @return `true` if it was stored or found, `false` if it reached `end`
+ */
+Private bool set_build_probe( struct set_build *build, const size_t i, const size_t end )
+{
+    Set *set          = build->set;
+    const size_t mask = set->capacity - 1;
+
+    for ( size_t slot = build->hashes[ i ] & mask; slot != end;
+          slot        = ( slot + 1 ) & mask )
+    {
+        const size_t value = set_slot_get( set, slot );
+        if ( value == SET_SLOT_EMPTY )
+        {
+            set_slot_set( set, slot, i );
+            return true;
         }
+        if ( set_build_eq( build, i, value ) )
+            return true;
+    }
+    return false;
+}
 
-        if ( curr->data == NULL && !curr->removed )
-            break;
+Private void set_build_hash( struct set_build *build, const size_t block )
+{
+    size_t *counts = build->counts + block * SET_PARALLEL_REGIONS;
+    for ( size_t i = block * SET_PARALLEL_GRAIN; i < set_build_block_end( build, block );
+          ++i )
+    {
+        build->hashes[ i ] =
+                set_hash( build->set, build->items + i * build->el_size, build->el_size );
+        ++counts[ set_build_region( build, build->hashes[ i ] ) ];
     }
+}
 
-    return SETREMOVE_NOT_FOUND;
+Private void set_build_scatter( struct set_build *build, const size_t block )
+{
+    size_t *offsets = build->counts + block * SET_PARALLEL_REGIONS;
+    for ( size_t i = block * SET_PARALLEL_GRAIN; i < set_build_block_end( build, block );
+          ++i )
+        build->order[ offsets[ set_build_region( build, build->hashes[ i ] ) ]++ ] = i;
 }
 
-Private int set_remove_item( Set *set, const struct set_item *item )
+Private void set_build_fill( struct set_build *build, const size_t region )
 {
-    return set_remove( set, item->data, item->size );
+    // the last region ends where the first one starts
+    const size_t end =
+            ( ( region + 1 ) << build->region_shift ) & ( build->set->capacity - 1 );
+    size_t *overflow  = build->order + build->starts[ region ];
+    size_t n_overflow = 0;
+
+    for ( size_t k = build->starts[ region ]; k < build->starts[ region + 1 ]; ++k )
+        if ( !set_build_probe( build, build->order[ k ], end ) )
+            overflow[ n_overflow++ ] = build->order[ k ]; // never ahead of `k`
+
+    build->n_overflow[ region ] = n_overflow;
 }
 
-int set_remove_array( Set *set, const size_t len,
-                      const struct set_item set_item_array[ len ] )
+Private void set_build_mark( struct set_build *build, const size_t region )
 {
-    for ( size_t i = 0; i < len; ++i )
+    const size_t end = ( region + 1 ) << build->region_shift;
+    for ( size_t slot = region << build->region_shift; slot < end; ++slot )
     {
-        const struct set_item *item = set_item_array + i;
-        if ( item->data != NULL )
+        const size_t value = set_slot_get( build->set, slot );
+        if ( value != SET_SLOT_EMPTY )
+            build->kept[ value ] = true;
+    }
+}
+
+Private void set_build_count( struct set_build *build, const size_t block )
+{
+    size_t n_kept = 0;
+    for ( size_t i = block * SET_PARALLEL_GRAIN; i < set_build_block_end( build, block );
+          ++i )
+        n_kept += build->kept[ i ];
+    build->n_kept[ block ] = n_kept;
+}
+
+Private void set_build_copy( struct set_build *build, const size_t block )
+{
+    Set *set   = build->set;
+    size_t pos = build->n_kept[ block ];
+
+    for ( size_t i = block * SET_PARALLEL_GRAIN;
+          i < set_build_block_end( build, block ) && !build->failed; ++i )
+    {
+        if ( !build->kept[ i ] )
+            continue;
+
+        struct set_item *item = set->items + pos;
+        item->size            = build->el_size;
+        item->hash            = build->hashes[ i ];
+        item->removed         = false;
+        item->func            = ITEM_PRINT_FUNCTION_NAME( byte );
+        if ( set_item_store( set, item, build->items + i * build->el_size,
+                             build->el_size )
+             != RV_SUCCESS )
         {
-            if ( set_remove_item( set, item ) == RV_ERROR )
-                return RV_ERROR;
+            build->failed = true;
+            return;
+        }
+        build->hashes[ i ] = pos++;
+    }
+}
+
+Private void set_build_translate( struct set_build *build, const size_t region )
+{
+    const size_t end = ( region + 1 ) << build->region_shift;
+    for ( size_t slot = region << build->region_shift; slot < end; ++slot )
+    {
+        const size_t value = set_slot_get( build->set, slot );
+        if ( value != SET_SLOT_EMPTY )
+            set_slot_set( build->set, slot, build->hashes[ value ] );
+    }
+}
+
+Private void set_build_free( struct set_build *build )
+{
+    free( build->hashes );
+    free( build->order );
+    free( build->counts );
+    free( build->starts );
+    free( build->n_overflow );
+    free( build->n_kept );
+    free( build->kept );
+}
+
+/** @return `RV_ERROR` if the scratch arrays can't be allocated */
+Private int set_build_alloc( struct set_build *build )
+{
+    build->hashes     = malloc( build->n * sizeof( uint64_t ) );
+    build->order      = malloc( build->n * sizeof( size_t ) );
+    build->counts     = calloc( build->n_blocks * SET_PARALLEL_REGIONS,
+                                sizeof( size_t ) );
+    build->starts     = malloc( ( SET_PARALLEL_REGIONS + 1 ) * sizeof( size_t ) );
+    build->n_overflow = malloc( SET_PARALLEL_REGIONS * sizeof( size_t ) );
+    build->n_kept     = malloc( build->n_blocks * sizeof( size_t ) );
+    build->kept       = calloc( build->n, sizeof( bool ) );
+
+    if ( build->hashes == NULL || build->order == NULL || build->counts == NULL
+         || build->starts == NULL || build->n_overflow == NULL || build->n_kept == NULL
+         || build->kept == NULL )
+    {
+        set_build_free( build );
+        return fwarn_ret( RV_ERROR, "malloc" );
+    }
+    return RV_SUCCESS;
+}
+
+/** Builds the empty `build->set` (which has room for all items) */
+Private int set_build( struct set_build *build, ThreadPool *pool )
+{
+    Set *set = build->set;
+    return_on_fail( set_build_alloc( build ) );
+
+    set_build_run( build, pool, build->n_blocks, set_build_hash );
+
+    // regions one after another, the blocks of each in order
+    size_t offset = 0;
+    for ( size_t region = 0; region < SET_PARALLEL_REGIONS; ++region )
+    {
+        build->starts[ region ] = offset;
+        for ( size_t block = 0; block < build->n_blocks; ++block )
+        {
+            size_t *count         = build->counts + block * SET_PARALLEL_REGIONS + region;
+            const size_t n_region = *count;
+            *count                = offset;
+            offset += n_region;
         }
     }
+    build->starts[ SET_PARALLEL_REGIONS ] = offset;
+
+    set_build_run( build, pool, build->n_blocks, set_build_scatter );
+    set_build_run( build, pool, SET_PARALLEL_REGIONS, set_build_fill );
+
+    // the full table this time (wrapping around), region by region;
+    // equal items share a region, whose overflow is in the order of the input,
+    // so the first occurrence of an item is still the one that is kept
+    for ( size_t region = 0; region < SET_PARALLEL_REGIONS; ++region )
+        for ( size_t k = 0; k < build->n_overflow[ region ]; ++k )
+            ( void ) set_build_probe( build, build->order[ build->starts[ region ] + k ],
+                                      SIZE_MAX );
+
+    set_build_run( build, pool, SET_PARALLEL_REGIONS, set_build_mark );
+    set_build_run( build, pool, build->n_blocks, set_build_count );
+
+    size_t n_kept = 0;
+    for ( size_t block = 0; block < build->n_blocks; ++block )
+    {
+        const size_t n_block   = build->n_kept[ block ];
+        build->n_kept[ block ] = n_kept;
+        n_kept += n_block;
+    }
+
+    // heap copies come from the allocator of the set
+    if ( build->el_size <= SET_INLINE_SIZE )
+        set_build_run( build, pool, build->n_blocks, set_build_copy );
+    else
+    {
+        memset( set->items, 0, n_kept * sizeof( struct set_item ) );
+        set_build_run( build, NULL, build->n_blocks, set_build_copy );
+    }
+
+    if ( build->failed )
+    {
+        for ( size_t i = 0; i < n_kept; ++i )
+            if ( set->items[ i ].data != NULL )
+                set_item_free( set, set->items + i );
+        memset( set->index, 0xFF, set_index_bytes( set->capacity ) );
+        set_build_free( build );
+        return f_stack_trace( RV_ERROR );
+    }
+
+    set_build_run( build, pool, SET_PARALLEL_REGIONS, set_build_translate );
+    set->n_items = n_kept;
+
+    set_build_free( build );
     return RV_SUCCESS;
 }
 
+int set_insert_many_parallel( Set *set,
+                              const void *items,
+                              const size_t n,
+                              const size_t el_size,
+                              ThreadPool *pool )
+{
+    if ( pool == NULL || set->n_items > 0 || n < SET_PARALLEL_MIN_ITEMS )
+        return set_insert_many( set, items, n, el_size );
+
+    // also drops the holes, if there are any
+    const size_t capacity = set_cap_for( n, set->max_load );
+    return_on_fail( set_rehash( set, capacity > set->capacity ? capacity
+                                                              : set->capacity ) );
+
+    size_t region_shift = 0;
+    while ( ( set->capacity >> region_shift ) > SET_PARALLEL_REGIONS )
+        ++region_shift;
+
+    struct set_build build = {
+        .set          = set,
+        .items        = items,
+        .n            = n,
+        .el_size      = el_size,
+        .region_shift = region_shift,
+        .n_blocks     = n / SET_PARALLEL_GRAIN + ( n % SET_PARALLEL_GRAIN != 0 ),
+        .failed       = false,
+    };
+    return set_build( &build, pool );
+}
+
+Set *set_from_array( const void *items, const size_t n, const size_t el_size )
+{
+    Set *set = set_init_cap( set_cap_for( n, SET_DEFAULT_MAX_LOAD ) );
+    if ( set == NULL )
+        return f_stack_trace( NULL );
+
+    if ( set_insert_many( set, items, n, el_size ) != RV_SUCCESS )
+    {
+        set_destroy( set );
+        return f_stack_trace( NULL );
+    }
+    return set;
+}
+
+
+/**
+ * Frees the item in `slot`, leaving a hole and a tombstone behind
+ * (the table never shrinks here)
+ */
+Private void set_remove_at( Set *set, const size_t slot )
+{
+    struct set_item *item = set->items + set_slot_get( set, slot );
+    set_item_free( set, item );
+
+    item->size    = 0;
+    item->removed = true;
+    set_slot_set( set, slot, SET_SLOT_REMOVED );
+
+    --set->n_items;
+    ++set->n_removed;
+}
+
+/**
+ * @param hash `set_hash( set, data, len )`
+ * @return `RV_ERROR` | `enum SetRemoveRV`
+ */
+Private int set_remove_hashed( Set *set,
+                               const void *data,
+                               const size_t len,
+                               const uint64_t hash )
+{
+    size_t slot;
+    if ( set_find( set, data, len, hash, &slot ) == NULL )
+        return SETREMOVE_NOT_FOUND;
+
+    set_remove_at( set, slot );
+
+    // shrink only if the halved table would still be at most half-full,
+    // so that alternating insert/remove doesn't keep resizing
+    if ( set_shrink( set ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return SETREMOVE_REMOVED;
+}
+
+int set_remove( Set *set, const void *data, const size_t len )
+{
+    return set_remove_hashed( set, data, len, set_hash( set, data, len ) );
+}
+
 
 bool set_search( const Set *set, const void *data, const size_t len )
 {
-    const size_t index = hash_func( data, len ) % set->capacity;
+    return set_find( set, data, len, set_hash( set, data, len ), NULL ) != NULL;
+}
 
-    const struct set_item new = {
-        .size = len, .data = ( void * ) data,
-        /* data is still const */
-    };
+/** Searches for an item stored in `owner` */
+Private bool set_search_item( const Set *set,
+                              const Set *owner,
+                              const struct set_item *item )
+{
+    return set_find( set, item->data, item->size, set_item_hash_in( set, owner, item ),
+                     NULL )
+           != NULL;
+}
+
+
+/** Both sets hash the same way, so cached hashes are valid in either */
+Private inline bool set_same_hash( const Set *set_1, const Set *set_2 )
+{
+    return set_1->hash == set_2->hash && set_1->seed == set_2->seed;
+}
 
-    for ( size_t i = 0; i < set->capacity; ++i )
+/**
+ * Copies all items of `set` (in order) into a new set which hashes the same way,
+ * with room for `n_items`; nothing is rehashed or compared.
+ *
+ * @param allocator of the new set
+ */
+Private Set *set_clone( const Set *set, const size_t n_items, const Allocator *allocator )
+{
+    Set *clone = set_init_with( set_cap_for( n_items, set->max_load ), set->hash,
+                                set->seed, allocator );
+    if ( clone == NULL )
+        return f_stack_trace( NULL );
+    if ( clone->max_load != set->max_load
+         && set_set_max_load( clone, set->max_load ) != RV_SUCCESS )
     {
-        const size_t current_index  = ( index + i ) % set->capacity;
-        const struct set_item *curr = set->items + current_index;
+        set_destroy( clone );
+        return f_stack_trace( NULL );
+    }
 
-        if ( set_item_cmp( &new, curr ) == 0 )
-            return true;
+    for ( size_t i = 0; i < set_n_used( set ); ++i )
+    {
+        const struct set_item *item = set->items + i;
+        if ( item->data == NULL )
+            continue;
+
+        struct set_item copy = *item;
+        if ( set_item_store( clone, &copy, item->data, item->size ) != RV_SUCCESS )
+        {
+            set_destroy( clone );
+            return f_stack_trace( NULL );
+        }
+        ( void ) set_append( clone, &copy );
     }
 
-    return false;
+    return clone;
 }
 
-Private bool set_search_item( const Set *set, const struct set_item *item )
+/**
+ * Moves `item` (with its heap copy, if it has one) into `set`;
+ * an equal item mustn't be in it.
+ *
+ * @param hash `set_hash( set, item->data, item->size )`
+ */
+Private int set_adopt( Set *set, const struct set_item *item, const uint64_t hash )
 {
-    return set_search( set, item->data, item->size );
+    if ( set_make_room( set ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    struct set_item rehashed;
+    set_item_move( &rehashed, item );
+    rehashed.hash = hash;
+
+    ( void ) set_append( set, &rehashed );
+    return RV_SUCCESS;
 }
 
 
 int set_union( const Set *set_1, const Set *set_2, Set **result )
 {
-    if ( *result == NULL )
-        *result = set_init_cap( set_1->capacity + set_2->capacity );
+    const size_t n_items = set_1->n_items + set_2->n_items;
 
-    const int rv = set_insert_array( *result, set_2->capacity, set_2->items );
-    if ( rv < 0 )
-        return rv;
-    return set_insert_array( *result, set_1->capacity, set_1->items );
+    if ( *result != NULL )
+    {
+        return_on_fail( set_reserve( *result, set_size( *result ) + n_items ) );
+        const int rv = set_insert_all( *result, set_1 );
+        if ( rv < 0 )
+            return rv;
+        return set_insert_all( *result, set_2 );
+    }
+
+    // copy the larger set as it is, only the smaller one is looked up
+    const bool larger_2 =
+            set_2->n_items > set_1->n_items && set_same_hash( set_1, set_2 );
+    const Set *larger  = larger_2 ? set_2 : set_1;
+    const Set *smaller = larger_2 ? set_1 : set_2;
+
+    if ( ( *result = set_clone( larger, n_items, set_1->allocator ) ) == NULL )
+        return f_stack_trace( RV_ERROR );
+    return set_insert_all( *result, smaller );
 }
 
 int set_unionize( Set *set, const Set *add )
 {
-    return set_insert_array( set, add->capacity, add->items );
+    if ( set == add )
+        return RV_SUCCESS;
+
+    return_on_fail( set_reserve( set, set->n_items + add->n_items ) );
+    return set_insert_all( set, add );
+}
+
+int set_absorb( Set *set, Set *add )
+{
+    if ( set == add )
+        return fwarnx_ret( RV_EXCEPTION, "cannot absorb a set into itself" );
+
+    if ( add->n_items > set->n_items && set_same_hash( set, add )
+         && set->allocator == add->allocator && set->max_load == add->max_load )
+    {
+        // the larger table stays
+        const Set tmp = *set;
+        *set          = *add;
+        *add          = tmp;
+    }
+
+    return_on_fail( set_reserve( set, set->n_items + add->n_items ) );
+
+    // heap copies can only be moved between sets of the same allocator
+    const bool move = set->allocator == add->allocator;
+    for ( size_t i = 0; add->n_items > 0; ++i )
+    {
+        struct set_item *item = add->items + i;
+        if ( item->data == NULL )
+            continue;
+
+        const uint64_t hash = set_item_hash_in( set, add, item );
+        if ( set_find( set, item->data, item->size, hash, NULL ) == NULL )
+        {
+            if ( move ? set_adopt( set, item, hash ) != RV_SUCCESS
+                      : set_insert_hashed( set, item->data, item->size, hash, item->func )
+                                == RV_ERROR )
+                return f_stack_trace( RV_ERROR );
+            if ( move )
+                item->data = NULL; // owned by `set` now
+        }
+
+        // keep `add` consistent, in case the next one fails
+        set_remove_at( add, set_slot_of( add, i ) );
+    }
+
+    set_destroy( add );
+    return RV_SUCCESS;
 }
 
 
 int set_intersection( const Set *set_1, const Set *set_2, Set **result )
 {
+    // the smaller set is iterated, the larger one looked up
+    const Set *smaller = set_2->n_items < set_1->n_items ? set_2 : set_1;
+    const Set *larger  = smaller == set_1 ? set_2 : set_1;
+
     if ( *result == NULL )
-        *result = set_init_cap( set_1->capacity + set_2->capacity );
+        *result = set_init_with( set_cap_for( smaller->n_items, SET_DEFAULT_MAX_LOAD ),
+                                 set_1->hash, set_1->seed, set_1->allocator );
+    else if ( set_reserve( *result, set_size( *result ) + smaller->n_items )
+              != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
     if ( *result == NULL )
         return RV_ERROR;
 
-    for ( size_t i = 0; i < set_2->capacity; ++i )
+    for ( size_t i = 0; i < set_n_used( smaller ); ++i )
     {
-        const struct set_item *item = set_2->items + i;
-        if ( item->data == NULL )
+        const struct set_item *item = smaller->items + i;
+        if ( item->data == NULL || !set_search_item( larger, smaller, item ) )
             continue;
 
-        if ( !set_search_item( set_1, item ) )
-            continue;
-
-        if ( set_insert_item( *result, item ) < 0 )
+        if ( set_insert_item( *result, smaller, item ) < 0 )
             return RV_ERROR;
     }
 
@@ -330,32 +1195,95 @@ int set_intersection( const Set *set_1, const Set *set_2, Set **result )
 
 int set_intersect( Set *set, const Set *intr )
 {
-    for ( size_t i = 0; i < intr->capacity; ++i )
-        if ( set->items->data != NULL )
-            if ( !set_search_item( intr, set->items + i ) )
-                if ( set_remove_item( set, set->items + i ) == RV_ERROR )
-                    return RV_ERROR;
+    if ( set == intr )
+        return RV_SUCCESS;
+
+    if ( set->n_items <= intr->n_items )
+    {
+        // remove what isn't in `intr`
+        for ( size_t i = 0; i < set_n_used( set ); ++i )
+        {
+            const struct set_item *item = set->items + i;
+            if ( item->data != NULL && !set_search_item( intr, set, item ) )
+                set_remove_at( set, set_slot_of( set, i ) );
+        }
+        return set_shrink( set );
+    }
+
+    // mark what is in `intr`, then move it (in order) to a new table
+    const size_t n_used = set_n_used( set );
+    byte *kept          = allocator_calloc( set->allocator, n_used, 1 );
+    if ( kept == NULL )
+        return fwarn_ret( RV_ERROR, "calloc" );
+
+    size_t n_kept = 0;
+    for ( size_t i = 0; i < set_n_used( intr ); ++i )
+    {
+        const struct set_item *item = intr->items + i;
+        if ( item->data == NULL )
+            continue;
+
+        const struct set_item *found =
+                set_find( set, item->data, item->size,
+                          set_item_hash_in( set, intr, item ), NULL );
+        if ( found != NULL )
+        {
+            kept[ found - set->items ] = true;
+            ++n_kept;
+        }
+    }
+
+    const size_t new_cap = set_cap_for( n_kept, set->max_load );
+    void *new_index;
+    struct set_item *new_items;
+    if ( set_table_alloc( set, new_cap, set->max_load, &new_index, &new_items )
+         != RV_SUCCESS )
+    {
+        allocator_free( set->allocator, kept, n_used );
+        return f_stack_trace( RV_ERROR );
+    }
+
+    size_t n = 0;
+    for ( size_t i = 0; i < n_used; ++i )
+    {
+        struct set_item *item = set->items + i;
+        if ( kept[ i ] )
+            set_item_move( new_items + n++, item );
+        else if ( item->data != NULL )
+            set_item_free( set, item );
+    }
+    allocator_free( set->allocator, kept, n_used );
+
+    set_install( set, new_cap, new_index, new_items, n );
     return RV_SUCCESS;
 }
 
 
 int set_difference( const Set *set, const Set *sub, Set **result )
 {
+    if ( *result == NULL && sub->n_items < set->n_items )
+    {
+        // copy `set` as it is, only the smaller `sub` is looked up
+        if ( ( *result = set_clone( set, set->n_items, set->allocator ) ) == NULL )
+            return f_stack_trace( RV_ERROR );
+        return set_subtract( *result, sub );
+    }
+
     if ( *result == NULL )
-        *result = set_init_cap( set->capacity );
+        *result = set_init_with( set_cap_for( set->n_items, SET_DEFAULT_MAX_LOAD ),
+                                 set->hash, set->seed, set->allocator );
+    else if ( set_reserve( *result, set_size( *result ) + set->n_items ) != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
     if ( *result == NULL )
         return RV_ERROR;
 
-    for ( size_t i = 0; i < set->capacity; ++i )
+    for ( size_t i = 0; i < set_n_used( set ); ++i )
     {
         const struct set_item *item = set->items + i;
-        if ( item->data == NULL )
+        if ( item->data == NULL || set_search_item( sub, set, item ) )
             continue;
 
-        if ( set_search_item( sub, item ) )
-            continue;
-
-        if ( set_insert_item( *result, item ) == RV_ERROR )
+        if ( set_insert_item( *result, set, item ) == RV_ERROR )
             return RV_ERROR;
     }
 
@@ -364,7 +1292,34 @@ int set_difference( const Set *set, const Set *sub, Set **result )
 
 int set_subtract( Set *set, const Set *sub )
 {
-    return set_remove_array( set, sub->capacity, sub->items );
+    if ( sub->n_items < set->n_items )
+    {
+        // look up the items of `sub`
+        for ( size_t i = 0; i < set_n_used( sub ); ++i )
+        {
+            const struct set_item *item = sub->items + i;
+            if ( item->data == NULL )
+                continue;
+
+            size_t slot;
+            if ( set_find( set, item->data, item->size,
+                           set_item_hash_in( set, sub, item ), &slot )
+                 != NULL )
+                set_remove_at( set, slot );
+        }
+    }
+    else
+    {
+        // look up the items of `set` (which may be `sub` itself)
+        for ( size_t i = 0; i < set_n_used( set ); ++i )
+        {
+            const struct set_item *item = set->items + i;
+            if ( item->data != NULL && set_search_item( sub, set, item ) )
+                set_remove_at( set, set_slot_of( set, i ) );
+        }
+    }
+
+    return set_shrink( set );
 }
 
 
@@ -374,14 +1329,12 @@ int set_cmp( const Set *set_1, const Set *set_2 )
     if ( cmp != 0 )
         return cmp;
 
-    for ( size_t i = 0; i < set_1->capacity; ++i )
+    // same size => equal iff every item of `set_1` is also in `set_2`
+    for ( size_t i = 0; i < set_n_used( set_1 ); ++i )
     {
-        const struct set_item *item_1 = set_1->items + i;
-        const struct set_item *item_2 = set_2->items + i;
-        if ( !set_search_item( set_2, item_1 ) )
+        const struct set_item *item = set_1->items + i;
+        if ( item->data != NULL && !set_search_item( set_2, set_1, item ) )
             return 1;
-        if ( !set_search_item( set_1, item_2 ) )
-            return -1;
     }
 
     return 0;
@@ -390,39 +1343,101 @@ int set_cmp( const Set *set_1, const Set *set_2 )
 
 Set *set_from_list( const List *list )
 {
-    Set *const new_set = set_init_cap( list_size( list ) );
-    if ( new_set == NULL )
+    return set_from_array( list_items( list ), list_size( list ), list_el_size( list ) );
+}
+
+
+void set_destroy( Set *set )
+{
+    for ( size_t i = 0; i < set_n_used( set ); ++i )
+        if ( set->items[ i ].data != NULL )
+            set_item_free( set, set->items + i );
+    allocator_free( set->allocator, set->index, set_index_bytes( set->capacity ) );
+    allocator_free( set->allocator, set->items,
+                    set->max_used * sizeof( struct set_item ) );
+    allocator_free( set->allocator, set, sizeof( Set ) );
+}
+
+
+int set_save( const Set *set, FILE *file )
+{
+    SerialWriter *writer = serial__writer_open(
+            file, SERIAL_SET, 0, set->hash, set->seed, 0, set->n_items );
+    if ( writer == NULL )
+        return f_stack_trace( RV_ERROR );
+
+    int rv = RV_SUCCESS;
+    for ( size_t i = 0; i < set_n_used( set ) && rv == RV_SUCCESS; ++i )
+    {
+        const struct set_item *item = set->items + i;
+        if ( item->data != NULL )
+            rv = serial__write_hashed(
+                    writer, item->hash, item->data, item->size, NULL, 0 );
+    }
+
+    if ( serial_writer_close( writer ) != RV_SUCCESS || rv != RV_SUCCESS )
+        return f_stack_trace( RV_ERROR );
+
+    return RV_SUCCESS;
+}
+
+Set *set_load( FILE *file, HashFunction hash )
+{
+    SerialReader *reader = serial_reader_open( file );
+    if ( reader == NULL )
         return f_stack_trace( NULL );
 
-    const size_t el_size = list_el_size( list );
-    for ( size_t i = 0; i < list_size( list ); ++i )
+    Set *set = NULL;
+    if ( serial_reader_kind( reader ) != SERIAL_SET )
+    {
+        fwarnx( "not a Set" );
+        goto ERROR;
+    }
+
+    const size_t count = serial_reader_count_hint( reader );
+    if ( count > SIZE_MAX / 4 / sizeof( struct set_item ) )
     {
-        const void *const data = list_see( list, i );
+        fwarnx( "invalid number of items: %zu", count );
+        goto ERROR;
+    }
 
-        switch ( set_insert( new_set, data, el_size ) )
+    // large enough for all the items, so the table never grows
+    set = set_init_with( set_cap_for( count, SET_DEFAULT_MAX_LOAD ),
+                         hash != NULL ? hash : hash_bytes,
+                         serial__reader_seed( reader ),
+                         allocator_default() );
+    if ( set == NULL )
+        goto ERROR;
+
+    uint64_t item_hash;
+    const void *data;
+    size_t len;
+    int rv;
+    while ( ( rv = serial__read_hashed( reader, &item_hash, &data, &len, NULL, NULL ) )
+            == 1 )
+    {
+        if ( set->n_items == 0 && set_hash( set, data, len ) != item_hash )
         {
-            case SETINSERT_WAS_IN:
-                // fflwarnx( "Actually found a collision in a set!" );
-            case SETINSERT_INSERTED:
-                // don't care
-                break;
-
-            case RV_ERROR:
-            case RV_EXCEPTION:
-                return f_stack_trace( NULL );
+            fwarnx( "the set was saved with a different hash function" );
+            goto ERROR;
         }
-    }
 
-    return new_set;
-}
+        if ( set_insert_hashed(
+                     set, data, len, item_hash, ITEM_PRINT_FUNCTION_NAME( byte ) )
+             == RV_ERROR )
+            goto ERROR;
+    }
+    if ( rv != 0 )
+        goto ERROR;
 
+    serial_reader_close( reader );
+    return set;
 
-void set_destroy( Set *set )
-{
-    for ( size_t i = 0; i < set->capacity; ++i )
-        free( set->items[ i ].data );
-    free( set->items );
-    free( set );
+ERROR:
+    if ( set != NULL )
+        set_destroy( set );
+    serial_reader_close( reader );
+    return f_stack_trace( NULL );
 }
 
 
@@ -431,7 +1446,7 @@ void set_print_as( const Set *set, const PrintFunction func )
     printf( "hash_set (size=%zu): {", set->n_items );
 
     size_t n = 0;
-    for ( size_t i = 0; i < set->capacity; ++i )
+    for ( size_t i = 0; i < set_n_used( set ); ++i )
     {
         const struct set_item *item = set->items + i;
         if ( item->data == NULL )
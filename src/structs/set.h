@@ -7,32 +7,72 @@
  * Items can be of any type -- they are treated as arrays of bytes.
  * Their keys are a combination of the number of bytes and each byte of the data.
  *
+ * The items are kept in a dense array, in insertion order,
+ * and the hash table itself only holds their positions in it
+ * (32-bit ones, unless the table is larger than 2^31 slots).
+ * The table uses open addressing with linear probing over a power-of-two number
+ * of slots. Removed items leave a hole in the array and a tombstone in the table,
+ * both dropped whenever the table is rebuilt.
+ * The table grows once the fraction of used slots exceeds the max load factor
+ * (0.75 by default, see `set_set_max_load()`).
+ *
+ * Iterating (`set_get_next()`, `foreach_set`, printing, ...) walks the dense array,
+ * so it visits the items in the order they were inserted and costs O(`n_items`)
+ * (plus the holes), regardless of the capacity.
+ *
  * @param n_items   : `size_t`; number of currently held items in the Set
- * @param capacity  : `size_t`; size of items array
- * @param items     : `struct set_item *`; array of type set_item
+ * @param capacity  : `size_t`; number of slots of the table (always a power of two)
+ * @param items     : `struct set_item *`; dense array of the items
  */
 
 #ifndef CLIBS_SETS_H
 #define CLIBS_SETS_H
 
+#include "../allocator.h"            /* Allocator */
+#include "../headers/hash.h"         /* HashFunction */
 #include "../headers/types.h"        /* stddef, stdint, stdbool */
 #include "../item_print_functions.h" /* PrintFunction */
+#include "../thread_pool.h"          /* ThreadPool */
+
+#include <stdio.h> /* FILE */
 
 
 struct hash_set;
 typedef struct hash_set Set;
 
 
+#ifndef SET_INLINE_SIZE
+/**
+ * Items of at most this many bytes are stored inline, in their slot,
+ * larger ones are copied to the heap.
+ *
+ * This may be redefined, but the library must be compiled with the same value.
+ */
+#define SET_INLINE_SIZE 16
+#endif //SET_INLINE_SIZE
+
 /**
  * `func` is set to `print_byte()` by default
+ *
+ * `hash` caches the hash of the data (as computed by the owning `Set`),
+ * so probing and resizing
+ * never need to rehash (or `memcmp` against) items with a different hash.
+ *
+ * `data` points either to `inline_data` (items of up to `SET_INLINE_SIZE` bytes)
+ * or to a heap copy. Either way it is only valid until the set is modified.
+ *
+ * `removed` marks a hole left in the items array by a removed item.
  */
 struct set_item {
     void *data;
     size_t size;
+    uint64_t hash;
 
     bool removed;
 
     PrintFunction func;
+
+    byte inline_data[ SET_INLINE_SIZE ];
 };
 
 
@@ -56,10 +96,50 @@ Constructor Set *set_init( void );
 /**
  * Initializes a `Set` with a custom capacity.
  *
- * @param capacity initial capacity
+ * @param capacity initial capacity (rounded up to a power of two)
  * @return pointer to a new `Set`
  */
 Constructor Set *set_init_cap( size_t capacity );
+/**
+ * Initializes a `Set` with a custom capacity and hash function.
+ *
+ * @param capacity  initial capacity (rounded up to a power of two)
+ * @param hash      hash function; `NULL` means the default (`hash_bytes()`)
+ * @param seed      passed to every `hash` call;
+ *                  use `hash_random_seed()` if the items come from untrusted input
+ * @return pointer to a new `Set`
+ */
+Constructor Set *set_init_with_hash( size_t capacity, HashFunction hash, uint64_t seed );
+/**
+ * Initializes a `Set` which allocates its table and items from `allocator`
+ * (see `allocator.h`).
+ *
+ * Sets derived from it (e.g. by `set_union()`) use the same allocator.
+ *
+ * @param allocator must outlive the set; `NULL` for `allocator_default()`
+ * @return pointer to a new `Set`
+ */
+Constructor Set *set_init_with_allocator( const Allocator *allocator );
+
+/**
+ * Sets the maximum load factor of the set
+ * (fraction of slots that may be used before the table grows).
+ *
+ * The table is rebuilt right away if it is already over the new limit.
+ *
+ * @param max_load value in the range (0, 1)
+ * @return `RV_EXCEPTION` if `max_load` is out of range, `RV_ERROR` on alloc failure,
+ * else `RV_SUCCESS`
+ */
+int set_set_max_load( Set *, double max_load );
+
+/**
+ * Makes room for `n_items` items in total,
+ * so that inserting up to that many never grows the table.
+ *
+ * @return `RV_ERROR` on alloc failure, else `RV_SUCCESS`
+ */
+int set_reserve( Set *, size_t n_items );
 
 /**
  * Inserts a value into the set.
@@ -79,6 +159,46 @@ int set_insert_f( Set *, const void *data, size_t len, PrintFunction func );
  */
 int set_insert( Set *, const void *data, size_t len );
 
+/**
+ * Inserts `n` items of `el_size` bytes (an array) into the set,
+ * like `set_insert()` one by one.
+ *
+ * Room is made for all of them up front (as if none were in the set yet)
+ * and they are hashed a batch at a time, ahead of being looked up,
+ * so that their lookups overlap.
+ *
+ * @param items array of `n` items
+ * @return `RV_ERROR` on alloc failure (some of the items may be inserted),
+ *         else `RV_SUCCESS`
+ */
+int set_insert_many( Set *, const void *items, size_t n, size_t el_size );
+/**
+ * `set_insert_many()` on the workers of `pool` (and the calling thread).
+ *
+ * Into an empty set, a large array is built in parallel:
+ * the items are hashed and grouped by the region of the table they hash into,
+ * each region is filled by one task and the items are then copied
+ * into the set, in order.
+ * The result is the same as that of `set_insert_many()`.
+ * Otherwise (or if `pool` is `NULL`) this is `set_insert_many()`.
+ *
+ * Items larger than `SET_INLINE_SIZE` are copied by the calling thread only,
+ * since the allocator of the set may not be thread-safe.
+ *
+ * @return `RV_ERROR` on alloc failure, else `RV_SUCCESS`
+ */
+int set_insert_many_parallel( Set *,
+                              const void *items,
+                              size_t n,
+                              size_t el_size,
+                              ThreadPool *pool );
+/**
+ * Creates a set of the `n` items of `el_size` bytes (see `set_insert_many()`).
+ *
+ * @return pointer to a new `Set`, or `NULL` on alloc failure
+ */
+Constructor Set *set_from_array( const void *items, size_t n, size_t el_size );
+
 /**
  * Removes a value from the set.
  *
@@ -97,6 +217,18 @@ int set_remove( Set *, const void *data, size_t len );
  */
 bool set_search( const Set *, const void *data, size_t len );
 
+/*
+ * Set algebra.
+ *
+ * Each operation iterates over the smaller of the two sets where it can,
+ * and looks its items up in the other one.
+ * The cached hashes are reused if both sets hash the same way
+ * (see `set_init_with_hash()`), and new sets are allocated at their final size.
+ *
+ * The items keep their relative order; a new union starts with the items
+ * of the larger set (the first one, if the sets differ in how they hash).
+ */
+
 /**
  * Creates an intersection of the two sets and shallowly copies the data to
  * a new set, stored under `result`
@@ -111,7 +243,7 @@ int set_intersection( const Set *, const Set *, Set **result );
  * Leaves the set with only the items which are in `intr`.
  *
  * @param intr  Second set
- * @return `RV_ERROR` if `set_remove_item()` fails
+ * @return `RV_ERROR` on alloc failure, else `RV_SUCCESS`
  */
 int set_intersect( Set *, const Set *intr );
 
@@ -129,6 +261,18 @@ int set_union( const Set *, const Set *, Set **result );
  * @return `RV_ERROR` on fatal error
  */
 int set_unionize( Set *, const Set *add );
+/**
+ * Moves all items from `add` to the set and destroys `add`.
+ *
+ * Nothing is copied if both sets use the same allocator
+ * (the larger table is kept, so it is the smaller set that's iterated).
+ *
+ * @param add   `Set` to be consumed; on error, it keeps the items not moved yet
+ *              (and must still be destroyed)
+ * @return `RV_EXCEPTION` if `add` is the set itself, `RV_ERROR` on alloc failure,
+ *         else `RV_SUCCESS`
+ */
+int set_absorb( Set *, Set *add );
 
 /**
  * Creates a new `Set *` (saved into `result`)
@@ -162,6 +306,29 @@ int set_cmp( const Set *, const Set * );
 void set_destroy( Set * );
 
 
+/**
+ * Writes the set to `file` in the binary format of `serialize.h`,
+ * along with its seed and the hashes of its items.
+ *
+ * The print functions of the items aren't saved.
+ *
+ * @return `RV_ERROR` if writing fails, else `RV_SUCCESS`
+ */
+int set_save( const Set *, FILE *file );
+/**
+ * Reads a set written by `set_save()` (or a `SerialWriter` of a Set).
+ *
+ * The saved hashes are used as they are, so nothing is hashed
+ * and the table is allocated at its final size right away.
+ *
+ * @param hash  the hash function the set was saved with (`NULL` for `hash_bytes()`);
+ *              the hash of the first item is checked against it
+ * @return pointer to a new `Set`, or `NULL` if the file is invalid or corrupt
+ *         (or of a different hash function), or if reading or allocation fails
+ */
+Constructor Set *set_load( FILE *file, HashFunction hash );
+
+
 #if defined( CLIBS_DYNAMIC_ARRAY_H ) || defined( CLIBS_STRUCT_CONVERSIONS )
 #include "dynarr.h"
 UseResult Set *set_from_list( const List *list );
@@ -169,7 +336,7 @@ UseResult Set *set_from_list( const List *list );
 
 
 /// @return number of items in the set
-Const size_t set_size( const Set *set );
+size_t set_size( const Set *set );
 
 
 typedef struct {
@@ -177,9 +344,12 @@ typedef struct {
     int64_t index;
 } SetEnumeratedEntry;
 /**
- * Iterator over set.
+ * Iterator over set, in insertion order.
+ *
+ * `index` is the position of the item in the items array;
+ * it stays valid until the set is modified.
  *
- * @param index_last index of the last iterated element
+ * @param index_last index of the last iterated element (-1 to start)
  * @return SetEnumeratedEntry (tuple of item* and index)
  */
 SetEnumeratedEntry set_get_next( const Set *, int64_t index_last );
@@ -0,0 +1,536 @@
+#include "thread_pool.h"
+
+#include "headers/atomics.h"
+#include "headers/errors.h"
+#include "headers/simple_math.h" /* min_m */
+#include "structs/concurrent_queue.h"
+
+#include <pthread.h>
+#include <sched.h>  /* sched_yield */
+#include <stdlib.h> /* alloc */
+#include <string.h> /* strerror */
+#include <unistd.h> /* sysconf */
+
+
+/** Capacity of the queue of the tasks submitted from outside the pool */
+#define THREAD_POOL_INJECT_CAP 1024
+/** Initial capacity of a worker's deque; doubled when full */
+#define THREAD_POOL_DEQUE_CAP 64
+/** Rounds of looking for a task (yielding the CPU in between) before going to sleep */
+#define THREAD_POOL_SPINS 64
+/** `thread_pool_parallel_for()` splits the range into this many per worker by default */
+#define THREAD_POOL_RANGES_PER_WORKER 4
+
+
+struct thread_pool_task {
+    void *( *func )( void * );
+    void *arg;
+    void *result;
+    ThreadPool *pool;
+    int done; // atomic
+};
+
+
+/* -------- Chase-Lev deque -------- */
+
+/*
+ * D. Chase, Y. Lev: Dynamic Circular Work-Stealing Deque (2005);
+ * memory orders after N. M. Lê et al.: Correct and Efficient Work-Stealing
+ * for Weak Memory Models (2013), with the two fences replaced
+ * by sequentially consistent accesses.
+ *
+ * The owner pushes and takes at `bottom`, the thieves steal at `top`.
+ * Arrays outgrown by the deque may still be read by a thief,
+ * so they are only freed along with the deque.
+ */
+
+struct ws_array {
+    size_t capacity;       // power of two
+    struct ws_array *prev; // the outgrown one
+    struct thread_pool_task *items[];
+};
+
+struct ws_deque {
+    int64_t top; // atomic
+    byte pad_top[ CLIBS_CACHE_LINE - sizeof( int64_t ) ];
+    int64_t bottom;         // atomic; written only by the owner
+    struct ws_array *array; // atomic; written only by the owner
+    byte pad_bottom[ CLIBS_CACHE_LINE - sizeof( int64_t ) - sizeof( void * ) ];
+};
+
+Private struct ws_array *ws_array_init( const size_t capacity )
+{
+    struct ws_array *array =
+            malloc( sizeof( struct ws_array ) + capacity * sizeof( array->items[ 0 ] ) );
+    if ( array == NULL )
+        return fwarn_ret( NULL, "malloc" );
+
+    array->capacity = capacity;
+    array->prev     = NULL;
+    return array;
+}
+
+Private int ws_init( struct ws_deque *deque )
+{
+    deque->top    = 0;
+    deque->bottom = 0;
+    deque->array  = ws_array_init( THREAD_POOL_DEQUE_CAP );
+    return deque->array == NULL ? RV_ERROR : RV_SUCCESS;
+}
+
+Private void ws_destroy( struct ws_deque *deque )
+{
+    struct ws_array *array = deque->array;
+    while ( array != NULL )
+    {
+        struct ws_array *prev = array->prev;
+        free( array );
+        array = prev;
+    }
+}
+
+Private inline struct thread_pool_task **ws_slot( struct ws_array *array,
+                                                  const int64_t index )
+{
+    return array->items + ( ( size_t ) index & ( array->capacity - 1 ) );
+}
+
+/** Owner only */
+Private struct ws_array *ws_grow( struct ws_deque *deque,
+                                  struct ws_array *array,
+                                  const int64_t top,
+                                  const int64_t bottom )
+{
+    struct ws_array *bigger = ws_array_init( 2 * array->capacity );
+    if ( bigger == NULL )
+        return NULL;
+
+    for ( int64_t i = top; i < bottom; ++i )
+        *ws_slot( bigger, i ) = atomic_load_relaxed( ws_slot( array, i ) );
+    bigger->prev = array;
+
+    atomic_store_release( &deque->array, bigger );
+    return bigger;
+}
+
+/** Owner only */
+Private int ws_push( struct ws_deque *deque, struct thread_pool_task *task )
+{
+    const int64_t bottom   = atomic_load_relaxed( &deque->bottom );
+    const int64_t top      = atomic_load_acquire( &deque->top );
+    struct ws_array *array = atomic_load_relaxed( &deque->array );
+
+    if ( bottom - top >= ( int64_t ) array->capacity
+         && ( array = ws_grow( deque, array, top, bottom ) ) == NULL )
+        return RV_ERROR;
+
+    atomic_store_relaxed( ws_slot( array, bottom ), task );
+    atomic_store_release( &deque->bottom, bottom + 1 );
+    return RV_SUCCESS;
+}
+
+/** Owner only; @return the newest task, or `NULL` if empty */
+Private struct thread_pool_task *ws_take( struct ws_deque *deque )
+{
+    const int64_t bottom   = atomic_load_relaxed( &deque->bottom ) - 1;
+    struct ws_array *array = atomic_load_relaxed( &deque->array );
+    atomic_store_seq_cst( &deque->bottom, bottom );
+    int64_t top = atomic_load_seq_cst( &deque->top );
+
+    if ( top > bottom )
+    {
+        atomic_store_relaxed( &deque->bottom, bottom + 1 );
+        return NULL;
+    }
+
+    struct thread_pool_task *task = atomic_load_relaxed( ws_slot( array, bottom ) );
+    if ( top == bottom )
+    {
+        // the last one; race the thieves for it
+        if ( !atomic_cas_seq_cst( &deque->top, &top, top + 1 ) )
+            task = NULL;
+        atomic_store_relaxed( &deque->bottom, bottom + 1 );
+    }
+    return task;
+}
+
+/** @return the oldest task, or `NULL` if empty (or another thread got it first) */
+Private struct thread_pool_task *ws_steal( struct ws_deque *deque )
+{
+    int64_t top          = atomic_load_seq_cst( &deque->top );
+    const int64_t bottom = atomic_load_seq_cst( &deque->bottom );
+    if ( top >= bottom )
+        return NULL;
+
+    struct ws_array *array        = atomic_load_acquire( &deque->array );
+    struct thread_pool_task *task = atomic_load_relaxed( ws_slot( array, top ) );
+    if ( !atomic_cas_seq_cst( &deque->top, &top, top + 1 ) )
+        return NULL;
+    return task;
+}
+
+
+/* -------- pool -------- */
+
+struct worker {
+    struct ws_deque deque;
+    ThreadPool *pool;
+    pthread_t thread;
+    size_t index;
+};
+
+struct thread_pool {
+    struct worker *workers;
+    size_t n_workers;
+
+    MpmcQueue *injected; // `ThreadPoolFuture *`s submitted from outside the pool
+    pthread_key_t self;  // the `struct worker` of the current thread
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;     // sleeping workers
+    pthread_cond_t finished; // threads outside the pool waiting on a future
+    bool stopping;           // under `lock`
+
+    size_t n_queued;   // atomic; tasks submitted and not yet taken
+    size_t n_sleeping; // atomic; workers waiting on `wake`
+    size_t n_waiting;  // atomic; threads waiting on `finished`
+};
+
+
+/**
+ * Pops a task from the deque of `self` (`NULL` outside the pool),
+ * then from the shared queue, then tries to steal one.
+ */
+Private struct thread_pool_task *pool_find_task( ThreadPool *pool, struct worker *self )
+{
+    struct thread_pool_task *task = NULL;
+
+    if ( self != NULL )
+        task = ws_take( &self->deque );
+
+    if ( task == NULL )
+        mpmc_queue_try_dequeue( pool->injected, &task );
+
+    // start with the next worker, so that the thieves spread out
+    const size_t start = self == NULL ? 0 : self->index + 1;
+    for ( size_t i = 0; task == NULL && i < pool->n_workers; ++i )
+    {
+        struct worker *victim = pool->workers + ( start + i ) % pool->n_workers;
+        if ( victim != self )
+            task = ws_steal( &victim->deque );
+    }
+
+    if ( task != NULL )
+        atomic_sub_seq_cst( &pool->n_queued, 1 );
+    return task;
+}
+
+Private void pool_run_task( ThreadPool *pool, struct thread_pool_task *task )
+{
+    task->result = task->func( task->arg );
+    atomic_store_seq_cst( &task->done, 1 );
+
+    if ( atomic_load_seq_cst( &pool->n_waiting ) > 0 )
+    {
+        pthread_mutex_lock( &pool->lock );
+        pthread_cond_broadcast( &pool->finished );
+        pthread_mutex_unlock( &pool->lock );
+    }
+}
+
+Private void *pool_worker_main( void *arg )
+{
+    struct worker *self = arg;
+    ThreadPool *pool    = self->pool;
+    pthread_setspecific( pool->self, self );
+
+    unsigned idle = 0;
+    while ( true )
+    {
+        struct thread_pool_task *task = pool_find_task( pool, self );
+        if ( task != NULL )
+        {
+            pool_run_task( pool, task );
+            idle = 0;
+            continue;
+        }
+
+        if ( ++idle < THREAD_POOL_SPINS )
+        {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock( &pool->lock );
+        atomic_add_seq_cst( &pool->n_sleeping, 1 );
+        while ( atomic_load_seq_cst( &pool->n_queued ) == 0 && !pool->stopping )
+            pthread_cond_wait( &pool->wake, &pool->lock );
+        atomic_sub_seq_cst( &pool->n_sleeping, 1 );
+        const bool stop = pool->stopping && atomic_load_seq_cst( &pool->n_queued ) == 0;
+        pthread_mutex_unlock( &pool->lock );
+
+        if ( stop )
+            return NULL;
+        idle = 0;
+    }
+}
+
+/** Stops and joins the first `n_started` workers, frees everything */
+Private void pool_shutdown( ThreadPool *pool, const size_t n_started )
+{
+    pthread_mutex_lock( &pool->lock );
+    pool->stopping = true;
+    pthread_cond_broadcast( &pool->wake );
+    pthread_mutex_unlock( &pool->lock );
+
+    for ( size_t i = 0; i < n_started; ++i )
+        pthread_join( pool->workers[ i ].thread, NULL );
+
+    for ( size_t i = 0; i < pool->n_workers; ++i )
+        ws_destroy( &pool->workers[ i ].deque );
+    mpmc_queue_destroy( pool->injected );
+    pthread_key_delete( pool->self );
+    pthread_cond_destroy( &pool->finished );
+    pthread_cond_destroy( &pool->wake );
+    pthread_mutex_destroy( &pool->lock );
+    free( pool->workers );
+    free( pool );
+}
+
+ThreadPool *thread_pool_init( size_t n_threads )
+{
+    if ( n_threads == 0 )
+    {
+        const long n_cpus = sysconf( _SC_NPROCESSORS_ONLN );
+        n_threads         = n_cpus < 1 ? 1 : ( size_t ) n_cpus;
+    }
+
+    ThreadPool *pool = calloc( 1, sizeof( ThreadPool ) );
+    if ( pool == NULL )
+        return fwarn_ret( NULL, "calloc" );
+
+    pool->n_workers = n_threads;
+    pool->workers   = calloc( n_threads, sizeof( struct worker ) );
+    pool->injected =
+            mpmc_queue_init( sizeof( ThreadPoolFuture * ), THREAD_POOL_INJECT_CAP );
+    if ( pool->workers == NULL || pool->injected == NULL )
+    {
+        if ( pool->injected != NULL )
+            mpmc_queue_destroy( pool->injected );
+        free( pool->workers );
+        free( pool );
+        return fwarn_ret( NULL, "alloc" );
+    }
+
+    pthread_mutex_init( &pool->lock, NULL );
+    pthread_cond_init( &pool->wake, NULL );
+    pthread_cond_init( &pool->finished, NULL );
+    pthread_key_create( &pool->self, NULL );
+
+    // deques first: every worker may steal from any other
+    for ( size_t i = 0; i < n_threads; ++i )
+    {
+        pool->workers[ i ].pool  = pool;
+        pool->workers[ i ].index = i;
+        if ( ws_init( &pool->workers[ i ].deque ) != RV_SUCCESS )
+        {
+            pool_shutdown( pool, 0 );
+            return f_stack_trace( NULL );
+        }
+    }
+
+    for ( size_t i = 0; i < n_threads; ++i )
+    {
+        const int rv = pthread_create(
+                &pool->workers[ i ].thread, NULL, pool_worker_main, pool->workers + i );
+        if ( rv != 0 )
+        {
+            pool_shutdown( pool, i );
+            return fwarnx_ret( NULL, "pthread_create: %s", strerror( rv ) );
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy( ThreadPool *pool )
+{
+    pool_shutdown( pool, pool->n_workers );
+}
+
+size_t thread_pool_size( const ThreadPool *pool )
+{
+    return pool->n_workers;
+}
+
+
+/* -------- tasks -------- */
+
+ThreadPoolFuture *thread_pool_submit( ThreadPool *pool,
+                                      void *( *func )( void *arg ),
+                                      void *arg )
+{
+    struct thread_pool_task *task = malloc( sizeof( struct thread_pool_task ) );
+    if ( task == NULL )
+        return fwarn_ret( NULL, "malloc" );
+
+    *task = ( struct thread_pool_task ) {
+        .func = func,
+        .arg  = arg,
+        .pool = pool,
+        .done = 0,
+    };
+
+    // counted before it can be taken (and the count decremented)
+    atomic_add_seq_cst( &pool->n_queued, 1 );
+
+    struct worker *self = pthread_getspecific( pool->self );
+    if ( self != NULL )
+    {
+        if ( ws_push( &self->deque, task ) != RV_SUCCESS )
+        {
+            atomic_sub_seq_cst( &pool->n_queued, 1 );
+            free( task );
+            return f_stack_trace( NULL );
+        }
+    }
+    else
+        mpmc_queue_enqueue( pool->injected, &task ); // waits while full
+
+    if ( atomic_load_seq_cst( &pool->n_sleeping ) > 0 )
+    {
+        pthread_mutex_lock( &pool->lock );
+        pthread_cond_signal( &pool->wake );
+        pthread_mutex_unlock( &pool->lock );
+    }
+
+    return task;
+}
+
+bool thread_pool_future_is_done( const ThreadPoolFuture *future )
+{
+    return atomic_load_acquire( &future->done ) != 0;
+}
+
+/** Runs other tasks, then sleeps (outside the pool) until `future` is done */
+Private void pool_wait_for( const ThreadPoolFuture *future )
+{
+    ThreadPool *pool    = future->pool;
+    struct worker *self = pthread_getspecific( pool->self );
+
+    unsigned idle = 0;
+    while ( !thread_pool_future_is_done( future ) )
+    {
+        struct thread_pool_task *task = pool_find_task( pool, self );
+        if ( task != NULL )
+        {
+            pool_run_task( pool, task );
+            idle = 0;
+        }
+        // a worker keeps helping; a thread outside the pool goes to sleep eventually
+        else if ( self != NULL || ++idle < THREAD_POOL_SPINS )
+            sched_yield();
+        else
+        {
+            pthread_mutex_lock( &pool->lock );
+            atomic_add_seq_cst( &pool->n_waiting, 1 );
+            while ( atomic_load_seq_cst( &future->done ) == 0 )
+                pthread_cond_wait( &pool->finished, &pool->lock );
+            atomic_sub_seq_cst( &pool->n_waiting, 1 );
+            pthread_mutex_unlock( &pool->lock );
+        }
+    }
+}
+
+void *thread_pool_future_wait( ThreadPoolFuture *future )
+{
+    // the pool may be gone already if the task is done
+    if ( !thread_pool_future_is_done( future ) )
+        pool_wait_for( future );
+
+    void *result = future->result;
+    free( future );
+    return result;
+}
+
+
+/* -------- parallel for -------- */
+
+struct parallel_for {
+    size_t begin;
+    size_t end;
+    size_t grain;
+    size_t n_ranges;
+    size_t next_range; // atomic
+
+    void ( *body )( size_t from, size_t to, void *arg );
+    void *arg;
+};
+
+Private void *parallel_for_ranges( void *arg )
+{
+    struct parallel_for *job = arg;
+
+    size_t range;
+    while ( ( range = atomic_add_relaxed( &job->next_range, 1 ) ) < job->n_ranges )
+    {
+        const size_t from = job->begin + range * job->grain;
+        job->body( from, min_m( from + job->grain, job->end ), job->arg );
+    }
+    return NULL;
+}
+
+int thread_pool_parallel_for( ThreadPool *pool,
+                              const size_t begin,
+                              const size_t end,
+                              size_t grain,
+                              void ( *body )( size_t from, size_t to, void *arg ),
+                              void *arg )
+{
+    if ( end <= begin )
+        return RV_SUCCESS;
+
+    const size_t n = end - begin;
+    if ( grain == 0 )
+        grain = n / ( THREAD_POOL_RANGES_PER_WORKER * pool->n_workers );
+    if ( grain == 0 )
+        grain = 1;
+
+    struct parallel_for job = {
+        .begin      = begin,
+        .end        = end,
+        .grain      = grain,
+        .n_ranges   = n / grain + ( n % grain != 0 ),
+        .next_range = 0,
+        .body       = body,
+        .arg        = arg,
+    };
+
+    // the calling thread takes part
+    const size_t n_helpers = min_m( pool->n_workers, job.n_ranges - 1 );
+    if ( n_helpers == 0 )
+    {
+        parallel_for_ranges( &job );
+        return RV_SUCCESS;
+    }
+
+    ThreadPoolFuture **helpers = malloc( n_helpers * sizeof( ThreadPoolFuture * ) );
+    if ( helpers == NULL )
+        return fwarn_ret( RV_ERROR, "malloc" );
+
+    // if a helper can't be submitted, the others do its share
+    size_t n_submitted = 0;
+    while ( n_submitted < n_helpers
+            && ( helpers[ n_submitted ] =
+                         thread_pool_submit( pool, parallel_for_ranges, &job ) )
+                       != NULL )
+        ++n_submitted;
+
+    parallel_for_ranges( &job );
+
+    for ( size_t i = 0; i < n_submitted; ++i )
+        thread_pool_future_wait( helpers[ i ] );
+
+    free( helpers );
+    return RV_SUCCESS;
+}
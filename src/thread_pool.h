@@ -0,0 +1,91 @@
+/**
+ * @file thread_pool.h
+ * @brief A work-stealing pool of worker threads.
+ *
+ * Every worker owns a Chase-Lev deque: tasks submitted by a worker
+ * (e.g. from inside another task) are pushed to and popped from the bottom
+ * of its own deque, LIFO, while idle workers steal the oldest tasks from the top
+ * of the others'. Tasks submitted from outside the pool go through a shared
+ * `MpmcQueue` (see concurrent_queue.h).
+ * Workers that find nothing to do sleep until a task is submitted.
+ *
+ * `thread_pool_submit()` returns a future, which must be waited on
+ * (which also frees it) with `thread_pool_future_wait()`.
+ * A thread waiting on a future runs other tasks of the pool meanwhile,
+ * so tasks may submit and wait on tasks of their own without deadlocking
+ * the pool.
+ *
+ * Apart from init and destroy, all functions are thread-safe.
+ */
+
+#ifndef CLIBS_THREAD_POOL_H
+#define CLIBS_THREAD_POOL_H
+
+#include "headers/attributes.h"
+#include "headers/types.h"
+
+#include <stdbool.h>
+
+
+typedef struct thread_pool ThreadPool;
+typedef struct thread_pool_task ThreadPoolFuture;
+
+
+/**
+ * Starts the worker threads.
+ *
+ * @param n_threads number of workers; 0 for one per online CPU
+ * @return pointer to a new pool, or `NULL` if allocation fails
+ *         or a thread can't be started
+ */
+Constructor ThreadPool *thread_pool_init( size_t n_threads );
+/**
+ * Graceful shutdown: runs all the tasks submitted so far, then joins the workers.
+ *
+ * Futures that haven't been waited on yet stay valid (and done).
+ * No task may be submitted once this is called.
+ */
+void thread_pool_destroy( ThreadPool * );
+
+/** @return number of worker threads */
+size_t thread_pool_size( const ThreadPool * );
+
+
+/**
+ * Schedules `func( arg )` to run on the pool.
+ *
+ * @return future of the task (see `thread_pool_future_wait()`),
+ *         or `NULL` if allocation fails (the task isn't run)
+ */
+Constructor ThreadPoolFuture *thread_pool_submit( ThreadPool *,
+                                                  void *( *func )( void *arg ),
+                                                  void *arg );
+
+/** @return whether the task has finished; never blocks */
+bool thread_pool_future_is_done( const ThreadPoolFuture * );
+/**
+ * Waits for the task to finish, running other tasks of the pool in the meantime.
+ * Destroys the future.
+ *
+ * @return the value returned by the task
+ */
+void *thread_pool_future_wait( ThreadPoolFuture * );
+
+
+/**
+ * Calls `body( from, to, arg )` for consecutive ranges of at most `grain` indices
+ * covering `[ begin, end )`, in parallel; returns once all of them are done.
+ * The calling thread takes part.
+ *
+ * @param grain 0 for about 4 ranges per worker
+ * @return `RV_ERROR` if allocation fails (no range is processed),
+ *         else `RV_SUCCESS`
+ */
+int thread_pool_parallel_for( ThreadPool *,
+                              size_t begin,
+                              size_t end,
+                              size_t grain,
+                              void ( *body )( size_t from, size_t to, void *arg ),
+                              void *arg );
+
+#endif //CLIBS_THREAD_POOL_H
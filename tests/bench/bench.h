@@ -0,0 +1,313 @@
+/*
+ * Tiny benchmark harness for `bench_clibs`.
+ *
+ * A benchmark case is a `setup` (not timed), a `run` (timed) and a `teardown`
+ * (not timed), repeated for problem sizes 10^k between the case's `min_size`
+ * and `max_size`.
+ *
+ * For every size, the case is first run `warmup` times, then it is repeated
+ * until it has run at least `min_reps` times and for at least `min_time_ms`
+ * (or `BENCH_MAX_REPS` times). Each repetition yields one ns/op sample
+ * (`run` time divided by `BenchState.ops`), of which the median, p99 and minimum
+ * are reported.
+ *
+ * bytes/op is the number of bytes requested from `BenchState.allocator`
+ * (which the cases pass to the containers) during `run`,
+ * plus whatever the case added to `BenchState.bytes` itself
+ * (e.g. the size of the strings returned by the string routines),
+ * divided by `BenchState.ops`.
+ *
+ * The results are printed to stdout as CSV or JSON, one row/object per case and size.
+ */
+
+#ifndef CLIBS_BENCH_H
+#define CLIBS_BENCH_H
+
+#include "../../src/allocator.h"
+#include "../../src/headers/errors.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define BENCH_MAX_REPS 1000
+
+#define BENCH_DEF_WARMUP      1
+#define BENCH_DEF_MIN_REPS    5
+#define BENCH_DEF_MIN_TIME_MS 100
+#define BENCH_DEF_MAX_SIZE    10000000
+
+
+typedef struct bench_state {
+    size_t size;                // problem size
+    size_t ops;                 // operations done by one `run`; `size` by default
+    void *data;                 // owned by the case
+    const Allocator *allocator; // counts the bytes allocated through it
+    size_t bytes;               // bytes allocated in `run` (added to by the allocator)
+} BenchState;
+
+typedef struct bench_case {
+    const char *name;
+    size_t min_size;
+    size_t max_size;
+
+    void ( *setup )( BenchState * );    // may be NULL
+    void ( *run )( BenchState * );      // timed
+    void ( *teardown )( BenchState * ); // may be NULL
+} BenchCase;
+
+typedef enum {
+    BENCH_FORMAT_CSV,
+    BENCH_FORMAT_JSON,
+} BenchFormat;
+
+typedef struct bench_options {
+    BenchFormat format;
+    const char *filter; // only run cases whose name contains this; NULL for all
+    size_t warmup;
+    size_t min_reps;
+    size_t min_time_ms;
+    size_t max_size; // cap for all cases
+
+    size_t n_printed; // results printed so far
+} BenchOptions;
+
+
+LibraryDefined uint64_t bench_now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000 + ( uint64_t ) ts.tv_nsec;
+}
+
+/** xorshift64*; deterministic, so that the runs are comparable */
+LibraryDefined uint64_t bench_rand( void )
+{
+    static uint64_t state = 0x2545F4914F6CDD1DULL;
+
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+
+/* -------- COUNTING ALLOCATOR -------- */
+
+LibraryDefined void *bench_alloc( void *ctx, const size_t size )
+{
+    *( size_t * ) ctx += size;
+    return malloc( size );
+}
+
+LibraryDefined void *bench_resize( void *ctx,
+                                   void *ptr,
+                                   const size_t old_size,
+                                   const size_t new_size )
+{
+    if ( new_size > old_size )
+        *( size_t * ) ctx += new_size;
+    return realloc( ptr, new_size );
+}
+
+LibraryDefined void bench_free( void *ctx, void *ptr, const size_t size )
+{
+    ( void ) ctx;
+    ( void ) size;
+    free( ptr );
+}
+
+
+/* -------- OPTIONS -------- */
+
+LibraryDefined size_t bench_parse_count( const char *arg,
+                                         const char *value,
+                                         const size_t min )
+{
+    char *end;
+    const double n = strtod( value, &end ); // allows "1e6"
+    if ( end == value || *end != '\0' || n < ( double ) min )
+        errx( EXIT_FAILURE, "%s: invalid number: '%s'", arg, value );
+    return ( size_t ) n;
+}
+
+/** Exits on invalid arguments */
+LibraryDefined BenchOptions bench_parse_options( const int argc, char *const argv[] )
+{
+    BenchOptions opts = {
+        .format      = BENCH_FORMAT_CSV,
+        .filter      = NULL,
+        .warmup      = BENCH_DEF_WARMUP,
+        .min_reps    = BENCH_DEF_MIN_REPS,
+        .min_time_ms = BENCH_DEF_MIN_TIME_MS,
+        .max_size    = BENCH_DEF_MAX_SIZE,
+    };
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        const char *arg   = argv[ i ];
+        const char *value = strchr( arg, '=' );
+        value             = value == NULL ? "" : value + 1;
+
+        if ( strcmp( arg, "--format=csv" ) == 0 )
+            opts.format = BENCH_FORMAT_CSV;
+        else if ( strcmp( arg, "--format=json" ) == 0 )
+            opts.format = BENCH_FORMAT_JSON;
+        else if ( strncmp( arg, "--filter=", strlen( "--filter=" ) ) == 0 )
+            opts.filter = value;
+        else if ( strncmp( arg, "--warmup=", strlen( "--warmup=" ) ) == 0 )
+            opts.warmup = bench_parse_count( arg, value, 0 );
+        else if ( strncmp( arg, "--reps=", strlen( "--reps=" ) ) == 0 )
+            opts.min_reps = bench_parse_count( arg, value, 1 );
+        else if ( strncmp( arg, "--min-time-ms=", strlen( "--min-time-ms=" ) ) == 0 )
+            opts.min_time_ms = bench_parse_count( arg, value, 0 );
+        else if ( strncmp( arg, "--max-size=", strlen( "--max-size=" ) ) == 0 )
+            opts.max_size = bench_parse_count( arg, value, 1 );
+        else
+        {
+            fprintf( stderr,
+                     "usage: %s [--format=csv|json] [--filter=SUBSTRING] [--warmup=N]"
+                     " [--reps=N] [--min-time-ms=N] [--max-size=N]\n",
+                     argv[ 0 ] );
+            exit( EXIT_FAILURE );
+        }
+    }
+
+    if ( opts.min_reps > BENCH_MAX_REPS )
+        opts.min_reps = BENCH_MAX_REPS;
+
+    return opts;
+}
+
+
+/* -------- RUNNING -------- */
+
+LibraryDefined int bench_cmp_double( const void *a, const void *b )
+{
+    const double x = *( const double * ) a;
+    const double y = *( const double * ) b;
+    return ( x > y ) - ( x < y );
+}
+
+/** Nearest-rank percentile of sorted `samples` */
+LibraryDefined double bench_percentile( const double *samples,
+                                        const size_t n,
+                                        const double percentile )
+{
+    size_t rank = ( size_t ) ( percentile / 100 * ( double ) n + 0.999999 );
+    if ( rank == 0 )
+        rank = 1;
+    return samples[ rank - 1 ];
+}
+
+LibraryDefined void bench_begin( const BenchOptions *opts )
+{
+    if ( opts->format == BENCH_FORMAT_JSON )
+        printf( "[\n" );
+    else
+        printf( "name,size,reps,median_ns_per_op,p99_ns_per_op,min_ns_per_op,"
+                "bytes_per_op\n" );
+}
+
+LibraryDefined void bench_end( const BenchOptions *opts )
+{
+    if ( opts->format == BENCH_FORMAT_JSON )
+        printf( "%s]\n", opts->n_printed == 0 ? "" : "\n" );
+}
+
+LibraryDefined void bench_print( BenchOptions *opts,
+                                 const char *name,
+                                 const size_t size,
+                                 double *samples,
+                                 const size_t reps,
+                                 const double bytes_per_op )
+{
+    qsort( samples, reps, sizeof *samples, bench_cmp_double );
+    const double median = bench_percentile( samples, reps, 50 );
+    const double p99    = bench_percentile( samples, reps, 99 );
+
+    if ( opts->format == BENCH_FORMAT_JSON )
+        printf( "%s  {\"name\": \"%s\", \"size\": %zu, \"reps\": %zu, "
+                "\"median_ns_per_op\": %.3f, \"p99_ns_per_op\": %.3f, "
+                "\"min_ns_per_op\": %.3f, \"bytes_per_op\": %.3f}",
+                opts->n_printed == 0 ? "" : ",\n",
+                name, size, reps, median, p99, samples[ 0 ], bytes_per_op );
+    else
+        printf( "%s,%zu,%zu,%.3f,%.3f,%.3f,%.3f\n",
+                name, size, reps, median, p99, samples[ 0 ], bytes_per_op );
+
+    ++opts->n_printed;
+    fflush( stdout );
+}
+
+/** Runs one case at one size */
+LibraryDefined void bench_run_one( BenchOptions *opts,
+                                   const BenchCase *bench,
+                                   const size_t size )
+{
+    static double samples[ BENCH_MAX_REPS ];
+
+    BenchState state    = { 0 };
+    Allocator allocator = {
+        .alloc  = bench_alloc,
+        .resize = bench_resize,
+        .free   = bench_free,
+        .ctx    = &state.bytes,
+    };
+
+    const uint64_t min_time_ns = ( uint64_t ) opts->min_time_ms * 1000000;
+    uint64_t total_ns          = 0;
+    size_t reps                = 0;
+    double bytes_per_op        = 0;
+
+    for ( size_t i = 0; reps < BENCH_MAX_REPS; ++i )
+    {
+        state = ( BenchState ) {
+            .size      = size,
+            .ops       = size,
+            .allocator = &allocator,
+        };
+        if ( bench->setup != NULL )
+            bench->setup( &state );
+
+        state.bytes          = 0;
+        const uint64_t start = bench_now_ns();
+        bench->run( &state );
+        const uint64_t elapsed = bench_now_ns() - start;
+
+        if ( bench->teardown != NULL )
+            bench->teardown( &state );
+
+        if ( i < opts->warmup )
+            continue;
+
+        samples[ reps++ ] = ( double ) elapsed / ( double ) state.ops;
+        bytes_per_op      = ( double ) state.bytes / ( double ) state.ops;
+        total_ns += elapsed;
+
+        if ( reps >= opts->min_reps && total_ns >= min_time_ns )
+            break;
+    }
+
+    bench_print( opts, bench->name, size, samples, reps, bytes_per_op );
+}
+
+LibraryDefined void bench_run_cases( BenchOptions *opts,
+                                     const BenchCase *cases,
+                                     const size_t count )
+{
+    for ( size_t i = 0; i < count; ++i )
+    {
+        if ( opts->filter != NULL && strstr( cases[ i ].name, opts->filter ) == NULL )
+            continue;
+
+        for ( size_t size = cases[ i ].min_size;
+              size <= cases[ i ].max_size && size <= opts->max_size;
+              size *= 10 )
+            bench_run_one( opts, cases + i, size );
+    }
+}
+
+#endif //CLIBS_BENCH_H
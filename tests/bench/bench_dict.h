@@ -0,0 +1,252 @@
+#ifndef BENCH_DICT_H
+#define BENCH_DICT_H
+
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/serialize.h"
+#include "../../src/structs/dictionary.h"
+#include "bench.h"
+
+
+/** Lookups done by one run of the search cases, whatever the size */
+#define BENCH_DICT_LOOKUPS ( 1 << 16 )
+
+
+Private void bench_dict_setup_empty( BenchState *state )
+{
+    state->data = dict_init_with_allocator( state->allocator );
+    if ( state->data == NULL )
+        errx( EXIT_FAILURE, "dict_init_with_allocator" );
+}
+
+Private void bench_dict_insert( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( dict_insert( state->data, &i, sizeof i, &i, sizeof i )
+             != DICTINSERT_INSERTED )
+            errx( EXIT_FAILURE, "dict_insert" );
+}
+
+Private void bench_dict_setup_filled( BenchState *state )
+{
+    bench_dict_setup_empty( state );
+    bench_dict_insert( state );
+}
+
+Private void bench_dict_setup_lookups( BenchState *state )
+{
+    bench_dict_setup_filled( state );
+    state->ops = BENCH_DICT_LOOKUPS;
+}
+
+Private void bench_dict_teardown( BenchState *state )
+{
+    dict_destroy( state->data );
+}
+
+
+Private void bench_dict_lookups( BenchState *state, const uint64_t first_key )
+{
+    size_t found = 0;
+    for ( size_t i = 0; i < BENCH_DICT_LOOKUPS; ++i )
+    {
+        const uint64_t key = first_key + bench_rand() % state->size;
+        found += dict_get_val( state->data, &key, sizeof key ) != NULL;
+    }
+
+    if ( found != ( first_key == 0 ? BENCH_DICT_LOOKUPS : 0 ) )
+        errx( EXIT_FAILURE, "dict_get_val: found %zu", found );
+}
+
+Private void bench_dict_search_hit( BenchState *state )
+{
+    bench_dict_lookups( state, 0 );
+}
+
+Private void bench_dict_search_miss( BenchState *state )
+{
+    bench_dict_lookups( state, state->size );
+}
+
+Private void bench_dict_remove( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( dict_remove( state->data, &i, sizeof i ) != DICTREMOVE_REMOVED )
+            errx( EXIT_FAILURE, "dict_remove" );
+}
+
+
+/** A saved dictionary and what's been loaded from it */
+typedef struct {
+    FILE *file;
+    Dictionary *loaded;
+} BenchDictFile;
+
+Private void bench_dict_setup_saved( BenchState *state )
+{
+    bench_dict_setup_filled( state );
+
+    BenchDictFile *saved = calloc( 1, sizeof( BenchDictFile ) );
+    if ( saved == NULL )
+        err( EXIT_FAILURE, "calloc" );
+    if ( ( saved->file = tmpfile() ) == NULL )
+        err( EXIT_FAILURE, "tmpfile" );
+    if ( dict_save( state->data, saved->file ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "dict_save" );
+
+    dict_destroy( state->data );
+    state->data = saved;
+}
+
+Private void bench_dict_teardown_saved( BenchState *state )
+{
+    BenchDictFile *saved = state->data;
+    if ( saved->loaded != NULL )
+        dict_destroy( saved->loaded );
+    fclose( saved->file );
+    free( saved );
+}
+
+/** Loads the table at its final size, with the saved hashes */
+Private void bench_dict_load( BenchState *state )
+{
+    BenchDictFile *saved = state->data;
+    rewind( saved->file );
+    if ( ( saved->loaded = dict_load( saved->file, NULL ) ) == NULL
+         || dict_size( saved->loaded ) != state->size )
+        errx( EXIT_FAILURE, "dict_load" );
+}
+
+/** Reads the same file, but inserts the items one by one (rehashing and growing) */
+Private void bench_dict_rebuild( BenchState *state )
+{
+    BenchDictFile *saved = state->data;
+    rewind( saved->file );
+    SerialReader *reader = serial_reader_open( saved->file );
+    if ( reader == NULL || ( saved->loaded = dict_init() ) == NULL )
+        errx( EXIT_FAILURE, "serial_reader_open" );
+
+    const void *key;
+    const void *val;
+    size_t key_size;
+    size_t val_size;
+    while ( serial_read_entry( reader, &key, &key_size, &val, &val_size ) == 1 )
+        if ( dict_insert( saved->loaded, key, key_size, val, val_size )
+             != DICTINSERT_INSERTED )
+            errx( EXIT_FAILURE, "dict_insert" );
+
+    serial_reader_close( reader );
+    if ( dict_size( saved->loaded ) != state->size )
+        errx( EXIT_FAILURE, "serial_read_entry" );
+}
+
+
+/** Keys 0 … `size - 1` (which are also their values) and an empty dictionary */
+typedef struct {
+    uint64_t *keys;
+    Dictionary *dict;
+} BenchDictArray;
+
+Private void bench_dict_setup_array( BenchState *state )
+{
+    BenchDictArray *array = calloc( 1, sizeof( BenchDictArray ) );
+    if ( array == NULL
+         || ( array->keys = malloc( state->size * sizeof( uint64_t ) ) ) == NULL )
+        err( EXIT_FAILURE, "malloc" );
+    for ( uint64_t i = 0; i < state->size; ++i )
+        array->keys[ i ] = i;
+
+    if ( ( array->dict = dict_init_with_allocator( state->allocator ) ) == NULL )
+        errx( EXIT_FAILURE, "dict_init_with_allocator" );
+    state->data = array;
+}
+
+Private void bench_dict_teardown_array( BenchState *state )
+{
+    BenchDictArray *array = state->data;
+    dict_destroy( array->dict );
+    free( array->keys );
+    free( array );
+}
+
+Private void bench_dict_insert_many( BenchState *state )
+{
+    BenchDictArray *array = state->data;
+    if ( dict_insert_many( array->dict, array->keys, sizeof( uint64_t ), array->keys,
+                           sizeof( uint64_t ), state->size )
+                 != RV_SUCCESS
+         || dict_size( array->dict ) != state->size )
+        errx( EXIT_FAILURE, "dict_insert_many" );
+}
+
+
+/** Keys with four occurrences each, counted the way callers had to before upserts */
+Private void bench_dict_setup_counts( BenchState *state )
+{
+    bench_dict_setup_array( state );
+
+    BenchDictArray *array = state->data;
+    for ( uint64_t i = 0; i < state->size; ++i )
+        array->keys[ i ] = i % ( state->size / 4 + 1 );
+}
+
+Private void bench_dict_count_lookup_set( BenchState *state )
+{
+    BenchDictArray *array = state->data;
+    for ( size_t i = 0; i < state->size; ++i )
+    {
+        const uint64_t *key  = array->keys + i;
+        const void *val      = dict_get_val( array->dict, key, sizeof *key );
+        const uint64_t count = ( val == NULL ? 0 : *( const uint64_t * ) val ) + 1;
+
+        const int rv = dict_has_key( array->dict, key, sizeof *key )
+                               ? dict_set_val( array->dict, key, sizeof *key, &count,
+                                               sizeof count )
+                               : dict_insert( array->dict, key, sizeof *key, &count,
+                                              sizeof count );
+        if ( rv == RV_ERROR )
+            errx( EXIT_FAILURE, "dict_insert" );
+    }
+}
+
+Private void bench_dict_count_get_or_insert( BenchState *state )
+{
+    BenchDictArray *array = state->data;
+    for ( size_t i = 0; i < state->size; ++i )
+    {
+        uint64_t *count = dict_get_or_insert( array->dict, array->keys + i,
+                                              sizeof( uint64_t ), &( uint64_t ) { 0 },
+                                              sizeof( uint64_t ), NULL );
+        if ( count == NULL )
+            errx( EXIT_FAILURE, "dict_get_or_insert" );
+        ++*count;
+    }
+}
+
+
+LibraryDefined void BENCHALL_DICT( BenchOptions *opts )
+{
+    static const BenchCase cases[] = {
+        { "dict_insert", 100, 10000000,
+          bench_dict_setup_empty, bench_dict_insert, bench_dict_teardown },
+        { "dict_search_hit", 100, 10000000,
+          bench_dict_setup_lookups, bench_dict_search_hit, bench_dict_teardown },
+        { "dict_search_miss", 100, 10000000,
+          bench_dict_setup_lookups, bench_dict_search_miss, bench_dict_teardown },
+        { "dict_remove", 100, 10000000,
+          bench_dict_setup_filled, bench_dict_remove, bench_dict_teardown },
+        { "dict_load", 100, 10000000,
+          bench_dict_setup_saved, bench_dict_load, bench_dict_teardown_saved },
+        { "dict_load_rebuild", 100, 10000000,
+          bench_dict_setup_saved, bench_dict_rebuild, bench_dict_teardown_saved },
+        { "dict_insert_many", 100, 10000000,
+          bench_dict_setup_array, bench_dict_insert_many, bench_dict_teardown_array },
+        { "dict_count_lookup_set", 100, 10000000, bench_dict_setup_counts,
+          bench_dict_count_lookup_set, bench_dict_teardown_array },
+        { "dict_count_get_or_insert", 100, 10000000, bench_dict_setup_counts,
+          bench_dict_count_get_or_insert, bench_dict_teardown_array },
+    };
+
+    bench_run_cases( opts, cases, countof( cases ) );
+}
+
+#endif //BENCH_DICT_H
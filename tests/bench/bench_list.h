@@ -0,0 +1,258 @@
+#ifndef BENCH_LIST_H
+#define BENCH_LIST_H
+
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/structs/dynarr.h"
+#include "../../src/structs/dynarr_index.h"
+#include "../../src/structs/dynarr_parallel.h"
+#include "../../src/structs/dynarr_typed.h"
+#include "bench.h"
+
+
+/** Lookups done by one run of the search cases, whatever the size */
+#define BENCH_LIST_LOOKUPS ( 1 << 16 )
+
+
+Private int bench_cmp_u64( const void *a, const void *b )
+{
+    const uint64_t x = *( const uint64_t * ) a;
+    const uint64_t y = *( const uint64_t * ) b;
+    return ( x > y ) - ( x < y );
+}
+
+Private List *bench_list_filled( BenchState *state, const bool random )
+{
+    List *ls = list_init_with_allocator( sizeof( uint64_t ), state->allocator );
+    if ( ls == NULL )
+        errx( EXIT_FAILURE, "list_init_with_allocator" );
+
+    for ( uint64_t i = 0; i < state->size; ++i )
+    {
+        const uint64_t n = random ? bench_rand() : 2 * i;
+        if ( list_append( ls, &n ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "list_append" );
+    }
+    return ls;
+}
+
+Private void bench_list_setup_empty( BenchState *state )
+{
+    state->data = list_init_with_allocator( sizeof( uint64_t ), state->allocator );
+    if ( state->data == NULL )
+        errx( EXIT_FAILURE, "list_init_with_allocator" );
+}
+
+Private void bench_list_setup_random( BenchState *state )
+{
+    state->data = bench_list_filled( state, true );
+}
+
+/** Even numbers, so that odd ones miss */
+Private void bench_list_setup_sorted( BenchState *state )
+{
+    state->data = bench_list_filled( state, false );
+    state->ops  = BENCH_LIST_LOOKUPS;
+}
+
+Private void bench_list_teardown( BenchState *state )
+{
+    list_destroy( state->data );
+}
+
+
+Private void bench_list_append( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( list_append( state->data, &i ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "list_append" );
+}
+
+Private void bench_list_append_reserved( BenchState *state )
+{
+    if ( list_reserve( state->data, state->size ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "list_reserve" );
+    bench_list_append( state );
+}
+
+/** Always in the middle */
+Private void bench_list_insert( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( list_insert( state->data, i / 2, &i ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "list_insert" );
+}
+
+Private void bench_list_sort( BenchState *state )
+{
+    list_sort( state->data, bench_cmp_u64 );
+}
+
+/** Baseline for the `list_sort*()` functions */
+Private void bench_list_qsort( BenchState *state )
+{
+    qsort( list_at( state->data, 0 ), state->size, sizeof( uint64_t ), bench_cmp_u64 );
+}
+
+Private void bench_list_sort_stable( BenchState *state )
+{
+    if ( list_sort_stable( state->data, bench_cmp_u64 ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "list_sort_stable" );
+}
+
+/** All online CPUs, default grain */
+Private void bench_list_parallel_sort( BenchState *state )
+{
+    if ( list_parallel_sort( state->data, bench_cmp_u64, NULL ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "list_parallel_sort" );
+}
+
+Private void bench_list_sort_radix( BenchState *state )
+{
+    if ( list_sort_radix_u64( state->data, 0 ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "list_sort_radix_u64" );
+}
+
+Private void bench_list_int64_append( BenchState *state )
+{
+    for ( int64_t i = 0; i < ( int64_t ) state->size; ++i )
+        if ( list_int64_append( state->data, i ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "list_int64_append" );
+}
+
+Private void bench_list_int64_sort( BenchState *state )
+{
+    list_int64_sort( state->data );
+}
+
+/** Half hits, half misses */
+Private void bench_list_bsearch( BenchState *state )
+{
+    size_t found = 0;
+    for ( size_t i = 0; i < BENCH_LIST_LOOKUPS; ++i )
+    {
+        const uint64_t needle = bench_rand() % ( 2 * state->size );
+        found += list_bsearch_i( state->data, &needle, bench_cmp_u64 ) >= 0;
+    }
+
+    if ( found == 0 || found == BENCH_LIST_LOOKUPS )
+        errx( EXIT_FAILURE, "list_bsearch_i: found %zu", found );
+}
+
+/** The List is replaced by its index (built outside of the measured run) */
+Private void bench_list_setup_index( BenchState *state )
+{
+    bench_list_setup_sorted( state );
+
+    List *ls    = state->data;
+    state->data = sorted_index_init( ls, bench_cmp_u64 );
+    if ( state->data == NULL )
+        errx( EXIT_FAILURE, "sorted_index_init" );
+    list_destroy( ls );
+}
+
+Private void bench_list_teardown_index( BenchState *state )
+{
+    sorted_index_destroy( state->data );
+}
+
+/** Same needles as `bench_list_bsearch()` */
+Private void bench_list_index_find( BenchState *state )
+{
+    size_t found = 0;
+    for ( size_t i = 0; i < BENCH_LIST_LOOKUPS; ++i )
+    {
+        const uint64_t needle = bench_rand() % ( 2 * state->size );
+        found += sorted_index_find( state->data, &needle ) >= 0;
+    }
+
+    if ( found == 0 || found == BENCH_LIST_LOOKUPS )
+        errx( EXIT_FAILURE, "sorted_index_find: found %zu", found );
+}
+
+Private void bench_list_index_find_n( BenchState *state )
+{
+    static uint64_t needles[ BENCH_LIST_LOOKUPS ];
+    static int64_t indices[ BENCH_LIST_LOOKUPS ];
+    for ( size_t i = 0; i < BENCH_LIST_LOOKUPS; ++i )
+        needles[ i ] = bench_rand() % ( 2 * state->size );
+
+    sorted_index_find_n( state->data, needles, BENCH_LIST_LOOKUPS, indices );
+
+    size_t found = 0;
+    for ( size_t i = 0; i < BENCH_LIST_LOOKUPS; ++i )
+        found += indices[ i ] >= 0;
+    if ( found == 0 || found == BENCH_LIST_LOOKUPS )
+        errx( EXIT_FAILURE, "sorted_index_find_n: found %zu", found );
+}
+
+
+/** `int`s, none of which is -1 */
+Private void bench_list_setup_ints( BenchState *state )
+{
+    List *ls = list_init_with_allocator( sizeof( int ), state->allocator );
+    if ( ls == NULL || list_resize( ls, state->size ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "list_resize" );
+    for ( size_t i = 0; i < state->size; ++i )
+        list_access( ls, i, int ) = ( int ) ( bench_rand() & INT32_MAX );
+    state->data = ls;
+}
+
+/** A miss, so all items are compared (ns/op is per item) */
+Private void bench_list_lsearch_as( BenchState *state, const enum ListSearchImpl impl )
+{
+    if ( list_lsearch_i_impl( state->data, &( int ) { -1 }, impl ) != -1 )
+        errx( EXIT_FAILURE, "list_lsearch_i_impl" );
+}
+
+Private void bench_list_lsearch_scalar( BenchState *state )
+{
+    bench_list_lsearch_as( state, LIST_SEARCH_SCALAR );
+}
+
+Private void bench_list_lsearch( BenchState *state )
+{
+    bench_list_lsearch_as( state, LIST_SEARCH_AUTO );
+}
+
+
+LibraryDefined void BENCHALL_LIST( BenchOptions *opts )
+{
+    static const BenchCase cases[] = {
+        { "list_append", 100, 10000000,
+          bench_list_setup_empty, bench_list_append, bench_list_teardown },
+        { "list_append_reserved", 100, 10000000,
+          bench_list_setup_empty, bench_list_append_reserved, bench_list_teardown },
+        // O(n) per insert
+        { "list_insert", 100, 10000,
+          bench_list_setup_empty, bench_list_insert, bench_list_teardown },
+        { "list_qsort", 100, 10000000,
+          bench_list_setup_random, bench_list_qsort, bench_list_teardown },
+        { "list_sort", 100, 10000000,
+          bench_list_setup_random, bench_list_sort, bench_list_teardown },
+        { "list_sort_stable", 100, 10000000,
+          bench_list_setup_random, bench_list_sort_stable, bench_list_teardown },
+        { "list_parallel_sort", 100, 10000000,
+          bench_list_setup_random, bench_list_parallel_sort, bench_list_teardown },
+        { "list_sort_radix_u64", 100, 10000000,
+          bench_list_setup_random, bench_list_sort_radix, bench_list_teardown },
+        // `List_int64` (dynarr_typed.h) is the same object as the generic `List`
+        { "list_int64_append", 100, 10000000,
+          bench_list_setup_empty, bench_list_int64_append, bench_list_teardown },
+        { "list_int64_sort", 100, 10000000,
+          bench_list_setup_random, bench_list_int64_sort, bench_list_teardown },
+        { "list_bsearch", 100, 10000000,
+          bench_list_setup_sorted, bench_list_bsearch, bench_list_teardown },
+        { "sorted_index_find", 100, 10000000,
+          bench_list_setup_index, bench_list_index_find, bench_list_teardown_index },
+        { "sorted_index_find_n", 100, 10000000,
+          bench_list_setup_index, bench_list_index_find_n, bench_list_teardown_index },
+        { "list_lsearch_int_scalar", 100, 10000000,
+          bench_list_setup_ints, bench_list_lsearch_scalar, bench_list_teardown },
+        { "list_lsearch_int", 100, 10000000,
+          bench_list_setup_ints, bench_list_lsearch, bench_list_teardown },
+    };
+
+    bench_run_cases( opts, cases, countof( cases ) );
+}
+
+#endif //BENCH_LIST_H
@@ -0,0 +1,56 @@
+#ifndef BENCH_QUEUE_H
+#define BENCH_QUEUE_H
+
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/structs/queue.h"
+#include "bench.h"
+
+
+Private void bench_queue_setup_empty( BenchState *state )
+{
+    state->data = queue_init_with_allocator( sizeof( uint64_t ), state->allocator );
+    if ( state->data == NULL )
+        errx( EXIT_FAILURE, "queue_init_with_allocator" );
+}
+
+Private void bench_queue_enqueue( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( queue_enqueue( state->data, &i ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "queue_enqueue" );
+}
+
+Private void bench_queue_setup_filled( BenchState *state )
+{
+    bench_queue_setup_empty( state );
+    bench_queue_enqueue( state );
+}
+
+Private void bench_queue_teardown( BenchState *state )
+{
+    queue_destroy( state->data );
+}
+
+
+Private void bench_queue_dequeue( BenchState *state )
+{
+    uint64_t item;
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( queue_dequeue( state->data, &item ) != RV_SUCCESS || item != i )
+            errx( EXIT_FAILURE, "queue_dequeue" );
+}
+
+
+LibraryDefined void BENCHALL_QUEUE( BenchOptions *opts )
+{
+    static const BenchCase cases[] = {
+        { "queue_enqueue", 100, 10000000,
+          bench_queue_setup_empty, bench_queue_enqueue, bench_queue_teardown },
+        { "queue_dequeue", 100, 10000000,
+          bench_queue_setup_filled, bench_queue_dequeue, bench_queue_teardown },
+    };
+
+    bench_run_cases( opts, cases, countof( cases ) );
+}
+
+#endif //BENCH_QUEUE_H
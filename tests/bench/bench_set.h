@@ -0,0 +1,334 @@
+#ifndef BENCH_SET_H
+#define BENCH_SET_H
+
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/serialize.h"
+#include "../../src/structs/set.h"
+#include "bench.h"
+
+
+/** Lookups done by one run of the search cases, whatever the size */
+#define BENCH_SET_LOOKUPS ( 1 << 16 )
+
+/** Long keys share everything but the first 8 bytes, like common-prefix strings */
+#define BENCH_SET_LONG_KEY 128
+
+
+Private void bench_set_make_key( byte key[ BENCH_SET_LONG_KEY ], const uint64_t n )
+{
+    memset( key, 'k', BENCH_SET_LONG_KEY );
+    memcpy( key, &n, sizeof n );
+}
+
+Private Set *bench_set_filled( BenchState *state, const size_t key_len )
+{
+    Set *set = set_init_with_allocator( state->allocator );
+    if ( set == NULL )
+        errx( EXIT_FAILURE, "set_init_with_allocator" );
+
+    byte key[ BENCH_SET_LONG_KEY ];
+    for ( uint64_t i = 0; i < state->size; ++i )
+    {
+        bench_set_make_key( key, i );
+        if ( set_insert( set, key, key_len ) != SETINSERT_INSERTED )
+            errx( EXIT_FAILURE, "set_insert" );
+    }
+    return set;
+}
+
+Private void bench_set_setup_empty( BenchState *state )
+{
+    state->data = set_init_with_allocator( state->allocator );
+    if ( state->data == NULL )
+        errx( EXIT_FAILURE, "set_init_with_allocator" );
+}
+
+Private void bench_set_setup_filled( BenchState *state )
+{
+    state->data = bench_set_filled( state, sizeof( uint64_t ) );
+}
+
+Private void bench_set_setup_lookups( BenchState *state )
+{
+    state->data = bench_set_filled( state, sizeof( uint64_t ) );
+    state->ops  = BENCH_SET_LOOKUPS;
+}
+
+Private void bench_set_setup_long_lookups( BenchState *state )
+{
+    state->data = bench_set_filled( state, BENCH_SET_LONG_KEY );
+    state->ops  = BENCH_SET_LOOKUPS;
+}
+
+Private void bench_set_teardown( BenchState *state )
+{
+    set_destroy( state->data );
+}
+
+
+Private void bench_set_insert( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( set_insert( state->data, &i, sizeof i ) != SETINSERT_INSERTED )
+            errx( EXIT_FAILURE, "set_insert" );
+}
+
+Private void bench_set_lookups( BenchState *state,
+                                const size_t key_len,
+                                const uint64_t first_key )
+{
+    byte key[ BENCH_SET_LONG_KEY ];
+    size_t found = 0;
+    for ( size_t i = 0; i < BENCH_SET_LOOKUPS; ++i )
+    {
+        bench_set_make_key( key, first_key + bench_rand() % state->size );
+        found += set_search( state->data, key, key_len );
+    }
+
+    if ( found != ( first_key == 0 ? BENCH_SET_LOOKUPS : 0 ) )
+        errx( EXIT_FAILURE, "set_search: found %zu", found );
+}
+
+Private void bench_set_search_hit( BenchState *state )
+{
+    bench_set_lookups( state, sizeof( uint64_t ), 0 );
+}
+
+Private void bench_set_search_miss( BenchState *state )
+{
+    bench_set_lookups( state, sizeof( uint64_t ), state->size );
+}
+
+Private void bench_set_search_long( BenchState *state )
+{
+    bench_set_lookups( state, BENCH_SET_LONG_KEY, 0 );
+}
+
+Private void bench_set_remove( BenchState *state )
+{
+    for ( uint64_t i = 0; i < state->size; ++i )
+        if ( set_remove( state->data, &i, sizeof i ) != SETREMOVE_REMOVED )
+            errx( EXIT_FAILURE, "set_remove" );
+}
+
+
+/** A saved set and what's been loaded from it */
+typedef struct {
+    FILE *file;
+    Set *loaded;
+} BenchSetFile;
+
+Private void bench_set_setup_saved( BenchState *state )
+{
+    Set *set = bench_set_filled( state, sizeof( uint64_t ) );
+
+    BenchSetFile *saved = calloc( 1, sizeof( BenchSetFile ) );
+    if ( saved == NULL )
+        err( EXIT_FAILURE, "calloc" );
+    if ( ( saved->file = tmpfile() ) == NULL )
+        err( EXIT_FAILURE, "tmpfile" );
+    if ( set_save( set, saved->file ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "set_save" );
+
+    set_destroy( set );
+    state->data = saved;
+}
+
+Private void bench_set_teardown_saved( BenchState *state )
+{
+    BenchSetFile *saved = state->data;
+    if ( saved->loaded != NULL )
+        set_destroy( saved->loaded );
+    fclose( saved->file );
+    free( saved );
+}
+
+/** Loads the table at its final size, with the saved hashes */
+Private void bench_set_load( BenchState *state )
+{
+    BenchSetFile *saved = state->data;
+    rewind( saved->file );
+    if ( ( saved->loaded = set_load( saved->file, NULL ) ) == NULL
+         || set_size( saved->loaded ) != state->size )
+        errx( EXIT_FAILURE, "set_load" );
+}
+
+/** Reads the same file, but inserts the items one by one (rehashing and growing) */
+Private void bench_set_rebuild( BenchState *state )
+{
+    BenchSetFile *saved = state->data;
+    rewind( saved->file );
+    SerialReader *reader = serial_reader_open( saved->file );
+    if ( reader == NULL || ( saved->loaded = set_init() ) == NULL )
+        errx( EXIT_FAILURE, "serial_reader_open" );
+
+    const void *item;
+    size_t size;
+    while ( serial_read_item( reader, &item, &size ) == 1 )
+        if ( set_insert( saved->loaded, item, size ) != SETINSERT_INSERTED )
+            errx( EXIT_FAILURE, "set_insert" );
+
+    serial_reader_close( reader );
+    if ( set_size( saved->loaded ) != state->size )
+        errx( EXIT_FAILURE, "serial_read_item" );
+}
+
+
+/** A set of `size` items, a 16 times smaller one (half of it in the larger one) */
+typedef struct {
+    Set *larger;
+    Set *smaller;
+    Set *result;
+} BenchSetPair;
+
+Private void bench_set_setup_pair( BenchState *state )
+{
+    BenchSetPair *pair = calloc( 1, sizeof( BenchSetPair ) );
+    if ( pair == NULL )
+        err( EXIT_FAILURE, "calloc" );
+
+    pair->larger = bench_set_filled( state, sizeof( uint64_t ) );
+    if ( ( pair->smaller = set_init_with_allocator( state->allocator ) ) == NULL )
+        errx( EXIT_FAILURE, "set_init_with_allocator" );
+    for ( uint64_t i = state->size - state->size / 32; i < state->size + state->size / 32;
+          ++i )
+        if ( set_insert( pair->smaller, &i, sizeof i ) != SETINSERT_INSERTED )
+            errx( EXIT_FAILURE, "set_insert" );
+
+    state->data = pair;
+}
+
+Private void bench_set_teardown_pair( BenchState *state )
+{
+    BenchSetPair *pair = state->data;
+    set_destroy( pair->larger );
+    set_destroy( pair->smaller );
+    if ( pair->result != NULL )
+        set_destroy( pair->result );
+    free( pair );
+}
+
+Private void bench_set_union( BenchState *state )
+{
+    BenchSetPair *pair = state->data;
+    if ( set_union( pair->smaller, pair->larger, &pair->result ) != RV_SUCCESS
+         || set_size( pair->result ) != state->size + state->size / 32 )
+        errx( EXIT_FAILURE, "set_union" );
+}
+
+Private void bench_set_intersection( BenchState *state )
+{
+    BenchSetPair *pair = state->data;
+    if ( set_intersection( pair->larger, pair->smaller, &pair->result ) != RV_SUCCESS
+         || set_size( pair->result ) != state->size / 32 )
+        errx( EXIT_FAILURE, "set_intersection" );
+}
+
+Private void bench_set_difference( BenchState *state )
+{
+    BenchSetPair *pair = state->data;
+    if ( set_difference( pair->larger, pair->smaller, &pair->result ) != RV_SUCCESS
+         || set_size( pair->result ) != state->size - state->size / 32 )
+        errx( EXIT_FAILURE, "set_difference" );
+}
+
+
+/** An array of `size` keys (a quarter of them twice) to build a set of */
+typedef struct {
+    uint64_t *keys;
+    Set *set;
+    ThreadPool *pool;
+} BenchSetArray;
+
+Private void bench_set_setup_array( BenchState *state )
+{
+    BenchSetArray *array = calloc( 1, sizeof( BenchSetArray ) );
+    if ( array == NULL
+         || ( array->keys = malloc( state->size * sizeof( uint64_t ) ) ) == NULL )
+        err( EXIT_FAILURE, "malloc" );
+    for ( uint64_t i = 0; i < state->size; ++i )
+        array->keys[ i ] = i % 4 == 3 ? bench_rand() % state->size : i;
+
+    if ( ( array->set = set_init() ) == NULL )
+        errx( EXIT_FAILURE, "set_init" );
+    if ( ( array->pool = thread_pool_init( 0 ) ) == NULL )
+        errx( EXIT_FAILURE, "thread_pool_init" );
+
+    state->data = array;
+}
+
+Private void bench_set_teardown_array( BenchState *state )
+{
+    BenchSetArray *array = state->data;
+    set_destroy( array->set );
+    thread_pool_destroy( array->pool );
+    free( array->keys );
+    free( array );
+}
+
+/** The way `set_from_list()` used to be: one by one, presized to the number of items */
+Private void bench_set_insert_each( BenchState *state )
+{
+    BenchSetArray *array = state->data;
+    set_destroy( array->set );
+    if ( ( array->set = set_init_cap( state->size ) ) == NULL )
+        errx( EXIT_FAILURE, "set_init_cap" );
+
+    for ( size_t i = 0; i < state->size; ++i )
+        if ( set_insert( array->set, array->keys + i, sizeof( uint64_t ) ) < 0 )
+            errx( EXIT_FAILURE, "set_insert" );
+}
+
+Private void bench_set_insert_many( BenchState *state )
+{
+    BenchSetArray *array = state->data;
+    if ( set_insert_many( array->set, array->keys, state->size, sizeof( uint64_t ) )
+         != RV_SUCCESS )
+        errx( EXIT_FAILURE, "set_insert_many" );
+}
+
+Private void bench_set_insert_many_parallel( BenchState *state )
+{
+    BenchSetArray *array = state->data;
+    if ( set_insert_many_parallel( array->set, array->keys, state->size,
+                                   sizeof( uint64_t ), array->pool )
+         != RV_SUCCESS )
+        errx( EXIT_FAILURE, "set_insert_many_parallel" );
+}
+
+
+LibraryDefined void BENCHALL_SET( BenchOptions *opts )
+{
+    static const BenchCase cases[] = {
+        { "set_insert", 100, 10000000,
+          bench_set_setup_empty, bench_set_insert, bench_set_teardown },
+        { "set_search_hit", 100, 10000000,
+          bench_set_setup_lookups, bench_set_search_hit, bench_set_teardown },
+        { "set_search_miss", 100, 10000000,
+          bench_set_setup_lookups, bench_set_search_miss, bench_set_teardown },
+        { "set_search_hit_key128", 100, 1000000,
+          bench_set_setup_long_lookups, bench_set_search_long, bench_set_teardown },
+        { "set_remove", 100, 10000000,
+          bench_set_setup_filled, bench_set_remove, bench_set_teardown },
+        { "set_load", 100, 10000000,
+          bench_set_setup_saved, bench_set_load, bench_set_teardown_saved },
+        { "set_load_rebuild", 100, 10000000,
+          bench_set_setup_saved, bench_set_rebuild, bench_set_teardown_saved },
+        { "set_union", 100, 10000000,
+          bench_set_setup_pair, bench_set_union, bench_set_teardown_pair },
+        { "set_intersection", 100, 10000000,
+          bench_set_setup_pair, bench_set_intersection, bench_set_teardown_pair },
+        { "set_difference", 100, 10000000,
+          bench_set_setup_pair, bench_set_difference, bench_set_teardown_pair },
+        { "set_build_each", 100, 10000000,
+          bench_set_setup_array, bench_set_insert_each, bench_set_teardown_array },
+        { "set_insert_many", 100, 10000000,
+          bench_set_setup_array, bench_set_insert_many, bench_set_teardown_array },
+        { "set_insert_many_parallel", 100, 10000000, bench_set_setup_array,
+          bench_set_insert_many_parallel, bench_set_teardown_array },
+    };
+
+    bench_run_cases( opts, cases, countof( cases ) );
+}
+
+#endif //BENCH_SET_H
@@ -0,0 +1,140 @@
+#ifndef BENCH_STRINGS_H
+#define BENCH_STRINGS_H
+
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/string_utils.h"
+#include "../../src/structs/dynstring.h"
+#include "bench.h"
+
+
+/** Appended/prepended at once, and the words of the split/joined strings */
+#define BENCH_STR_CHUNK "0123456789abcdef"
+#define BENCH_STR_WORD  "word"
+
+
+struct bench_strings {
+    str_t string;        // words separated by ','
+    const char **words;  // for string_join()
+    str_t *parts;        // result of string_split()
+    str_t joined;        // result of string_join()
+};
+
+
+/* -------- DynString -------- */
+
+Private void bench_dynstr_setup( BenchState *state )
+{
+    state->data = dynstr_init_with_allocator( state->allocator );
+    if ( state->data == NULL )
+        errx( EXIT_FAILURE, "dynstr_init_with_allocator" );
+}
+
+Private void bench_dynstr_teardown( BenchState *state )
+{
+    dynstr_destroy( state->data );
+}
+
+Private void bench_dynstr_append( BenchState *state )
+{
+    for ( size_t i = 0; i < state->size; ++i )
+        if ( dynstr_appendn( state->data, BENCH_STR_CHUNK, STRLEN( BENCH_STR_CHUNK ) )
+             < 0 )
+            errx( EXIT_FAILURE, "dynstr_appendn" );
+}
+
+Private void bench_dynstr_prepend( BenchState *state )
+{
+    for ( size_t i = 0; i < state->size; ++i )
+        if ( dynstr_prependn( state->data, BENCH_STR_CHUNK, STRLEN( BENCH_STR_CHUNK ) )
+             < 0 )
+            errx( EXIT_FAILURE, "dynstr_prependn" );
+}
+
+
+/* -------- string_utils -------- */
+
+/** "word,word,...,word" (`size` words) */
+Private void bench_strings_setup( BenchState *state )
+{
+    struct bench_strings *strings = calloc( 1, sizeof( struct bench_strings ) );
+    const size_t word_len         = STRLEN( BENCH_STR_WORD );
+    if ( strings == NULL
+         || ( strings->string = malloc( state->size * ( word_len + 1 ) ) ) == NULL
+         || ( strings->words = malloc( state->size * sizeof( const char * ) ) ) == NULL )
+        err( EXIT_FAILURE, "malloc" );
+
+    for ( size_t i = 0; i < state->size; ++i )
+    {
+        memcpy( strings->string + i * ( word_len + 1 ), BENCH_STR_WORD, word_len );
+        strings->string[ i * ( word_len + 1 ) + word_len ] = ',';
+        strings->words[ i ]                                 = BENCH_STR_WORD;
+    }
+    strings->string[ state->size * ( word_len + 1 ) - 1 ] = '\0';
+
+    state->data = strings;
+}
+
+Private void bench_strings_teardown( BenchState *state )
+{
+    struct bench_strings *strings = state->data;
+
+    if ( strings->parts != NULL )
+        string_split_destroy( state->size, &strings->parts );
+    free( strings->joined );
+    free( strings->words );
+    free( strings->string );
+    free( strings );
+}
+
+Private void bench_string_split( BenchState *state )
+{
+    struct bench_strings *strings = state->data;
+
+    if ( string_split( &strings->parts, strings->string, ",", 0 )
+         != ( ssize_t ) state->size )
+        errx( EXIT_FAILURE, "string_split" );
+
+    state->bytes += state->size * ( sizeof( str_t ) + sizeof( BENCH_STR_WORD ) );
+}
+
+Private void bench_string_replace( BenchState *state )
+{
+    struct bench_strings *strings = state->data;
+
+    if ( string_replace( strings->string, BENCH_STR_WORD, "WORD" ) != RV_SUCCESS
+         || strings->string[ 0 ] != 'W' )
+        errx( EXIT_FAILURE, "string_replace" );
+}
+
+Private void bench_string_join( BenchState *state )
+{
+    struct bench_strings *strings = state->data;
+
+    strings->joined = string_join( state->size, strings->words, "," );
+    if ( strings->joined == NULL )
+        errx( EXIT_FAILURE, "string_join" );
+
+    state->bytes += state->size * ( STRLEN( BENCH_STR_WORD ) + 1 );
+}
+
+
+LibraryDefined void BENCHALL_STRINGS( BenchOptions *opts )
+{
+    static const BenchCase cases[] = {
+        { "dynstr_append", 100, 10000000,
+          bench_dynstr_setup, bench_dynstr_append, bench_dynstr_teardown },
+        // O(n) per prepend
+        { "dynstr_prepend", 100, 10000,
+          bench_dynstr_setup, bench_dynstr_prepend, bench_dynstr_teardown },
+        { "string_split", 100, 1000000,
+          bench_strings_setup, bench_string_split, bench_strings_teardown },
+        { "string_replace", 100, 10000000,
+          bench_strings_setup, bench_string_replace, bench_strings_teardown },
+        { "string_join", 100, 1000000,
+          bench_strings_setup, bench_string_join, bench_strings_teardown },
+    };
+
+    bench_run_cases( opts, cases, countof( cases ) );
+}
+
+#endif //BENCH_STRINGS_H
@@ -0,0 +1,35 @@
+/*
+ * Benchmark suite for the containers and string routines.
+ *
+ * usage: bench_clibs [--format=csv|json] [--filter=SUBSTRING] [--warmup=N]
+ *                    [--reps=N] [--min-time-ms=N] [--max-size=N]
+ *
+ * Prints one CSV row (or JSON object) per case and size
+ * with the median, p99 and minimum ns/op and bytes allocated per op,
+ * so that the output of two runs can be diffed (see `bench/bench.h`).
+ */
+
+#include "bench/bench.h"
+#include "bench/bench_dict.h"
+#include "bench/bench_list.h"
+#include "bench/bench_queue.h"
+#include "bench/bench_set.h"
+#include "bench/bench_strings.h"
+
+
+int main( const int argc, char *argv[] )
+{
+    BenchOptions opts = bench_parse_options( argc, argv );
+
+    bench_begin( &opts );
+
+    BENCHALL_LIST( &opts );
+    BENCHALL_SET( &opts );
+    BENCHALL_DICT( &opts );
+    BENCHALL_QUEUE( &opts );
+    BENCHALL_STRINGS( &opts );
+
+    bench_end( &opts );
+
+    return EXIT_SUCCESS;
+}
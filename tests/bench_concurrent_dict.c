@@ -0,0 +1,187 @@
+/*
+ * Measures the throughput of a dictionary shared by 1..N threads,
+ * at read/write ratios of 99/1, 90/10 and 50/50.
+ * Every operation is a lookup or a value replacement of a random key.
+ *
+ *  - "Dict+rwlock":    `Dictionary` behind one `pthread_rwlock_t`
+ *                      (what `ConcurrentDict` replaces)
+ *  - "ConcurrentDict": `CDICT_DEF_SHARDS` shards
+ *
+ * Usage: bench_concurrent_dict [max threads]
+ * (by default, as many as there are CPUs, at most 64)
+ */
+
+#include "../src/headers/errors.h"
+#include "../src/structs/concurrent_dict.h"
+#include "../src/structs/dictionary.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h> /* sysconf */
+
+
+#define BENCH_KEYS           ( 1 << 16 )
+#define BENCH_OPS_PER_THREAD ( 1 << 19 )
+#define BENCH_MAX_THREADS    64
+
+
+Private uint64_t now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000 + ( uint64_t ) ts.tv_nsec;
+}
+
+/** xorshift64 */
+Private inline uint64_t next_random( uint64_t *state )
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+
+struct bench_thread {
+    struct dictionary *dict;
+    pthread_rwlock_t *lock;
+    ConcurrentDict *cdict;
+
+    unsigned read_percent;
+    uint64_t seed;
+    uint64_t sum; // of the values read, so that the reads aren't optimized out
+};
+
+Private void *locked_worker( void *arg )
+{
+    struct bench_thread *thread = arg;
+    uint64_t state              = thread->seed;
+
+    for ( size_t i = 0; i < BENCH_OPS_PER_THREAD; ++i )
+    {
+        const uint64_t random = next_random( &state );
+        const uint64_t key    = random % BENCH_KEYS;
+
+        if ( ( random >> 32 & 0xFFFF ) % 100 < thread->read_percent )
+        {
+            pthread_rwlock_rdlock( thread->lock );
+            const uint64_t *val = dict_get_val( thread->dict, &key, sizeof key );
+            thread->sum += *val;
+            pthread_rwlock_unlock( thread->lock );
+        }
+        else
+        {
+            pthread_rwlock_wrlock( thread->lock );
+            const int rv = dict_set_val( thread->dict, &key, sizeof key, &random,
+                                         sizeof random );
+            pthread_rwlock_unlock( thread->lock );
+            if ( rv != RV_SUCCESS )
+                errx( EXIT_FAILURE, "dict_set_val" );
+        }
+    }
+    return NULL;
+}
+
+Private void *cdict_worker( void *arg )
+{
+    struct bench_thread *thread = arg;
+    uint64_t state              = thread->seed;
+
+    for ( size_t i = 0; i < BENCH_OPS_PER_THREAD; ++i )
+    {
+        const uint64_t random = next_random( &state );
+        const uint64_t key    = random % BENCH_KEYS;
+
+        if ( ( random >> 32 & 0xFFFF ) % 100 < thread->read_percent )
+        {
+            uint64_t val = 0;
+            cdict_get_val( thread->cdict, &key, sizeof key, &val, sizeof val );
+            thread->sum += val;
+        }
+        else if ( cdict_set_val( thread->cdict, &key, sizeof key, &random,
+                                 sizeof random )
+                  != RV_SUCCESS )
+            errx( EXIT_FAILURE, "cdict_set_val" );
+    }
+    return NULL;
+}
+
+
+/**
+ * Runs `n_threads` of `worker`, each on a copy of `proto` with its own seed
+ *
+ * @return millions of operations per second
+ */
+Private double run_threads( const size_t n_threads,
+                            void *( *worker )( void * ),
+                            const struct bench_thread *proto )
+{
+    pthread_t threads[ BENCH_MAX_THREADS ];
+    struct bench_thread args[ BENCH_MAX_THREADS ];
+
+    for ( size_t i = 0; i < n_threads; ++i )
+    {
+        args[ i ]      = *proto;
+        args[ i ].seed = 0x9E3779B97F4A7C15 * ( i + 1 );
+    }
+
+    const uint64_t start = now_ns();
+    for ( size_t i = 0; i < n_threads; ++i )
+        if ( pthread_create( threads + i, NULL, worker, args + i ) != 0 )
+            errx( EXIT_FAILURE, "pthread_create" );
+    for ( size_t i = 0; i < n_threads; ++i )
+        pthread_join( threads[ i ], NULL );
+    const uint64_t elapsed = now_ns() - start;
+
+    return ( double ) ( n_threads * BENCH_OPS_PER_THREAD ) * 1e3 / ( double ) elapsed;
+}
+
+
+int main( const int argc, char *const argv[] )
+{
+    const long wanted        = argc > 1 ? strtol( argv[ 1 ], NULL, 10 )
+                                        : sysconf( _SC_NPROCESSORS_ONLN );
+    const size_t max_threads = wanted >= BENCH_MAX_THREADS ? BENCH_MAX_THREADS
+                             : wanted >= 1                 ? ( size_t ) wanted
+                                                           : 1;
+
+    struct dictionary *dict = dict_init();
+    ConcurrentDict *cdict   = cdict_init();
+    pthread_rwlock_t lock;
+    if ( dict == NULL || cdict == NULL || pthread_rwlock_init( &lock, NULL ) != 0 )
+        errx( EXIT_FAILURE, "init" );
+
+    for ( uint64_t key = 0; key < BENCH_KEYS; ++key )
+        if ( dict_insert( dict, &key, sizeof key, &key, sizeof key ) == RV_ERROR
+             || cdict_insert( cdict, &key, sizeof key, &key, sizeof key ) == RV_ERROR )
+            errx( EXIT_FAILURE, "insert" );
+
+    printf( "throughput (million ops/s), %d keys, %d ops per thread\n", BENCH_KEYS,
+            BENCH_OPS_PER_THREAD );
+    printf( "%8s %8s %14s %14s\n",
+            "reads %", "threads", "Dict+rwlock", "ConcurrentDict" );
+
+    const unsigned read_percents[] = { 99, 90, 50 };
+    for ( size_t r = 0; r < sizeof read_percents / sizeof *read_percents; ++r )
+        for ( size_t n_threads = 1; n_threads <= max_threads; n_threads *= 2 )
+        {
+            const struct bench_thread proto = {
+                .dict         = dict,
+                .lock         = &lock,
+                .cdict        = cdict,
+                .read_percent = read_percents[ r ],
+            };
+            const double locked_mops = run_threads( n_threads, locked_worker, &proto );
+            const double cdict_mops  = run_threads( n_threads, cdict_worker, &proto );
+
+            printf( "%8u %8zu %14.1f %14.1f\n",
+                    read_percents[ r ], n_threads, locked_mops, cdict_mops );
+        }
+
+    pthread_rwlock_destroy( &lock );
+    cdict_destroy( cdict );
+    dict_destroy( dict );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*
+ * Measures the latency of every single insert into a growing `Dictionary`
+ * and prints its percentiles.
+ *
+ * The `Set` (which rehashes everything at once when it grows) is measured
+ * the same way for comparison: its maximum is the cost of the last full rehash,
+ * while the `Dictionary` spreads that work over the following inserts.
+ * What remains of the `Dictionary`'s maximum is mostly `free()`-ing the old table
+ * (the kernel unmapping its pages) once everything has been moved out of it.
+ *
+ * Then compares the lookup cost (hits and misses) of the dictionary engines.
+ */
+
+#include "../src/headers/errors.h"
+#include "../src/headers/misc.h" /* countof */
+#include "../src/structs/dictionary.h"
+#include "../src/structs/set.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+
+#define BENCH_INSERTS ( 1 << 22 )
+
+#define BENCH_MIN_SIZE 1000
+#define BENCH_MAX_SIZE 1000000
+#define BENCH_LOOKUPS  1000000
+
+
+Private uint64_t now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000 + ( uint64_t ) ts.tv_nsec;
+}
+
+Private int cmp_u64( const void *a, const void *b )
+{
+    const uint64_t x = *( const uint64_t * ) a;
+    const uint64_t y = *( const uint64_t * ) b;
+    return ( x > y ) - ( x < y );
+}
+
+
+Private int insert_dict( void *dict, const uint64_t key )
+{
+    return dict_insert( dict, &key, sizeof key, &key, sizeof key ) == DICTINSERT_INSERTED
+                   ? RV_SUCCESS
+                   : RV_ERROR;
+}
+
+Private int insert_set( void *set, const uint64_t key )
+{
+    return set_insert( set, &key, sizeof key ) == SETINSERT_INSERTED ? RV_SUCCESS
+                                                                     : RV_ERROR;
+}
+
+
+Private void print_percentiles( const char *name, uint64_t *latencies, const size_t n )
+{
+    static const double percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+
+    qsort( latencies, n, sizeof *latencies, cmp_u64 );
+
+    printf( "%-12s", name );
+    for ( size_t i = 0; i < countof( percentiles ); ++i )
+    {
+        const size_t idx = ( size_t ) ( ( double ) n * percentiles[ i ] / 100 );
+        printf( " %10" PRIu64, latencies[ idx ] );
+    }
+    printf( " %10" PRIu64 "\n", latencies[ n - 1 ] );
+}
+
+Private void bench_one( const char *name, void *container,
+                        int ( *insert )( void *, uint64_t ), uint64_t *latencies )
+{
+    for ( uint64_t i = 0; i < BENCH_INSERTS; ++i )
+    {
+        const uint64_t start = now_ns();
+        if ( insert( container, i ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "%s: insert", name );
+        latencies[ i ] = now_ns() - start;
+    }
+
+    print_percentiles( name, latencies, BENCH_INSERTS );
+}
+
+
+Private Dictionary *make_dict( const enum DictEngine engine )
+{
+    Dictionary *dict = dict_init_with_engine( engine, NULL, HASH_DEFAULT_SEED );
+    if ( dict == NULL )
+        err( EXIT_FAILURE, "dict_init_with_engine" );
+    return dict;
+}
+
+/** Prints the cost of a single hit and miss of `dict_get_val()` in ns */
+Private void bench_lookups( const enum DictEngine engine, const size_t size )
+{
+    Dictionary *dict = make_dict( engine );
+    for ( uint64_t i = 0; i < size; ++i )
+        if ( insert_dict( dict, i ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "insert" );
+
+    size_t found   = 0;
+    uint64_t start = now_ns();
+    for ( uint64_t i = 0; i < BENCH_LOOKUPS; ++i )
+    {
+        const uint64_t key = i % size;
+        found += dict_get_val( dict, &key, sizeof key ) != NULL;
+    }
+    const double hit_ns = ( double ) ( now_ns() - start ) / BENCH_LOOKUPS;
+
+    start = now_ns();
+    for ( uint64_t i = 0; i < BENCH_LOOKUPS; ++i )
+    {
+        const uint64_t key = size + i;
+        found += dict_get_val( dict, &key, sizeof key ) != NULL;
+    }
+    const double miss_ns = ( double ) ( now_ns() - start ) / BENCH_LOOKUPS;
+
+    if ( found != BENCH_LOOKUPS )
+        errx( EXIT_FAILURE, "lookups found %zu items, expected %d", found,
+              BENCH_LOOKUPS );
+
+    printf( " %8.1f %8.1f", hit_ns, miss_ns );
+    dict_destroy( dict );
+}
+
+
+int main( void )
+{
+    uint64_t *latencies = malloc( BENCH_INSERTS * sizeof *latencies );
+    if ( latencies == NULL )
+        err( EXIT_FAILURE, "malloc" );
+
+    printf( "insert latency (ns), %d inserts\n", BENCH_INSERTS );
+    printf( "%-12s %10s %10s %10s %10s %10s %10s\n", "", "p50", "p90", "p99", "p99.9",
+            "p99.99", "max" );
+
+    Dictionary *dict = make_dict( DICT_ENGINE_LINEAR );
+    bench_one( "Dictionary", dict, insert_dict, latencies );
+    dict_destroy( dict );
+
+    dict = make_dict( DICT_ENGINE_SWISS );
+    bench_one( "(swiss)", dict, insert_dict, latencies );
+    dict_destroy( dict );
+
+    Set *set = set_init();
+    if ( set == NULL )
+        err( EXIT_FAILURE, "set_init" );
+    bench_one( "Set", set, insert_set, latencies );
+    set_destroy( set );
+
+    free( latencies );
+
+    printf( "\nlookup (ns/op)\n" );
+    printf( "%10s %17s %17s\n", "", "linear", "swiss" );
+    printf( "%10s %8s %8s %8s %8s\n", "size", "hit", "miss", "hit", "miss" );
+    for ( size_t size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size *= 10 )
+    {
+        printf( "%10zu", size );
+        bench_lookups( DICT_ENGINE_LINEAR, size );
+        bench_lookups( DICT_ENGINE_SWISS, size );
+        printf( "\n" );
+    }
+
+    return EXIT_SUCCESS;
+}
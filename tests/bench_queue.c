@@ -0,0 +1,203 @@
+/*
+ * Measures the throughput of passing items between threads
+ * with 1..N producer/consumer pairs.
+ *
+ *  - "Queue+mutex": the single-threaded `Queue` behind one `pthread_mutex_t`
+ *    (what the concurrent queues replace)
+ *  - "MpmcQueue":   all pairs share one queue
+ *  - "SpscQueue":   every pair has its own queue (items moved in batches)
+ */
+
+#include "../src/headers/errors.h"
+#include "../src/structs/concurrent_queue.h"
+#include "../src/structs/queue.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h> /* sysconf */
+
+
+#define BENCH_ITEMS_PER_PRODUCER ( 1 << 20 )
+#define BENCH_QUEUE_CAP          1024
+#define BENCH_BATCH              32
+#define BENCH_MAX_PAIRS          8
+
+
+Private uint64_t now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000 + ( uint64_t ) ts.tv_nsec;
+}
+
+
+/* -------- Queue + mutex -------- */
+
+struct locked_queue {
+    Queue *queue;
+    pthread_mutex_t lock;
+};
+
+Private void *locked_producer( void *arg )
+{
+    struct locked_queue *lq = arg;
+    for ( uint64_t i = 0; i < BENCH_ITEMS_PER_PRODUCER; ++i )
+    {
+        pthread_mutex_lock( &lq->lock );
+        const int rv = queue_enqueue( lq->queue, &i );
+        pthread_mutex_unlock( &lq->lock );
+        if ( rv != RV_SUCCESS )
+            errx( EXIT_FAILURE, "queue_enqueue" );
+    }
+    return NULL;
+}
+
+Private void *locked_consumer( void *arg )
+{
+    struct locked_queue *lq = arg;
+    for ( uint64_t n = 0; n < BENCH_ITEMS_PER_PRODUCER; )
+    {
+        uint64_t item;
+        pthread_mutex_lock( &lq->lock );
+        const bool got = !queue_is_empty( lq->queue )
+                         && queue_dequeue( lq->queue, &item ) == RV_SUCCESS;
+        pthread_mutex_unlock( &lq->lock );
+        if ( got )
+            ++n;
+        else
+            sched_yield();
+    }
+    return NULL;
+}
+
+
+/* -------- MPMC -------- */
+
+Private void *mpmc_producer( void *queue )
+{
+    for ( uint64_t i = 0; i < BENCH_ITEMS_PER_PRODUCER; ++i )
+        mpmc_queue_enqueue( queue, &i );
+    return NULL;
+}
+
+Private void *mpmc_consumer( void *queue )
+{
+    uint64_t item;
+    for ( uint64_t n = 0; n < BENCH_ITEMS_PER_PRODUCER; ++n )
+        mpmc_queue_dequeue( queue, &item );
+    return NULL;
+}
+
+
+/* -------- SPSC -------- */
+
+Private void *spsc_producer( void *queue )
+{
+    uint64_t batch[ BENCH_BATCH ];
+    for ( uint64_t i = 0; i < BENCH_ITEMS_PER_PRODUCER; )
+    {
+        for ( size_t j = 0; j < BENCH_BATCH; ++j )
+            batch[ j ] = i + j;
+
+        const size_t n = spsc_queue_try_enqueue_n( queue, batch, BENCH_BATCH );
+        if ( n == 0 )
+            sched_yield();
+        i += n;
+    }
+    return NULL;
+}
+
+Private void *spsc_consumer( void *queue )
+{
+    uint64_t batch[ BENCH_BATCH ];
+    for ( uint64_t n = 0; n < BENCH_ITEMS_PER_PRODUCER; )
+    {
+        const size_t got = spsc_queue_try_dequeue_n( queue, batch, BENCH_BATCH );
+        if ( got == 0 )
+            sched_yield();
+        n += got;
+    }
+    return NULL;
+}
+
+
+/**
+ * Runs `n_pairs` producers and consumers, the `i`-th pair getting `args[ i ]`
+ *
+ * @return millions of items per second
+ */
+Private double run_pairs( const size_t n_pairs,
+                          void *( *producer )( void * ),
+                          void *( *consumer )( void * ),
+                          void *const *args )
+{
+    pthread_t producers[ BENCH_MAX_PAIRS ];
+    pthread_t consumers[ BENCH_MAX_PAIRS ];
+
+    const uint64_t start = now_ns();
+    for ( size_t i = 0; i < n_pairs; ++i )
+        if ( pthread_create( producers + i, NULL, producer, args[ i ] ) != 0
+             || pthread_create( consumers + i, NULL, consumer, args[ i ] ) != 0 )
+            errx( EXIT_FAILURE, "pthread_create" );
+
+    for ( size_t i = 0; i < n_pairs; ++i )
+    {
+        pthread_join( producers[ i ], NULL );
+        pthread_join( consumers[ i ], NULL );
+    }
+    const uint64_t elapsed = now_ns() - start;
+
+    return ( double ) ( n_pairs * BENCH_ITEMS_PER_PRODUCER ) * 1e3 / ( double ) elapsed;
+}
+
+
+int main( void )
+{
+    const long n_cpus      = sysconf( _SC_NPROCESSORS_ONLN );
+    const size_t max_pairs = n_cpus >= 2 * BENCH_MAX_PAIRS ? BENCH_MAX_PAIRS
+                           : n_cpus >= 2                  ? ( size_t ) n_cpus / 2
+                                                          : 1;
+
+    printf( "throughput (million items/s), %d items per producer\n",
+            BENCH_ITEMS_PER_PRODUCER );
+    printf( "%6s %14s %14s %14s\n", "pairs", "Queue+mutex", "MpmcQueue", "SpscQueue" );
+
+    for ( size_t n_pairs = 1; n_pairs <= max_pairs; n_pairs *= 2 )
+    {
+        void *args[ BENCH_MAX_PAIRS ];
+
+        struct locked_queue lq = { .queue = queue_init( sizeof( uint64_t ) ) };
+        if ( lq.queue == NULL || pthread_mutex_init( &lq.lock, NULL ) != 0 )
+            errx( EXIT_FAILURE, "locked queue init" );
+        for ( size_t i = 0; i < n_pairs; ++i )
+            args[ i ] = &lq;
+        const double locked_mops =
+                run_pairs( n_pairs, locked_producer, locked_consumer, args );
+        pthread_mutex_destroy( &lq.lock );
+        queue_destroy( lq.queue );
+
+        MpmcQueue *mpmc = mpmc_queue_init( sizeof( uint64_t ), BENCH_QUEUE_CAP );
+        if ( mpmc == NULL )
+            errx( EXIT_FAILURE, "mpmc_queue_init" );
+        for ( size_t i = 0; i < n_pairs; ++i )
+            args[ i ] = mpmc;
+        const double mpmc_mops = run_pairs( n_pairs, mpmc_producer, mpmc_consumer, args );
+        mpmc_queue_destroy( mpmc );
+
+        for ( size_t i = 0; i < n_pairs; ++i )
+            if ( ( args[ i ] = spsc_queue_init( sizeof( uint64_t ), BENCH_QUEUE_CAP ) )
+                 == NULL )
+                errx( EXIT_FAILURE, "spsc_queue_init" );
+        const double spsc_mops = run_pairs( n_pairs, spsc_producer, spsc_consumer, args );
+        for ( size_t i = 0; i < n_pairs; ++i )
+            spsc_queue_destroy( args[ i ] );
+
+        printf( "%6zu %14.1f %14.1f %14.1f\n",
+                n_pairs, locked_mops, mpmc_mops, spsc_mops );
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/*
+ * Measures how the thread pool scales from 1 to N worker threads
+ * (N is the number of online CPUs, or the first argument).
+ *
+ *  - "parallel_for": a compute-bound loop over `BENCH_FOR_N` indices
+ *  - "fib tasks":    recursive Fibonacci, one task (submit + wait) per call;
+ *                    the overhead of the tasks and of stealing
+ *  - "list sort":    `list_parallel_sort()` of `BENCH_SORT_N` random integers
+ *
+ * The speedup is relative to the run with 1 worker.
+ */
+
+#include "../src/headers/errors.h"
+#include "../src/headers/simple_math.h" /* min_m */
+#include "../src/structs/dynarr_parallel.h"
+#include "../src/thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h> /* sysconf */
+
+
+#define BENCH_FOR_N  ( 1 << 24 )
+#define BENCH_FIB    24
+#define BENCH_SORT_N ( 1 << 22 )
+
+
+Private uint64_t now_ns( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t ) ts.tv_sec * 1000000000 + ( uint64_t ) ts.tv_nsec;
+}
+
+/** splitmix64 */
+Private uint64_t mix( uint64_t x )
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+    return x ^ ( x >> 31 );
+}
+
+
+/* -------- parallel_for -------- */
+
+Private void mix_range( const size_t from, const size_t to, void *sum )
+{
+    uint64_t local = 0;
+    for ( size_t i = from; i < to; ++i )
+        local += mix( mix( i ) );
+    __atomic_fetch_add( ( uint64_t * ) sum, local, __ATOMIC_RELAXED );
+}
+
+/** @return milliseconds */
+Private double bench_parallel_for( ThreadPool *pool )
+{
+    uint64_t sum         = 0;
+    const uint64_t start = now_ns();
+    if ( thread_pool_parallel_for( pool, 0, BENCH_FOR_N, 0, mix_range, &sum )
+         != RV_SUCCESS )
+        errx( EXIT_FAILURE, "thread_pool_parallel_for" );
+    const uint64_t elapsed = now_ns() - start;
+
+    if ( sum == 0 )
+        errx( EXIT_FAILURE, "parallel_for: no sum" );
+    return ( double ) elapsed / 1e6;
+}
+
+
+/* -------- fib -------- */
+
+struct fib {
+    ThreadPool *pool;
+    uintptr_t n;
+};
+
+Private void *fib_task( void *arg )
+{
+    const struct fib *fib = arg;
+    if ( fib->n < 2 )
+        return ( void * ) fib->n;
+
+    struct fib left  = { .pool = fib->pool, .n = fib->n - 1 };
+    struct fib right = { .pool = fib->pool, .n = fib->n - 2 };
+
+    ThreadPoolFuture *future = thread_pool_submit( fib->pool, fib_task, &left );
+    if ( future == NULL )
+        errx( EXIT_FAILURE, "thread_pool_submit" );
+
+    const uintptr_t r = ( uintptr_t ) fib_task( &right );
+    return ( void * ) ( r + ( uintptr_t ) thread_pool_future_wait( future ) );
+}
+
+Private uintptr_t fib_serial( const uintptr_t n )
+{
+    uintptr_t a = 0, b = 1;
+    for ( uintptr_t i = 0; i < n; ++i )
+    {
+        const uintptr_t c = a + b;
+        a                 = b;
+        b                 = c;
+    }
+    return a;
+}
+
+/** @return millions of tasks per second */
+Private double bench_fib( ThreadPool *pool )
+{
+    struct fib root = { .pool = pool, .n = BENCH_FIB };
+
+    const uint64_t start     = now_ns();
+    ThreadPoolFuture *future = thread_pool_submit( pool, fib_task, &root );
+    if ( future == NULL )
+        errx( EXIT_FAILURE, "thread_pool_submit" );
+    const uintptr_t fib    = ( uintptr_t ) thread_pool_future_wait( future );
+    const uint64_t elapsed = now_ns() - start;
+
+    if ( fib != fib_serial( BENCH_FIB ) )
+        errx( EXIT_FAILURE, "fib: wrong result" );
+
+    // the root and one task per inner call
+    const uintptr_t n_tasks = fib_serial( BENCH_FIB + 1 );
+    return ( double ) n_tasks * 1e3 / ( double ) elapsed;
+}
+
+
+/* -------- list sort -------- */
+
+Private int cmp_u64( const void *a, const void *b )
+{
+    const uint64_t x = *( const uint64_t * ) a;
+    const uint64_t y = *( const uint64_t * ) b;
+    return ( x > y ) - ( x < y );
+}
+
+/** @return milliseconds */
+Private double bench_list_sort( ThreadPool *pool )
+{
+    List *ls = list_init_type( uint64_t );
+    if ( ls == NULL )
+        errx( EXIT_FAILURE, "list_init_type" );
+    for ( uint64_t i = 0; i < BENCH_SORT_N; ++i )
+    {
+        const uint64_t n = mix( i );
+        if ( list_append( ls, &n ) != RV_SUCCESS )
+            errx( EXIT_FAILURE, "list_append" );
+    }
+
+    const ListParallelOptions opts = { .pool = pool };
+
+    const uint64_t start = now_ns();
+    if ( list_parallel_sort( ls, cmp_u64, &opts ) != RV_SUCCESS )
+        errx( EXIT_FAILURE, "list_parallel_sort" );
+    const uint64_t elapsed = now_ns() - start;
+
+    list_destroy( ls );
+    return ( double ) elapsed / 1e6;
+}
+
+
+int main( const int argc, char *const argv[] )
+{
+    long max_threads = sysconf( _SC_NPROCESSORS_ONLN );
+    if ( argc > 1 )
+        max_threads = strtol( argv[ 1 ], NULL, 10 );
+    if ( max_threads < 1 )
+        max_threads = 1;
+
+    printf( "%7s %16s %8s %16s %8s %14s %8s\n",
+            "threads", "parallel_for ms", "speedup", "fib Mtasks/s", "speedup",
+            "list sort ms", "speedup" );
+
+    double base_for = 0, base_fib = 0, base_sort = 0;
+    for ( long n_threads = 1;; n_threads = min_m( 2 * n_threads, max_threads ) )
+    {
+        ThreadPool *pool = thread_pool_init( ( size_t ) n_threads );
+        if ( pool == NULL )
+            errx( EXIT_FAILURE, "thread_pool_init" );
+
+        const double for_ms   = bench_parallel_for( pool );
+        const double fib_mtps = bench_fib( pool );
+        const double sort_ms  = bench_list_sort( pool );
+        thread_pool_destroy( pool );
+
+        if ( n_threads == 1 )
+        {
+            base_for  = for_ms;
+            base_fib  = fib_mtps;
+            base_sort = sort_ms;
+        }
+
+        printf( "%7ld %16.1f %8.2f %16.2f %8.2f %14.1f %8.2f\n",
+                n_threads, for_ms, base_for / for_ms, fib_mtps, fib_mtps / base_fib,
+                sort_ms, base_sort / sort_ms );
+
+        if ( n_threads == max_threads )
+            break;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#ifndef TEST_ALLOCATOR_H
+#define TEST_ALLOCATOR_H
+
+#include "../../src/allocator.h"
+#include "../../src/headers/assert_that.h"
+#include "../../src/headers/unit_tests.h"
+#include "../../src/structs/dictionary.h"
+#include "../../src/structs/dynarr.h"
+#include "../../src/structs/dynstring.h"
+#include "../../src/structs/queue.h"
+#include "../../src/structs/set.h"
+
+#include <stdint.h> /* uintptr_t */
+#include <string.h>
+
+
+#define ALLOCATOR_TEST_N 1000
+
+#define is_aligned( PTR ) ( ( uintptr_t ) ( PTR ) % ALLOCATOR_ALIGNMENT == 0 )
+
+
+TEST( arena )
+{
+    Arena *arena = arena_init( 256 );
+    assert_that( arena != NULL, "init failed" );
+
+    // also larger than a block
+    bool aligned = true;
+    for ( size_t size = 1; size <= 300; ++size )
+    {
+        byte *ptr = arena_alloc( arena, size );
+        assert_that( ptr != NULL, "arena_alloc" );
+        memset( ptr, ( int ) size, size );
+
+        aligned = aligned && is_aligned( ptr );
+    }
+    UNIT_TEST( aligned );
+    UNIT_TEST( arena_used( arena ) >= 300 * 301 / 2 );
+
+    arena_reset( arena );
+    UNIT_TEST( arena_used( arena ) == 0 );
+
+    // the last allocation grows in place
+    const Allocator *allocator = arena_allocator( arena );
+    void *ptr                  = allocator_alloc( allocator, 16 );
+    UNIT_TEST( allocator_resize( allocator, ptr, 16, 64 ) == ptr );
+    allocator_free( allocator, ptr, 64 );
+    UNIT_TEST( arena_used( arena ) == 0 );
+
+    arena_destroy( arena );
+}
+END_TEST
+
+TEST( slab )
+{
+    SlabPool *pool = slab_init( sizeof( int ), 8 );
+    assert_that( pool != NULL, "init failed" );
+
+    int *ptrs[ ALLOCATOR_TEST_N ];
+    bool alloc = true;
+    for ( int i = 0; i < ALLOCATOR_TEST_N; ++i )
+    {
+        alloc = alloc && ( ptrs[ i ] = slab_alloc( pool ) ) != NULL
+                && is_aligned( ptrs[ i ] );
+        if ( ptrs[ i ] != NULL )
+            *ptrs[ i ] = i;
+    }
+    UNIT_TEST( alloc );
+
+    bool intact = true;
+    for ( int i = 0; i < ALLOCATOR_TEST_N; ++i )
+        intact = intact && *ptrs[ i ] == i;
+    UNIT_TEST( intact );
+
+    // freed objects are reused
+    slab_free( pool, ptrs[ 42 ] );
+    UNIT_TEST( slab_alloc( pool ) == ptrs[ 42 ] );
+
+    // larger blocks fall back to `malloc()`
+    const Allocator *allocator = slab_allocator( pool );
+    void *big                  = allocator_alloc( allocator, 1000 );
+    UNIT_TEST( big != NULL );
+    allocator_free( allocator, big, 1000 );
+
+    slab_destroy( pool );
+}
+END_TEST
+
+TEST( tcache )
+{
+    const Allocator *allocator = tcache_allocator();
+
+    void *ptr = allocator_alloc( allocator, 100 );
+    assert_that( ptr != NULL, "alloc" );
+    UNIT_TEST( allocator_resize( allocator, ptr, 100, 120 ) == ptr );
+    allocator_free( allocator, ptr, 120 );
+    UNIT_TEST( allocator_alloc( allocator, 128 ) == ptr );
+    allocator_free( allocator, ptr, 128 );
+
+    void *big = allocator_alloc( allocator, TCACHE_MAX_SIZE + 1 );
+    UNIT_TEST( big != NULL );
+    allocator_free( allocator, big, TCACHE_MAX_SIZE + 1 );
+
+    tcache_flush();
+}
+END_TEST
+
+
+/** Fills one of each container using `allocator` and checks their contents */
+Private bool fill_containers( const Allocator *allocator, const bool destroy )
+{
+    List *list       = list_init_with_allocator( sizeof( int ), allocator );
+    DynString *str   = dynstr_init_with_allocator( allocator );
+    Set *set         = set_init_with_allocator( allocator );
+    Dictionary *dict = dict_init_with_allocator( allocator );
+    Queue *queue     = queue_init_with_allocator( sizeof( int ), allocator );
+    assert_that( list != NULL && str != NULL && set != NULL && dict != NULL
+                         && queue != NULL,
+                 "init failed" );
+
+    char big_key[ 64 ] = { 0 };
+    char digit[ 3 ]    = "0,";
+    for ( int i = 0; i < ALLOCATOR_TEST_N; ++i )
+    {
+        memcpy( big_key, &i, sizeof i );
+        digit[ 0 ] = ( char ) ( '0' + i % 10 );
+        assert_that( list_append( list, &i ) == RV_SUCCESS, "list_append" );
+        assert_that( dynstr_append( str, digit ) >= 0, "dynstr_append" );
+        assert_that( set_insert( set, big_key, sizeof big_key ) == SETINSERT_INSERTED,
+                     "set_insert" );
+        assert_that( dict_insert( dict, &i, sizeof i, big_key, sizeof big_key )
+                             == DICTINSERT_INSERTED,
+                     "dict_insert" );
+        assert_that( queue_enqueue( queue, &i ) == RV_SUCCESS, "queue_enqueue" );
+    }
+
+    bool ok = list_size( list ) == ALLOCATOR_TEST_N
+              && dynstr_len( str ) == 2 * ALLOCATOR_TEST_N
+              && set_size( set ) == ALLOCATOR_TEST_N
+              && dict_size( dict ) == ALLOCATOR_TEST_N
+              && queue_get_size( queue ) == ALLOCATOR_TEST_N;
+
+    for ( int i = 0; i < ALLOCATOR_TEST_N; ++i )
+    {
+        memcpy( big_key, &i, sizeof i );
+        const char *val = dict_get_val( dict, &i, sizeof i );
+        int dequeued    = -1;
+        ok = ok && *( const int * ) list_see( list, i ) == i
+             && set_search( set, big_key, sizeof big_key ) && val != NULL
+             && memcmp( val, big_key, sizeof big_key ) == 0
+             && queue_dequeue( queue, &dequeued ) == RV_SUCCESS && dequeued == i;
+    }
+
+    // shrink everything back
+    for ( int i = 0; i < ALLOCATOR_TEST_N; ++i )
+    {
+        memcpy( big_key, &i, sizeof i );
+        ok = ok && list_pop( list, NULL ) == RV_SUCCESS
+             && set_remove( set, big_key, sizeof big_key ) == SETREMOVE_REMOVED
+             && dict_remove( dict, &i, sizeof i ) == DICTREMOVE_REMOVED;
+    }
+    ok = ok && dynstr_slice_e( str, 2 ) == RV_SUCCESS
+         && strcmp( dynstr_data( str ), "0," ) == 0;
+
+    if ( destroy )
+    {
+        list_destroy( list );
+        dynstr_destroy( str );
+        set_destroy( set );
+        dict_destroy( dict );
+        queue_destroy( queue );
+    }
+
+    return ok;
+}
+
+TEST( containers_with_allocator )
+{
+    UNIT_TEST( fill_containers( NULL, true ) );
+
+    UNIT_TEST( fill_containers( tcache_allocator(), true ) );
+    tcache_flush();
+
+    SlabPool *pool = slab_init( 64, 0 );
+    assert_that( pool != NULL, "slab_init" );
+    UNIT_TEST( fill_containers( slab_allocator( pool ), true ) );
+    slab_destroy( pool );
+
+    // containers in an arena need not be destroyed one by one
+    Arena *arena = arena_init( 0 );
+    assert_that( arena != NULL, "arena_init" );
+    UNIT_TEST( fill_containers( arena_allocator( arena ), false ) );
+    arena_reset( arena );
+    UNIT_TEST( fill_containers( arena_allocator( arena ), false ) );
+    arena_destroy( arena );
+}
+END_TEST
+
+
+LibraryDefined void RUNALL_ALLOCATOR( void )
+{
+    RUN_TEST( arena );
+    RUN_TEST( slab );
+    RUN_TEST( tcache );
+    RUN_TEST( containers_with_allocator );
+}
+
+#endif //TEST_ALLOCATOR_H
@@ -0,0 +1,188 @@
+#ifndef TEST_CONCURRENT_DICT_H
+#define TEST_CONCURRENT_DICT_H
+
+#include "../../src/headers/assert_that.h"
+#include "../../src/headers/unit_tests.h"
+#include "../../src/structs/concurrent_dict.h"
+
+#include <pthread.h>
+#include <string.h> /* memset */
+
+
+#define CDICT_TEST_N       20000
+#define CDICT_TEST_KEYS    256
+#define CDICT_TEST_ROUNDS  2000
+#define CDICT_TEST_READERS 3
+
+
+TEST( cdict )
+{
+    // a single shard, so that it grows and shrinks a lot
+    ConcurrentDict *dict = cdict_init_with( 1, NULL, HASH_DEFAULT_SEED );
+    assert_that( dict != NULL, "init failed" );
+
+    UNIT_TEST( cdict_size( dict ) == 0 );
+    UNIT_TEST( !cdict_has_key( dict, "", 0 ) );
+    UNIT_TEST( cdict_remove( dict, "", 0 ) == DICTREMOVE_NOT_FOUND );
+    UNIT_TEST( cdict_set_val( dict, "", 0, "", 0 ) == RV_EXCEPTION );
+
+    for ( int i = 0; i < CDICT_TEST_N; ++i )
+        UNIT_TEST( cdict_insert( dict, &i, sizeof i, &( long ) { i }, sizeof( long ) )
+                   == DICTINSERT_INSERTED );
+    UNIT_TEST( cdict_insert( dict, &( int ) { 7 }, sizeof( int ), "x", 1 )
+               == DICTINSERT_WAS_IN );
+    UNIT_TEST( cdict_size( dict ) == CDICT_TEST_N );
+
+    bool all_there = true;
+    for ( int i = 0; i < CDICT_TEST_N; ++i )
+    {
+        long val = -1;
+        all_there = all_there
+                    && cdict_get_val( dict, &i, sizeof i, &val, sizeof val )
+                               == sizeof( long )
+                    && val == i;
+    }
+    UNIT_TEST( all_there );
+
+    for ( int i = 0; i < CDICT_TEST_N; i += 2 )
+        UNIT_TEST( cdict_remove( dict, &i, sizeof i ) == DICTREMOVE_REMOVED );
+    UNIT_TEST( cdict_remove( dict, &( int ) { 0 }, sizeof( int ) )
+               == DICTREMOVE_NOT_FOUND );
+    UNIT_TEST( cdict_size( dict ) == CDICT_TEST_N / 2 );
+
+    bool odd_only = true;
+    for ( int i = 0; i < CDICT_TEST_N; ++i )
+        odd_only = odd_only && cdict_has_key( dict, &i, sizeof i ) == ( i % 2 == 1 );
+    UNIT_TEST( odd_only );
+
+    // heap copies: long key, long value replacing an inline one and back
+    const char long_key[] = "a key longer than sixteen bytes";
+    char long_val[ 40 ];
+    memset( long_val, 'v', sizeof long_val );
+    UNIT_TEST( cdict_insert( dict, long_key, sizeof long_key, "short", 6 )
+               == DICTINSERT_INSERTED );
+    UNIT_TEST( cdict_set_val( dict, long_key, sizeof long_key, long_val, sizeof long_val )
+               == RV_SUCCESS );
+
+    char got[ sizeof long_val ] = { 0 };
+    UNIT_TEST( cdict_get_val( dict, long_key, sizeof long_key, got, 1 )
+               == sizeof long_val );
+    UNIT_TEST( got[ 0 ] == 0 ); // didn't fit => not copied
+    UNIT_TEST( cdict_get_val( dict, long_key, sizeof long_key, got, sizeof got )
+               == sizeof long_val );
+    UNIT_TEST( memcmp( got, long_val, sizeof long_val ) == 0 );
+
+    UNIT_TEST( cdict_set_val( dict, long_key, sizeof long_key, "", 0 ) == RV_SUCCESS );
+    UNIT_TEST( cdict_get_val( dict, long_key, sizeof long_key, NULL, 0 ) == 0 );
+
+    for ( int i = 1; i < CDICT_TEST_N; i += 2 )
+        UNIT_TEST( cdict_remove( dict, &i, sizeof i ) == DICTREMOVE_REMOVED );
+    UNIT_TEST( cdict_size( dict ) == 1 );
+
+    cdict_destroy( dict );
+}
+END_TEST
+
+
+/*
+ * The writer keeps replacing the values (heap copies, every word of which
+ * is the same version number), removing and re-inserting keys,
+ * while the readers check that they never see a torn or freed value.
+ */
+struct cdict_test_val {
+    size_t words[ 3 ];
+};
+
+struct cdict_test_reader {
+    ConcurrentDict *dict;
+    const bool *done;
+    bool consistent;
+};
+
+Private void *cdict_test_read( void *arg )
+{
+    struct cdict_test_reader *reader = arg;
+
+    while ( !__atomic_load_n( reader->done, __ATOMIC_ACQUIRE ) )
+        for ( size_t key = 0; key < CDICT_TEST_KEYS; ++key )
+        {
+            struct cdict_test_val val;
+            const int64_t size = cdict_get_val( reader->dict, &key, sizeof key, &val,
+                                                sizeof val );
+            if ( size < 0 )
+                continue;
+
+            reader->consistent = reader->consistent && size == sizeof val
+                                 && val.words[ 0 ] == val.words[ 1 ]
+                                 && val.words[ 1 ] == val.words[ 2 ];
+        }
+    return NULL;
+}
+
+TEST( cdict_threads )
+{
+    ConcurrentDict *dict = cdict_init_with( 4, NULL, HASH_DEFAULT_SEED );
+    assert_that( dict != NULL, "init failed" );
+
+    for ( size_t key = 0; key < CDICT_TEST_KEYS; ++key )
+        assert_that( cdict_insert( dict, &key, sizeof key,
+                                   &( struct cdict_test_val ) { { 0, 0, 0 } },
+                                   sizeof( struct cdict_test_val ) )
+                             == DICTINSERT_INSERTED,
+                     "insert failed" );
+
+    bool done = false;
+    pthread_t threads[ CDICT_TEST_READERS ];
+    struct cdict_test_reader readers[ CDICT_TEST_READERS ];
+    for ( int i = 0; i < CDICT_TEST_READERS; ++i )
+    {
+        readers[ i ] = ( struct cdict_test_reader ) {
+            .dict       = dict,
+            .done       = &done,
+            .consistent = true,
+        };
+        assert_that( pthread_create( threads + i, NULL, cdict_test_read, readers + i )
+                             == 0,
+                     "pthread_create" );
+    }
+
+    bool writes_ok = true;
+    for ( size_t round = 1; round <= CDICT_TEST_ROUNDS; ++round )
+    {
+        const size_t key                = round % CDICT_TEST_KEYS;
+        const struct cdict_test_val val = { { round, round, round } };
+
+        writes_ok = writes_ok
+                    && cdict_set_val( dict, &key, sizeof key, &val, sizeof val )
+                               == RV_SUCCESS;
+        // tombstones pile up and the shards get rebuilt
+        if ( round % 3 == 0 )
+            writes_ok = writes_ok
+                        && cdict_remove( dict, &key, sizeof key ) == DICTREMOVE_REMOVED
+                        && cdict_insert( dict, &key, sizeof key, &val, sizeof val )
+                                   == DICTINSERT_INSERTED;
+    }
+    UNIT_TEST( writes_ok );
+
+    __atomic_store_n( &done, true, __ATOMIC_RELEASE );
+    bool consistent = true;
+    for ( int i = 0; i < CDICT_TEST_READERS; ++i )
+    {
+        pthread_join( threads[ i ], NULL );
+        consistent = consistent && readers[ i ].consistent;
+    }
+    UNIT_TEST( consistent );
+    UNIT_TEST( cdict_size( dict ) == CDICT_TEST_KEYS );
+
+    cdict_destroy( dict );
+}
+END_TEST
+
+
+LibraryDefined void RUNALL_CONCURRENT_DICT( void )
+{
+    RUN_TEST( cdict );
+    RUN_TEST( cdict_threads );
+}
+
+#endif //TEST_CONCURRENT_DICT_H
@@ -0,0 +1,171 @@
+#ifndef TEST_CONCURRENT_QUEUE_H
+#define TEST_CONCURRENT_QUEUE_H
+
+#include "../../src/headers/assert_that.h"
+#include "../../src/headers/unit_tests.h"
+#include "../../src/structs/concurrent_queue.h"
+
+#include <pthread.h>
+#include <string.h> /* memcmp */
+
+
+#define CQUEUE_TEST_N       100000
+#define CQUEUE_TEST_THREADS 4
+
+
+TEST( spsc_queue )
+{
+    SpscQueue *queue = spsc_queue_init( sizeof( int ), 5 );
+    assert_that( queue != NULL, "init failed" );
+    UNIT_TEST( spsc_queue_capacity( queue ) == 8 );
+
+    int data[ 10 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    UNIT_TEST( spsc_queue_try_enqueue_n( queue, data, 10 ) == 8 );
+    UNIT_TEST( !spsc_queue_try_enqueue( queue, data ) );
+    UNIT_TEST( spsc_queue_size( queue ) == 8 );
+
+    int out[ 10 ] = { 0 };
+    UNIT_TEST( spsc_queue_try_dequeue_n( queue, out, 5 ) == 5 );
+    UNIT_TEST( memcmp( out, data, 5 * sizeof( int ) ) == 0 );
+
+    // wraps around
+    UNIT_TEST( spsc_queue_try_enqueue_n( queue, data + 8, 2 ) == 2 );
+    UNIT_TEST( spsc_queue_try_dequeue_n( queue, out, 10 ) == 5 );
+    UNIT_TEST( memcmp( out, data + 5, 5 * sizeof( int ) ) == 0 );
+
+    int one = -1;
+    UNIT_TEST( !spsc_queue_try_dequeue( queue, &one ) );
+    UNIT_TEST( spsc_queue_size( queue ) == 0 );
+
+    spsc_queue_destroy( queue );
+}
+END_TEST
+
+TEST( mpmc_queue )
+{
+    MpmcQueue *queue = mpmc_queue_init( sizeof( int ), 8 );
+    assert_that( queue != NULL, "init failed" );
+
+    int data[ 10 ] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    UNIT_TEST( mpmc_queue_try_enqueue_n( queue, data, 10 ) == 8 );
+    UNIT_TEST( !mpmc_queue_try_enqueue( queue, data ) );
+    UNIT_TEST( mpmc_queue_size( queue ) == 8 );
+
+    int out[ 10 ] = { 0 };
+    UNIT_TEST( mpmc_queue_try_dequeue_n( queue, out, 5 ) == 5 );
+    UNIT_TEST( memcmp( out, data, 5 * sizeof( int ) ) == 0 );
+
+    UNIT_TEST( mpmc_queue_try_enqueue_n( queue, data + 8, 2 ) == 2 );
+    UNIT_TEST( mpmc_queue_try_dequeue_n( queue, out, 10 ) == 5 );
+    UNIT_TEST( memcmp( out, data + 5, 5 * sizeof( int ) ) == 0 );
+
+    int one = -1;
+    UNIT_TEST( !mpmc_queue_try_dequeue( queue, &one ) );
+    UNIT_TEST( mpmc_queue_size( queue ) == 0 );
+
+    mpmc_queue_destroy( queue );
+}
+END_TEST
+
+
+Private void *spsc_test_producer( void *queue )
+{
+    for ( int i = 0; i < CQUEUE_TEST_N; ++i )
+        spsc_queue_enqueue( queue, &i );
+    return NULL;
+}
+
+TEST( spsc_queue_threads )
+{
+    SpscQueue *queue = spsc_queue_init( sizeof( int ), 64 );
+    assert_that( queue != NULL, "init failed" );
+
+    pthread_t producer;
+    assert_that( pthread_create( &producer, NULL, spsc_test_producer, queue ) == 0,
+                 "pthread_create" );
+
+    bool in_order = true;
+    for ( int i = 0; i < CQUEUE_TEST_N; ++i )
+    {
+        int got = -1;
+        spsc_queue_dequeue( queue, &got );
+        in_order = in_order && got == i;
+    }
+    UNIT_TEST( in_order );
+
+    pthread_join( producer, NULL );
+    UNIT_TEST( spsc_queue_size( queue ) == 0 );
+    spsc_queue_destroy( queue );
+}
+END_TEST
+
+
+struct mpmc_test_consumer {
+    MpmcQueue *queue;
+    long long sum;
+};
+
+Private void *mpmc_test_producer( void *queue )
+{
+    for ( int i = 0; i < CQUEUE_TEST_N; ++i )
+        mpmc_queue_enqueue( queue, &i );
+    return NULL;
+}
+
+Private void *mpmc_test_consumer( void *arg )
+{
+    struct mpmc_test_consumer *consumer = arg;
+
+    for ( int i = 0; i < CQUEUE_TEST_N; ++i )
+    {
+        int got = -1;
+        mpmc_queue_dequeue( consumer->queue, &got );
+        consumer->sum += got;
+    }
+    return NULL;
+}
+
+TEST( mpmc_queue_threads )
+{
+    MpmcQueue *queue = mpmc_queue_init( sizeof( int ), 64 );
+    assert_that( queue != NULL, "init failed" );
+
+    pthread_t producers[ CQUEUE_TEST_THREADS ];
+    pthread_t consumers[ CQUEUE_TEST_THREADS ];
+    struct mpmc_test_consumer results[ CQUEUE_TEST_THREADS ];
+    for ( int i = 0; i < CQUEUE_TEST_THREADS; ++i )
+    {
+        results[ i ] = ( struct mpmc_test_consumer ) { .queue = queue, .sum = 0 };
+        const int rv_p = pthread_create( producers + i, NULL, mpmc_test_producer, queue );
+        const int rv_c =
+                pthread_create( consumers + i, NULL, mpmc_test_consumer, results + i );
+        assert_that( rv_p == 0 && rv_c == 0, "pthread_create" );
+    }
+
+    long long sum = 0;
+    for ( int i = 0; i < CQUEUE_TEST_THREADS; ++i )
+    {
+        pthread_join( producers[ i ], NULL );
+        pthread_join( consumers[ i ], NULL );
+        sum += results[ i ].sum;
+    }
+
+    // every item came out exactly once
+    UNIT_TEST( sum == ( long long ) CQUEUE_TEST_THREADS * CQUEUE_TEST_N
+                              * ( CQUEUE_TEST_N - 1 ) / 2 );
+    UNIT_TEST( mpmc_queue_size( queue ) == 0 );
+
+    mpmc_queue_destroy( queue );
+}
+END_TEST
+
+
+LibraryDefined void RUNALL_CONCURRENT_QUEUE( void )
+{
+    RUN_TEST( spsc_queue );
+    RUN_TEST( mpmc_queue );
+    RUN_TEST( spsc_queue_threads );
+    RUN_TEST( mpmc_queue_threads );
+}
+
+#endif //TEST_CONCURRENT_QUEUE_H
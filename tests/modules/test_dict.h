@@ -4,21 +4,333 @@
 #ifndef TEST_DICT_H
 #define TEST_DICT_H
 
+#include "../../src/headers/assert_that.h"
+#include "../../src/headers/misc.h" /* countof */
 #include "../../src/headers/pointer_utils.h"
 #include "../../src/headers/unit_tests.h"
 #include "../../src/structs/dictionary.h"
 
+#include <stdio.h>  /* snprintf */
+#include <string.h> /* strcmp */
+
+/** Every test runs once for each engine */
+static enum DictEngine dict_test_engine = DICT_ENGINE_LINEAR;
+
+static Dictionary *dict_test_init( void )
+{
+    return dict_init_with_engine( dict_test_engine, NULL, HASH_DEFAULT_SEED );
+}
+
+
 TEST( dict_init )
 {
-    Dictionary *dict = dict_init();
+    Dictionary *dict = dict_test_init();
     UNIT_TEST( dict != NULL );
     dict_destroy( dict );
 }
 END_TEST
 
+/** Well past the initial capacity, so that the table is rehashed many times */
+#define DICT_TEST_N 10000
+
+/** Every key maps to its own square */
+static bool dict_check_squares( const Dictionary *dict, const int from, const int to,
+                                const int step )
+{
+    for ( int i = from; i < to; i += step )
+    {
+        const int *val = dict_get_val( dict, &i, sizeof i );
+        if ( val == NULL || *val != i * i )
+            return false;
+    }
+    return true;
+}
+
+TEST( dict_grow )
+{
+    Dictionary *dict = dict_test_init();
+    assert_that( dict != NULL, "init failed" );
+
+    bool insert = true;
+    bool search = true;
+    for ( int i = 0; i < DICT_TEST_N; ++i )
+    {
+        const int square = i * i;
+        const int half   = i / 2;
+        insert = insert
+                 && dict_insert( dict, &i, sizeof i, &square, sizeof square )
+                            == DICTINSERT_INSERTED;
+        // keys inserted earlier may still be waiting in the old table
+        search = search && dict_has_key( dict, &i, sizeof i )
+                 && dict_has_key( dict, &half, sizeof half );
+    }
+    UNIT_TEST( insert );
+    UNIT_TEST( search );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N );
+    UNIT_TEST( dict_check_squares( dict, 0, DICT_TEST_N, 1 ) );
+
+    bool dupes = true;
+    for ( int i = 0; i < DICT_TEST_N; i += 7 )
+        dupes = dupes
+                && dict_insert( dict, &i, sizeof i, &i, sizeof i ) == DICTINSERT_WAS_IN;
+    UNIT_TEST( dupes );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N );
+
+    const int missing = -1;
+    UNIT_TEST( !dict_has_key( dict, &missing, sizeof missing ) );
+
+    dict_destroy( dict );
+}
+END_TEST
+
+TEST( dict_remove )
+{
+    Dictionary *dict = dict_test_init();
+    assert_that( dict != NULL, "init failed" );
+
+    for ( int i = 0; i < DICT_TEST_N; ++i )
+    {
+        const int square = i * i;
+        assert_that( dict_insert( dict, &i, sizeof i, &square, sizeof square )
+                             == DICTINSERT_INSERTED,
+                     "insert" );
+    }
+
+    // remove while the last growth may still be in progress
+    bool remove_odd = true;
+    for ( int i = 1; i < DICT_TEST_N; i += 2 )
+        remove_odd = remove_odd
+                     && dict_remove( dict, &i, sizeof i ) == DICTREMOVE_REMOVED;
+    UNIT_TEST( remove_odd );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N / 2 );
+    UNIT_TEST( dict_check_squares( dict, 0, DICT_TEST_N, 2 ) );
+
+    const int one = 1;
+    UNIT_TEST( !dict_has_key( dict, &one, sizeof one ) );
+    UNIT_TEST( dict_remove( dict, &one, sizeof one ) == DICTREMOVE_NOT_FOUND );
+
+    // shrink down to nothing and grow back
+    bool remove_all = true;
+    for ( int i = 0; i < DICT_TEST_N; i += 2 )
+    {
+        remove_all = remove_all
+                     && dict_remove( dict, &i, sizeof i ) == DICTREMOVE_REMOVED;
+        if ( i % 512 == 0 ) // while shrinking
+            remove_all = remove_all && dict_check_squares( dict, i + 2, DICT_TEST_N, 2 );
+    }
+    UNIT_TEST( remove_all );
+    UNIT_TEST( dict_size( dict ) == 0 );
+
+    bool reinsert = true;
+    for ( int i = 0; i < DICT_TEST_N; ++i )
+    {
+        const int square = i * i;
+        reinsert = reinsert
+                   && dict_insert( dict, &i, sizeof i, &square, sizeof square )
+                              == DICTINSERT_INSERTED;
+    }
+    UNIT_TEST( reinsert );
+    UNIT_TEST( dict_check_squares( dict, 0, DICT_TEST_N, 1 ) );
+
+    dict_destroy( dict );
+}
+END_TEST
+
+TEST( dict_churn )
+{
+    Dictionary *dict = dict_test_init();
+    assert_that( dict != NULL, "init failed" );
+
+    // a sliding window of keys: lots of tombstones, but the size stays the same
+    static const int window = 100;
+
+    bool churn = true;
+    for ( int i = 0; i < DICT_TEST_N; ++i )
+    {
+        const int square = i * i;
+        const int old    = i - window;
+
+        churn = churn
+                && dict_insert( dict, &i, sizeof i, &square, sizeof square )
+                           == DICTINSERT_INSERTED;
+        if ( old >= 0 )
+            churn = churn && dict_remove( dict, &old, sizeof old ) == DICTREMOVE_REMOVED
+                    && !dict_has_key( dict, &old, sizeof old );
+    }
+    UNIT_TEST( churn );
+    UNIT_TEST( dict_size( dict ) == ( size_t ) window );
+    UNIT_TEST( dict_check_squares( dict, DICT_TEST_N - window, DICT_TEST_N, 1 ) );
+
+    dict_destroy( dict );
+}
+END_TEST
+
+TEST( dict_item_sizes )
+{
+    Dictionary *dict = dict_test_init();
+    assert_that( dict != NULL, "init failed" );
+
+    // keys and values both below and above the inline size
+    char key[ 64 ];
+    char val[ 64 ];
+    bool insert = true;
+    for ( int i = 0; i < DICT_TEST_N; ++i )
+    {
+        const size_t key_len =
+                ( size_t ) snprintf( key, sizeof key, "%0*d", 1 + i % 40, i );
+        const size_t val_len =
+                ( size_t ) snprintf( val, sizeof val, "value %0*d", 1 + i % 50, i );
+        insert = insert
+                 && dict_insert( dict, key, key_len + 1, val, val_len + 1 )
+                            == DICTINSERT_INSERTED;
+    }
+    UNIT_TEST( insert );
+
+    bool search = true;
+    for ( int i = 0; i < DICT_TEST_N; ++i )
+    {
+        const int key_len = snprintf( key, sizeof key, "%0*d", 1 + i % 40, i );
+        snprintf( val, sizeof val, "value %0*d", 1 + i % 50, i );
+
+        const char *found = dict_get_val( dict, key, ( size_t ) key_len + 1 );
+        search = search && found != NULL && strcmp( found, val ) == 0;
+    }
+    UNIT_TEST( search );
+
+    // replace a small value with a large one and back, from its own storage
+    const int number = 7;
+    const char *large = "a value which is too long to be stored inline";
+    UNIT_TEST( dict_insert( dict, &number, sizeof number, &number, sizeof number )
+               == DICTINSERT_INSERTED );
+    UNIT_TEST( dict_set_val( dict, &number, sizeof number, large, strlen( large ) + 1 )
+               == RV_SUCCESS );
+    UNIT_TEST( strcmp( dict_get_val( dict, &number, sizeof number ), large ) == 0 );
+    UNIT_TEST( dict_set_val( dict, &number, sizeof number,
+                             dict_get_val( dict, &number, sizeof number ), sizeof number )
+               == RV_SUCCESS );
+    const void *small = dict_get_val( dict, &number, sizeof number );
+    UNIT_TEST( memcmp( small, large, sizeof number ) == 0 );
+
+    dict_destroy( dict );
+}
+END_TEST
+
+TEST( dict_insert_many )
+{
+    Dictionary *dict = dict_test_init();
+    assert_that( dict != NULL, "init failed" );
+
+    // every key twice; the first value of a key is the one kept
+    static int keys[ 2 * DICT_TEST_N ];
+    static int squares[ 2 * DICT_TEST_N ];
+    for ( int i = 0; i < 2 * DICT_TEST_N; ++i )
+    {
+        keys[ i ]    = i % DICT_TEST_N;
+        squares[ i ] = i < DICT_TEST_N ? i * i : -1;
+    }
+
+    UNIT_TEST( dict_insert_many( dict, keys, sizeof *keys, squares, sizeof *squares,
+                                 countof( keys ) )
+               == RV_SUCCESS );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N );
+    UNIT_TEST( dict_check_squares( dict, 0, DICT_TEST_N, 1 ) );
+
+    // into a dictionary which already has (some of) the keys
+    const int more[] = { 1, DICT_TEST_N, DICT_TEST_N + 1 };
+    const int more_squares[] = { -1, DICT_TEST_N * DICT_TEST_N,
+                                 ( DICT_TEST_N + 1 ) * ( DICT_TEST_N + 1 ) };
+    UNIT_TEST( dict_insert_many( dict, more, sizeof *more, more_squares,
+                                 sizeof *more_squares, countof( more ) )
+               == RV_SUCCESS );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N + 2 );
+    UNIT_TEST( dict_check_squares( dict, 0, DICT_TEST_N + 2, 1 ) );
+    dict_destroy( dict );
+
+    dict = dict_from_arrays( keys, sizeof *keys, squares, sizeof *squares, DICT_TEST_N );
+    UNIT_TEST( dict != NULL );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N );
+    UNIT_TEST( dict_check_squares( dict, 0, DICT_TEST_N, 1 ) );
+    dict_destroy( dict );
+}
+END_TEST
+
+/** `dict_update()` callback; adds `*ctx` to an int */
+static void dict_test_add( void *val, const size_t val_size, void *ctx )
+{
+    assert_that( val_size == sizeof( int ), "val_size: %zu", val_size );
+    *( int * ) val += *( const int * ) ctx;
+}
+
+TEST( dict_upsert )
+{
+    Dictionary *dict = dict_test_init();
+    assert_that( dict != NULL, "init failed" );
+
+    // counts: key `i % DICT_TEST_N` comes up three times
+    bool count = true;
+    for ( int i = 0; i < 3 * DICT_TEST_N; ++i )
+    {
+        const int key = i % DICT_TEST_N;
+        bool inserted = false;
+        int *val =
+                dict_get_or_insert( dict, &key, sizeof key, &( int ) { 0 }, sizeof( int ),
+                                    &inserted );
+        count = count && val != NULL && inserted == ( i < DICT_TEST_N );
+        if ( val != NULL )
+            ++*val;
+    }
+    UNIT_TEST( count );
+    UNIT_TEST( dict_size( dict ) == DICT_TEST_N );
+    const int five = 5;
+    UNIT_TEST( deref_as( int, dict_get_val( dict, &five, sizeof five ) ) == 3 );
+
+    // squares again, half of them overwritten and half of them new
+    bool upsert = true;
+    for ( int i = DICT_TEST_N / 2; i < 3 * DICT_TEST_N / 2; ++i )
+        upsert = upsert
+                 && dict_upsert( dict, &i, sizeof i, &( int ) { i * i }, sizeof( int ) )
+                            == ( i < DICT_TEST_N ? DICTINSERT_WAS_IN
+                                                 : DICTINSERT_INSERTED );
+    UNIT_TEST( upsert );
+    UNIT_TEST( dict_size( dict ) == 3 * DICT_TEST_N / 2 );
+    UNIT_TEST( dict_check_squares( dict, DICT_TEST_N / 2, 3 * DICT_TEST_N / 2, 1 ) );
+
+    // a value of a different size
+    const char *large = "a value which is too long to be stored inline";
+    const int zero    = 0;
+    UNIT_TEST( dict_upsert( dict, &zero, sizeof zero, large, strlen( large ) + 1 )
+               == DICTINSERT_WAS_IN );
+    UNIT_TEST( strcmp( dict_get_val( dict, &zero, sizeof zero ), large ) == 0 );
+
+    const int key = 1;
+    UNIT_TEST( dict_update( dict, &key, sizeof key, dict_test_add, &( int ) { 10 } )
+               == RV_SUCCESS );
+    UNIT_TEST( deref_as( int, dict_get_val( dict, &key, sizeof key ) ) == 13 );
+    UNIT_TEST( dict_update( dict, &( int ) { -1 }, sizeof( int ), dict_test_add,
+                            &( int ) { 10 } )
+               == RV_EXCEPTION );
+    UNIT_TEST( dict_size( dict ) == 3 * DICT_TEST_N / 2 );
+
+    dict_destroy( dict );
+}
+END_TEST
+
 LibraryDefined void RUNALL_DICT( void )
 {
-    RUN_TEST( dict_init );
+    static const enum DictEngine engines[] = { DICT_ENGINE_LINEAR, DICT_ENGINE_SWISS };
+
+    for ( size_t i = 0; i < countof( engines ); ++i )
+    {
+        dict_test_engine = engines[ i ];
+
+        RUN_TEST( dict_init );
+        RUN_TEST( dict_grow );
+        RUN_TEST( dict_remove );
+        RUN_TEST( dict_churn );
+        RUN_TEST( dict_item_sizes );
+        RUN_TEST( dict_insert_many );
+        RUN_TEST( dict_upsert );
+    }
 }
 
 #endif
@@ -8,6 +8,16 @@
 #include "../../src/headers/misc.h"
 #include "../../src/headers/unit_tests.h"
 #include "../../src/structs/dynarr.h"
+#include "../../src/structs/dynarr_index.h"
+#include "../../src/structs/dynarr_mmap.h"
+#include "../../src/structs/dynarr_parallel.h"
+#include "../../src/structs/dynarr_typed.h"
+#include "../../src/structs/dynarr_view.h"
+#include "../../src/thread_pool.h"
+
+#include <stddef.h>   /* offsetof */
+#include <sys/stat.h> /* stat */
+#include <unistd.h>   /* write, unlink */
 
 
 #define DEFAULT_DYNSTRING_CAP 256
@@ -214,11 +224,810 @@ TEST( list_advanced )
 }
 END_TEST
 
+TEST( list_capacity )
+{
+    List *ls = list_init_cap_size( sizeof( int ), 5 );
+    assert( ls != NULL );
+    UNIT_TEST( list_capacity( ls ) == 5 );
+
+    // grows only once full
+    bool correct = true;
+    for ( int i = 0; i < 5; ++i )
+        correct = correct && list_append( ls, &i ) == RV_SUCCESS;
+    UNIT_TEST( correct && list_capacity( ls ) == 5 );
+    UNIT_TEST( list_append( ls, &( int ) { 5 } ) == RV_SUCCESS );
+    UNIT_TEST( list_capacity( ls ) > 5 );
+
+    // no reallocation within the reserved space
+    UNIT_TEST( list_reserve( ls, 1000 ) == RV_SUCCESS );
+    UNIT_TEST( list_capacity( ls ) == 1000 );
+    const void *items = list_items( ls );
+    for ( int i = 6; i < 1000; ++i )
+        correct = correct && list_append( ls, &i ) == RV_SUCCESS;
+    UNIT_TEST( correct && list_items( ls ) == items && list_capacity( ls ) == 1000 );
+    UNIT_TEST( list_reserve( ls, 10 ) == RV_SUCCESS && list_capacity( ls ) == 1000 );
+
+    // hysteresis: popping just below half and appending back doesn't reallocate
+    for ( int i = 0; i < 500; ++i )
+        correct = correct && list_pop( ls, NULL ) == RV_SUCCESS;
+    UNIT_TEST( correct && list_capacity( ls ) == 1000 );
+    for ( int i = 0; i < 10; ++i )
+    {
+        correct = correct && list_pop( ls, NULL ) == RV_SUCCESS;
+        correct = correct && list_append( ls, &i ) == RV_SUCCESS;
+    }
+    UNIT_TEST( correct && list_capacity( ls ) == 1000 );
+
+    // ... popping down to a quarter does
+    while ( list_size( ls ) > 250 )
+        correct = correct && list_pop( ls, NULL ) == RV_SUCCESS;
+    UNIT_TEST( correct && list_capacity( ls ) == 500 );
+    for ( int i = 0; i < 250; ++i )
+        correct = correct && list_fetch( ls, i, int ) == i;
+    UNIT_TEST( correct );
+
+    UNIT_TEST( list_shrink_to_fit( ls ) == RV_SUCCESS );
+    UNIT_TEST( list_capacity( ls ) == 250 && list_size( ls ) == 250 );
+
+    // resize: zeroed items appended, items removed from the end
+    UNIT_TEST( list_resize( ls, 300 ) == RV_SUCCESS );
+    UNIT_TEST( list_size( ls ) == 300 && list_capacity( ls ) >= 300 );
+    for ( int i = 250; i < 300; ++i )
+        correct = correct && list_fetch( ls, i, int ) == 0;
+    UNIT_TEST( correct && list_fetch( ls, 249, int ) == 249 );
+    const size_t capacity = list_capacity( ls );
+    UNIT_TEST( list_resize( ls, 3 ) == RV_SUCCESS );
+    UNIT_TEST( list_size( ls ) == 3 && list_capacity( ls ) == capacity );
+    UNIT_TEST( list_fetch( ls, 2, int ) == 2 );
+
+    // full List: remove from the middle
+    UNIT_TEST( list_shrink_to_fit( ls ) == RV_SUCCESS && list_capacity( ls ) == 3 );
+    UNIT_TEST( list_remove( ls, 0, NULL ) == RV_SUCCESS );
+    UNIT_TEST( list_fetch( ls, 0, int ) == 1 && list_fetch( ls, 1, int ) == 2 );
+
+    UNIT_TEST( list_resize( ls, 0 ) == RV_SUCCESS && list_is_empty( ls ) );
+    UNIT_TEST( list_shrink_to_fit( ls ) == RV_SUCCESS && list_capacity( ls ) == 1 );
+    UNIT_TEST( list_insert( ls, 0, &( int ) { 7 } ) == RV_SUCCESS );
+    UNIT_TEST( list_insert( ls, 0, &( int ) { 6 } ) == RV_SUCCESS );
+    UNIT_TEST( list_fetch( ls, 0, int ) == 6 && list_fetch( ls, 1, int ) == 7 );
+    list_destroy( ls );
+
+    // zero initial capacity
+    ls = list_init_cap_size( sizeof( int ), 0 );
+    assert( ls != NULL );
+    UNIT_TEST( list_append( ls, &( int ) { 1 } ) == RV_SUCCESS );
+    UNIT_TEST( list_append( ls, &( int ) { 2 } ) == RV_SUCCESS );
+    UNIT_TEST( list_size( ls ) == 2 && list_fetch( ls, 1, int ) == 2 );
+    list_destroy( ls );
+}
+END_TEST
+
+TEST( list_view )
+{
+    List *ls = list_init_type( int );
+    assert( ls != NULL );
+    for ( int i = 0; i < 10; ++i )
+        assert( list_append( ls, &i ) == RV_SUCCESS );
+
+    const ListView all = list_view( ls );
+    UNIT_TEST( all.size == 10 && list_view_is_contiguous( all ) );
+    UNIT_TEST( list_view_at( all, 3 ) == list_at( ls, 3 ) );
+    UNIT_TEST( list_view_at( all, 10 ) == NULL );
+
+    ListView view;
+    UNIT_TEST( list_view_slice( all, 2, 7, 1, &view ) == RV_SUCCESS );
+    UNIT_TEST( view.size == 5 && list_view_is_contiguous( view ) );
+    UNIT_TEST( list_view_fetch( view, 0, int ) == 2 );
+    UNIT_TEST( list_view_fetch( view, 4, int ) == 6 );
+
+    // every third of [ 1, 10 ): 1 4 7
+    UNIT_TEST( list_view_slice( all, 1, 10, 3, &view ) == RV_SUCCESS );
+    UNIT_TEST( view.size == 3 && !list_view_is_contiguous( view ) );
+    UNIT_TEST( list_view_fetch( view, 2, int ) == 7 );
+
+    // reversed, then every other: 7 1
+    view = list_view_reversed( view );
+    UNIT_TEST( list_view_fetch( view, 0, int ) == 7 );
+    UNIT_TEST( list_view_slice( view, 0, 3, 2, &view ) == RV_SUCCESS );
+    UNIT_TEST( view.size == 2 && list_view_fetch( view, 1, int ) == 1 );
+
+    List *copy = list_from_view( list_view_reversed( all ) );
+    assert( copy != NULL );
+    bool correct = list_size( copy ) == 10;
+    for ( int i = 0; i < 10; ++i )
+        correct = correct && list_fetch( copy, i, int ) == 9 - i;
+    UNIT_TEST( correct );
+    list_destroy( copy );
+
+    UNIT_TEST( list_view_slice( all, 10, 10, 1, &view ) == RV_SUCCESS );
+    UNIT_TEST( view.size == 0 && list_view_reversed( view ).size == 0 );
+    copy = list_from_view( view );
+    UNIT_TEST( copy != NULL && list_is_empty( copy ) );
+    list_destroy( copy );
+
+    UNIT_TEST( list_view_slice( all, 3, 2, 1, &view ) == RV_EXCEPTION );
+    UNIT_TEST( list_view_slice( all, 0, 11, 1, &view ) == RV_EXCEPTION );
+    UNIT_TEST( list_view_slice( all, 0, 1, 0, &view ) == RV_EXCEPTION );
+
+    const int array[] = { 5, 6, 7 };
+    view              = list_view_of_array( array, countof( array ), sizeof( int ) );
+    UNIT_TEST( list_view_fetch( list_view_reversed( view ), 0, int ) == 7 );
+
+    list_destroy( ls );
+}
+END_TEST
+
+TEST( list_buffer )
+{
+    int *buffer = malloc( 8 * sizeof( int ) );
+    assert( buffer != NULL );
+    for ( int i = 0; i < 5; ++i )
+        buffer[ i ] = i;
+
+    List *ls = list_adopt_buffer( buffer, 5, 8, sizeof( int ) );
+    assert( ls != NULL );
+    UNIT_TEST( list_items( ls ) == buffer );
+    UNIT_TEST( list_size( ls ) == 5 && list_capacity( ls ) == 8 );
+    UNIT_TEST( list_fetch( ls, 4, int ) == 4 );
+
+    // grows (reallocates) the adopted buffer
+    bool correct = true;
+    for ( int i = 5; i < 100; ++i )
+        correct = correct && list_append( ls, &i ) == RV_SUCCESS;
+    UNIT_TEST( correct );
+
+    const void *items = list_items( ls );
+    size_t size       = 0;
+    buffer            = list_release_buffer( ls, &size );
+    UNIT_TEST( buffer == items && size == 100 );
+    for ( int i = 0; i < 100; ++i )
+        correct = correct && buffer[ i ] == i;
+    UNIT_TEST( correct );
+    free( buffer );
+
+    UNIT_TEST( list_adopt_buffer( NULL, 0, 1, sizeof( int ) ) == NULL );
+    UNIT_TEST( list_adopt_buffer( &size, 2, 1, sizeof( int ) ) == NULL );
+
+    // a List from another allocator hands out a copy
+    Arena *arena = arena_init( 0 );
+    assert( arena != NULL );
+    ls = list_init_with_allocator( sizeof( int ), arena_allocator( arena ) );
+    assert( ls != NULL );
+    UNIT_TEST( list_append( ls, &( int ) { 42 } ) == RV_SUCCESS );
+    buffer = list_release_buffer( ls, NULL );
+    UNIT_TEST( buffer != NULL && buffer[ 0 ] == 42 );
+    free( buffer );
+    arena_destroy( arena );
+}
+END_TEST
+
+Private off_t test_list_file_size( const char *path )
+{
+    struct stat st;
+    return stat( path, &st ) == 0 ? st.st_size : -1;
+}
+
+TEST( list_mmap )
+{
+    char path[] = "/tmp/clibs_list_mmap_XXXXXX";
+    const int fd = mkstemp( path );
+    assert_that( fd >= 0, "mkstemp" );
+    uint64_t records[ 1000 ];
+    for ( uint64_t i = 0; i < countof( records ); ++i )
+        records[ i ] = 3 * i;
+    assert( write( fd, records, sizeof records ) == sizeof records );
+    close( fd );
+
+    // read-only: the file isn't read (nor changed), the items are there
+    List *ls = list_open_mmap( path, sizeof( uint64_t ), LIST_MMAP_SEQUENTIAL );
+    assert( ls != NULL );
+    UNIT_TEST( list_size( ls ) == 1000 );
+    UNIT_TEST( *( const uint64_t * ) list_see( ls, 999 ) == 2997 );
+    UNIT_TEST( list_bsearch_i( ls, &( uint64_t ) { 300 }, cmp_uint64_t ) == 100 );
+    UNIT_TEST( list_lsearch_i( ls, &( uint64_t ) { 301 } ) == -1 );
+    UNIT_TEST( list_mmap_sync( ls ) == RV_SUCCESS );
+
+    // private changes
+    UNIT_TEST( list_append( ls, &( uint64_t ) { 1 } ) == RV_SUCCESS );
+    list_access( ls, 0, uint64_t ) = 7;
+    UNIT_TEST( list_size( ls ) == 1001 && list_fetch( ls, 999, uint64_t ) == 2997 );
+    list_destroy( ls );
+    UNIT_TEST( test_list_file_size( path ) == sizeof records );
+
+    // read-write: the file grows and shrinks with the List
+    ls = list_open_mmap( path, sizeof( uint64_t ), LIST_MMAP_WRITE | LIST_MMAP_RANDOM );
+    assert( ls != NULL );
+    UNIT_TEST( list_fetch( ls, 0, uint64_t ) == 0 );
+    bool correct = true;
+    for ( uint64_t i = 1000; i < 5000; ++i )
+        correct = correct && list_append( ls, &( uint64_t ) { 3 * i } ) == RV_SUCCESS;
+    UNIT_TEST( correct );
+    list_access( ls, 0, uint64_t ) = 42;
+    UNIT_TEST( list_mmap_sync( ls ) == RV_SUCCESS );
+    list_destroy( ls );
+    UNIT_TEST( test_list_file_size( path ) == 5000 * sizeof( uint64_t ) );
+
+    ls = list_open_mmap( path, sizeof( uint64_t ), LIST_MMAP_WRITE );
+    assert( ls != NULL );
+    UNIT_TEST( list_size( ls ) == 5000 && list_fetch( ls, 0, uint64_t ) == 42 );
+    for ( uint64_t i = 1; i < 5000; ++i )
+        correct = correct && list_fetch( ls, i, uint64_t ) == 3 * i;
+    UNIT_TEST( correct );
+    UNIT_TEST( list_resize( ls, 10 ) == RV_SUCCESS );
+    list_destroy( ls );
+    UNIT_TEST( test_list_file_size( path ) == 10 * sizeof( uint64_t ) );
+
+    // copies are ordinary Lists; destroying them leaves the mapping alone
+    ls = list_open_mmap( path, sizeof( uint64_t ), LIST_MMAP_WRITE );
+    assert( ls != NULL );
+    List *copy     = list_copy_of( ls );
+    List *reversed = list_reversed( ls );
+    assert( copy != NULL && reversed != NULL );
+    UNIT_TEST( !list_is_mmap( copy ) && !list_is_mmap( reversed ) );
+    UNIT_TEST( list_fetch( copy, 9, uint64_t ) == 27 );
+    UNIT_TEST( list_fetch( reversed, 0, uint64_t ) == 27 );
+    UNIT_TEST( list_append( copy, &( uint64_t ) { 1 } ) == RV_SUCCESS );
+    list_destroy( copy );
+    list_destroy( reversed );
+    UNIT_TEST( list_is_mmap( ls ) );
+    UNIT_TEST( list_append( ls, &( uint64_t ) { 30 } ) == RV_SUCCESS );
+    UNIT_TEST( list_pop( ls, NULL ) == RV_SUCCESS );
+    UNIT_TEST( list_mmap_sync( ls ) == RV_SUCCESS );
+    list_destroy( ls );
+    UNIT_TEST( test_list_file_size( path ) == 10 * sizeof( uint64_t ) );
+
+    // a copy of the items outlives the mapping
+    ls = list_open_mmap( path, sizeof( uint64_t ), LIST_MMAP_WRITE );
+    assert( ls != NULL );
+    uint64_t *items = list_release_buffer( ls, NULL );
+    UNIT_TEST( items != NULL && items[ 9 ] == 27 );
+    free( items );
+
+    UNIT_TEST( list_open_mmap( path, 3, 0 ) == NULL );
+    UNIT_TEST( list_open_mmap( path, 8, LIST_MMAP_CREATE ) == NULL );
+    List *ordinary = list_init_type( int );
+    assert( ordinary != NULL );
+    UNIT_TEST( list_mmap_sync( ordinary ) == RV_EXCEPTION );
+    list_destroy( ordinary );
+
+    // a new (empty) file
+    unlink( path );
+    UNIT_TEST( list_open_mmap( path, sizeof( uint64_t ), 0 ) == NULL );
+    ls = list_open_mmap( path, sizeof( uint64_t ), LIST_MMAP_WRITE | LIST_MMAP_CREATE );
+    assert( ls != NULL );
+    UNIT_TEST( list_is_empty( ls ) );
+    UNIT_TEST( list_append( ls, &( uint64_t ) { 5 } ) == RV_SUCCESS );
+    UNIT_TEST( list_append( ls, &( uint64_t ) { 6 } ) == RV_SUCCESS );
+    UNIT_TEST( list_clear( ls ) == RV_SUCCESS && list_is_empty( ls ) );
+    UNIT_TEST( list_append( ls, &( uint64_t ) { 7 } ) == RV_SUCCESS );
+    list_destroy( ls );
+    UNIT_TEST( test_list_file_size( path ) == sizeof( uint64_t ) );
+
+    // empty and read-only
+    ls = list_open_mmap( path, sizeof( uint64_t ), 0 );
+    assert( ls != NULL );
+    UNIT_TEST( list_fetch( ls, 0, uint64_t ) == 7 );
+    UNIT_TEST( list_pop( ls, NULL ) == RV_SUCCESS );
+    UNIT_TEST( list_clear( ls ) == RV_SUCCESS );
+    UNIT_TEST( list_append( ls, &( uint64_t ) { 8 } ) == RV_SUCCESS );
+    list_destroy( ls );
+    UNIT_TEST( test_list_file_size( path ) == sizeof( uint64_t ) );
+
+    unlink( path );
+}
+END_TEST
+
+struct test_list_pair {
+    int key;
+    int val;
+};
+
+#define TEST_LIST_PAIR_GREATER( A, B ) ( ( A ).key > ( B ).key )
+
+LIST_DEFINE_LESS( struct test_list_pair, pair, TEST_LIST_PAIR_GREATER )
+
+TEST( list_lsearch )
+{
+    static const size_t widths[] = { 1, 2, 3, 4, 8, 16 };
+    static const enum ListSearchImpl impls[] = {
+        LIST_SEARCH_SCALAR,
+        LIST_SEARCH_SSE2,
+        LIST_SEARCH_AVX2,
+    };
+
+    for ( size_t w = 0; w < countof( widths ); ++w )
+    {
+        const size_t el_size = widths[ w ];
+        byte needle[ 16 ];
+        memset( needle, 0x5A, el_size );
+
+        // every position of the match, in lists around the vector sizes
+        bool correct = true;
+        for ( size_t size = 0; size <= 200; ++size )
+        {
+            List *ls = list_init_cap_size( el_size, size );
+            assert( ls != NULL );
+            assert( list_resize( ls, size ) == RV_SUCCESS );
+            for ( size_t i = 0; i < size; ++i )
+                memset( list_at( ls, i ), ( int ) ( i % 7 ), el_size );
+
+            for ( size_t impl = 0; impl < countof( impls ); ++impl )
+                correct = correct
+                       && list_lsearch_i_impl( ls, needle, impls[ impl ] ) == -1;
+
+            for ( size_t at = 0; at < size; ++at )
+            {
+                memcpy( list_at( ls, at ), needle, el_size );
+                // an item equal to the needle in all but its last byte
+                if ( at + 1 < size )
+                    ( ( byte * ) list_at( ls, at + 1 ) )[ el_size - 1 ] = 0x5A;
+
+                for ( size_t impl = 0; impl < countof( impls ); ++impl )
+                    correct = correct
+                           && list_lsearch_i_impl( ls, needle, impls[ impl ] )
+                                      == ( int64_t ) at;
+                correct = correct && list_lsearch_p( ls, needle ) == list_see( ls, at );
+
+                memset( list_at( ls, at ), 0, el_size );
+            }
+            list_destroy( ls );
+        }
+        UNIT_TEST( correct );
+    }
+
+    List *numbers = list_init_type( int );
+    assert( numbers != NULL );
+    for ( int i = 0; i < 1000; ++i )
+        assert( list_append( numbers, &( int ) { i % 100 } ) == RV_SUCCESS );
+
+    List *indices = list_lsearch_all( numbers, &( int ) { 42 } );
+    UNIT_TEST( indices != NULL && list_size( indices ) == 10 );
+    bool correct = indices != NULL;
+    for ( size_t i = 0; correct && i < list_size( indices ); ++i )
+        correct = list_fetch( indices, i, size_t ) == 42 + 100 * i;
+    UNIT_TEST( correct );
+    if ( indices != NULL )
+        list_destroy( indices );
+
+    indices = list_lsearch_all( numbers, &( int ) { 100 } );
+    UNIT_TEST( indices != NULL && list_is_empty( indices ) );
+    if ( indices != NULL )
+        list_destroy( indices );
+
+    list_destroy( numbers );
+}
+END_TEST
+
+TEST( sorted_index )
+{
+    // every size up to a few full trees, and a large one; duplicates
+    bool correct = true;
+    for ( size_t size = 0; size <= 300; size = size < 140 ? size + 1 : size * 3 + 1 )
+    {
+        List *ls = list_init_type( int64_t );
+        assert( ls != NULL );
+        for ( size_t i = 0; i < size; ++i )
+            assert( list_append( ls, &( int64_t ) { 2 * ( int64_t ) ( i / 3 ) } )
+                    == RV_SUCCESS );
+
+        SortedIndex *index = sorted_index_init( ls, cmp_int64_t );
+        assert( index != NULL );
+        correct = correct && sorted_index_size( index ) == size;
+
+        const int64_t last = size == 0 ? 0 : list_fetch( ls, size - 1, int64_t );
+        List *needles      = list_init_type( int64_t );
+        assert( needles != NULL );
+        for ( int64_t needle = -2; needle <= last + 2; ++needle )
+        {
+            assert( list_append( needles, &needle ) == RV_SUCCESS );
+
+            correct = correct
+                   && sorted_index_find( index, &needle )
+                              == list_bsearch_i( ls, &needle, cmp_int64_t );
+
+            const size_t rank = sorted_index_rank( index, &needle );
+            correct = correct && rank <= size
+                   && ( rank == 0 || list_fetch( ls, rank - 1, int64_t ) < needle )
+                   && ( rank == size || list_fetch( ls, rank, int64_t ) >= needle );
+        }
+
+        int64_t *found = malloc( list_size( needles ) * sizeof( int64_t ) );
+        assert( found != NULL );
+        sorted_index_find_n( index, list_items( needles ), list_size( needles ), found );
+        for ( size_t i = 0; i < list_size( needles ); ++i )
+            correct = correct
+                   && found[ i ] == sorted_index_find( index, list_see( needles, i ) );
+        free( found );
+
+        list_destroy( needles );
+        sorted_index_destroy( index );
+        list_destroy( ls );
+    }
+    UNIT_TEST( correct );
+
+    // independent of the List
+    List *words = list_init_type( uint64_t );
+    assert( words != NULL );
+    for ( uint64_t i = 0; i < 100000; ++i )
+        assert( list_append( words, &( uint64_t ) { i * i } ) == RV_SUCCESS );
+    SortedIndex *index = sorted_index_init( words, cmp_uint64_t );
+    assert( index != NULL );
+    list_destroy( words );
+
+    UNIT_TEST( sorted_index_find( index, &( uint64_t ) { 0 } ) == 0 );
+    UNIT_TEST( sorted_index_find( index, &( uint64_t ) { 99999ULL * 99999 } ) == 99999 );
+    UNIT_TEST( sorted_index_find( index, &( uint64_t ) { 1234 * 1234 } ) == 1234 );
+    UNIT_TEST( sorted_index_find( index, &( uint64_t ) { 1234 * 1234 + 1 } ) == -1 );
+    UNIT_TEST( sorted_index_rank( index, &( uint64_t ) { 1234 * 1234 + 1 } ) == 1235 );
+    UNIT_TEST( sorted_index_rank( index, &( uint64_t ) { UINT64_MAX } ) == 100000 );
+    sorted_index_destroy( index );
+}
+END_TEST
+
+TEST( list_typed )
+{
+    List_int64 *ls = list_int64_init();
+    assert( ls != NULL );
+
+    // more than fits into the initial capacity; duplicates and sorted runs
+    uint64_t rng  = 0x2545F4914F6CDD1DULL;
+    bool appended = true;
+    for ( int64_t i = 0; i < 5000; ++i )
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        const int64_t n = i % 3 == 0 ? ( int64_t ) ( rng % 100 ) - 50
+                        : i % 3 == 1 ? ( int64_t ) rng
+                                     : i;
+        appended = appended && list_int64_append( ls, n ) == RV_SUCCESS;
+    }
+    UNIT_TEST( appended );
+    UNIT_TEST( ls->size == 5000 );
+    UNIT_TEST( list_size( list_int64_as_list( ls ) ) == 5000 );
+
+    List *generic = list_copy_of( list_int64_as_list( ls ) );
+    assert( generic != NULL );
+    list_sort( generic, cmp_int64_t );
+    list_int64_sort( ls );
+    UNIT_TEST( memcmp( ls->items, list_items( generic ), 5000 * sizeof( int64_t ) )
+               == 0 );
+
+    const int64_t needle = list_int64_get( ls, 1234 );
+    const int64_t found  = list_int64_bsearch( ls, needle );
+    UNIT_TEST( found >= 0 && found <= 1234 && list_int64_get( ls, found ) == needle );
+    UNIT_TEST( found == 0 || list_int64_get( ls, found - 1 ) < needle );
+    UNIT_TEST( list_int64_bsearch( ls, list_int64_get( ls, 0 ) - 1 ) == -1 );
+
+    // same object, either way
+    UNIT_TEST( list_int64_from_list( generic ) == ( List_int64 * ) generic );
+    UNIT_TEST( list_pop( list_int64_as_list( ls ), NULL ) == RV_SUCCESS );
+    UNIT_TEST( ls->size == 4999 );
+    list_int64_set( ls, 0, 42 );
+    UNIT_TEST( list_fetch( list_int64_as_list( ls ), 0, int64_t ) == 42 );
+
+    List *chars = list_init_type( char );
+    assert( chars != NULL );
+    UNIT_TEST( list_int64_from_list( chars ) == NULL );
+
+    List_pair *pairs = list_pair_init();
+    assert( pairs != NULL );
+    for ( int i = 0; i < 100; ++i )
+        appended = appended
+                   && list_pair_append( pairs, ( struct test_list_pair ) { i % 10, i } )
+                              == RV_SUCCESS;
+    UNIT_TEST( appended );
+    list_pair_sort( pairs );
+    bool descending = true;
+    for ( size_t i = 1; i < pairs->size; ++i )
+        descending = descending && pairs->items[ i - 1 ].key >= pairs->items[ i ].key;
+    UNIT_TEST( descending );
+    UNIT_TEST( list_pair_get( pairs, 0 ).key == 9 );
+
+    list_pair_destroy( pairs );
+    list_destroy( chars );
+    list_destroy( generic );
+    list_int64_destroy( ls );
+}
+END_TEST
+
+/** Lists of `n` int64s in various patterns */
+Private List *test_list_sort_input( const int pattern, const size_t n )
+{
+    List *ls = list_init_type( int64_t );
+    assert( ls != NULL );
+
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for ( size_t i = 0; i < n; ++i )
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+
+        int64_t item;
+        switch ( pattern )
+        {
+            case 0: // random, both signs
+                item = ( int64_t ) rng;
+                break;
+            case 1: // sorted
+                item = ( int64_t ) i;
+                break;
+            case 2: // reversed
+                item = -( int64_t ) i;
+                break;
+            case 3: // all equal
+                item = 7;
+                break;
+            case 4: // few unique
+                item = ( int64_t ) ( rng % 4 );
+                break;
+            default: // organ pipe
+                item = ( int64_t ) ( i < n / 2 ? i : n - i );
+        }
+        assert( list_append( ls, &item ) == RV_SUCCESS );
+    }
+    return ls;
+}
+
+/** Same items as `ls`, sorted by `qsort()` */
+Private bool test_list_sorted_as_qsort( const List *sorted, const List *orig )
+{
+    int64_t *expected = list_items_copy( orig );
+    assert( expected != NULL || list_size( orig ) == 0 );
+    qsort( expected, list_size( orig ), sizeof( int64_t ), cmp_int64_t );
+
+    const bool same = list_size( sorted ) == list_size( orig )
+                      && ( list_size( orig ) == 0
+                           || memcmp( list_items( sorted ),
+                                      expected,
+                                      list_size( orig ) * sizeof( int64_t ) )
+                                      == 0 );
+    free( expected );
+    return same;
+}
+
+TEST( list_sort )
+{
+    static const size_t sizes[] = { 0, 1, 2, 23, 24, 65, 129, 1000, 20000 };
+
+    for ( int pattern = 0; pattern < 6; ++pattern )
+        for ( size_t i = 0; i < countof( sizes ); ++i )
+        {
+            List *orig = test_list_sort_input( pattern, sizes[ i ] );
+
+            List *pdq = list_copy_of( orig );
+            list_sort( pdq, cmp_int64_t );
+            UNIT_TEST( test_list_sorted_as_qsort( pdq, orig ) );
+
+            List *stable = list_copy_of( orig );
+            UNIT_TEST( list_sort_stable( stable, cmp_int64_t ) == RV_SUCCESS );
+            UNIT_TEST( test_list_sorted_as_qsort( stable, orig ) );
+
+            List *radix = list_copy_of( orig );
+            UNIT_TEST( list_sort_radix_i64( radix, 0 ) == RV_SUCCESS );
+            UNIT_TEST( test_list_sorted_as_qsort( radix, orig ) );
+
+            list_destroy( radix );
+            list_destroy( stable );
+            list_destroy( pdq );
+            list_destroy( orig );
+        }
+}
+END_TEST
+
+struct test_sort_record {
+    uint32_t id;
+    uint32_t key_u32;
+    uint64_t key_u64;
+    double key_f64;
+};
+
+Private int test_sort_record_cmp( const void *a, const void *b )
+{
+    const struct test_sort_record *x = a;
+    const struct test_sort_record *y = b;
+    return ( x->key_u32 > y->key_u32 ) - ( x->key_u32 < y->key_u32 );
+}
+
+/** Sorted by `key`; records with equal keys in the order of their `id`s */
+#define TEST_SORTED_STABLY( LIST, KEY, SORTED )                                 \
+    do                                                                          \
+    {                                                                           \
+        const struct test_sort_record *r_ = list_items( LIST );                 \
+        ( SORTED )                        = true;                               \
+        for ( size_t i_ = 1; i_ < list_size( LIST ); ++i_ )                     \
+            ( SORTED ) = ( SORTED )                                             \
+                         && ( r_[ i_ - 1 ].KEY < r_[ i_ ].KEY                   \
+                              || ( r_[ i_ - 1 ].KEY == r_[ i_ ].KEY             \
+                                   && r_[ i_ - 1 ].id < r_[ i_ ].id ) );        \
+    }                                                                           \
+    while ( 0 )
+
+TEST( list_sort_records )
+{
+    static const double f64s[] = { -1e300, -2.5, -1e-300, 0.0, 1e-300, 3.0, 1e300 };
+
+    List *records = list_init_type( struct test_sort_record );
+    assert( records != NULL );
+    for ( uint32_t i = 0; i < 5000; ++i )
+    {
+        const struct test_sort_record record = {
+            .id      = i,
+            .key_u32 = ( i * 2654435761U ) % 100,
+            .key_u64 = ( uint64_t ) ( i * 2654435761U % 1000 ) << 40,
+            .key_f64 = f64s[ i * 7 % countof( f64s ) ],
+        };
+        assert( list_append( records, &record ) == RV_SUCCESS );
+    }
+
+    bool sorted;
+    List *ls = list_copy_of( records );
+    UNIT_TEST( list_sort_stable( ls, test_sort_record_cmp ) == RV_SUCCESS );
+    TEST_SORTED_STABLY( ls, key_u32, sorted );
+    UNIT_TEST( sorted );
+    list_destroy( ls );
+
+    ls = list_copy_of( records );
+    UNIT_TEST( list_sort_radix_u32( ls, offsetof( struct test_sort_record, key_u32 ) )
+               == RV_SUCCESS );
+    TEST_SORTED_STABLY( ls, key_u32, sorted );
+    UNIT_TEST( sorted );
+    list_destroy( ls );
+
+    ls = list_copy_of( records );
+    UNIT_TEST( list_sort_radix_u64( ls, offsetof( struct test_sort_record, key_u64 ) )
+               == RV_SUCCESS );
+    TEST_SORTED_STABLY( ls, key_u64, sorted );
+    UNIT_TEST( sorted );
+    list_destroy( ls );
+
+    ls = list_copy_of( records );
+    UNIT_TEST( list_sort_radix_f64( ls, offsetof( struct test_sort_record, key_f64 ) )
+               == RV_SUCCESS );
+    TEST_SORTED_STABLY( ls, key_f64, sorted );
+    UNIT_TEST( sorted );
+    list_destroy( ls );
+
+    UNIT_TEST( list_sort_radix_u64( records, sizeof( struct test_sort_record ) - 4 )
+               == RV_EXCEPTION );
+
+    list_destroy( records );
+}
+END_TEST
+
+/** Order-sensitive: a polynomial hash of the items, in order */
+struct test_list_hash {
+    uint64_t hash;
+    uint64_t pow; // `TEST_LIST_HASH_BASE` to the number of folded items
+};
+
+#define TEST_LIST_HASH_BASE 1000003
+
+Private void test_list_hash_fold( void *acc, const void *item, void *arg )
+{
+    struct test_list_hash *h = acc;
+    h->hash = h->hash * TEST_LIST_HASH_BASE + *( const uint64_t * ) item;
+    h->pow *= TEST_LIST_HASH_BASE;
+    ( void ) arg;
+}
+
+Private void test_list_hash_combine( void *acc, const void *other, void *arg )
+{
+    struct test_list_hash *h       = acc;
+    const struct test_list_hash *o = other;
+    ( void ) arg;
+
+    h->hash = h->hash * o->pow + o->hash;
+    h->pow *= o->pow;
+}
+
+Private void test_list_square_index( void *item, const size_t index, void *arg )
+{
+    ( void ) arg;
+    *( uint64_t * ) item = ( uint64_t ) index * index;
+}
+
+TEST( list_parallel )
+{
+    ThreadPool *pool = thread_pool_init( 3 );
+    assert( pool != NULL );
+
+    // { n_threads, grain_size, pool }
+    const ListParallelOptions options[] = {
+        { 0, 0, NULL },     { 1, 0, NULL },  { 2, 1, NULL },
+        { 3, 7, NULL },     { 4, 64, NULL }, { 7, 1000, NULL },
+        { 100, 333, NULL }, { 0, 0, pool },  { 0, 5, pool },
+    };
+
+    List *records = list_init_type( struct test_sort_record );
+    assert( records != NULL );
+    for ( uint32_t i = 0; i < 5000; ++i )
+    {
+        const struct test_sort_record record = {
+            .id      = i,
+            .key_u32 = ( i * 2654435761U ) % 100,
+        };
+        assert( list_append( records, &record ) == RV_SUCCESS );
+    }
+    List *stable = list_copy_of( records );
+    assert( list_sort_stable( stable, test_sort_record_cmp ) == RV_SUCCESS );
+
+    List *numbers = list_init_type( uint64_t );
+    assert( numbers != NULL );
+    for ( uint64_t i = 0; i < 10000; ++i )
+    {
+        const uint64_t n = i * 2654435761U % 1000;
+        assert( list_append( numbers, &n ) == RV_SUCCESS );
+    }
+    struct test_list_hash serial = { .hash = 0, .pow = 1 };
+    for ( size_t i = 0; i < list_size( numbers ); ++i )
+        test_list_hash_fold( &serial, list_see( numbers, i ), NULL );
+
+    static const uint64_t needles[] = { 0, 1, 500, 999, 1000 };
+    UNIT_TEST( list_lsearch_i( numbers, needles + 0 ) == 0 );
+    UNIT_TEST( list_lsearch_i( numbers, needles + 4 ) == -1 );
+
+    for ( size_t i = 0; i < countof( options ); ++i )
+    {
+        const ListParallelOptions *opts = options + i;
+
+        List *ls = list_copy_of( records );
+        UNIT_TEST( list_parallel_sort( ls, test_sort_record_cmp, opts ) == RV_SUCCESS );
+        UNIT_TEST( memcmp( list_items( ls ),
+                           list_items( stable ),
+                           list_size( stable ) * sizeof( struct test_sort_record ) )
+                   == 0 );
+        list_destroy( ls );
+
+        struct test_list_hash parallel = { .hash = 0, .pow = 1 };
+        UNIT_TEST( list_parallel_reduce( numbers,
+                                         &parallel,
+                                         sizeof parallel,
+                                         test_list_hash_fold,
+                                         test_list_hash_combine,
+                                         NULL,
+                                         opts )
+                   == RV_SUCCESS );
+        UNIT_TEST( parallel.hash == serial.hash && parallel.pow == serial.pow );
+
+        bool same = true;
+        for ( size_t j = 0; j < countof( needles ); ++j )
+            same = same
+                   && list_parallel_lsearch_i( numbers, needles + j, opts )
+                              == list_lsearch_i( numbers, needles + j );
+        UNIT_TEST( same );
+
+        ls = list_copy_of( numbers );
+        list_parallel_for_each( ls, test_list_square_index, NULL, opts );
+        for ( size_t j = 0; j < list_size( ls ); ++j )
+            same = same && list_fetch( ls, j, uint64_t ) == ( uint64_t ) j * j;
+        UNIT_TEST( same );
+        list_destroy( ls );
+    }
+
+    list_destroy( numbers );
+    list_destroy( stable );
+    list_destroy( records );
+    thread_pool_destroy( pool );
+}
+END_TEST
+
 LibraryDefined void RUNALL_LIST( void )
 {
     RUN_TEST( list_init );
     RUN_TEST( list_basic );
     RUN_TEST( list_advanced );
+    RUN_TEST( list_capacity );
+    RUN_TEST( list_view );
+    RUN_TEST( list_buffer );
+    RUN_TEST( list_mmap );
+    RUN_TEST( list_lsearch );
+    RUN_TEST( sorted_index );
+    RUN_TEST( list_typed );
+    RUN_TEST( list_sort );
+    RUN_TEST( list_sort_records );
+    RUN_TEST( list_parallel );
 }
 
 
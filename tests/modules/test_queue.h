@@ -9,19 +9,7 @@
 #include "../../src/headers/unit_tests.h"
 #include "../../src/structs/queue.h"
 
-
-struct queue_node {
-    struct queue_node *next;
-
-    void *data;
-};
-
-struct fifo_queue {
-    struct queue_node *head; // first in line; first out
-    struct queue_node *tail; // last
-
-    size_t el_size; // each element must be the same size
-};
+#include "../../src/headers/foreach.h" /* foreach_que (needs queue.h first) */
 
 
 TEST( init )
@@ -39,9 +27,11 @@ TEST( enqueue )
 
     int data = -1;
     UNIT_TEST( queue_enqueue( queue, &data ) == RV_SUCCESS );
-    const struct queue_node *node = queue->head;
-    UNIT_TEST( node != NULL );
-    UNIT_TEST( queue->head == queue->tail );
+    int head = 0;
+    int tail = 0;
+    UNIT_TEST( queue_get_head( queue, &head ) == RV_SUCCESS );
+    UNIT_TEST( queue_get_tail( queue, &tail ) == RV_SUCCESS );
+    UNIT_TEST( head == data && tail == data );
 
     const int orig_verbosity = GET_UNIT_TEST_VERBOSITY();
     SET_UNIT_TEST_VERBOSITY( UNIT_TESTS_YAP_NONE );
@@ -51,9 +41,8 @@ TEST( enqueue )
         UNIT_TEST( ( rv = queue_enqueue( queue, &data ) ) == RV_SUCCESS );
         if ( rv == RV_SUCCESS )
         {
-            node = node->next;
-            UNIT_TEST( node->data != NULL );
-            UNIT_TEST( deref_as( int, node->data ) == data );
+            UNIT_TEST( queue_get_tail( queue, &tail ) == RV_SUCCESS );
+            UNIT_TEST( tail == data );
         }
         else
         {
@@ -91,8 +80,9 @@ TEST( dequeue )
 
     int cont;
     UNIT_TEST( queue_dequeue( queue, &cont ) == RV_EXCEPTION );
-    UNIT_TEST( queue->head == NULL );
-    UNIT_TEST( queue->tail == NULL );
+    UNIT_TEST( queue_is_empty( queue ) );
+    UNIT_TEST( queue_get_head( queue, &cont ) == RV_EXCEPTION );
+    UNIT_TEST( queue_get_tail( queue, &cont ) == RV_EXCEPTION );
 
     queue_destroy( queue );
 }
@@ -170,6 +160,76 @@ TEST( get_size )
 END_TEST
 
 
+TEST( wrap_around )
+{
+    struct fifo_queue *queue = queue_init( sizeof( int ) );
+    assert_that( queue != NULL, "init failed" );
+
+    // keep the queue short while its head moves around the buffer many times,
+    // then let it grow while wrapped around
+    int next_in  = 0;
+    int next_out = 0;
+    bool fifo    = true;
+    for ( int round = 0; round < 100; ++round )
+    {
+        for ( int i = 0; i < 7 + round / 10; ++i, ++next_in )
+            assert_that( queue_enqueue( queue, &next_in ) == RV_SUCCESS, "enqueue" );
+        for ( int i = 0; i < 5; ++i, ++next_out )
+        {
+            int out = -1;
+            fifo    = fifo && queue_dequeue( queue, &out ) == RV_SUCCESS
+                   && out == next_out;
+        }
+    }
+    UNIT_TEST( fifo );
+    UNIT_TEST( queue_get_size( queue ) == ( size_t ) ( next_in - next_out ) );
+
+    bool get  = true;
+    int index = 0;
+    foreach_que( entry, queue )
+    {
+        int got = -1;
+        get     = get && queue_get( queue, index, &got ) == RV_SUCCESS
+              && got == next_out + index
+              && deref_as( int, queue_node_get_data( entry ) ) == got;
+        ++index;
+    }
+    UNIT_TEST( get );
+    UNIT_TEST( index == next_in - next_out );
+
+    queue_destroy( queue );
+}
+END_TEST
+
+TEST( enqueue_n )
+{
+    struct fifo_queue *queue = queue_init( sizeof( int ) );
+    assert_that( queue != NULL, "init failed" );
+
+    int data[ 100 ];
+    for ( int i = 0; i < 100; ++i )
+        data[ i ] = i;
+
+    UNIT_TEST( queue_enqueue_n( queue, data, 10 ) == RV_SUCCESS );
+    UNIT_TEST( queue_dequeue_n( queue, NULL, 7 ) == 7 );
+    UNIT_TEST( queue_enqueue_n( queue, data + 10, 10 ) == RV_SUCCESS ); // wraps around
+    UNIT_TEST( queue_enqueue_n( queue, data + 20, 80 ) == RV_SUCCESS ); // grows
+    UNIT_TEST( queue_enqueue_n( queue, data, 0 ) == RV_SUCCESS );
+    UNIT_TEST( queue_get_size( queue ) == 93 );
+
+    int out[ 100 ] = { 0 };
+    UNIT_TEST( queue_dequeue_n( queue, out, 50 ) == 50 );
+    UNIT_TEST( memcmp( out, data + 7, 50 * sizeof( int ) ) == 0 );
+    UNIT_TEST( queue_dequeue_n( queue, out, 100 ) == 43 );
+    UNIT_TEST( memcmp( out, data + 57, 43 * sizeof( int ) ) == 0 );
+    UNIT_TEST( queue_dequeue_n( queue, out, 100 ) == 0 );
+    UNIT_TEST( queue_is_empty( queue ) );
+
+    queue_destroy( queue );
+}
+END_TEST
+
+
 LibraryDefined void RUNALL_QUEUE( void )
 {
     RUN_TEST( init );
@@ -177,6 +237,8 @@ LibraryDefined void RUNALL_QUEUE( void )
     RUN_TEST( dequeue );
     RUN_TEST( get );
     RUN_TEST( get_size );
+    RUN_TEST( wrap_around );
+    RUN_TEST( enqueue_n );
 }
 
 #endif
@@ -0,0 +1,402 @@
+#ifndef CLIBS_TEST_SERIALIZE_H
+#define CLIBS_TEST_SERIALIZE_H
+
+#include "../../src/headers/assert_that.h"
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/headers/unit_tests.h"
+#include "../../src/serialize.h"
+#include "../../src/structs/dictionary.h"
+#include "../../src/structs/dynarr.h"
+#include "../../src/structs/queue.h"
+#include "../../src/structs/set.h"
+
+#include <stdio.h>  /* tmpfile */
+#include <string.h> /* memcmp */
+
+
+/** Flips one byte of the file `offset` bytes before its end */
+LibraryDefined void test_serialize_corrupt( FILE *file, const long offset )
+{
+    assert( fseek( file, -offset, SEEK_END ) == 0 );
+    const int c = fgetc( file );
+    assert( fseek( file, -offset, SEEK_END ) == 0 );
+    fputc( c ^ 0xFF, file );
+    rewind( file );
+}
+
+/** Any hash function other than `hash_bytes()` */
+LibraryDefined uint64_t test_serialize_other_hash( const void *data,
+                                                   const size_t len,
+                                                   const uint64_t seed )
+{
+    return ~hash_bytes( data, len, seed );
+}
+
+TEST( serialize_list )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    List *ls = list_init_type( int64_t );
+    assert( ls != NULL );
+    for ( int64_t i = 0; i < 100000; ++i ) // several chunks
+        assert( list_append( ls, &( int64_t ) { i * i - 7 } ) == RV_SUCCESS );
+
+    UNIT_TEST( list_save( ls, file ) == RV_SUCCESS );
+    rewind( file );
+    List *loaded = list_load( file );
+    UNIT_TEST( loaded != NULL );
+    if ( loaded != NULL )
+    {
+        UNIT_TEST( list_el_size( loaded ) == sizeof( int64_t ) );
+        UNIT_TEST( list_size( loaded ) == list_size( ls ) );
+        UNIT_TEST( memcmp( list_items( loaded ),
+                           list_items( ls ),
+                           list_size( ls ) * sizeof( int64_t ) )
+                   == 0 );
+        list_destroy( loaded );
+    }
+
+    // an empty List
+    rewind( file );
+    assert( list_clear( ls ) == RV_SUCCESS );
+    UNIT_TEST( list_save( ls, file ) == RV_SUCCESS );
+    rewind( file );
+    loaded = list_load( file );
+    UNIT_TEST( loaded != NULL && list_is_empty( loaded ) );
+    if ( loaded != NULL )
+        list_destroy( loaded );
+
+    list_destroy( ls );
+    fclose( file );
+}
+END_TEST
+
+TEST( serialize_queue )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    Queue *queue = queue_init( sizeof( int ) );
+    assert( queue != NULL );
+    for ( int i = 0; i < 1000; ++i )
+        assert( queue_enqueue( queue, &i ) == RV_SUCCESS );
+    assert( queue_dequeue_n( queue, NULL, 300 ) == 300 );
+    for ( int i = 1000; i < 1300; ++i ) // wraps around
+        assert( queue_enqueue( queue, &i ) == RV_SUCCESS );
+
+    UNIT_TEST( queue_save( queue, file ) == RV_SUCCESS );
+    rewind( file );
+    Queue *loaded = queue_load( file );
+    UNIT_TEST( loaded != NULL );
+    if ( loaded != NULL )
+    {
+        UNIT_TEST( queue_get_size( loaded ) == 1000 );
+        bool correct = true;
+        for ( int i = 300; i < 1300; ++i )
+        {
+            int item;
+            correct = correct && queue_dequeue( loaded, &item ) == RV_SUCCESS
+                   && item == i;
+        }
+        UNIT_TEST( correct );
+        queue_destroy( loaded );
+    }
+
+    // a Queue isn't a List
+    rewind( file );
+    UNIT_TEST( list_load( file ) == NULL );
+
+    queue_destroy( queue );
+    fclose( file );
+}
+END_TEST
+
+TEST( serialize_set )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    Set *set = set_init_with_hash( 0, NULL, 12345 );
+    assert( set != NULL );
+    for ( int i = 0; i < 5000; ++i )
+        assert( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED );
+    const char *long_item = "an item longer than SET_INLINE_SIZE";
+    assert( set_insert( set, long_item, strlen( long_item ) ) == SETINSERT_INSERTED );
+
+    UNIT_TEST( set_save( set, file ) == RV_SUCCESS );
+    rewind( file );
+    Set *loaded = set_load( file, NULL );
+    UNIT_TEST( loaded != NULL );
+    if ( loaded != NULL )
+    {
+        UNIT_TEST( set_cmp( set, loaded ) == 0 );
+        UNIT_TEST( set_search( loaded, long_item, strlen( long_item ) ) );
+        UNIT_TEST( set_insert( loaded, &( int ) { 42 }, sizeof( int ) )
+                   == SETINSERT_WAS_IN );
+        set_destroy( loaded );
+    }
+
+    // the hashes in the file don't match a different hash function
+    rewind( file );
+    UNIT_TEST( set_load( file, test_serialize_other_hash ) == NULL );
+
+    set_destroy( set );
+    fclose( file );
+}
+END_TEST
+
+TEST( serialize_large_record )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    // a record over SERIAL_CHUNK_SIZE gets a chunk of its own,
+    // the ones after it go back to chunks of at most SERIAL_CHUNK_SIZE bytes
+    static char large[ 100000 ];
+    memset( large, 'x', sizeof large );
+
+    Set *set = set_init();
+    assert( set != NULL );
+    assert( set_insert( set, large, sizeof large ) == SETINSERT_INSERTED );
+    for ( int i = 0; i < 20000; ++i )
+        assert( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED );
+
+    UNIT_TEST( set_save( set, file ) == RV_SUCCESS );
+    rewind( file );
+    Set *loaded = set_load( file, NULL );
+    UNIT_TEST( loaded != NULL );
+    if ( loaded != NULL )
+    {
+        UNIT_TEST( set_cmp( set, loaded ) == 0 );
+        UNIT_TEST( set_search( loaded, large, sizeof large ) );
+        set_destroy( loaded );
+    }
+
+    set_destroy( set );
+    fclose( file );
+}
+END_TEST
+
+TEST( serialize_dict )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    const enum DictEngine engines[] = { DICT_ENGINE_LINEAR, DICT_ENGINE_SWISS };
+    for ( size_t e = 0; e < countof( engines ); ++e )
+    {
+        Dictionary *dict = dict_init_with_engine( engines[ e ], NULL, 99 );
+        assert( dict != NULL );
+        for ( int i = 0; i < 3000; ++i )
+        {
+            const double val = i / 2.0;
+            assert( dict_insert( dict, &i, sizeof i, &val, sizeof val )
+                    == DICTINSERT_INSERTED );
+        }
+        const char key[]   = "key";
+        const char value[] = "a value longer than DICT_INLINE_SIZE";
+        assert( dict_insert( dict, key, sizeof key, value, sizeof value )
+                == DICTINSERT_INSERTED );
+
+        rewind( file );
+        UNIT_TEST( dict_save( dict, file ) == RV_SUCCESS );
+        rewind( file );
+        Dictionary *loaded = dict_load( file, NULL );
+        UNIT_TEST( loaded != NULL );
+        if ( loaded == NULL )
+        {
+            dict_destroy( dict );
+            continue;
+        }
+
+        UNIT_TEST( dict_size( loaded ) == dict_size( dict ) );
+        bool correct = true;
+        for ( int i = 0; i < 3000; ++i )
+        {
+            const double *val = dict_get_val( loaded, &i, sizeof i );
+            correct = correct && val != NULL && *val == i / 2.0;
+        }
+        UNIT_TEST( correct );
+        const char *got = dict_get_val( loaded, key, sizeof key );
+        UNIT_TEST( got != NULL && strcmp( got, value ) == 0 );
+
+        // still an ordinary dictionary
+        UNIT_TEST( dict_insert( loaded, key, sizeof key, "", 1 ) == DICTINSERT_WAS_IN );
+        UNIT_TEST( dict_remove( loaded, key, sizeof key ) == DICTREMOVE_REMOVED );
+
+        dict_destroy( loaded );
+        dict_destroy( dict );
+    }
+
+    fclose( file );
+}
+END_TEST
+
+TEST( serialize_stream )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    // a Dictionary written an entry at a time, without one in memory
+    SerialWriter *writer = serial_writer_open( file, SERIAL_DICT, 0, NULL, 0 );
+    assert( writer != NULL );
+    char key[ 32 ];
+    for ( int i = 0; i < 20000; ++i )
+    {
+        const int key_len = snprintf( key, sizeof key, "key %d", i );
+        assert( serial_write_entry( writer, key, key_len, &i, sizeof i ) == RV_SUCCESS );
+    }
+    UNIT_TEST( serial_write_item( writer, "item", 4 ) == RV_EXCEPTION );
+    UNIT_TEST( serial_writer_close( writer ) == RV_SUCCESS );
+
+    rewind( file );
+    SerialReader *reader = serial_reader_open( file );
+    assert( reader != NULL );
+    UNIT_TEST( serial_reader_kind( reader ) == SERIAL_DICT );
+    UNIT_TEST( serial_reader_count_hint( reader ) == 0 ); // unknown in advance
+
+    const void *k;
+    const void *v;
+    size_t key_size;
+    size_t val_size;
+    int n      = 0;
+    bool order = true;
+    int rv;
+    while ( ( rv = serial_read_entry( reader, &k, &key_size, &v, &val_size ) ) == 1 )
+    {
+        const int key_len = snprintf( key, sizeof key, "key %d", n );
+        order = order && key_size == ( size_t ) key_len && memcmp( k, key, key_size ) == 0
+             && val_size == sizeof n && memcmp( v, &n, sizeof n ) == 0;
+        ++n;
+    }
+    UNIT_TEST( rv == 0 && n == 20000 && order );
+    serial_reader_close( reader );
+
+    // which loads like a saved one
+    rewind( file );
+    Dictionary *dict = dict_load( file, NULL );
+    UNIT_TEST( dict != NULL );
+    if ( dict != NULL )
+    {
+        UNIT_TEST( dict_size( dict ) == 20000 );
+        const int *val = dict_get_val( dict, "key 1234", 8 );
+        UNIT_TEST( val != NULL && *val == 1234 );
+        dict_destroy( dict );
+    }
+    fclose( file );
+
+    // List items in batches
+    file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+    writer = serial_writer_open( file, SERIAL_LIST, sizeof( uint32_t ), NULL, 0 );
+    assert( writer != NULL );
+    uint32_t batch[ 1000 ];
+    for ( uint32_t i = 0; i < 50; ++i )
+    {
+        for ( uint32_t j = 0; j < countof( batch ); ++j )
+            batch[ j ] = i * countof( batch ) + j;
+        assert( serial_write_items( writer, batch, countof( batch ) ) == RV_SUCCESS );
+    }
+    UNIT_TEST( serial_write_item( writer, batch, 2 ) == RV_EXCEPTION );
+    UNIT_TEST( serial_writer_close( writer ) == RV_SUCCESS );
+
+    rewind( file );
+    List *ls = list_load( file );
+    UNIT_TEST( ls != NULL );
+    if ( ls != NULL )
+    {
+        bool correct = list_size( ls ) == 50 * countof( batch );
+        for ( uint32_t i = 0; correct && i < list_size( ls ); ++i )
+            correct = *( const uint32_t * ) list_see( ls, i ) == i;
+        UNIT_TEST( correct );
+        list_destroy( ls );
+    }
+    fclose( file );
+}
+END_TEST
+
+TEST( serialize_corrupt )
+{
+    FILE *file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+
+    Set *set = set_init();
+    assert( set != NULL );
+    for ( int i = 0; i < 100; ++i )
+        assert( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED );
+    assert( set_save( set, file ) == RV_SUCCESS );
+    set_destroy( set );
+
+    // a changed item => the checksum doesn't match
+    test_serialize_corrupt( file, 33 );
+    UNIT_TEST( set_load( file, NULL ) == NULL );
+    test_serialize_corrupt( file, 33 );
+    set = set_load( file, NULL );
+    UNIT_TEST( set != NULL && set_size( set ) == 100 );
+    if ( set != NULL )
+        set_destroy( set );
+
+    // a changed checksum
+    test_serialize_corrupt( file, 1 );
+    UNIT_TEST( set_load( file, NULL ) == NULL );
+    test_serialize_corrupt( file, 1 );
+
+    // not the right magic
+    fseek( file, 0, SEEK_SET );
+    fputc( 'X', file );
+    rewind( file );
+    UNIT_TEST( serial_reader_open( file ) == NULL );
+    fclose( file );
+
+    // a file cut short
+    file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+    List *ls = list_init_type( int );
+    assert( ls != NULL );
+    for ( int i = 0; i < 100; ++i )
+        assert( list_append( ls, &i ) == RV_SUCCESS );
+    assert( list_save( ls, file ) == RV_SUCCESS );
+    list_destroy( ls );
+
+    char buffer[ 1024 ];
+    rewind( file );
+    const size_t len = fread( buffer, 1, sizeof buffer, file );
+    fclose( file );
+
+    // an absurd number of items in the header isn't allocated up front
+    file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+    char huge_count[ 1024 ];
+    memcpy( huge_count, buffer, len );
+    memset( huge_count + 32, 0xFF, 7 ); // bytes 32..39: count (little endian)
+    fwrite( huge_count, 1, len, file );
+    rewind( file );
+    ls = list_load( file );
+    UNIT_TEST( ls != NULL && list_size( ls ) == 100 );
+    if ( ls != NULL )
+        list_destroy( ls );
+    fclose( file );
+
+    file = tmpfile();
+    assert_that( file != NULL, "tmpfile" );
+    fwrite( buffer, 1, len - 20, file );
+    rewind( file );
+    UNIT_TEST( list_load( file ) == NULL );
+    fclose( file );
+}
+END_TEST
+
+
+LibraryDefined void RUNALL_SERIALIZE( void )
+{
+    RUN_TEST( serialize_list );
+    RUN_TEST( serialize_queue );
+    RUN_TEST( serialize_set );
+    RUN_TEST( serialize_large_record );
+    RUN_TEST( serialize_dict );
+    RUN_TEST( serialize_stream );
+    RUN_TEST( serialize_corrupt );
+}
+
+#endif //CLIBS_TEST_SERIALIZE_H
@@ -5,6 +5,10 @@
 #include "../../src/headers/unit_tests.h"
 #include "../../src/structs/set.h"
 
+#include <string.h> /* memcpy */
+
+#include "../../src/headers/foreach.h" /* foreach_set (needs set.h first) */
+
 
 #define SET_DEFAULT_CAP 64
 
@@ -68,10 +72,406 @@ TEST( set_insert )
 END_TEST
 
 
+TEST( set_remove )
+{
+    Set *set = set_init();
+    assert_that( set != NULL, "init failed" );
+
+    for ( int i = 0; i < SET_DEFAULT_CAP * 4; ++i )
+        assert_that( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED, "insert" );
+
+    bool remove_odd = true;
+    for ( int i = 1; i < SET_DEFAULT_CAP * 4; i += 2 )
+        remove_odd = remove_odd && set_remove( set, &i, sizeof i ) == SETREMOVE_REMOVED;
+    UNIT_TEST( remove_odd );
+    UNIT_TEST( set_size( set ) == SET_DEFAULT_CAP * 2 );
+
+    bool search = true;
+    for ( int i = 0; i < SET_DEFAULT_CAP * 4; ++i )
+        search = search && set_search( set, &i, sizeof i ) == ( i % 2 == 0 );
+    UNIT_TEST( search );
+
+    int number = 1;
+    UNIT_TEST( set_remove( set, &number, sizeof number ) == SETREMOVE_NOT_FOUND );
+
+    // tombstones are reused
+    bool reinsert = true;
+    for ( int i = 1; i < SET_DEFAULT_CAP * 4; i += 2 )
+        reinsert = reinsert && set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED;
+    UNIT_TEST( reinsert );
+    UNIT_TEST( set_size( set ) == SET_DEFAULT_CAP * 4 );
+
+    // shrink down to nothing and grow back
+    bool remove_all = true;
+    for ( int i = 0; i < SET_DEFAULT_CAP * 4; ++i )
+        remove_all = remove_all && set_remove( set, &i, sizeof i ) == SETREMOVE_REMOVED;
+    UNIT_TEST( remove_all );
+    UNIT_TEST( set_size( set ) == 0 );
+
+    number = 0;
+    UNIT_TEST( !set_search( set, &number, sizeof number ) );
+    UNIT_TEST( set_insert( set, &number, sizeof number ) == SETINSERT_INSERTED );
+    UNIT_TEST( set_search( set, &number, sizeof number ) );
+
+    set_destroy( set );
+}
+END_TEST
+
+TEST( set_item_sizes )
+{
+    Set *set = set_init();
+    assert_that( set != NULL, "init failed" );
+
+    // items around `SET_INLINE_SIZE`, moved around by many resizes
+    byte item[ SET_INLINE_SIZE * 2 ];
+    for ( size_t len = 1; len <= sizeof item; ++len )
+        for ( int i = 0; i < SET_DEFAULT_CAP; ++i )
+        {
+            memset( item, i, sizeof item );
+            assert_that( set_insert( set, item, len ) == SETINSERT_INSERTED, "insert" );
+        }
+    UNIT_TEST( set_size( set ) == sizeof item * SET_DEFAULT_CAP );
+
+    bool search = true;
+    for ( size_t len = 1; len <= sizeof item; ++len )
+        for ( int i = 0; i < SET_DEFAULT_CAP; ++i )
+        {
+            memset( item, i, sizeof item );
+            search = search && set_search( set, item, len );
+        }
+    UNIT_TEST( search );
+
+    // `data` points to a valid copy, wherever it is stored
+    bool data = true;
+    foreach_set( entry, set )
+    {
+        const byte *bytes = entry.item->data;
+        for ( size_t i = 1; i < entry.item->size; ++i )
+            data = data && bytes[ i ] == bytes[ 0 ];
+    }
+    UNIT_TEST( data );
+
+    set_destroy( set );
+}
+END_TEST
+
+TEST( set_max_load )
+{
+    Set *set = set_init();
+    assert_that( set != NULL, "init failed" );
+
+    UNIT_TEST( set_set_max_load( set, 0 ) == RV_EXCEPTION );
+    UNIT_TEST( set_set_max_load( set, 1 ) == RV_EXCEPTION );
+
+    for ( int i = 0; i < SET_DEFAULT_CAP / 2; ++i )
+        assert_that( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED, "insert" );
+
+    UNIT_TEST( set_set_max_load( set, 0.25 ) == RV_SUCCESS );
+    UNIT_TEST( set_size( set ) == SET_DEFAULT_CAP / 2 );
+
+    bool search = true;
+    for ( int i = 0; i < SET_DEFAULT_CAP / 2; ++i )
+        search = search && set_search( set, &i, sizeof i );
+    UNIT_TEST( search );
+
+    UNIT_TEST( set_set_max_load( set, 0.9 ) == RV_SUCCESS );
+    for ( int i = 0; i < SET_DEFAULT_CAP * 4; ++i )
+        search = search && set_insert( set, &i, sizeof i ) >= 0;
+    UNIT_TEST( search );
+    UNIT_TEST( set_size( set ) == SET_DEFAULT_CAP * 4 );
+
+    // below 1 / SET_MIN_CAP, the smallest tables have no room at all
+    UNIT_TEST( set_set_max_load( set, 0.05 ) == RV_SUCCESS );
+    for ( int i = 0; i < SET_DEFAULT_CAP * 4; ++i )
+        search = search && set_remove( set, &i, sizeof i ) == SETREMOVE_REMOVED;
+    UNIT_TEST( search );
+    UNIT_TEST( set_size( set ) == 0 );
+
+    for ( int i = 0; i < 40; ++i )
+        search = search && set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED;
+    for ( int i = 0; i < 40; ++i )
+        search = search && set_remove( set, &i, sizeof i ) == SETREMOVE_REMOVED;
+    UNIT_TEST( search );
+    UNIT_TEST( set_insert( set, &( int ) { 1 }, sizeof( int ) ) == SETINSERT_INSERTED );
+    UNIT_TEST( set_size( set ) == 1 );
+
+    set_destroy( set );
+}
+END_TEST
+
+TEST( set_order )
+{
+    Set *set = set_init();
+    assert_that( set != NULL, "init failed" );
+
+    // descending, so that the order can't come from the hashes
+    const int count = SET_DEFAULT_CAP * 4;
+    for ( int i = count - 1; i >= 0; --i )
+        assert_that( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED, "insert" );
+    // the odd ones leave holes, which are skipped
+    for ( int i = 1; i < count; i += 2 )
+        assert_that( set_remove( set, &i, sizeof i ) == SETREMOVE_REMOVED, "remove" );
+
+    int expected = count - 2;
+    bool ordered = true;
+    foreach_set( entry, set )
+    {
+        int item;
+        memcpy( &item, entry.item->data, sizeof item );
+        ordered  = ordered && item == expected;
+        expected -= 2;
+    }
+    UNIT_TEST( ordered );
+    UNIT_TEST( expected == -2 );
+
+    // rebuilding the table keeps the order
+    UNIT_TEST( set_set_max_load( set, 0.5 ) == RV_SUCCESS );
+    const int last = count;
+    assert_that( set_insert( set, &last, sizeof last ) == SETINSERT_INSERTED, "insert" );
+
+    expected = count - 2;
+    int64_t prev = -1;
+    ordered      = true;
+    foreach_set( entry, set )
+    {
+        int item;
+        memcpy( &item, entry.item->data, sizeof item );
+        ordered = ordered && entry.index > prev
+               && item == ( expected < 0 ? last : expected );
+        prev    = entry.index;
+        expected -= 2;
+    }
+    UNIT_TEST( ordered );
+    UNIT_TEST( expected == -4 );
+
+    set_destroy( set );
+}
+END_TEST
+
+/** Multiples of `step` in [0, `end`), each padded to `len` bytes */
+Private Set *test_sets_multiples( const int step,
+                                  const int end,
+                                  const size_t len,
+                                  const uint64_t seed )
+{
+    Set *set = set_init_with_hash( 8, NULL, seed );
+    assert_that( set != NULL, "init failed" );
+
+    byte item[ 32 ] = { 0 };
+    for ( int i = 0; i < end; i += step )
+    {
+        memcpy( item, &i, sizeof i );
+        assert_that( set_insert( set, item, len ) == SETINSERT_INSERTED, "insert" );
+    }
+    return set;
+}
+
+/** The set holds exactly the numbers in [0, 300) for which `expected` is true */
+Private bool test_sets_holds( const Set *set,
+                             const size_t len,
+                             bool ( *expected )( int ) )
+{
+    bool holds  = true;
+    size_t size = 0;
+
+    byte item[ 32 ] = { 0 };
+    for ( int x = 0; x < 300; ++x )
+    {
+        memcpy( item, &x, sizeof x );
+        size += expected( x );
+        holds = holds && set_search( set, item, len ) == expected( x );
+    }
+    return holds && set_size( set ) == size;
+}
+
+// `a` = evens below 200, `b` = multiples of 3 below 300
+Private bool test_sets_in_a( const int x )
+{
+    return x % 2 == 0 && x < 200;
+}
+Private bool test_sets_in_union( const int x )
+{
+    return test_sets_in_a( x ) || x % 3 == 0;
+}
+Private bool test_sets_in_intersection( const int x )
+{
+    return test_sets_in_a( x ) && x % 3 == 0;
+}
+Private bool test_sets_in_a_minus_b( const int x )
+{
+    return test_sets_in_a( x ) && x % 3 != 0;
+}
+Private bool test_sets_in_b_minus_a( const int x )
+{
+    return x % 3 == 0 && !test_sets_in_a( x );
+}
+
+TEST( set_algebra )
+{
+    for ( size_t len = sizeof( int ); len <= 32; len += 32 - sizeof( int ) )
+        for ( uint64_t seed = 0; seed < 2; ++seed )
+        {
+            // `b` hashed differently in the second round
+            Set *a = test_sets_multiples( 2, 200, len, 0 );
+            Set *b = test_sets_multiples( 3, 300, len, seed );
+
+            for ( int swap = 0; swap < 2; ++swap )
+            {
+                const Set *first  = swap ? b : a;
+                const Set *second = swap ? a : b;
+
+                Set *result = NULL;
+                UNIT_TEST( set_union( first, second, &result ) == RV_SUCCESS );
+                UNIT_TEST( test_sets_holds( result, len, test_sets_in_union ) );
+                set_destroy( result );
+
+                result = NULL;
+                UNIT_TEST( set_intersection( first, second, &result ) == RV_SUCCESS );
+                UNIT_TEST( test_sets_holds( result, len, test_sets_in_intersection ) );
+                set_destroy( result );
+            }
+
+            Set *result = NULL;
+            UNIT_TEST( set_difference( a, b, &result ) == RV_SUCCESS );
+            UNIT_TEST( test_sets_holds( result, len, test_sets_in_a_minus_b ) );
+            set_destroy( result );
+
+            result = NULL;
+            UNIT_TEST( set_difference( b, a, &result ) == RV_SUCCESS );
+            UNIT_TEST( test_sets_holds( result, len, test_sets_in_b_minus_a ) );
+            set_destroy( result );
+
+            // in place, from the larger and from the smaller side
+            for ( int swap = 0; swap < 2; ++swap )
+            {
+                Set *set         = swap ? test_sets_multiples( 3, 300, len, seed )
+                                        : test_sets_multiples( 2, 200, len, 0 );
+                const Set *other = swap ? a : b;
+
+                UNIT_TEST( set_intersect( set, other ) == RV_SUCCESS );
+                UNIT_TEST( test_sets_holds( set, len, test_sets_in_intersection ) );
+                set_destroy( set );
+
+                set = swap ? test_sets_multiples( 3, 300, len, seed )
+                           : test_sets_multiples( 2, 200, len, 0 );
+                UNIT_TEST( set_subtract( set, other ) == RV_SUCCESS );
+                UNIT_TEST( test_sets_holds( set, len,
+                                            swap ? test_sets_in_b_minus_a
+                                                 : test_sets_in_a_minus_b ) );
+                set_destroy( set );
+
+                set = swap ? test_sets_multiples( 3, 300, len, seed )
+                           : test_sets_multiples( 2, 200, len, 0 );
+                UNIT_TEST( set_unionize( set, other ) == RV_SUCCESS );
+                UNIT_TEST( test_sets_holds( set, len, test_sets_in_union ) );
+                set_destroy( set );
+
+                set       = swap ? test_sets_multiples( 3, 300, len, seed )
+                                 : test_sets_multiples( 2, 200, len, 0 );
+                Set *from = swap ? test_sets_multiples( 2, 200, len, 0 )
+                                 : test_sets_multiples( 3, 300, len, seed );
+                UNIT_TEST( set_absorb( set, set ) == RV_EXCEPTION );
+                UNIT_TEST( set_absorb( set, from ) == RV_SUCCESS );
+                UNIT_TEST( test_sets_holds( set, len, test_sets_in_union ) );
+                set_destroy( set );
+            }
+
+            // with itself
+            UNIT_TEST( set_intersect( a, a ) == RV_SUCCESS );
+            UNIT_TEST( test_sets_holds( a, len, test_sets_in_a ) );
+            UNIT_TEST( set_subtract( a, a ) == RV_SUCCESS );
+            UNIT_TEST( set_size( a ) == 0 );
+
+            set_destroy( a );
+            set_destroy( b );
+        }
+}
+END_TEST
+
+
+/** Both sets hold the same items, in the same order */
+Private bool test_sets_same_order( const Set *set_1, const Set *set_2 )
+{
+    if ( set_size( set_1 ) != set_size( set_2 ) )
+        return false;
+
+    SetEnumeratedEntry entry_2 = set_get_next( set_2, -1 );
+    foreach_set( entry_1, set_1 )
+    {
+        const struct set_item *item_1 = entry_1.item;
+        const struct set_item *item_2 = entry_2.item;
+        if ( item_1->size != item_2->size
+             || memcmp( item_1->data, item_2->data, item_1->size ) != 0 )
+            return false;
+        entry_2 = set_get_next( set_2, entry_2.index );
+    }
+    return true;
+}
+
+/** Enough for `set_insert_many_parallel()` not to fall back to `set_insert_many()` */
+#define SET_TEST_MANY 200000
+
+TEST( set_insert_many )
+{
+    ThreadPool *pool = thread_pool_init( 3 );
+    assert_that( pool != NULL, "thread_pool_init failed" );
+
+    // below and above the inline size
+    static byte items[ SET_TEST_MANY ][ 24 ];
+    for ( size_t len = sizeof( int ); len <= 24; len += 24 - sizeof( int ) )
+    {
+        // three quarters distinct, in no particular order
+        for ( int i = 0; i < SET_TEST_MANY; ++i )
+        {
+            const int value = ( int ) ( ( i * 7919L ) % ( SET_TEST_MANY * 3 / 4 ) );
+            memset( items[ i ], 0, sizeof items[ i ] );
+            memcpy( items[ i ], &value, sizeof value );
+            // packed: item `i` at `i * len`, over items already read
+            memcpy( ( byte * ) items + i * len, items[ i ], len );
+        }
+
+        Set *one_by_one = set_init();
+        assert_that( one_by_one != NULL, "init failed" );
+        for ( size_t i = 0; i < SET_TEST_MANY; ++i )
+            assert_that( set_insert( one_by_one, ( byte * ) items + i * len, len ) >= 0,
+                         "insert" );
+        UNIT_TEST( set_size( one_by_one ) == SET_TEST_MANY * 3 / 4 );
+
+        Set *set = set_from_array( items, SET_TEST_MANY, len );
+        UNIT_TEST( set != NULL );
+        UNIT_TEST( test_sets_same_order( set, one_by_one ) );
+        set_destroy( set );
+
+        set = set_init();
+        assert_that( set != NULL, "init failed" );
+        UNIT_TEST( set_insert_many_parallel( set, items, SET_TEST_MANY, len, pool )
+                   == RV_SUCCESS );
+        UNIT_TEST( test_sets_same_order( set, one_by_one ) );
+
+        // not empty anymore: one by one, on the calling thread
+        UNIT_TEST( set_insert_many_parallel( set, items, SET_TEST_MANY, len, pool )
+                   == RV_SUCCESS );
+        UNIT_TEST( test_sets_same_order( set, one_by_one ) );
+
+        set_destroy( set );
+        set_destroy( one_by_one );
+    }
+
+    thread_pool_destroy( pool );
+}
+END_TEST
+
+
 LibraryDefined void RUNALL_SETS( void )
 {
     RUN_TEST( set_init );
     RUN_TEST( set_insert );
+    RUN_TEST( set_remove );
+    RUN_TEST( set_item_sizes );
+    RUN_TEST( set_max_load );
+    RUN_TEST( set_order );
+    RUN_TEST( set_algebra );
+    RUN_TEST( set_insert_many );
 }
 
 #endif
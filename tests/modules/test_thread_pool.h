@@ -0,0 +1,218 @@
+#ifndef TEST_THREAD_POOL_H
+#define TEST_THREAD_POOL_H
+
+#include "../../src/headers/assert_that.h"
+#include "../../src/headers/misc.h" /* countof */
+#include "../../src/headers/unit_tests.h"
+#include "../../src/thread_pool.h"
+
+#include <pthread.h>
+#include <stdint.h> /* uintptr_t */
+#include <stdlib.h> /* alloc */
+
+
+#define TPOOL_TEST_TASKS      2000
+#define TPOOL_TEST_THREADS    4
+#define TPOOL_TEST_SUBMITTERS 4
+#define TPOOL_TEST_FIB        18
+
+
+Private void *tpool_test_square( void *arg )
+{
+    const uintptr_t n = ( uintptr_t ) arg;
+    return ( void * ) ( n * n );
+}
+
+Private void *tpool_test_increment( void *counter )
+{
+    __atomic_fetch_add( ( size_t * ) counter, 1, __ATOMIC_RELAXED );
+    return NULL;
+}
+
+struct tpool_test_fib {
+    ThreadPool *pool;
+    uintptr_t n;
+};
+
+/** Every call but the leaves submits and waits on two tasks */
+Private void *tpool_test_fib( void *arg )
+{
+    const struct tpool_test_fib *fib = arg;
+    if ( fib->n < 2 )
+        return ( void * ) fib->n;
+
+    struct tpool_test_fib left  = { .pool = fib->pool, .n = fib->n - 1 };
+    struct tpool_test_fib right = { .pool = fib->pool, .n = fib->n - 2 };
+
+    ThreadPoolFuture *f_left  = thread_pool_submit( fib->pool, tpool_test_fib, &left );
+    ThreadPoolFuture *f_right = thread_pool_submit( fib->pool, tpool_test_fib, &right );
+    assert( f_left != NULL && f_right != NULL );
+
+    // in reverse, so that waiting on `f_right` runs `f_left` too
+    const uintptr_t r = ( uintptr_t ) thread_pool_future_wait( f_right );
+    const uintptr_t l = ( uintptr_t ) thread_pool_future_wait( f_left );
+    return ( void * ) ( l + r );
+}
+
+struct tpool_test_submitter {
+    ThreadPool *pool;
+    size_t *counter;
+};
+
+/** Submits `TPOOL_TEST_TASKS` increments of the counter and waits on them */
+Private void *tpool_test_submitter( void *arg )
+{
+    const struct tpool_test_submitter *submitter = arg;
+
+    ThreadPoolFuture **futures = malloc( TPOOL_TEST_TASKS * sizeof *futures );
+    assert( futures != NULL );
+    for ( size_t i = 0; i < TPOOL_TEST_TASKS; ++i )
+        assert( ( futures[ i ] = thread_pool_submit(
+                          submitter->pool, tpool_test_increment, submitter->counter ) )
+                != NULL );
+    for ( size_t i = 0; i < TPOOL_TEST_TASKS; ++i )
+        thread_pool_future_wait( futures[ i ] );
+
+    free( futures );
+    return NULL;
+}
+
+Private void tpool_test_mark( const size_t from, const size_t to, void *counts )
+{
+    for ( size_t i = from; i < to; ++i )
+        __atomic_fetch_add( ( int * ) counts + i, 1, __ATOMIC_RELAXED );
+}
+
+
+TEST( thread_pool_futures )
+{
+    ThreadPool *pool = thread_pool_init( TPOOL_TEST_THREADS );
+    assert_that( pool != NULL, "init failed" );
+    UNIT_TEST( thread_pool_size( pool ) == TPOOL_TEST_THREADS );
+
+    ThreadPoolFuture *futures[ TPOOL_TEST_TASKS ];
+    for ( uintptr_t i = 0; i < TPOOL_TEST_TASKS; ++i )
+        assert( ( futures[ i ] =
+                          thread_pool_submit( pool, tpool_test_square, ( void * ) i ) )
+                != NULL );
+
+    bool correct = true;
+    for ( uintptr_t i = 0; i < TPOOL_TEST_TASKS; ++i )
+    {
+        const uintptr_t result = ( uintptr_t ) thread_pool_future_wait( futures[ i ] );
+        correct                = correct && result == i * i;
+    }
+    UNIT_TEST( correct );
+
+    thread_pool_destroy( pool );
+}
+END_TEST
+
+TEST( thread_pool_nested )
+{
+    ThreadPool *pool = thread_pool_init( TPOOL_TEST_THREADS );
+    assert_that( pool != NULL, "init failed" );
+
+    // ~ 10^4 tasks, most of them submitted by workers (to their own deques)
+    struct tpool_test_fib root = { .pool = pool, .n = TPOOL_TEST_FIB };
+    ThreadPoolFuture *future   = thread_pool_submit( pool, tpool_test_fib, &root );
+    assert( future != NULL );
+    UNIT_TEST( ( uintptr_t ) thread_pool_future_wait( future ) == 2584 );
+
+    // a worker pushes more tasks than its deque initially holds
+    size_t counter                        = 0;
+    struct tpool_test_submitter submitter = { .pool = pool, .counter = &counter };
+    future = thread_pool_submit( pool, tpool_test_submitter, &submitter );
+    assert( future != NULL );
+    thread_pool_future_wait( future );
+    UNIT_TEST( counter == TPOOL_TEST_TASKS );
+
+    // one worker, which has to wait on tasks it is yet to run
+    ThreadPool *single = thread_pool_init( 1 );
+    assert_that( single != NULL, "init failed" );
+    root.pool = single;
+    future    = thread_pool_submit( single, tpool_test_fib, &root );
+    assert( future != NULL );
+    UNIT_TEST( ( uintptr_t ) thread_pool_future_wait( future ) == 2584 );
+
+    thread_pool_destroy( single );
+    thread_pool_destroy( pool );
+}
+END_TEST
+
+TEST( thread_pool_parallel_for )
+{
+    ThreadPool *pool = thread_pool_init( TPOOL_TEST_THREADS );
+    assert_that( pool != NULL, "init failed" );
+
+    static const size_t grains[] = { 0, 1, 7, 1000, 100000 };
+    for ( size_t g = 0; g < countof( grains ); ++g )
+    {
+        int *counts = calloc( 100000, sizeof( int ) );
+        assert( counts != NULL );
+        UNIT_TEST( thread_pool_parallel_for(
+                           pool, 10, 100000, grains[ g ], tpool_test_mark, counts )
+                   == RV_SUCCESS );
+
+        // every index exactly once
+        bool once = counts[ 9 ] == 0;
+        for ( size_t i = 10; i < 100000; ++i )
+            once = once && counts[ i ] == 1;
+        UNIT_TEST( once );
+        free( counts );
+    }
+
+    UNIT_TEST( thread_pool_parallel_for( pool, 5, 5, 0, tpool_test_mark, NULL )
+               == RV_SUCCESS );
+
+    thread_pool_destroy( pool );
+}
+END_TEST
+
+TEST( thread_pool_stress )
+{
+    ThreadPool *pool = thread_pool_init( TPOOL_TEST_THREADS );
+    assert_that( pool != NULL, "init failed" );
+
+    // several threads outside the pool submitting at once
+    size_t counter = 0;
+    pthread_t threads[ TPOOL_TEST_SUBMITTERS ];
+    struct tpool_test_submitter submitter = { .pool = pool, .counter = &counter };
+    for ( size_t i = 0; i < TPOOL_TEST_SUBMITTERS; ++i )
+        assert_that( pthread_create( threads + i, NULL, tpool_test_submitter, &submitter )
+                             == 0,
+                     "pthread_create" );
+    for ( size_t i = 0; i < TPOOL_TEST_SUBMITTERS; ++i )
+        pthread_join( threads[ i ], NULL );
+    UNIT_TEST( counter == TPOOL_TEST_SUBMITTERS * TPOOL_TEST_TASKS );
+
+    // graceful shutdown: the tasks still queued are run first
+    counter = 0;
+    ThreadPoolFuture *futures[ TPOOL_TEST_TASKS ];
+    for ( size_t i = 0; i < TPOOL_TEST_TASKS; ++i )
+        assert( ( futures[ i ] =
+                          thread_pool_submit( pool, tpool_test_increment, &counter ) )
+                != NULL );
+    thread_pool_destroy( pool );
+    UNIT_TEST( counter == TPOOL_TEST_TASKS );
+
+    bool done = true;
+    for ( size_t i = 0; i < TPOOL_TEST_TASKS; ++i )
+    {
+        done = done && thread_pool_future_is_done( futures[ i ] );
+        thread_pool_future_wait( futures[ i ] );
+    }
+    UNIT_TEST( done );
+}
+END_TEST
+
+
+LibraryDefined void RUNALL_THREAD_POOL( void )
+{
+    RUN_TEST( thread_pool_futures );
+    RUN_TEST( thread_pool_nested );
+    RUN_TEST( thread_pool_parallel_for );
+    RUN_TEST( thread_pool_stress );
+}
+
+#endif //TEST_THREAD_POOL_H
@@ -0,0 +1,21 @@
+/*
+ * The ConcurrentDict tests (tests/modules/test_concurrent_dict.h) on their own,
+ * built with ThreadSanitizer (see CMakeLists.txt) and repeated,
+ * so that races between the lock-free lookups and the writers get a chance to show up.
+ */
+
+#include "modules/test_concurrent_dict.h"
+
+
+#define STRESS_ROUNDS 10
+
+
+int main( void )
+{
+    SET_UNIT_TEST_VERBOSITY( UNIT_TESTS_YAP_FAILED );
+
+    for ( int i = 0; i < STRESS_ROUNDS; ++i )
+        RUNALL_CONCURRENT_DICT();
+
+    FINISH_TESTING();
+}
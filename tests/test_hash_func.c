@@ -2,58 +2,291 @@
 // Created by MacBook on 30.12.2024.
 //
 
+/*
+ * Quality and throughput of the hash functions in `hash.h`:
+ *  - all implementations (scalar, SSE2, AVX2) agree
+ *  - avalanche: flipping any input bit flips each output bit with p ~ 0.5
+ *  - small sequential keys spread evenly over power-of-two tables
+ *  - GB/s by key length
+ */
+
 #include "../src/headers/assert_that.h" /* assert_that(), include errors.h */
-#include "../src/headers/misc.h"        /* hash_func() */
-#include "../src/structs/set.h"         /* Set */
+#include "../src/headers/hash.h"        /* hash_bytes() */
+#include "../src/headers/misc.h"        /* countof */
+#include "../src/headers/simple_math.h" /* min_m */
+#include "../src/headers/unit_tests.h"
+#include "../src/structs/set.h" /* Set */
 
-#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 
-#define try_one( TYPE, VALUE )                                         \
-    do                                                                 \
-    {                                                                  \
-        TYPE Variable = VALUE;                                         \
-        uint64_t Hash = hash_func( &Variable, sizeof( TYPE ) );        \
-        printf( "`%s`\t:= %s -> %" PRIu64 "\n", #TYPE, #VALUE, Hash ); \
-    }                                                                  \
-    while ( 0 )
+/** Largest allowed |P(output bit flips) - 0.5| for any (input bit, output bit) pair */
+#define AVALANCHE_MAX_BIAS 0.1
+#define AVALANCHE_SAMPLES  1000
+/** Only this many input bits are flipped for long keys */
+#define AVALANCHE_MAX_BITS 256
 
-int main( void )
+/** chi^2 / degrees of freedom must be below this */
+#define BUCKETS_MAX_CHI2_RATIO 1.25
+#define BUCKETS_LOG2           16
+#define BUCKETS_KEYS_PER       8
+
+
+/** xorshift64*; deterministic, so that failures are reproducible */
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t rng_next( void )
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void rng_fill( byte *buffer, const size_t len )
+{
+    for ( size_t i = 0; i < len; ++i )
+        buffer[ i ] = ( byte ) rng_next();
+}
+
+
+TEST( implementations_agree )
+{
+    static byte buffer[ 4096 + 1 ];
+    rng_fill( buffer, sizeof buffer );
+
+    bool agree = true;
+    for ( size_t len = 0; len <= 4096; len += ( len < 300 ? 1 : 61 ) )
+        for ( size_t offset = 0; offset < 2; ++offset ) // unaligned input as well
+        {
+            const uint64_t seed   = rng_next();
+            const byte *data      = buffer + offset;
+            const uint64_t scalar = hash_bytes_impl( data, len, seed, HASH_IMPL_SCALAR );
+
+            agree = agree && scalar == hash_bytes_impl( data, len, seed, HASH_IMPL_SSE2 )
+                    && scalar == hash_bytes_impl( data, len, seed, HASH_IMPL_AVX2 )
+                    && scalar == hash_bytes( data, len, seed );
+        }
+    UNIT_TEST( agree );
+
+    // hash_func is the default hash with the default seed
+    const uint64_t number = 123456789;
+    UNIT_TEST( hash_func( &number, sizeof number )
+               == hash_bytes( &number, sizeof number, HASH_DEFAULT_SEED ) );
+}
+END_TEST
+
+
+/** @return the largest bias over all (input bit, output bit) pairs */
+static double avalanche_max_bias( const size_t len, const uint64_t seed )
+{
+    static byte buffer[ 1024 ];
+    static unsigned flips[ AVALANCHE_MAX_BITS ][ 64 ];
+    assert_that( len <= sizeof buffer, "key too long" );
+
+    const size_t n_bits = min_m( len * 8, ( size_t ) AVALANCHE_MAX_BITS );
+    memset( flips, 0, sizeof flips );
+
+    for ( size_t s = 0; s < AVALANCHE_SAMPLES; ++s )
+    {
+        rng_fill( buffer, len );
+        const uint64_t orig = hash_bytes( buffer, len, seed );
+
+        for ( size_t bit = 0; bit < n_bits; ++bit )
+        {
+            // spread the tested bits over the whole key
+            const size_t input_bit = bit * ( len * 8 ) / n_bits;
+
+            buffer[ input_bit / 8 ] ^= ( byte ) ( 1 << ( input_bit % 8 ) );
+            const uint64_t diff = orig ^ hash_bytes( buffer, len, seed );
+            buffer[ input_bit / 8 ] ^= ( byte ) ( 1 << ( input_bit % 8 ) );
+
+            for ( size_t out = 0; out < 64; ++out )
+                flips[ bit ][ out ] += ( diff >> out ) & 1;
+        }
+    }
+
+    double max_bias = 0;
+    for ( size_t bit = 0; bit < n_bits; ++bit )
+        for ( size_t out = 0; out < 64; ++out )
+        {
+            const double p    = ( double ) flips[ bit ][ out ] / AVALANCHE_SAMPLES;
+            const double bias = fabs( p - 0.5 );
+            if ( bias > max_bias )
+                max_bias = bias;
+        }
+
+    return max_bias;
+}
+
+TEST( avalanche )
+{
+    // (a single byte has too few distinct values for a meaningful sample)
+    static const size_t lengths[] = { 2,  3,  4,   8,   12,  16,  17,
+                                      33, 64, 100, 255, 256, 1000 };
+
+    for ( size_t i = 0; i < countof( lengths ); ++i )
+    {
+        const double bias = avalanche_max_bias( lengths[ i ], HASH_DEFAULT_SEED );
+        printf( "    key length %4zu: max bias %.4f\n", lengths[ i ], bias );
+        UNIT_TEST( bias < AVALANCHE_MAX_BIAS );
+    }
+
+    UNIT_TEST( avalanche_max_bias( 8, rng_next() ) < AVALANCHE_MAX_BIAS );
+}
+END_TEST
+
+
+/** chi^2 / (number of buckets - 1) of `n` keys created by `make_key` */
+static double bucket_chi2_ratio( void ( *make_key )( byte *, size_t *, uint64_t ) )
+{
+    static unsigned buckets[ 1 << BUCKETS_LOG2 ];
+    memset( buckets, 0, sizeof buckets );
+
+    const size_t n_buckets = countof( buckets );
+    const size_t n_keys    = n_buckets * BUCKETS_KEYS_PER;
+
+    byte key[ 64 ];
+    size_t key_len;
+    for ( uint64_t i = 0; i < n_keys; ++i )
+    {
+        make_key( key, &key_len, i );
+        // same as the `Set` -- only the low bits are used
+        ++buckets[ hash_bytes( key, key_len, HASH_DEFAULT_SEED ) & ( n_buckets - 1 ) ];
+    }
+
+    double chi2 = 0;
+    for ( size_t b = 0; b < n_buckets; ++b )
+    {
+        const double d = ( double ) buckets[ b ] - BUCKETS_KEYS_PER;
+        chi2 += d * d / BUCKETS_KEYS_PER;
+    }
+
+    return chi2 / ( double ) ( n_buckets - 1 );
+}
+
+static void key_int32( byte *key, size_t *len, const uint64_t i )
+{
+    const int32_t n = ( int32_t ) i;
+    memcpy( key, &n, *len = sizeof n );
+}
+
+static void key_int64_stride( byte *key, size_t *len, const uint64_t i )
+{
+    const uint64_t n = i << BUCKETS_LOG2; // low bits are all zero
+    memcpy( key, &n, *len = sizeof n );
+}
+
+static void key_string( byte *key, size_t *len, const uint64_t i )
+{
+    *len = ( size_t ) snprintf( ( char * ) key, 64, "user:%" PRIu64 ":session", i );
+}
+
+TEST( bucket_distribution )
 {
-    try_one( int64_t, 0 );
-    try_one( int32_t, 0 );
-    try_one( int16_t, 0 );
-    try_one( int8_t, 0 );
+    const double int32  = bucket_chi2_ratio( key_int32 );
+    const double stride = bucket_chi2_ratio( key_int64_stride );
+    const double string = bucket_chi2_ratio( key_string );
+
+    printf( "    chi^2/df: int32 %.3f, int64 (stride 2^%d) %.3f, string %.3f\n", int32,
+            BUCKETS_LOG2, stride, string );
+
+    UNIT_TEST( int32 < BUCKETS_MAX_CHI2_RATIO );
+    UNIT_TEST( stride < BUCKETS_MAX_CHI2_RATIO );
+    UNIT_TEST( string < BUCKETS_MAX_CHI2_RATIO );
+}
+END_TEST
 
-    try_one( size_t, SIZE_MAX );
 
-    try_one( char *, NULL );
+static uint64_t seeded_hash_calls = 0;
 
-    char *p;
-    try_one( void *, p = malloc( 1 ) );
-    printf( "%td\n", ( ptrdiff_t ) p );
+static uint64_t counting_hash( const void *data,
+                               const size_t nbytes,
+                               const uint64_t seed )
+{
+    ++seeded_hash_calls;
+    return hash_bytes( data, nbytes, seed );
+}
 
-    char buffer[ 128 ] = { 0 };
-    uint64_t Hash      = hash_func( buffer, sizeof buffer );
-    printf( "`%s`\t:= %s -> %" PRIu64 "\n", "char[128]", "{0}", Hash );
+TEST( seeds )
+{
+    const uint64_t number = 42;
+    UNIT_TEST( hash_bytes( &number, sizeof number, 1 )
+               != hash_bytes( &number, sizeof number, 2 ) );
+    UNIT_TEST( hash_random_seed() != hash_random_seed() );
 
-    for ( int i = 0; i < 128; ++i )
-        buffer[ i ] = ( char ) ( rand() % 0xFF ); // NOLINT(cert-msc50-cpp)
-    Hash = hash_func( buffer, 128 );
-    printf( "`%s`\t:= %s -> %" PRIu64 "\n", "char[128]", "rand() % 0xFF", Hash );
+    Set *set = set_init_with_hash( 0, counting_hash, hash_random_seed() );
+    CRITICAL_TEST( set != NULL );
 
-    Set *set = set_init();
-    if ( set == NULL )
-        err( -1, "set_init" );
+    for ( uint64_t i = 0; i < 1000; ++i )
+        assert_that( set_insert( set, &i, sizeof i ) == SETINSERT_INSERTED, "insert" );
 
-    return_on_error( set_insert( set, &buffer, sizeof( char * ) ) );
-    return_on_error( set_insert( set, p, sizeof( char ) ) );
-    return_on_error( set_insert( set, &p, sizeof( char * ) ) );
+    bool search = true;
+    for ( uint64_t i = 0; i < 1000; ++i )
+        search = search && set_search( set, &i, sizeof i );
+    UNIT_TEST( search );
 
-    assert_that( set_search( set, &buffer, sizeof( char * ) ), "&buffer" );
-    assert_that( set_search( set, p, sizeof( char ) ), "p" );
-    assert_that( set_search( set, &p, sizeof( char * ) ), "&p" );
+    // resizing reuses the cached hashes
+    UNIT_TEST( seeded_hash_calls == 2000 );
 
     set_destroy( set );
 }
+END_TEST
+
+
+static double now_s( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( double ) ts.tv_sec + ( double ) ts.tv_nsec * 1e-9;
+}
+
+/** @return GB/s */
+static double throughput( const byte *data, const size_t len, const enum HashImpl impl )
+{
+    const size_t total = 1 << 26; // bytes hashed per measurement
+    const size_t reps  = total / len;
+
+    uint64_t sink     = 0;
+    const double start = now_s();
+    for ( size_t r = 0; r < reps; ++r )
+        sink += hash_bytes_impl( data, len, sink, impl );
+    const double elapsed = now_s() - start;
+
+    // keep `sink` alive
+    if ( sink == 42 )
+        printf( " " );
+
+    return ( double ) ( reps * len ) / elapsed / 1e9;
+}
+
+static void print_throughput( void )
+{
+    static const size_t lengths[] = { 4, 8, 16, 32, 64, 128, 256, 1024, 4096, 65536 };
+    static byte buffer[ 65536 ];
+    rng_fill( buffer, sizeof buffer );
+
+    printf( "\nThroughput (long inputs: %s)\n", hash_impl_name() );
+    printf( "%10s %12s %12s\n", "key len", "scalar GB/s", "auto GB/s" );
+    for ( size_t i = 0; i < countof( lengths ); ++i )
+        printf( "%10zu %12.2f %12.2f\n", lengths[ i ],
+                throughput( buffer, lengths[ i ], HASH_IMPL_SCALAR ),
+                throughput( buffer, lengths[ i ], HASH_IMPL_AUTO ) );
+    printf( "\n" );
+}
+
+
+int main( void )
+{
+    RUN_TEST( implementations_agree );
+    RUN_TEST( avalanche );
+    RUN_TEST( bucket_distribution );
+    RUN_TEST( seeds );
+
+    print_throughput();
+
+    FINISH_TESTING();
+}
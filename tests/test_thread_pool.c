@@ -0,0 +1,21 @@
+/*
+ * The thread pool tests (tests/modules/test_thread_pool.h) on their own,
+ * built with ThreadSanitizer (see CMakeLists.txt) and repeated,
+ * so that races in the pool get a chance to show up.
+ */
+
+#include "modules/test_thread_pool.h"
+
+
+#define STRESS_ROUNDS 10
+
+
+int main( void )
+{
+    SET_UNIT_TEST_VERBOSITY( UNIT_TESTS_YAP_FAILED );
+
+    for ( int i = 0; i < STRESS_ROUNDS; ++i )
+        RUNALL_THREAD_POOL();
+
+    FINISH_TESTING();
+}
@@ -2,7 +2,10 @@
 // Created by MacBook on 06.01.2025.
 //
 
+#include "modules/test_allocator.h"
 #include "modules/test_array_sprintf.h"
+#include "modules/test_concurrent_dict.h"
+#include "modules/test_concurrent_queue.h"
 #include "modules/test_dict.h"
 #include "modules/test_dynstr.h"
 #include "modules/test_filenames.h"
@@ -11,10 +14,12 @@
 #include "modules/test_math.h"
 #include "modules/test_misc_c.h"
 #include "modules/test_queue.h"
+#include "modules/test_serialize.h"
 #include "modules/test_sets.h"
 #include "modules/test_string_utils.h"
 #include "modules/test_struct_conversions.h"
 #include "modules/test_swex.h"
+#include "modules/test_thread_pool.h"
 
 
 int main( void )
@@ -28,6 +33,11 @@ int main( void )
     RUNALL_DICT();
     RUNALL_SETS();
     RUNALL_QUEUE();
+    RUNALL_CONCURRENT_QUEUE();
+    RUNALL_CONCURRENT_DICT();
+    RUNALL_THREAD_POOL();
+    RUNALL_ALLOCATOR();
+    RUNALL_SERIALIZE();
 
     RUNALL_STRUCT_CONVERSIONS();
 